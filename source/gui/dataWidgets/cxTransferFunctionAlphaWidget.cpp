@@ -35,7 +35,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <limits.h>
 #include <vtkImageData.h>
 #include <vtkPointData.h>
-#include <vtkImageAccumulate.h>
 #include <QPainter>
 #include <QPen>
 #include <QColor>
@@ -49,6 +48,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "vtkDataArray.h"
 #include "cxReporter.h"
 #include "cxMathUtils.h"
+#include "cxImageStatistics.h"
 
 
 namespace cx
@@ -286,20 +286,35 @@ void TransferFunctionAlphaWidget::paintHistogram(QPainter& painter)
 	// Draw histogram
 	// with log compression
 
-	vtkImageAccumulatePtr histogram = mImage->getHistogram();
-	int histogramSize = histogram->GetComponentExtent()[1] -
-						histogram->GetComponentExtent()[0];
+	ImageStatisticsPtr statistics = mImage->getStatistics();
+	const std::vector<qint64>& histogram = statistics->getHistogram();
+	double origin = statistics->getHistogramOrigin();
+	double binWidth = statistics->getHistogramBinWidth();
+	if (histogram.empty() || (mImage->getRange() <= 0))
+		return;
+
+	// Ignore zero, required for Sonowand CT volumes, where data are placed between 31K and 35K.
+	int zeroBin = static_cast<int>(floor((0 - origin) / binWidth));
+
+	qint64 binWithMostElements = 0;
+	for (unsigned i = 0; i < histogram.size(); ++i)
+		if (int(i) != zeroBin)
+			binWithMostElements = std::max(binWithMostElements, histogram[i]);
 
 	painter.setPen(QColor(140, 140, 210));
 
-	double numElementsInBinWithMostElements = log(histogram->GetOutput()->GetPointData()->GetScalars()->GetRange()[1]+1);
+	double numElementsInBinWithMostElements = log(double(binWithMostElements)+1);
+	if (numElementsInBinWithMostElements <= 0)
+		return;
 	double barHeightMult = (this->height() - mBorder*2) / numElementsInBinWithMostElements;
 
-	double posMult = (this->width() - mBorder*2) / double(histogramSize);
-	for (int i = mImage->getMin(); i <= mImage->getMax(); i++)
+	double posMult = (this->width() - mBorder*2) / double(mImage->getRange());
+	for (unsigned i = 0; i < histogram.size(); ++i)
 	{
-	  int x = ((i- mImage->getMin()) * posMult); //Offset with min value
-	  int y = log(double(static_cast<int*>(histogram->GetOutput()->GetScalarPointer(i - mImage->getMin(), 0, 0))[0]+1)) * barHeightMult;
+	  if (int(i) == zeroBin)
+		continue;
+	  int x = ((origin + i*binWidth - mImage->getMin()) * posMult); //Offset with min value
+	  int y = log(double(histogram[i]+1)) * barHeightMult;
 	  if (y > 0)
 	  {
 		painter.drawLine(x + mBorder, height() - mBorder,
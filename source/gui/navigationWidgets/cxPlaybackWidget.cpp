@@ -37,6 +37,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QMouseEvent>
 #include <QLabel>
 #include "cxTrackingService.h"
+#include "cxTimedTransformStore.h"
 #include "cxHelperWidgets.h"
 #include "cxTime.h"
 #include "cxLogger.h"
@@ -190,31 +191,24 @@ QColor PlaybackWidget::generateRandomToolColor() const
 std::vector<TimelineEvent> PlaybackWidget::convertHistoryToEvents(ToolPtr tool)
 {
 	std::vector<TimelineEvent> retval;
-	TimedTransformMapPtr history = tool->getPositionHistory();
+	TimedTransformStorePtr history = tool->getPositionHistory();
 	if (!history || history->empty())
 		return retval;
 	double timeout = 200;
-	TimelineEvent currentEvent(tool->getName() + " visible", history->begin()->first);
+	// use the time spans from the position index: avoids loading the positions from file.
+	std::vector<std::pair<double, double> > spans = history->getTimeSpans(timeout);
+	TimelineEvent currentEvent(tool->getName() + " visible", spans.front().first);
 	currentEvent.mGroup = "tool";
 	currentEvent.mColor = this->generateRandomToolColor(); // QColor::fromHsv(110, 255, 192);
-//	std::cout << "first event start: " << currentEvent.mDescription << " " << currentEvent.mStartTime << " " << history->size() << std::endl;
 
-	for(TimedTransformMap::iterator iter=history->begin(); iter!=history->end(); ++iter)
+	for(unsigned i=0; i<spans.size(); ++i)
 	{
-		double current = iter->first;
-
-		if (current - currentEvent.mEndTime > timeout)
-		{
+		currentEvent.mStartTime = spans[i].first;
+		currentEvent.mEndTime = spans[i].second;
+		bool last = (i+1==spans.size());
+		if (!last || !similar(currentEvent.mEndTime - currentEvent.mStartTime, 0))
 			retval.push_back(currentEvent);
-			currentEvent.mStartTime = currentEvent.mEndTime = current;
-		}
-		else
-		{
-			currentEvent.mEndTime = current;
-		}
 	}
-	if (!similar(currentEvent.mEndTime - currentEvent.mStartTime, 0))
-		retval.push_back(currentEvent);
 
 	return retval;
 }
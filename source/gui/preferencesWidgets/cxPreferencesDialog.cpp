@@ -362,6 +362,7 @@ VideoTab::VideoTab(QWidget *parent) :
 	m24bitRadioButton = NULL;
 	m8bitRadioButton = NULL;
 	mCompressCheckBox = NULL;
+	mLiveReconstructionCheckBox = NULL;
 
 }
 
@@ -389,10 +390,15 @@ void VideoTab::init()
 	mCompressCheckBox->setChecked(settings()->value("Ultrasound/CompressAcquisition", true).toBool());
 	mCompressCheckBox->setToolTip("Store the US Acquisition data as compressed MHD");
 
+	mLiveReconstructionCheckBox = new QCheckBox("Live reconstruction");
+	mLiveReconstructionCheckBox->setChecked(settings()->value("Ultrasound/LiveReconstruction", false).toBool());
+	mLiveReconstructionCheckBox->setToolTip("Reconstruct the active stream during US Acquisition");
+
   toplayout->addSpacing(5);
   toplayout->addWidget(m24bitRadioButton);
   toplayout->addWidget(m8bitRadioButton);
   toplayout->addWidget(mCompressCheckBox);
+  toplayout->addWidget(mLiveReconstructionCheckBox);
 
   mTopLayout->addLayout(toplayout);
 
@@ -403,6 +409,7 @@ void VideoTab::saveParametersSlot()
   settings()->setValue("Ultrasound/acquisitionName", mAcquisitionNameLineEdit->text());
   settings()->setValue("Ultrasound/8bitAcquisitionData", m8bitRadioButton->isChecked());
   settings()->setValue("Ultrasound/CompressAcquisition", mCompressCheckBox->isChecked());
+  settings()->setValue("Ultrasound/LiveReconstruction", mLiveReconstructionCheckBox->isChecked());
 }
 
 //==============================================================================
@@ -594,6 +601,7 @@ DebugTab::DebugTab(QWidget *parent) :
 		mIGSTKDebugLoggingCheckBox(NULL),
 		mManualToolPhysicalPropertiesCheckBox(NULL),
 		mRenderSpeedLoggingCheckBox(NULL),
+		mRenderTimingOverlayCheckBox(NULL),
 		mMainLayout(NULL)
 {
 	this->setObjectName("preferences_debug_widget");
@@ -617,6 +625,10 @@ void DebugTab::init()
 	mRenderSpeedLoggingCheckBox->setChecked(settings()->value("renderSpeedLogging", true).toBool());
 	mRenderSpeedLoggingCheckBox->setToolTip("Dump render speed statistics to the console");
 
+	mRenderTimingOverlayCheckBox = new QCheckBox("Render Timing Overlay");
+	mRenderTimingOverlayCheckBox->setChecked(settings()->value("renderTimingOverlay").toBool());
+	mRenderTimingOverlayCheckBox->setToolTip("Show render time for each view and its slowest rep in the view");
+
 	//Layout
 	mMainLayout = new QGridLayout;
 	int i=0;
@@ -624,6 +636,7 @@ void DebugTab::init()
 	mMainLayout->addWidget(mManualToolPhysicalPropertiesCheckBox, i++, 0);
 	mMainLayout->addWidget(runDebugToolButton, i++, 0);
 	mMainLayout->addWidget(mRenderSpeedLoggingCheckBox, i++, 0);
+	mMainLayout->addWidget(mRenderTimingOverlayCheckBox, i++, 0);
 
 	mTopLayout->addLayout(mMainLayout);
 }
@@ -650,6 +663,7 @@ void DebugTab::saveParametersSlot()
 	settings()->setValue("IGSTKDebugLogging", mIGSTKDebugLoggingCheckBox->isChecked());
 	settings()->setValue("giveManualToolPhysicalProperties", mManualToolPhysicalPropertiesCheckBox->isChecked());
 	settings()->setValue("renderSpeedLogging", mRenderSpeedLoggingCheckBox->isChecked());
+	settings()->setValue("renderTimingOverlay", mRenderTimingOverlayCheckBox->isChecked());
 }
 
 }//namespace cx
@@ -179,6 +179,7 @@ protected:
   QRadioButton* m24bitRadioButton;
   QRadioButton* m8bitRadioButton;
   QCheckBox* mCompressCheckBox;
+  QCheckBox* mLiveReconstructionCheckBox;
 };
 
 /**
@@ -285,6 +286,7 @@ protected:
   QCheckBox* mIGSTKDebugLoggingCheckBox;
   QCheckBox* mManualToolPhysicalPropertiesCheckBox;
   QCheckBox* mRenderSpeedLoggingCheckBox;
+  QCheckBox* mRenderTimingOverlayCheckBox;
   QGridLayout *mMainLayout;
 };
 
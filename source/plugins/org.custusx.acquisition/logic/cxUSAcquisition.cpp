@@ -32,6 +32,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxUSAcquisition.h"
 
+#include <QTimer>
 #include "cxBoolProperty.h"
 
 #include "cxSettings.h"
@@ -46,6 +47,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxAcquisitionService.h"
 #include "cxUsReconstructionService.h"
 #include "cxVisServices.h"
+#include "cxLiveReconstruction.h"
+#include "cxSavingVideoRecorder.h"
+#include "cxLogger.h"
 
 
 namespace cx
@@ -54,9 +58,14 @@ namespace cx
 USAcquisition::USAcquisition(AcquisitionPtr base, QObject* parent) :
 	QObject(parent),
 	mBase(base),
+	mBacklogWarningReported(false),
 	mReady(true),
 	mInfoText("")
 {
+	mRecordStatusTimer = new QTimer(this);
+	mRecordStatusTimer->setInterval(500);
+	connect(mRecordStatusTimer, &QTimer::timeout, this, &USAcquisition::checkIfReadySlot);
+
 	mCore.reset(new USSavingRecorder());
 	connect(mCore.get(), SIGNAL(saveDataCompleted(QString)), this, SLOT(checkIfReadySlot()));
 	connect(mCore.get(), SIGNAL(saveDataCompleted(QString)), this, SIGNAL(saveDataCompleted(QString)));
@@ -137,6 +146,9 @@ void USAcquisition::checkIfReadySlot()
 			mWhatsMissing.append("<font color=red>Need to start streaming.</font><br>");
 	}
 
+	if (mRecordStatusTimer->isActive())
+		mWhatsMissing.append(this->getRecordStatusText());
+
 	int saving = mCore->getNumberOfSavingThreads();
 
 	if (saving!=0)
@@ -162,6 +174,33 @@ void USAcquisition::setReady(bool val, QString text)
 	emit readinessChanged();
 }
 
+/** Describe the frames recorded but not yet written to temporary storage.
+  * These are held in memory, warn if they are about to exceed the limit.
+  */
+QString USAcquisition::getRecordStatusText()
+{
+	VideoRecorderSaveStatistics stats = mCore->getRecordStatistics();
+	double maxBacklog = settings()->value("Ultrasound/MaxRecordBacklog", 1000).toDouble() * 1024 * 1024;
+	double remaining = stats.getSecondsUntilBacklogReaches(maxBacklog);
+
+	QString text = QString("Writing %1 fps, %2 frames (%3 MB) waiting.")
+			.arg(stats.mWriteRate, 0, 'f', 0)
+			.arg(stats.mBacklogFrames)
+			.arg(stats.mBacklogBytes/1024/1024);
+
+	if (stats.mBacklogBytes >= maxBacklog)
+	{
+		if (!mBacklogWarningReported)
+			reportWarning(QString("Ultrasound recording exceeds %1 MB of unwritten frames, "
+								  "consider stopping the recording.").arg(maxBacklog/1024/1024));
+		mBacklogWarningReported = true;
+		return QString("<font color=red>%1 Memory limit exceeded!</font><br>").arg(text);
+	}
+	if ((remaining >= 0) && (remaining < 60))
+		return QString("<font color=orange>%1 Memory limit reached in %2 s.</font><br>").arg(text).arg(int(remaining));
+	return QString("%1<br>").arg(text);
+}
+
 int USAcquisition::getNumberOfSavingThreads() const
 {
 	return mCore->getNumberOfSavingThreads();
@@ -180,6 +219,22 @@ void USAcquisition::recordStarted()
 					   tool,
 					   this->getServices()->tracking()->getReferenceTool(),
 					   this->getRecordingVideoSources(tool));
+	mBacklogWarningReported = false;
+	mRecordStatusTimer->start();
+
+	if (settings()->value("Ultrasound/LiveReconstruction", false).toBool())
+		this->startLiveReconstruction(tool);
+}
+
+void USAcquisition::startLiveReconstruction(ToolPtr tool)
+{
+	VideoSourcePtr activeVideoSource = this->getServices()->video()->getActiveVideoSource();
+
+	mLiveReconstruction.reset(new LiveReconstruction(this->getServices()->patient(),
+													 this->getReconstructer()->createAlgorithm(),
+													 this->getReconstructer()->createCoreParameters()));
+	if (!mLiveReconstruction->start(tool, activeVideoSource))
+		mLiveReconstruction.reset();
 }
 
 void USAcquisition::recordStopped()
@@ -187,8 +242,12 @@ void USAcquisition::recordStopped()
 	if (!mBase->getCurrentContext().testFlag(AcquisitionService::tUS))
 		return;
 
+	mRecordStatusTimer->stop();
 	mCore->stopRecord();
 
+	if (mLiveReconstruction)
+		mLiveReconstruction->stop(); // completes in the background, kept until the next recording
+
 	this->sendAcquisitionDataToReconstructer();
 
 	mCore->set_rMpr(this->getServices()->patient()->get_rMpr());
@@ -203,7 +262,9 @@ void USAcquisition::recordStopped()
 
 void USAcquisition::recordCancelled()
 {
+	mRecordStatusTimer->stop();
 	mCore->cancelRecord();
+	mLiveReconstruction.reset(); // cancels and removes the preview
 }
 
 void USAcquisition::sendAcquisitionDataToReconstructer()
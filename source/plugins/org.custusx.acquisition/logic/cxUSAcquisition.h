@@ -38,6 +38,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxForwardDeclarations.h"
 #include "cxAcquisitionService.h"
 
+class QTimer;
+
 namespace cx
 {
 struct USReconstructInputData;
@@ -52,6 +54,7 @@ typedef boost::shared_ptr<class UsReconstructionService> UsReconstructionService
 typedef boost::shared_ptr<class VisServices> VisServicesPtr;
 typedef boost::shared_ptr<class UsReconstructionService> UsReconstructionServicePtr;
 typedef boost::shared_ptr<class VisServices> VisServicesPtr;
+typedef boost::shared_ptr<class LiveReconstruction> LiveReconstructionPtr;
 
 
 /**
@@ -72,6 +75,13 @@ typedef boost::shared_ptr<class VisServices> VisServicesPtr;
  * the reconstructer and saved to disk. saveDataCompleted() is
  * emitted after a successful save of each video stream.
  *
+ * If the setting Ultrasound/LiveReconstruction is on, the active
+ * stream is also reconstructed during acquisition.
+ *
+ * During recording, the info text shows the progress of writing frames
+ * to temporary storage, with a warning if the unwritten frames are about
+ * to exceed the setting Ultrasound/MaxRecordBacklog (MB).
+ *
  *  \date May 12, 2011
  *  \author christiana
  */
@@ -104,13 +114,18 @@ private:
 	std::vector<VideoSourcePtr> getRecordingVideoSources(ToolPtr tool);
 	bool getWriteColor();
 	void sendAcquisitionDataToReconstructer();
+	void startLiveReconstruction(ToolPtr tool);
 	void setReady(bool val, QString text);
+	QString getRecordStatusText();
 
 	VisServicesPtr getServices();
 	UsReconstructionServicePtr getReconstructer();
 
 	AcquisitionPtr mBase;
 	USSavingRecorderPtr mCore;
+	LiveReconstructionPtr mLiveReconstruction;
+	QTimer* mRecordStatusTimer;
+	bool mBacklogWarningReported;
 	bool mReady;
 	QString mInfoText;
 };
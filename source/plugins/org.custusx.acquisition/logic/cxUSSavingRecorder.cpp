@@ -147,7 +147,7 @@ USReconstructInputData USSavingRecorder::getDataForStream(unsigned videoRecorder
 	std::cout << "----------- "
 				 "trackerMetadata : " << trackerMetadata.size() << std::endl;
 
-	CachedImageDataContainerPtr imageData = videoRecorder->getImageData();
+	ImageDataContainerPtr imageData = videoRecorder->getImageData();
 	std::vector<TimeInfo> imageTimestamps = videoRecorder->getTimestamps();
 	QString streamSessionName = mSession->getDescription()+"_"+videoRecorder->getSource()->getUid();
 
@@ -194,6 +194,14 @@ size_t USSavingRecorder::getNumberOfSavingThreads() const
 	return mSaveThreads.size();
 }
 
+VideoRecorderSaveStatistics USSavingRecorder::getRecordStatistics() const
+{
+	VideoRecorderSaveStatistics retval;
+	for (unsigned i=0; i<mVideoRecorder.size(); ++i)
+		retval.add(mVideoRecorder[i]->getSaveStatistics());
+	return retval;
+}
+
 void USSavingRecorder::saveStreamSession(USReconstructInputData reconstructData, QString saveFolder, QString streamSessionName, bool compress)
 {
 	UsReconstructionFileMakerPtr fileMaker;
@@ -48,6 +48,7 @@ namespace cx
 typedef boost::shared_ptr<class UsReconstructionFileMaker> UsReconstructionFileMakerPtr;
 typedef boost::shared_ptr<class SavingVideoRecorder> SavingVideoRecorderPtr;
 typedef boost::shared_ptr<class RecordSession> RecordSessionPtr;
+struct VideoRecorderSaveStatistics;
 
 /**
  * \file
@@ -100,6 +101,10 @@ public:
 	  */
 	void startSaveData(QString baseFolder, bool compressImages);
 	size_t getNumberOfSavingThreads() const;
+	/** Return the progress of writing the recorded frames
+	  * to temporary storage, summed over all streams.
+	  */
+	VideoRecorderSaveStatistics getRecordStatistics() const;
 	void clearRecording();
 
 signals:
@@ -0,0 +1,280 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "cxCrossCorrelation.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <complex>
+#include <algorithm>
+
+namespace cx
+{
+
+namespace
+{
+typedef std::complex<double> Complex;
+
+int nextPowerOfTwo(int n)
+{
+	int retval = 1;
+	while (retval < n)
+		retval *= 2;
+	return retval;
+}
+
+/** In-place iterative radix-2 FFT. data.size() must be a power of two.
+ *  The inverse transform is not scaled.
+ */
+void fft(std::vector<Complex>& data, bool inverse)
+{
+	int n = data.size();
+
+	// bit reversal permutation
+	for (int i=1, j=0; i<n; ++i)
+	{
+		int bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+			std::swap(data[i], data[j]);
+	}
+
+	for (int len=2; len<=n; len <<= 1)
+	{
+		double angle = 2*M_PI/len * (inverse ? 1 : -1);
+		Complex wlen(cos(angle), sin(angle));
+		int half = len/2;
+		for (int i=0; i<n; i+=len)
+		{
+			Complex w(1);
+			for (int j=0; j<half; ++j)
+			{
+				Complex u = data[i+j];
+				Complex v = data[i+j+half] * w;
+				data[i+j] = u + v;
+				data[i+j+half] = u - v;
+				w *= wlen;
+			}
+		}
+	}
+}
+
+/** Compute c[d] = sum_i x[i]*y[i+d] for all d in (-n, n).
+ *  The result is stored circularly: d at c[d], -d at c[size-d].
+ */
+std::vector<double> crossCorrelateRaw(const std::vector<double>& x, const std::vector<double>& y)
+{
+	int n = std::max(x.size(), y.size());
+	int size = nextPowerOfTwo(2*n);
+
+	// pack both real series into one complex transform: z = x + iy
+	std::vector<Complex> z(size, Complex(0,0));
+	for (int i=0; i<n; ++i)
+	{
+		double re = (i < int(x.size())) ? x[i] : 0;
+		double im = (i < int(y.size())) ? y[i] : 0;
+		z[i] = Complex(re, im);
+	}
+	fft(z, false);
+
+	// unpack X and Y, multiply conj(X)*Y
+	std::vector<Complex> p(size);
+	for (int k=0; k<size; ++k)
+	{
+		Complex zk = z[k];
+		Complex zn = std::conj(z[(size-k)%size]);
+		Complex X = (zk + zn) * 0.5;
+		Complex Y = (zk - zn) * Complex(0, -0.5);
+		p[k] = std::conj(X)*Y;
+	}
+	fft(p, true);
+
+	std::vector<double> retval(size);
+	for (int i=0; i<size; ++i)
+		retval[i] = p[i].real()/size;
+	return retval;
+}
+
+} // namespace
+
+void correlate(const double* x, const double* y, double* corr, int maxdelay, int n)
+{
+	int i, j;
+	double mx, my, sx, sy, sxy, denom, r;
+	int delay;
+
+	/* Calculate the mean of the two series x[], y[] */
+	mx = 0;
+	my = 0;
+	for (i = 0; i < n; i++)
+	{
+		mx += x[i];
+		my += y[i];
+	}
+	mx /= n;
+	my /= n;
+
+	/* Calculate the denominator */
+	sx = 0;
+	sy = 0;
+	for (i = 0; i < n; i++)
+	{
+		sx += (x[i] - mx) * (x[i] - mx);
+		sy += (y[i] - my) * (y[i] - my);
+	}
+	denom = sqrt(sx * sy);
+
+	/* Calculate the correlation series */
+	for (delay = -maxdelay; delay < maxdelay; delay++)
+	{
+		sxy = 0;
+		for (i = 0; i < n; i++)
+		{
+			j = i + delay;
+			if (j < 0 || j >= n)
+				continue;
+			else
+				sxy += (x[i] - mx) * (y[j] - my);
+		}
+		r = sxy / denom;
+		corr[delay+maxdelay] = r;
+
+		/* r is the correlation coefficient at "delay" */
+	}
+}
+
+void correlateFFT(const double* x, const double* y, double* corr, int maxdelay, int n)
+{
+	double mx = 0;
+	double my = 0;
+	for (int i = 0; i < n; i++)
+	{
+		mx += x[i];
+		my += y[i];
+	}
+	mx /= n;
+	my /= n;
+
+	std::vector<double> xc(n);
+	std::vector<double> yc(n);
+	double sx = 0;
+	double sy = 0;
+	for (int i = 0; i < n; i++)
+	{
+		xc[i] = x[i] - mx;
+		yc[i] = y[i] - my;
+		sx += xc[i] * xc[i];
+		sy += yc[i] * yc[i];
+	}
+	double denom = sqrt(sx * sy);
+
+	std::vector<double> c = crossCorrelateRaw(xc, yc);
+	int size = c.size();
+
+	for (int delay = -maxdelay; delay < maxdelay; delay++)
+	{
+		double sxy = 0;
+		if (std::abs(delay) < n)
+			sxy = c[(delay+size)%size];
+		corr[delay+maxdelay] = sxy / denom;
+	}
+}
+
+double rmsDifference(const std::vector<double>& frames, const std::vector<double>& tracking, int shift)
+{
+	int r0 = std::max<int>(0, -shift);
+	int r1 = std::min<int>(frames.size(), int(tracking.size()) - shift);
+
+	double value = 0;
+	for (int i=r0; i<r1; ++i)
+	{
+		double core = pow(frames[i] - tracking[i+shift], 2.0);
+		value += core;
+	}
+	value /= (r1-r0);
+	value = sqrt(value);
+	return value;
+}
+
+std::vector<double> rmsDifferenceFFT(const std::vector<double>& frames, const std::vector<double>& tracking, int W)
+{
+	// sum (f_i - t_i+s)^2 = sum f_i^2 + sum t_i+s^2 - 2 sum f_i*t_i+s
+	// The squares are found from cumulative sums, the cross term from the correlation.
+	int F = frames.size();
+	int T = tracking.size();
+
+	std::vector<double> cumF(F+1, 0);
+	for (int i=0; i<F; ++i)
+		cumF[i+1] = cumF[i] + frames[i]*frames[i];
+	std::vector<double> cumT(T+1, 0);
+	for (int i=0; i<T; ++i)
+		cumT[i+1] = cumT[i] + tracking[i]*tracking[i];
+
+	std::vector<double> c = crossCorrelateRaw(frames, tracking);
+	int size = c.size();
+
+	std::vector<double> retval(2*W, 0);
+	for (int shift=-W; shift<W; ++shift)
+	{
+		int r0 = std::max<int>(0, -shift);
+		int r1 = std::min<int>(F, T - shift);
+		if (r1 <= r0)
+			continue;
+
+		double sumF = cumF[r1] - cumF[r0];
+		double sumT = cumT[r1+shift] - cumT[r0+shift];
+		double sumFT = c[(shift+size)%size];
+		double value = std::max(0.0, sumF + sumT - 2*sumFT);
+		retval[shift+W] = sqrt(value/(r1-r0));
+	}
+	return retval;
+}
+
+double findSubSamplePeak(const std::vector<double>& values, int index)
+{
+	if (index <= 0 || index+1 >= int(values.size()))
+		return index;
+
+	double a = values[index-1];
+	double b = values[index];
+	double c = values[index+1];
+	double denom = a - 2*b + c;
+	if (fabs(denom) < 1.0E-12)
+		return index;
+
+	double offset = 0.5 * (a - c) / denom;
+	offset = std::max(-0.5, std::min(0.5, offset));
+	return index + offset;
+}
+
+} // namespace cx
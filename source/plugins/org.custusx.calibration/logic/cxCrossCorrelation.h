@@ -0,0 +1,93 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#ifndef CXCROSSCORRELATION_H_
+#define CXCROSSCORRELATION_H_
+
+#include "org_custusx_calibration_Export.h"
+
+#include <vector>
+
+namespace cx
+{
+/**
+ * \file
+ * \addtogroup org_custusx_calibration
+ * @{
+ */
+
+/**
+ * Normalized cross correlation between the series x and y, both of size n.
+ *
+ * Straightforward O(n*maxdelay) implementation, found on
+ * http://paulbourke.net/miscellaneous/correlate/
+ * Slightly modified.
+ *
+ * corr: correlation result, size maxdelay*2 (zero shift is found at corr[maxdelay])
+ */
+org_custusx_calibration_EXPORT void correlate(const double* x, const double* y, double* corr, int maxdelay, int n);
+
+/**
+ * Same result as correlate(), but computed in O(n log n) using FFT.
+ */
+org_custusx_calibration_EXPORT void correlateFFT(const double* x, const double* y, double* corr, int maxdelay, int n);
+
+/**
+ * RMS of the difference between frames and tracking shifted by shift:
+ *   sqrt( mean( (frames[i] - tracking[i+shift])^2 ) )
+ * over the overlapping part of the series.
+ */
+org_custusx_calibration_EXPORT double rmsDifference(const std::vector<double>& frames, const std::vector<double>& tracking, int shift);
+
+/**
+ * Compute rmsDifference() for all shifts in [-W, W), using FFT.
+ * The result has size 2W, with shift=0 at index W.
+ *
+ * The overlap of the series must be nonempty for all shifts,
+ * i.e. W <= min(frames.size(), tracking.size()).
+ */
+org_custusx_calibration_EXPORT std::vector<double> rmsDifferenceFFT(const std::vector<double>& frames, const std::vector<double>& tracking, int W);
+
+/**
+ * Refine the position of the extremum values[index] by fitting a
+ * parabola through index and its two neighbours.
+ *
+ * Return the position in fractional index units, in the range [index-0.5, index+0.5].
+ * If index is on the border, or the neighbourhood is flat, return index.
+ */
+org_custusx_calibration_EXPORT double findSubSamplePeak(const std::vector<double>& values, int index);
+
+/**
+ * @}
+ */
+}
+
+#endif /* CXCROSSCORRELATION_H_ */
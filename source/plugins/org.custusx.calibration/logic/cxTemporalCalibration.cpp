@@ -44,16 +44,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxSettings.h"
 #include "cxUtilHelpers.h"
 #include "cxVolumeHelpers.h"
-#include "vtkImageCorrelation.h"
 #include "cxUSFrameData.h"
 #include "cxImage.h"
 #include "cxUsReconstructionFileReader.h"
 #include "cxLogger.h"
 #include "cxTime.h"
-#include <vtkImageMask.h>
-
-typedef vtkSmartPointer<vtkImageMask> vtkImageMaskPtr;
-typedef vtkSmartPointer<vtkImageCorrelation> vtkImageCorrelationPtr;
+#include "cxCrossCorrelation.h"
+#include <QThreadPool>
+#include <QtConcurrentRun>
 
 namespace cx
 {
@@ -62,69 +60,18 @@ typedef unsigned char uchar; // for removing eclipse warnings
 
 
 
-/**
- * Found this on
- * http://paulbourke.net/miscellaneous/correlate/
- * Slightly modified.
- *
- * x: first input series, size n
- * y: second input series, size n
- * corr: correlation result, size maxdelay*2 (zero shif is found at corr[maxdelay]
- */
-void correlate(double* x, double* y, double* corr, int maxdelay, int n)
-{
-  int i, j;
-  double mx, my, sx, sy, sxy, denom, r;
-  int delay;
-
-  /* Calculate the mean of the two series x[], y[] */
-  mx = 0;
-  my = 0;
-  for (i = 0; i < n; i++)
-  {
-    mx += x[i];
-    my += y[i];
-  }
-  mx /= n;
-  my /= n;
-
-  /* Calculate the denominator */
-  sx = 0;
-  sy = 0;
-  for (i = 0; i < n; i++)
-  {
-    sx += (x[i] - mx) * (x[i] - mx);
-    sy += (y[i] - my) * (y[i] - my);
-  }
-  denom = sqrt(sx * sy);
-
-  /* Calculate the correlation series */
-  for (delay = -maxdelay; delay < maxdelay; delay++)
-  {
-    sxy = 0;
-    for (i = 0; i < n; i++)
-    {
-      j = i + delay;
-      if (j < 0 || j >= n)
-        continue;
-      else
-        sxy += (x[i] - mx) * (y[j] - my);
-    }
-    r = sxy / denom;
-    corr[delay+maxdelay] = r;//(sxy/denom+1) * 128;
-
-    /* r is the correlation coefficient at "delay" */
-
-  }
-
-}
-
 TemporalCalibration::TemporalCalibration()
 {
 	mAddRawToDebug = false;
+	mSubSampleInterpolation = true;
 	mMask = vtkImageDataPtr();
 }
 
+void TemporalCalibration::setSubSampleInterpolation(bool on)
+{
+	mSubSampleInterpolation = on;
+}
+
 void TemporalCalibration::selectData(QString filename)
 {
   mFilename = filename;
@@ -261,29 +208,6 @@ bool TemporalCalibration::checkFrameMovementQuality(std::vector<double> pos)
 	return error < 0.2;
 }
 
-/** shift tracking data with the input shift, then compute RMS value of function
- *
- */
-double TemporalCalibration::findLeastSquares(std::vector<double> frames, std::vector<double> tracking, int shift) const
-{
-	size_t r0 = 0;
-	size_t r1 = frames.size();
-
-	r0 = std::max<int>(r0, - shift);
-	r1 = std::min<int>(r1, tracking.size() - shift);
-
-	double value = 0;
-
-	for (int i=r0; i<r1; ++i)
-	{
-		double core = pow(frames[i] - tracking[i+shift], 2.0);
-		value += core;
-	}
-	value /= (r1-r0);
-	value = sqrt(value);
-	return value;
-}
-
 /** Find the correlation shift between the regularly spaces series frames and tracking,
  *  with a spacing of resolution.
  *
@@ -294,17 +218,12 @@ double TemporalCalibration::findLSShift(std::vector<double> frames, std::vector<
 	double maxShift = 1000;
 	size_t N = std::min(tracking.size(), frames.size());
   N = std::min<int>(N, 2*maxShift/resolution); // constrain search to 1 second in each direction
-  std::vector<double> result(N, 0);
   int W = N/2;
-
-  for (int i=-W; i<W; ++i)
-  {
-  	double rms = this->findLeastSquares(frames, tracking, i);
-  	result[i+W] = rms;
-  }
+  std::vector<double> result = rmsDifferenceFFT(frames, tracking, W);
 
   int top = std::distance(result.begin(), std::min_element(result.begin(), result.end()));
-  double shift = (W-top) * resolution; // convert to shift in ms.
+  double refinedTop = mSubSampleInterpolation ? findSubSamplePeak(result, top) : top;
+  double shift = (W-refinedTop) * resolution; // convert to shift in ms.
 
   mDebugStream << "=======================================" << std::endl;
   mDebugStream << "tracking vs frames fit using least squares:" << std::endl;
@@ -316,13 +235,13 @@ double TemporalCalibration::findLSShift(std::vector<double> frames, std::vector<
 	for (size_t x = 0; x < std::min<int>(tracking.size(), frames.size()); ++x)
   {
     mDebugStream << frames[x] << "\t" << tracking[x];
-    if (x<N)
+    if (x<result.size())
     	mDebugStream << "\t" << result[x];
   	mDebugStream << std::endl;
   }
 
   mDebugStream << std::endl;
-  mDebugStream << "minimal index: " << top << ", = shift in ms: " << shift << std::endl;
+  mDebugStream << "minimal index: " << refinedTop << ", = shift in ms: " << shift << std::endl;
   mDebugStream << "=======================================" << std::endl;
 
   return shift; // shift frames-tracking: frame = tracking + shift
@@ -338,10 +257,11 @@ double TemporalCalibration::findCorrelationShift(std::vector<double> frames, std
 	size_t N = std::min(tracking.size(), frames.size());
   std::vector<double> result(N, 0);
 
-  correlate(&*frames.begin(), &*tracking.begin(), &*result.begin(), N / 2, N);
+  correlateFFT(&*frames.begin(), &*tracking.begin(), &*result.begin(), N / 2, N);
 
   int top = std::distance(result.begin(), std::max_element(result.begin(), result.end()));
-  double shift = (N/2-top) * resolution; // convert to shift in ms.
+  double refinedTop = mSubSampleInterpolation ? findSubSamplePeak(result, top) : top;
+  double shift = (N/2-refinedTop) * resolution; // convert to shift in ms.
 
   mDebugStream << "=======================================" << std::endl;
   mDebugStream << "tracking vs frames correlation:" << std::endl;
@@ -355,7 +275,7 @@ double TemporalCalibration::findCorrelationShift(std::vector<double> frames, std
   }
 
   mDebugStream << std::endl;
-  mDebugStream << "corr top: " << top << ", = shift in ms: " << shift << std::endl;
+  mDebugStream << "corr top: " << refinedTop << ", = shift in ms: " << shift << std::endl;
   mDebugStream << "=======================================" << std::endl;
 
   return shift; // shift frames-tracking: frame = tracking + shift
@@ -446,6 +366,9 @@ std::vector<double> TemporalCalibration::computeTrackingMovement()
 
 /** Calculate offset values from the first frame for all frames.
  *
+ * The correlation between each frame and the first frame is independent
+ * of the other frames, and is computed in parallel. The peak search uses
+ * the previous hit as a seed, and is done afterwards in frame order.
  */
 std::vector<double> TemporalCalibration::computeProbeMovement()
 {
@@ -454,14 +377,38 @@ std::vector<double> TemporalCalibration::computeProbeMovement()
   std::vector<double> retval;
 
   double maxSingleStep = 5; // assume max 5mm movement per frame
-//	double currentMaxShift;
   double lastVal = 0;
 
 	mMask = mFileData.getMask();
+	int line_index_x = mFileData.mProbeDefinition.mData.getOrigin_p()[0];
+	std::vector<double> reference = this->extractLine_y(line_index_x, 0);
+	std::vector<std::vector<double> > correlations(N_frames);
+
+	int numberOfThreads = std::max(1, std::min(QThread::idealThreadCount(), N_frames));
+	if (numberOfThreads <= 1)
+	{
+		this->correlateFrames(reference, line_index_x, 0, N_frames, &correlations);
+	}
+	else
+	{
+		int numberOfBlocks = std::min(4*numberOfThreads, N_frames);
+		QThreadPool pool;
+		pool.setMaxThreadCount(numberOfThreads);
+		std::vector<QFuture<void> > blocks;
+		for (int i = 0; i < numberOfBlocks; ++i)
+		{
+			int start = (i * N_frames) / numberOfBlocks;
+			int stop = ((i+1) * N_frames) / numberOfBlocks;
+			blocks.push_back(QtConcurrent::run(&pool, boost::bind(&TemporalCalibration::correlateFrames, this,
+																   boost::cref(reference), line_index_x, start, stop, &correlations)));
+		}
+		for (unsigned i = 0; i < blocks.size(); ++i)
+			blocks[i].waitForFinished();
+	}
+
   for (int i=0; i<N_frames; ++i)
   {
-    double val = this->findCorrelation(mFileData.mUsRaw, 0, i, maxSingleStep, lastVal);
-//    currentMaxShift =  fabs(val) + maxSingleStep;
+    double val = this->findCorrelation(correlations[i], maxSingleStep, lastVal);
     lastVal = val;
     retval.push_back(val);
   }
@@ -483,25 +430,34 @@ std::vector<double> TemporalCalibration::computeProbeMovement()
   return retval;
 }
 
-double TemporalCalibration::findCorrelation(USFrameDataPtr data, int frame_a, int frame_b, double maxShift, double lastVal)
+/** Correlate frames [start, stop) with the reference line,
+ *  store the result in correlations.
+ *
+ *  Thread-safe, as long as the ranges are disjoint.
+ */
+void TemporalCalibration::correlateFrames(const std::vector<double>& reference, int line_index_x, int start, int stop, std::vector<std::vector<double> >* correlations) const
 {
-	int maxShift_pix = maxShift / mFileData.mUsRaw->getSpacing()[1];
-	int lastVal_pix = lastVal / mFileData.mUsRaw->getSpacing()[1];
-
-	int line_index_x = mFileData.mProbeDefinition.mData.getOrigin_p()[0];
-
-  int dimY = mFileData.mUsRaw->getDimensions()[1];
+	int dimY = reference.size();
+	int N = 2*dimY; //result vector allocate space on both sides of zero
 
-	vtkImageDataPtr line1 = this->extractLine_y(mFileData.mUsRaw, line_index_x, frame_a);
-	vtkImageDataPtr line2 = this->extractLine_y(mFileData.mUsRaw, line_index_x, frame_b);
+	for (int frame=start; frame<stop; ++frame)
+	{
+		std::vector<double> line = this->extractLine_y(line_index_x, frame);
+		std::vector<double>& result = (*correlations)[frame];
+		result.assign(N, 0);
+		correlateFFT(&*reference.begin(), &*line.begin(), &*result.begin(), N/2, dimY);
+	}
+}
 
-  int N = 2*dimY; //result vector allocate space on both sides of zero
-  std::vector<double> result(N, 0);
-  double* line_a = static_cast<double*>(line1->GetScalarPointer());
-  double* line_b = static_cast<double*>(line2->GetScalarPointer());
-  double* line_c = &*result.begin();
+/** Find the shift of a frame from its correlation with the first frame.
+ *  Look for a maximum within maxShift of the last found hit.
+ */
+double TemporalCalibration::findCorrelation(const std::vector<double>& result, double maxShift, double lastVal) const
+{
+	int maxShift_pix = maxShift / mFileData.mUsRaw->getSpacing()[1];
+	int lastVal_pix = lastVal / mFileData.mUsRaw->getSpacing()[1];
 
-  correlate(line_a, line_b, line_c, N/2, dimY);
+  int N = result.size();
 
   // use the last found hit as a seed for looking for a local maximum
   int lastTop = N/2 - lastVal_pix;
@@ -511,48 +467,47 @@ double TemporalCalibration::findCorrelation(USFrameDataPtr data, int frame_a, in
 
   // look for a max in the vicinity of the last hit
   int top = std::distance(result.begin(), std::max_element(result.begin()+range.first, result.begin()+range.second));
+  double refinedTop = mSubSampleInterpolation ? findSubSamplePeak(result, top) : top;
 
-  double hit = (N/2-top) * mFileData.mUsRaw->getSpacing()[1]; // convert to downwards movement in mm.
+  double hit = (N/2-refinedTop) * mFileData.mUsRaw->getSpacing()[1]; // convert to downwards movement in mm.
 
   return hit;
 }
 
-/**extract the y-line with x-index line_index_x from frame ( data[line_index_x, y_varying, frame] )
+/**extract the y-line with x-index line_index_x from frame ( data[line_index_x, y_varying, frame] ),
+ * with the probe mask applied.
  *
+ * Thread-safe.
  */
-vtkImageDataPtr TemporalCalibration::extractLine_y(USFrameDataPtr data, int line_index_x, int frame)
+std::vector<double> TemporalCalibration::extractLine_y(int line_index_x, int frame) const
 {
-  int dimX = data->getDimensions()[0];
-  int dimY = data->getDimensions()[1];
+  int dimX = mFileData.mUsRaw->getDimensions()[0];
+  int dimY = mFileData.mUsRaw->getDimensions()[1];
 
-  vtkImageDataPtr retval = generateVtkImageDataDouble(Eigen::Array3i(dimY, 1, 1), Vector3D(1,1,1), 1);
+  std::vector<double> retval(dimY, 0);
 
   vtkImageDataPtr base = mProcessedFrames[frame];
+  uchar* source = static_cast<uchar*>(base->GetScalarPointer());
 
-  // run the base frame through the mask. Result is source.
-  vtkImageMaskPtr maskFilter = vtkImageMaskPtr::New();
-	maskFilter->SetMaskInputData(mMask);
-  maskFilter->SetImageInputData(base);
-  maskFilter->SetMaskedOutputValue(0.0);
-  maskFilter->Update();
-  uchar* source = static_cast<uchar*>(maskFilter->GetOutput()->GetScalarPointer());
-
-  double* dest = static_cast<double*>(retval->GetScalarPointer());
+  // run the base frame through the mask, masked values are set to zero.
+  uchar* mask = NULL;
+  if (mMask)
+  {
+	  int* maskDim = mMask->GetDimensions();
+	  if (maskDim[0]==dimX && maskDim[1]==dimY)
+		  mask = static_cast<uchar*>(mMask->GetScalarPointer());
+  }
 
   for (int y=0; y<dimY; ++y)
   {
-    dest[y] = source[y*dimX + line_index_x];
+    int index = y*dimX + line_index_x;
+    if (!mask || mask[index])
+      retval[y] = source[index];
   }
 
   return retval;
 }
 
-
-
-
-
-
-
 }//namespace cx
 
 
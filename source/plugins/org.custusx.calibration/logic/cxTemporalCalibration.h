@@ -60,6 +60,8 @@ typedef std::map<double,double> TimeSeriesType;
  * The shift sign is given from:
  *   frames = tracking + shift
  *
+ * The correlations are computed using FFT, see cxCrossCorrelation.h.
+ *
  */
 class org_custusx_calibration_EXPORT TemporalCalibration
 {
@@ -68,15 +70,19 @@ public:
   void selectData(QString filename);
   void setDebugFolder(QString path);
   double calibrate(bool* success);
+  /** Refine the correlation peaks to a fraction of a sample
+    * by parabolic interpolation. Default on.
+    */
+  void setSubSampleInterpolation(bool on);
 
 private:
-	vtkImageDataPtr extractLine_y(USFrameDataPtr data, int line_index_x, int frame);
-  double findCorrelation(USFrameDataPtr data, int frame_a, int frame_b, double maxShift, double lastVal);
+  std::vector<double> extractLine_y(int line_index_x, int frame) const;
+  void correlateFrames(const std::vector<double>& reference, int line_index_x, int start, int stop, std::vector<std::vector<double> >* correlations) const;
+  double findCorrelation(const std::vector<double>& correlation, double maxShift, double lastVal) const;
   std::vector<double> computeProbeMovement();
   std::vector<double> resample(std::vector<double> shift, std::vector<TimedPosition> time, double resolution);
   std::vector<double> computeTrackingMovement();
   double findCorrelationShift(std::vector<double> frames, std::vector<double> tracking, double resolution) const;
-  double findLeastSquares(std::vector<double> frames, std::vector<double> tracking, int shift) const;
   double findLSShift(std::vector<double> frames, std::vector<double> tracking, double resolution) const;
   bool checkFrameMovementQuality(std::vector<double> pos);
   void writePositions(QString title, std::vector<double> pos, std::vector<TimedPosition> time, double shift);
@@ -89,6 +95,7 @@ private:
   QString mFilename;
   mutable std::stringstream mDebugStream;
   bool mAddRawToDebug;
+  bool mSubSampleInterpolation;
 	vtkImageDataPtr mMask;
 
 };
@@ -34,12 +34,15 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxDataLocations.h"
 #include "cxTemporalCalibration.h"
+#include "cxCrossCorrelation.h"
+#include <cmath>
 
 TEST_CASE("TemporalCalibration reproduces old results on a test data set", "[unit][modules][calibration]")
 {
   cx::TemporalCalibration calibrator;
   QString filename = cx::DataLocations::getTestDataPath() + "/testing/20110511T092103_temporal_calib_mac.cx3/US_Acq/US-Acq_01_20110511T092317/US-Acq_01_20110511T092317.mhd";
   calibrator.selectData(filename);
+  calibrator.setSubSampleInterpolation(false);
   bool success = false;
   double shift = calibrator.calibrate(&success);
 
@@ -51,3 +54,69 @@ TEST_CASE("TemporalCalibration reproduces old results on a test data set", "[uni
 
 
 
+
+TEST_CASE("TemporalCalibration with sub-sample interpolation is close to old results", "[unit][modules][calibration]")
+{
+  cx::TemporalCalibration calibrator;
+  QString filename = cx::DataLocations::getTestDataPath() + "/testing/20110511T092103_temporal_calib_mac.cx3/US_Acq/US-Acq_01_20110511T092317/US-Acq_01_20110511T092317.mhd";
+  calibrator.selectData(filename);
+  bool success = false;
+  double shift = calibrator.calibrate(&success);
+
+  double testValue = 115; // shift found on data set during first tests.
+  double resolution = 5; // ms, resampling resolution used by the calibration
+
+  CHECK( success );
+  CHECK( cx::similar(shift, testValue, resolution));
+}
+
+namespace
+{
+std::vector<double> createSeries(int n, double phase, double scale, double offset)
+{
+	std::vector<double> retval(n);
+	for (int i=0; i<n; ++i)
+		retval[i] = offset + scale*sin(0.05*i+phase) + 0.1*scale*sin(0.37*i*i);
+	return retval;
+}
+}
+
+TEST_CASE("FFT correlation equals direct correlation", "[unit][modules][calibration]")
+{
+	int n = 317;
+	std::vector<double> x = createSeries(n, 0, 1, 0);
+	std::vector<double> y = createSeries(n, 0.4, 2, 3);
+
+	int maxdelay = n/2;
+	std::vector<double> reference(2*maxdelay);
+	std::vector<double> result(2*maxdelay);
+	cx::correlate(&*x.begin(), &*y.begin(), &*reference.begin(), maxdelay, n);
+	cx::correlateFFT(&*x.begin(), &*y.begin(), &*result.begin(), maxdelay, n);
+
+	for (unsigned i=0; i<reference.size(); ++i)
+		REQUIRE( cx::similar(result[i], reference[i], 1.0E-9) );
+}
+
+TEST_CASE("FFT least squares equals direct least squares", "[unit][modules][calibration]")
+{
+	std::vector<double> frames = createSeries(200, 0, 10, 50);
+	std::vector<double> tracking = createSeries(250, 0.7, 10, 50);
+
+	int W = 100;
+	std::vector<double> result = cx::rmsDifferenceFFT(frames, tracking, W);
+	REQUIRE( int(result.size()) == 2*W );
+
+	for (int shift=-W; shift<W; ++shift)
+		REQUIRE( cx::similar(result[shift+W], cx::rmsDifference(frames, tracking, shift), 1.0E-6) );
+}
+
+TEST_CASE("Sub-sample peak is found using parabolic interpolation", "[unit][modules][calibration]")
+{
+	std::vector<double> values(5);
+	for (unsigned i=0; i<values.size(); ++i)
+		values[i] = -pow(i-2.3, 2.0);
+
+	CHECK( cx::similar(cx::findSubSamplePeak(values, 2), 2.3) );
+	CHECK( cx::similar(cx::findSubSamplePeak(values, 0), 0) );
+	CHECK( cx::similar(cx::findSubSamplePeak(values, 4), 4) );
+}
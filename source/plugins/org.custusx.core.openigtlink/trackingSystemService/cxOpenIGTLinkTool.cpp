@@ -175,7 +175,7 @@ void OpenIGTLinkTool::toolTransformAndTimestampSlot(Transform3D prMs, double tim
         prMt_filtered = mTrackingPositionFilter->getFilteredPosition();
     }
 
-    (*mPositionHistory)[mTimestamp] = prMt; // store original in history
+    mPositionHistory->set(mTimestamp, prMt); // store original in history
     m_prMt = prMt_filtered;
     emit toolTransformAndTimestamp(m_prMt, mTimestamp);
 }
@@ -183,20 +183,16 @@ void OpenIGTLinkTool::toolTransformAndTimestampSlot(Transform3D prMs, double tim
 void OpenIGTLinkTool::calculateTpsSlot()
 {
     int tpsNr = 0;
-    size_t numberOfTransformsToCheck = ((mPositionHistory->size() >= 10) ? 10 : mPositionHistory->size());
+    TimedTransformRange recent = mPositionHistory->getLast(10);
+    size_t numberOfTransformsToCheck = recent.size();
     if (numberOfTransformsToCheck <= 1)
     {
         emit tps(0);
         return;
     }
 
-    TimedTransformMap::reverse_iterator rit = mPositionHistory->rbegin();
-    double lastTransform = rit->first;
-    for (int i = 0; i < numberOfTransformsToCheck-1; ++i)
-    {
-        ++rit;
-    }
-    double firstTransform = rit->first;
+    double lastTransform = recent.getTimestamp(numberOfTransformsToCheck-1);
+    double firstTransform = recent.getTimestamp(0);
     double secondsPassed = (lastTransform - firstTransform) / 1000;
 
     if (!similar(secondsPassed, 0))
@@ -114,6 +114,8 @@ DataFactoryPtr DataManagerImpl::getDataFactory()
 void DataManagerImpl::clear()
 {
 	mData.clear();
+	mBackgroundLoads = 0;
+	mCompletedBackgroundLoads = 0;
 	mCenter = Vector3D(0, 0, 0);
 	mLandmarkProperties.clear();
 
@@ -358,6 +360,10 @@ void DataManagerImpl::parseXml(QDomNode& dataManagerNode, QString rootPath)
 	// All images must be created from the DataManager, so the image nodes are parsed here
 	std::map<DataPtr, QDomNode> datanodes;
 
+	mBackgroundLoads = 0;
+	mCompletedBackgroundLoads = 0;
+	mBackgroundLoadTimer.start();
+
 	QDomNode child = dataManagerNode.firstChild();
 	for (; !child.isNull(); child = child.nextSibling())
 	{
@@ -376,6 +382,9 @@ void DataManagerImpl::parseXml(QDomNode& dataManagerNode, QString rootPath)
 		iter->first->parseXml(iter->second);
 	}
 
+	if (mBackgroundLoads)
+		report(QString("Loading %1 images in the background").arg(mBackgroundLoads));
+
 	emit dataAddedOrRemoved();
 
 	//we need to make sure all images are loaded before we try to set an active image
@@ -413,7 +422,9 @@ DataPtr DataManagerImpl::loadData(QDomElement node, QString rootPath)
 		reportWarning(QString("Unknown type: %1 for file %2").arg(type).arg(absolutePath));
 		return DataPtr();
 	}
-	bool loaded = data->load(absolutePath);
+	// Images are read in parallel, the voxels are completed on first use.
+	ImagePtr image = boost::dynamic_pointer_cast<Image>(data);
+	bool loaded = image ? image->loadInBackground(absolutePath) : data->load(absolutePath);
 
 	if (!loaded)
 	{
@@ -425,6 +436,12 @@ DataPtr DataManagerImpl::loadData(QDomElement node, QString rootPath)
 		data->setName(name);
 	data->setFilename(relativePath.path());
 
+	if (image && image->isLoadingInBackground())
+	{
+		++mBackgroundLoads;
+		connect(image.get(), &Image::backgroundLoadFinished, this, &DataManagerImpl::backgroundLoadFinishedSlot);
+	}
+
 	this->loadData(data);
 
 	// conversion for change in format 2013-10-29
@@ -438,6 +455,24 @@ DataPtr DataManagerImpl::loadData(QDomElement node, QString rootPath)
 	return data;
 }
 
+void DataManagerImpl::backgroundLoadFinishedSlot()
+{
+	Image* image = dynamic_cast<Image*>(this->sender());
+	if (!image || !mBackgroundLoads)
+		return;
+	disconnect(image, &Image::backgroundLoadFinished, this, &DataManagerImpl::backgroundLoadFinishedSlot);
+
+	++mCompletedBackgroundLoads;
+	report(QString("Loaded image %1 [%2/%3]")
+		   .arg(image->getName())
+		   .arg(mCompletedBackgroundLoads)
+		   .arg(mBackgroundLoads));
+	if (mCompletedBackgroundLoads == mBackgroundLoads)
+		report(QString("Loaded all %1 images in %2 s")
+			   .arg(mBackgroundLoads)
+			   .arg(double(mBackgroundLoadTimer.elapsed())/1000.0, 0, 'f', 1));
+}
+
 QDir DataManagerImpl::findRelativePath(QDomElement node, QString rootPath)
 {
 	QString path = this->findPath(node);
@@ -572,7 +607,10 @@ void DataManagerImpl::deleteFiles(DataPtr data, QString basePath)
 	{
 		files << QDir(basePath).absoluteFilePath(data->getFilename());
 		if (image)
+		{
 			files <<  changeExtension(files[0], "raw");
+			files << ImagePyramid::getCacheFiles(files[0]);
+		}
 	}
 
 	for (int i=0; i<files.size(); ++i)
@@ -46,6 +46,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxMesh.h"
 #include "cxDataManager.h"
 #include <QFileInfo>
+#include <QElapsedTimer>
 #include "boost/scoped_ptr.hpp"
 
 class QDomElement;
@@ -146,8 +147,13 @@ private:
 	QDir findRelativePath(QDomElement node, QString rootPath);
 	QString findPath(QDomElement node);
 	QString findAbsolutePath(QDir relativePath, QString rootPath);
+
+	int mBackgroundLoads; ///< number of images loading in the background since last parseXml
+	int mCompletedBackgroundLoads;
+	QElapsedTimer mBackgroundLoadTimer;
 private slots:
 	void settingsChangedSlot(QString key);
+	void backgroundLoadFinishedSlot();
 };
 
 } // namespace cx
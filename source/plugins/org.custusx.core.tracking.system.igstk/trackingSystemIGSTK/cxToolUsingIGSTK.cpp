@@ -243,7 +243,7 @@ void ToolUsingIGSTK::toolTransformAndTimestampSlot(Transform3D matrix, double ti
 
 	// Store positions in history, but only if visible - the history has no concept of visibility
 	if (this->getVisible())
-		(*mPositionHistory)[timestamp] = matrix;
+		mPositionHistory->set(timestamp, matrix);
 	m_prMt = prMt_filtered;
 	emit toolTransformAndTimestamp(m_prMt, timestamp);
 
@@ -254,18 +254,16 @@ void ToolUsingIGSTK::calculateTpsSlot()
 {
 	int tpsNr = 0;
 
-	int numberOfTransformsToCheck = ((mPositionHistory->size() >= 10) ? 10 : mPositionHistory->size());
+	TimedTransformRange recent = mPositionHistory->getLast(10);
+	int numberOfTransformsToCheck = recent.size();
 	if (	numberOfTransformsToCheck <= 1)
 	{
 		emit tps(0);
 		return;
 	}
 
-	TimedTransformMap::reverse_iterator it = mPositionHistory->rbegin();
-	double lastTransform = it->first;
-	for (int i = 0; i < numberOfTransformsToCheck; ++i)
-		++it;
-	double firstTransform = it->first;
+	double lastTransform = recent.getTimestamp(numberOfTransformsToCheck-1);
+	double firstTransform = recent.getTimestamp(0);
 	double secondsPassed = (lastTransform - firstTransform) / 1000;
 
 	if (!similar(secondsPassed, 0))
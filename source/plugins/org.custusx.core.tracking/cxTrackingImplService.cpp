@@ -36,6 +36,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "boost/bind.hpp"
 
+#include <limits>
 #include <QTimer>
 #include <QDir>
 #include <QList>
@@ -48,6 +49,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxLogger.h"
 #include "cxTypeConversions.h"
 #include "cxPositionStorageFile.h"
+#include "cxTimedTransformStore.h"
 #include "cxTime.h"
 #include "cxEnumConverter.h"
 #include "cxDummyTool.h"
@@ -371,15 +373,15 @@ void TrackingImplService::savePositionHistory()
 	for (; it != mTools.end(); ++it)
 	{
 		ToolPtr current = it->second;
-		TimedTransformMapPtr data = current->getPositionHistory();
+		TimedTransformStorePtr data = current->getPositionHistory();
 
 		if (!data)
 			continue;
 
 		// save only data acquired after mLastLoadPositionHistory:
-		TimedTransformMap::iterator iter = data->lower_bound(mLastLoadPositionHistory);
-		for (; iter != data->end(); ++iter)
-			writer.write(iter->second, (iter->first), current->getUid());
+		TimedTransformRange range = data->getRange(mLastLoadPositionHistory, std::numeric_limits<double>::max());
+		for (unsigned i=0; i<range.size(); ++i)
+			writer.write(range.getTransform(i), range.getTimestamp(i), current->getUid());
 	}
 
 	mLastLoadPositionHistory = getMilliSecondsSinceEpoch();
@@ -394,27 +396,21 @@ void TrackingImplService::loadPositionHistory()
 
 	QString filename = this->getLoggingFolder()+ "/toolpositions.snwpos";
 
-	PositionStorageReader reader(filename);
-
-	Transform3D matrix = Transform3D::Identity();
-	double timestamp;
-	QString toolUid;
+	// register the blocks of the file in the tools, positions are read when used.
+	std::vector<PositionStorageBlock> blocks = PositionStorageIndex::load(filename);
 
 	QStringList missingTools;
 
-	while (!reader.atEnd())
+	for (unsigned i=0; i<blocks.size(); ++i)
 	{
-		if (!reader.read(&matrix, &timestamp, &toolUid))
-			break;
-
-		ToolPtr current = this->getTool(toolUid);
-		if (current)
+		ToolPtr current = this->getTool(blocks[i].mToolUid);
+		if (current && current->getPositionHistory())
 		{
-			(*current->getPositionHistory())[timestamp] = matrix;
+			current->getPositionHistory()->addFileBlock(filename, blocks[i]);
 		}
 		else
 		{
-			missingTools << toolUid;
+			missingTools << blocks[i].mToolUid;
 		}
 	}
 
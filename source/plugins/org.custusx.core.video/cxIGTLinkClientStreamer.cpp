@@ -50,15 +50,27 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxTime.h"
 #include "cxSender.h"
 #include "vtkImageData.h"
+#include <QElapsedTimer>
+#include <algorithm>
 
 namespace cx
 {
 
+IGTLinkClientStreamerStatistics::IGTLinkClientStreamerStatistics() :
+	mImages(0),
+	mCopiedImages(0),
+	mMeanLatency(0),
+	mMaxLatency(0)
+{
+}
+
 IGTLinkClientStreamer::IGTLinkClientStreamer() :
 	mHeadingReceived(false),
 	mAddress(""),
-	mPort(0)
+	mPort(0),
+	mTotalLatency(0)
 {
+	mMessagePool = IGTLinkImageMessagePool::create();
 }
 
 IGTLinkClientStreamer::~IGTLinkClientStreamer()
@@ -146,6 +158,14 @@ bool IGTLinkClientStreamer::isStreaming()
 	return (mSocket && mSocket->isValid());
 }
 
+IGTLinkClientStreamerStatistics IGTLinkClientStreamer::getStatistics() const
+{
+	QMutexLocker sentry(&mStatisticsMutex);
+	IGTLinkClientStreamerStatistics retval = mStatistics;
+	retval.mMessages = mMessagePool->getStatistics();
+	return retval;
+}
+
 QString IGTLinkClientStreamer::hostDescription() const
 {
 	return mAddress + ":" + qstring_cast(mPort);
@@ -304,20 +324,19 @@ void write_time_info(igtl::ImageMessage::Pointer imgMsg)
 
 bool IGTLinkClientStreamer::ReceiveImage(QTcpSocket* socket, igtl::MessageHeader::Pointer& header)
 {
-	// Create a message buffer to receive transform data
-	igtl::ImageMessage::Pointer imgMsg = igtl::ImageMessage::New();
-	imgMsg->SetMessageHeader(header);
-	imgMsg->AllocatePack();
-
-	// Receive transform data from the socket
 	// ignore if not enough data (yet)
-	if (socket->bytesAvailable() < imgMsg->GetPackBodySize())
+	if (socket->bytesAvailable() < header->GetBodySizeToRead())
 	{
 		//std::cout << "Incomplete body received, ignoring. " << std::endl;
 		return false;
 	}
 
+	// Receive image data from the socket into a recycled message
+	igtl::ImageMessage::Pointer imgMsg = mMessagePool->acquire(header);
 	socket->read(reinterpret_cast<char*>(imgMsg->GetPackBodyPointer()), imgMsg->GetPackBodySize());
+	QElapsedTimer timer;
+	timer.start();
+
 	// Deserialize the transform data
 	// If you want to do a CRC check, call Unpack(1).
 	// If you want to skip CRC check, call Unpack() without argument.
@@ -327,21 +346,37 @@ bool IGTLinkClientStreamer::ReceiveImage(QTcpSocket* socket, igtl::MessageHeader
 
 	if (c & (igtl::MessageHeader::UNPACK_BODY | igtl::MessageHeader::UNPACK_UNDEF)) // if CRC check is OK or skipped
 	{
-		this->addToQueue(imgMsg);
+		bool copied = this->addToQueue(imgMsg);
+		this->updateStatistics(timer.nsecsElapsed()/1.0E6, copied);
 		return true;
 	}
 
+	mMessagePool->release(imgMsg);
 	std::cout << "body crc failed!" << std::endl;
 	return true;
 }
 
+void IGTLinkClientStreamer::updateStatistics(double latency, bool copied)
+{
+	QMutexLocker sentry(&mStatisticsMutex);
+	++mStatistics.mImages;
+	if (copied)
+		++mStatistics.mCopiedImages;
+	mTotalLatency += latency;
+	mStatistics.mMeanLatency = mTotalLatency / mStatistics.mImages;
+	mStatistics.mMaxLatency = std::max(mStatistics.mMaxLatency, latency);
+}
+
 void IGTLinkClientStreamer::addToQueue(IGTLinkUSStatusMessage::Pointer msg)
 {
 	// set temporary, then assume the image adder will pass this message on.
 	mUnsentUSStatusMessage = msg;
 }
 
-void IGTLinkClientStreamer::addToQueue(igtl::ImageMessage::Pointer msg)
+/** Decode and send the image.
+ * Return true if the image data was copied out of the message.
+ */
+bool IGTLinkClientStreamer::addToQueue(igtl::ImageMessage::Pointer msg)
 {
 	IGTLinkConversion converter;
 	IGTLinkConversionImage imageconverter;
@@ -349,16 +384,8 @@ void IGTLinkClientStreamer::addToQueue(igtl::ImageMessage::Pointer msg)
 
     PackagePtr package(new Package());
 
-    if (cxconverter.guessIsSonixLegacyFormat(msg->GetDeviceName()))
-    {
-        package->mImage = cxconverter.decode(msg);
-    }
-    else
-    {
-        package->mImage = imageconverter.decode(msg);
-    }
-
 	// if us status not sent, do it here
+	// (before decoding the image, as the message might be released by the decoding)
 	if (mUnsentUSStatusMessage)
 	{
         package->mProbe = converter.decode(mUnsentUSStatusMessage, msg, ProbeDefinitionPtr());
@@ -371,14 +398,27 @@ void IGTLinkClientStreamer::addToQueue(igtl::ImageMessage::Pointer msg)
         mUnsentUSStatusMessage = IGTLinkUSStatusMessage::Pointer();
 	}
 
+	bool copied = true;
+    if (cxconverter.guessIsSonixLegacyFormat(msg->GetDeviceName()))
+    {
+		// legacy images might refer to the message without keeping it alive: dont recycle.
+        package->mImage = cxconverter.decode(msg);
+    }
+    else
+    {
+		void* buffer = msg->GetScalarPointer();
+		package->mImage = imageconverter.decode(msg, mMessagePool);
+		copied = (package->mImage->getBaseVtkImageData()->GetScalarPointer() != buffer);
+    }
+
     //Should only be needed if time stamp is set on another computer that is
     //not synched with the one running this code: e.g. The Ultrasonix scanner
     mStreamSynchronizer.syncToCurrentTime(package->mImage);
 
 	mSender->send(package);
+	return copied;
 }
 
-
 } // namespace cx
 
 
@@ -35,19 +35,35 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxStreamer.h"
 #include "org_custusx_core_video_Export.h"
 #include <QAbstractSocket>
+#include <QMutex>
 #include "cxIGTLinkImageMessage.h"
 #include "cxIGTLinkUSStatusMessage.h"
 #include "cxStreamedTimestampSynchronizer.h"
+#include "cxIGTLinkImageMessagePool.h"
 
 class QTcpSocket;
 
 namespace cx
 {
 
+struct org_custusx_core_video_EXPORT IGTLinkClientStreamerStatistics
+{
+	IGTLinkClientStreamerStatistics();
+	IGTLinkImageMessagePoolStatistics mMessages; ///< message buffer allocations and reuse
+	int mImages; ///< number of received images
+	int mCopiedImages; ///< images where the image data was copied out of the message
+	double mMeanLatency; ///< mean time in ms from an image is received until it is sent
+	double mMaxLatency; ///< max time in ms from an image is received until it is sent
+};
+
 /**
  * Streamer that listens to an IGTLink connection, then
  * streams the incoming data.
  *
+ * Images are received into messages from a pool, and decoded
+ * without copying when possible. The messages are recycled when
+ * the images are deleted, thus a steady stream causes no allocations.
+ *
  * \addtogroup org_custusx_core_video
  * \author Christian Askeland, SINTEF
  * \date 2014-11-20
@@ -66,6 +82,7 @@ public:
 	virtual void stopStreaming();
 	virtual bool isStreaming();
 
+	IGTLinkClientStreamerStatistics getStatistics() const; ///< threadsafe
 
 private slots:
 	virtual void streamSlot() {}
@@ -85,7 +102,8 @@ private:
 	bool ReceiveSonixStatus(QTcpSocket* socket, igtl::MessageHeader::Pointer& header);
 	bool readOneMessage();
 	void addToQueue(IGTLinkUSStatusMessage::Pointer msg);
-	void addToQueue(igtl::ImageMessage::Pointer msg);
+	bool addToQueue(igtl::ImageMessage::Pointer msg);
+	void updateStatistics(double latency, bool copied);
 	bool multipleTryConnectToHost();
 	bool tryConnectToHost();
 
@@ -96,6 +114,11 @@ private:
     boost::shared_ptr<QTcpSocket> mSocket;
 	igtl::MessageHeader::Pointer mHeaderMsg;
 	IGTLinkUSStatusMessage::Pointer mUnsentUSStatusMessage; ///< received message, will be added to queue when next image arrives
+	IGTLinkImageMessagePoolPtr mMessagePool;
+
+	mutable QMutex mStatisticsMutex;
+	IGTLinkClientStreamerStatistics mStatistics;
+	double mTotalLatency;
 
 
 };
@@ -32,6 +32,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxImageReceiverThread.h"
 
+#include <set>
+
 #include "cxCyclicActionLogger.h"
 #include "cxXmlOptionItem.h"
 #include "cxStreamer.h"
@@ -45,8 +47,13 @@ namespace cx
 
 ImageReceiverThread::ImageReceiverThread(StreamerServicePtr streamerInterface, QObject* parent) :
 		QObject(parent),
+		mMutexedDefaultQueueCapacity(8),
+		mImageQueuesChanged(0),
+		mProducerImageQueuesVersion(0),
+		mImageReceivedPending(0),
 		mStreamerInterface(streamerInterface)
 {
+	qRegisterMetaType<ImageRingBufferStatistics>("ImageRingBufferStatistics");
 	this->setObjectName("imagereceiver worker");
 }
 
@@ -110,7 +117,8 @@ void ImageReceiverThread::addSonixStatusToQueueSlot()
 
 void ImageReceiverThread::addImageToQueue(ImagePtr imgMsg)
 {
-	this->reportFPS(imgMsg->getUid());
+	ImageRingBufferPtr queue = this->getImageQueue(imgMsg->getUid());
+	this->reportFPS(imgMsg->getUid(), queue);
 
 //	bool needToCalibrateMsgTimeStamp = this->imageComesFromSonix(imgMsg);
 
@@ -120,11 +128,87 @@ void ImageReceiverThread::addImageToQueue(ImagePtr imgMsg)
 //	if (needToCalibrateMsgTimeStamp)
 //        mStreamSynchronizer.syncToCurrentTime(imgMsg);
 
+	queue->push(imgMsg);
+
+	// coalesce wakeups: one signal is enough until the receiver has emptied the queues.
+	if (mImageReceivedPending.testAndSetOrdered(0, 1))
+		emit imageReceived(); // catch possibly in another thread
+}
+
+ImageRingBufferPtr ImageReceiverThread::getImageQueue(QString streamUid)
+{
+	int version = mImageQueuesChanged.loadAcquire();
+	if (version != mProducerImageQueuesVersion.load())
+	{
+		// from now on, retired queues are not pushed to.
+		mProducerImageQueues.clear();
+		mProducerImageQueuesVersion.storeRelease(version);
+	}
+
+	std::map<QString, ImageRingBufferPtr>::iterator iter = mProducerImageQueues.find(streamUid);
+	if (iter != mProducerImageQueues.end())
+		return iter->second;
+
+	// new stream or changed capacity: get the queue from the shared map
 	QMutexLocker sentry(&mImageMutex);
-	mMutexedImageMessageQueue.push_back(imgMsg);
-	sentry.unlock();
+	ImageRingBufferPtr queue = mMutexedImageQueues[streamUid];
+	if (!queue)
+	{
+		queue.reset(new ImageRingBuffer(this->getQueueCapacity(streamUid)));
+		mMutexedImageQueues[streamUid] = queue;
+	}
+	mProducerImageQueues[streamUid] = queue;
+	return queue;
+}
 
-	emit imageReceived(); // emit signal outside lock, catch possibly in another thread
+unsigned ImageReceiverThread::getQueueCapacity(QString streamUid) const
+{
+	std::map<QString, unsigned>::const_iterator iter = mMutexedQueueCapacities.find(streamUid);
+	if (iter != mMutexedQueueCapacities.end())
+		return iter->second;
+	return mMutexedDefaultQueueCapacity;
+}
+
+void ImageReceiverThread::setDefaultQueueCapacity(unsigned capacity)
+{
+	QMutexLocker sentry(&mImageMutex);
+	mMutexedDefaultQueueCapacity = capacity;
+
+	// queues are recreated with the new capacity on the next image
+	int version = mImageQueuesChanged.fetchAndAddOrdered(1) + 1;
+	std::map<QString, ImageRingBufferPtr>::iterator iter = mMutexedImageQueues.begin();
+	while (iter != mMutexedImageQueues.end())
+	{
+		QString streamUid = (iter++)->first;
+		if (mMutexedImageQueues[streamUid]->getCapacity() != this->getQueueCapacity(streamUid))
+			this->retireImageQueue(streamUid, version);
+	}
+}
+
+void ImageReceiverThread::setQueueCapacity(QString streamUid, unsigned capacity)
+{
+	QMutexLocker sentry(&mImageMutex);
+	mMutexedQueueCapacities[streamUid] = capacity;
+
+	// the queue is recreated with the new capacity on the next image
+	if (mMutexedImageQueues.count(streamUid) && mMutexedImageQueues[streamUid]->getCapacity()!=capacity)
+	{
+		int version = mImageQueuesChanged.fetchAndAddOrdered(1) + 1;
+		this->retireImageQueue(streamUid, version);
+	}
+}
+
+/** Move the queue out of mMutexedImageQueues. It is emptied by the consumer
+  * until the producer has switched to the new queue, thus no image is lost.
+  */
+void ImageReceiverThread::retireImageQueue(QString streamUid, int version)
+{
+	RetiredImageQueue retired;
+	retired.mStreamUid = streamUid;
+	retired.mQueue = mMutexedImageQueues[streamUid];
+	retired.mVersion = version;
+	mMutexedRetiredImageQueues.push_back(retired);
+	mMutexedImageQueues.erase(streamUid);
 }
 
 void ImageReceiverThread::addSonixStatusToQueue(ProbeDefinitionPtr msg)
@@ -135,14 +219,45 @@ void ImageReceiverThread::addSonixStatusToQueue(ProbeDefinitionPtr msg)
 	emit sonixStatusReceived(); // emit signal outside lock, catch possibly in another thread
 }
 
-ImagePtr ImageReceiverThread::getLastImageMessage()
+std::vector<ImagePtr> ImageReceiverThread::popImageMessages()
 {
-	QMutexLocker sentry(&mImageMutex);
-	if (mMutexedImageMessageQueue.empty())
-		return ImagePtr();
-	ImagePtr retval = mMutexedImageMessageQueue.front();
-	mMutexedImageMessageQueue.pop_front();
+	// reset before emptying the queues: images arriving from now on give a new signal.
+	mImageReceivedPending.storeRelease(0);
 
+	std::vector<ImageRingBufferPtr> queues;
+	{
+		QMutexLocker sentry(&mImageMutex);
+		// Empty retired queues first. While the producer may still push to a retired
+		// queue, leave the new queue for that stream, as its images are newer.
+		int producerVersion = mProducerImageQueuesVersion.loadAcquire();
+		std::set<QString> retiredStreams;
+		std::list<RetiredImageQueue>::iterator retired = mMutexedRetiredImageQueues.begin();
+		while (retired != mMutexedRetiredImageQueues.end())
+		{
+			queues.push_back(retired->mQueue);
+			if (producerVersion - retired->mVersion >= 0)
+			{
+				mMutexedRetiredImageQueues.erase(retired++); // emptied for the last time below
+			}
+			else
+			{
+				retiredStreams.insert(retired->mStreamUid);
+				++retired;
+			}
+		}
+
+		std::map<QString, ImageRingBufferPtr>::iterator iter;
+		for (iter=mMutexedImageQueues.begin(); iter!=mMutexedImageQueues.end(); ++iter)
+			if (!retiredStreams.count(iter->first))
+				queues.push_back(iter->second);
+	}
+
+	std::vector<ImagePtr> retval;
+	for (unsigned i=0; i<queues.size(); ++i)
+	{
+		for (ImagePtr image = queues[i]->pop(); image; image = queues[i]->pop())
+			retval.push_back(image);
+	}
 	return retval;
 }
 
@@ -156,7 +271,7 @@ ProbeDefinitionPtr ImageReceiverThread::getLastSonixStatusMessage()
 	return retval;
 }
 
-void ImageReceiverThread::reportFPS(QString streamUid)
+void ImageReceiverThread::reportFPS(QString streamUid, ImageRingBufferPtr queue)
 {
 	int timeout = 2000;
 	if (!mFPSTimer.count(streamUid))
@@ -170,7 +285,7 @@ void ImageReceiverThread::reportFPS(QString streamUid)
 	logger->begin();
 	if (logger->intervalPassed())
 	{
-		emit fps(streamUid, logger->getFPS());
+		emit fps(streamUid, logger->getFPS(), queue->takeStatistics());
 		logger->reset(timeout);
 	}
 }
@@ -39,11 +39,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include <vector>
+#include <list>
 #include "boost/shared_ptr.hpp"
 #include <QThread>
 #include <QMutex>
 #include <QDateTime>
+#include <QAtomicInt>
 #include "cxForwardDeclarations.h"
+#include "cxImageRingBuffer.h"
 //#include "cxStreamedTimestampSynchronizer.h"
 
 namespace cx
@@ -70,6 +73,11 @@ typedef boost::shared_ptr<class ImageReceiverThread> ImageReceiverThreadPtr;
  *  - Image : contains vtkImageData, timestamp, uid, all else is discarded.
  *  - ProbeDefinition : contains sector and image definition, temporal cal is discarded.
  *
+ * Images are queued in one ImageRingBuffer per stream, keeping only the
+ * newest frames if the receiver falls behind. imageReceived() is emitted
+ * once for any number of queued images, call popImageMessages() to get them all.
+ * Statistics for each queue are emitted along with fps().
+ *
  * \ingroup org_custusx_core_video
  * \date Oct 11, 2012
  * \author Christian Askeland, SINTEF
@@ -80,9 +88,11 @@ Q_OBJECT
 public:
 	ImageReceiverThread(StreamerServicePtr streamerInterface, QObject* parent = NULL);
 	virtual ~ImageReceiverThread() {}
-	virtual ImagePtr getLastImageMessage(); // threadsafe, Threadsafe retrieval of last image message.
+	virtual std::vector<ImagePtr> popImageMessages(); // threadsafe, retrieve all queued image messages, oldest first.
 	virtual ProbeDefinitionPtr getLastSonixStatusMessage(); // threadsafe,Threadsafe retrieval of last status message.
 	virtual QString hostDescription() const; // threadsafe
+	void setDefaultQueueCapacity(unsigned capacity); // threadsafe, max number of queued images for each stream.
+	void setQueueCapacity(QString streamUid, unsigned capacity); // threadsafe, override default for one stream.
 
 public slots:
 	void initialize(); // not threadsafe, call via postevent
@@ -91,7 +101,7 @@ public slots:
 signals:
 	void imageReceived();
 	void sonixStatusReceived();
-	void fps(QString, double);
+	void fps(QString, double, ImageRingBufferStatistics);
 	void finished(); // emitted when object has completed shutdown
 
 protected:
@@ -110,14 +120,33 @@ private slots:
 	void addSonixStatusToQueueSlot();
 
 private:
-	void reportFPS(QString streamUid);
+	void reportFPS(QString streamUid, ImageRingBufferPtr queue);
+	ImageRingBufferPtr getImageQueue(QString streamUid); // producer only
+	unsigned getQueueCapacity(QString streamUid) const; // call with mImageMutex locked
+	void retireImageQueue(QString streamUid, int version); // call with mImageMutex locked
 //	bool imageComesFromSonix(ImagePtr imgMsg);
 	bool attemptInitialize();
 
 	std::map<QString, cx::CyclicActionLoggerPtr> mFPSTimer;
-	QMutex mImageMutex;
+	mutable QMutex mImageMutex; ///< protects the queue map and capacities, not the queues themselves.
 	QMutex mSonixStatusMutex;
-	std::list<ImagePtr> mMutexedImageMessageQueue;
+	std::map<QString, ImageRingBufferPtr> mMutexedImageQueues;
+	/** A queue replaced in mMutexedImageQueues, which the producer may still push to
+	  * until it has seen mVersion.
+	  */
+	struct RetiredImageQueue
+	{
+		QString mStreamUid;
+		ImageRingBufferPtr mQueue;
+		int mVersion;
+	};
+	std::list<RetiredImageQueue> mMutexedRetiredImageQueues;
+	std::map<QString, unsigned> mMutexedQueueCapacities;
+	unsigned mMutexedDefaultQueueCapacity;
+	QAtomicInt mImageQueuesChanged; ///< incremented when mMutexedImageQueues changes
+	std::map<QString, ImageRingBufferPtr> mProducerImageQueues; ///< producer copy of mMutexedImageQueues
+	QAtomicInt mProducerImageQueuesVersion; ///< version of mProducerImageQueues, written by producer
+	QAtomicInt mImageReceivedPending; ///< nonzero if imageReceived() is emitted but not handled
 	std::list<ProbeDefinitionPtr> mMutexedSonixStatusMessageQueue;
 
 //    StreamedTimestampSynchronizer mStreamSynchronizer;
@@ -0,0 +1,152 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxImageRingBuffer.h"
+
+#include <algorithm>
+#include <QDateTime>
+
+namespace cx
+{
+
+ImageRingBuffer::ImageRingBuffer(unsigned capacity) :
+	mCapacity(std::max<unsigned>(capacity, 1)),
+	mSlots(new QAtomicPointer<Item>[std::max<unsigned>(capacity, 1)]),
+	mHead(0),
+	mTail(0),
+	mDropped(0),
+	mLatencySum(0),
+	mLatencyCount(0)
+{
+}
+
+ImageRingBuffer::~ImageRingBuffer()
+{
+	for (unsigned i=0; i<mCapacity; ++i)
+		delete mSlots[i].fetchAndStoreOrdered(NULL);
+}
+
+void ImageRingBuffer::push(ImagePtr image)
+{
+	Item* item = new Item;
+	item->mImage = image;
+	item->mPushTime = QDateTime::currentMSecsSinceEpoch();
+
+	unsigned head = mHead.load();
+	item->mIndex = head;
+	// If the slot still contains an image, it is the oldest one in the buffer: drop it.
+	Item* old = mSlots[head % mCapacity].fetchAndStoreOrdered(item);
+	if (old)
+	{
+		delete old;
+		mDropped.ref();
+	}
+	mHead.storeRelease(head+1);
+}
+
+ImagePtr ImageRingBuffer::pop()
+{
+	unsigned head = mHead.loadAcquire();
+	unsigned tail = mTail.load();
+
+	// skip slots overwritten by the producer
+	if (head - tail > mCapacity)
+		tail = head - mCapacity;
+
+	ImagePtr retval;
+	while (int(head - tail) > 0)
+	{
+		QAtomicPointer<Item>& slot = mSlots[tail % mCapacity];
+		Item* item = slot.fetchAndStoreOrdered(NULL);
+		if (!item)
+		{
+			++tail; // dropped by producer after we read head
+			continue;
+		}
+
+		int age = int(item->mIndex - tail);
+		if (age < 0)
+		{
+			// left behind when skipping overwritten slots
+			delete item;
+			mDropped.ref();
+			++tail;
+			continue;
+		}
+		if (age > 0)
+		{
+			// Overwritten by a newer image after we read head: images older than
+			// its index-capacity are gone. Put it back and continue from there.
+			unsigned index = item->mIndex;
+			if (!slot.testAndSetOrdered(NULL, item))
+			{
+				delete item; // overwritten again meanwhile
+				mDropped.ref();
+			}
+			tail = index - mCapacity + 1;
+			head = mHead.loadAcquire();
+			continue;
+		}
+
+		++tail;
+		retval = item->mImage;
+		mLatencySum.fetchAndAddRelaxed(int(QDateTime::currentMSecsSinceEpoch() - item->mPushTime));
+		mLatencyCount.ref();
+		delete item;
+		break;
+	}
+
+	mTail.storeRelease(tail);
+	return retval;
+}
+
+unsigned ImageRingBuffer::size() const
+{
+	unsigned head = mHead.loadAcquire();
+	unsigned tail = mTail.loadAcquire();
+	return std::min(head - tail, mCapacity);
+}
+
+ImageRingBufferStatistics ImageRingBuffer::takeStatistics()
+{
+	ImageRingBufferStatistics retval;
+	retval.mCapacity = mCapacity;
+	retval.mDepth = this->size();
+	retval.mDropped = mDropped.fetchAndStoreOrdered(0);
+	int count = mLatencyCount.fetchAndStoreOrdered(0);
+	int sum = mLatencySum.fetchAndStoreOrdered(0);
+	if (count)
+		retval.mLatency = double(sum)/count;
+	return retval;
+}
+
+} // namespace cx
@@ -0,0 +1,121 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXIMAGERINGBUFFER_H
+#define CXIMAGERINGBUFFER_H
+
+#include "org_custusx_core_video_Export.h"
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QMetaType>
+#include <boost/scoped_array.hpp>
+#include "cxForwardDeclarations.h"
+
+namespace cx
+{
+
+/**
+ * \file
+ * \addtogroup org_custusx_core_video
+ * @{
+ */
+
+/** Statistics for an ImageRingBuffer, collected between two calls
+ *  to ImageRingBuffer::takeStatistics().
+ */
+struct org_custusx_core_video_EXPORT ImageRingBufferStatistics
+{
+	ImageRingBufferStatistics() : mCapacity(0), mDepth(0), mDropped(0), mLatency(-1) {}
+	unsigned mCapacity;
+	unsigned mDepth; ///< frames waiting in the buffer
+	unsigned mDropped; ///< frames dropped because the buffer was full
+	double mLatency; ///< average time in ms from push to pop, negative if no frames were popped
+};
+
+/** \brief Fixed-capacity image queue between one producer and one consumer thread.
+ *
+ * When the buffer is full, the oldest image is dropped, i.e. the buffer
+ * keeps only the newest capacity images. This keeps memory use and latency
+ * bounded if the consumer stalls.
+ *
+ * Lock-free: push() and pop() only use atomic operations, thus the producer
+ * never waits for the consumer. push() must be called from one thread only,
+ * pop() from one (possibly other) thread only. The rest of the interface is
+ * thread-safe.
+ *
+ * Images are popped in the same order as they are pushed. Each image
+ * is tagged with its push index, and pop() only returns the image with the
+ * index it expects next, thus an image written into a slot after pop()
+ * has read the head is never returned ahead of older images.
+ */
+class org_custusx_core_video_EXPORT ImageRingBuffer
+{
+public:
+	explicit ImageRingBuffer(unsigned capacity);
+	~ImageRingBuffer();
+
+	void push(ImagePtr image); ///< producer only
+	ImagePtr pop(); ///< consumer only. Return the oldest image, or null if empty.
+
+	unsigned getCapacity() const { return mCapacity; }
+	unsigned size() const; ///< number of images in the buffer, approximate if called during push/pop
+	ImageRingBufferStatistics takeStatistics(); ///< return statistics since last call, reset counters
+
+private:
+	struct Item
+	{
+		ImagePtr mImage;
+		qint64 mPushTime;
+		unsigned mIndex; ///< push index
+	};
+	ImageRingBuffer(const ImageRingBuffer&);
+	ImageRingBuffer& operator=(const ImageRingBuffer&);
+
+	const unsigned mCapacity;
+	boost::scoped_array<QAtomicPointer<Item> > mSlots; ///< slot i%capacity holds image i, NULL when popped or empty
+	QAtomicInt mHead; ///< number of pushed images, written by producer
+	QAtomicInt mTail; ///< next image to pop, written by consumer
+	QAtomicInt mDropped;
+	QAtomicInt mLatencySum; ///< ms
+	QAtomicInt mLatencyCount;
+};
+typedef boost::shared_ptr<ImageRingBuffer> ImageRingBufferPtr;
+
+/**
+ * @}
+ */
+} // namespace cx
+
+Q_DECLARE_METATYPE(cx::ImageRingBufferStatistics)
+
+#endif // CXIMAGERINGBUFFER_H
@@ -35,11 +35,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxDoubleProperty.h"
 #include "cxBoolProperty.h"
 #include "cxIGTLinkClientStreamer.h"
+#include "cxSharedMemoryClientStreamer.h"
 #include "cxImageStreamerOpenCV.h"
 #include "cxUtilHelpers.h"
 #include "cxLogger.h"
 #include "QApplication"
 #include <QDir>
+#include <QTimer>
 #include "cxDataLocations.h"
 #include "cxTypeConversions.h"
 #include "cxFilePathProperty.h"
@@ -123,9 +125,18 @@ StreamerPtr LocalServerStreamer::createStreamerIfEnabled(QDomElement root, Strin
 	return streamer;
 }
 
+namespace
+{
+QString createSharedMemoryKey()
+{
+	static int counter = 0;
+	return QString("CustusX_video_%1_%2").arg(QCoreApplication::applicationPid()).arg(counter++);
+}
+}
+
 LocalServerStreamer::LocalServerStreamer(QString serverName, QString serverArguments) :
 	mServerName(serverName),
-	mServerArguments(serverArguments)
+	mAttachAttempts(0)
 {
 	mLocalVideoServerProcess.reset(new ProcessWrapper(QString("Local Video Server: %1").arg(mServerName)));
 
@@ -133,6 +144,19 @@ LocalServerStreamer::LocalServerStreamer(QString serverName, QString serverArgum
 	int defaultport = 18333;
 	igtLinkStreamer->setAddress("Localhost", defaultport);
 	mBase = igtLinkStreamer;
+
+	QString key = createSharedMemoryKey();
+	mSharedMemoryStreamer.reset(new SharedMemoryClientStreamer(key));
+	QStringList arguments;
+	if (!serverArguments.isEmpty())
+		arguments << serverArguments;
+	arguments << "--shm" << key;
+	mServerArguments = arguments.join(" ");
+
+	// the server creates the shared memory when the first frame is grabbed
+	mAttachTimer = new QTimer(this);
+	mAttachTimer->setInterval(250);
+	connect(mAttachTimer, &QTimer::timeout, this, &LocalServerStreamer::attachSharedMemorySlot);
 }
 
 LocalServerStreamer::~LocalServerStreamer()
@@ -148,13 +172,48 @@ void LocalServerStreamer::startStreaming(SenderPtr sender)
 
 void LocalServerStreamer::processStateChanged()
 {
-	if(mLocalVideoServerProcess->isRunning())
-		mBase->startStreaming(mSender);
+	if(mLocalVideoServerProcess->isRunning() && !mActiveStreamer && !mAttachTimer->isActive())
+	{
+		mAttachAttempts = 0;
+		mAttachTimer->start();
+	}
+}
+
+/** Try to attach to the shared memory written by the server, fall
+ *  back to tcp if the server does not create it within a few seconds.
+ */
+void LocalServerStreamer::attachSharedMemorySlot()
+{
+	if (!this->localVideoServerIsRunning())
+	{
+		mAttachTimer->stop();
+		return;
+	}
+
+	if (mSharedMemoryStreamer->attach())
+	{
+		mAttachTimer->stop();
+		mActiveStreamer = mSharedMemoryStreamer;
+		mActiveStreamer->startStreaming(mSender);
+		return;
+	}
+
+	int maxAttempts = 40;
+	if (++mAttachAttempts < maxAttempts)
+		return;
+
+	mAttachTimer->stop();
+	reportWarning("Failed to connect to local video server through shared memory, falling back to tcp.");
+	mActiveStreamer = mBase;
+	mActiveStreamer->startStreaming(mSender);
 }
 
 void LocalServerStreamer::stopStreaming()
 {
-	mBase->stopStreaming();
+	mAttachTimer->stop();
+	if (mActiveStreamer)
+		mActiveStreamer->stopStreaming();
+	mActiveStreamer.reset();
 
 	if (mLocalVideoServerProcess->getProcess())
 	{
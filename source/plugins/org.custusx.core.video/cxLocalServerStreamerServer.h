@@ -38,6 +38,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxProcessWrapper.h"
 
 class ctkPluginContext;
+class QTimer;
 
 namespace cx
 {
@@ -46,6 +47,7 @@ typedef boost::shared_ptr<class DoublePropertyBase> DoublePropertyBasePtr;
 typedef boost::shared_ptr<class Property> PropertyPtr;
 typedef boost::shared_ptr<class FilePathProperty> FilePathPropertyPtr;
 typedef boost::shared_ptr<class BoolPropertyBase> BoolPropertyBasePtr;
+typedef boost::shared_ptr<class SharedMemoryClientStreamer> SharedMemoryClientStreamerPtr;
 
 
 /** Options for LocalServerStreamer
@@ -65,6 +67,9 @@ public:
 };
 
 /** Streamer wrapping another Streamer, but also runs an executable as a local process.
+ *
+ * Video is received through shared memory when the server supports it,
+ * otherwise through a tcp connection to the server.
  *
  * \ingroup org_custusx_core_video
  *
@@ -88,11 +93,16 @@ private slots:
 	virtual void streamSlot() {}
 
 	void processStateChanged();
+	void attachSharedMemorySlot();
 private:
 	bool localVideoServerIsRunning();
 	ProcessWrapperPtr mLocalVideoServerProcess;
 
-	StreamerPtr mBase;
+	StreamerPtr mBase; ///< tcp fallback
+	SharedMemoryClientStreamerPtr mSharedMemoryStreamer;
+	StreamerPtr mActiveStreamer; ///< the streamer in use, null until connected
+	QTimer* mAttachTimer;
+	int mAttachAttempts;
 	QString mServerName;
 	QString mServerArguments;
 };
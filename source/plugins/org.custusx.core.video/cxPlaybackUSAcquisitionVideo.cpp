@@ -53,6 +53,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxFileHelpers.h"
 #include <QtConcurrent>
 #include "cxTool.h"
+#include "cxPrefetchImageDataContainer.h"
 
 namespace cx
 {
@@ -105,7 +106,50 @@ void USAcquisitionVideoPlayback::setTime(PlaybackTimePtr controller)
 void USAcquisitionVideoPlayback::setRoot(const QString path)
 {
 	mRoot = path;
-	mEvents = this->getEvents();
+	this->setEvents(this->getEvents());
+}
+
+namespace
+{
+bool startsBefore(const TimelineEvent& lhs, const TimelineEvent& rhs)
+{
+	return lhs.mStartTime < rhs.mStartTime;
+}
+}
+
+/** Store events sorted on start time, along with the
+ *  running max of the stop times, for use in findEvent().
+ */
+void USAcquisitionVideoPlayback::setEvents(std::vector<TimelineEvent> events)
+{
+	std::stable_sort(events.begin(), events.end(), startsBefore);
+	mEvents = events;
+
+	mEventsMaxStopTime.resize(mEvents.size());
+	for (unsigned i=0; i<mEvents.size(); ++i)
+	{
+		mEventsMaxStopTime[i] = mEvents[i].mEndTime;
+		if (i>0)
+			mEventsMaxStopTime[i] = std::max(mEventsMaxStopTime[i], mEventsMaxStopTime[i-1]);
+	}
+}
+
+/** Find the event containing time. If several do,
+ *  use the one starting last.
+ */
+TimelineEvent USAcquisitionVideoPlayback::findEvent(double time) const
+{
+	// candidates are the events starting before time, search backwards
+	// until no earlier event can reach time.
+	TimelineEvent probe;
+	probe.mStartTime = time;
+	int i = std::upper_bound(mEvents.begin(), mEvents.end(), probe, startsBefore) - mEvents.begin() - 1;
+	for (; i>=0 && mEventsMaxStopTime[i]>=time; --i)
+	{
+		if (mEvents[i].isInside(time))
+			return mEvents[i];
+	}
+	return TimelineEvent();
 }
 
 std::vector<TimelineEvent> USAcquisitionVideoPlayback::getEvents()
@@ -150,15 +194,7 @@ QString USAcquisitionVideoPlayback::getType() const
 
 void USAcquisitionVideoPlayback::timerChangedSlot()
 {
-    TimelineEvent event;
-    for (unsigned i=0; i<mEvents.size(); ++i)
-    {
-        if (mEvents[i].isInside(mTimer->getTime().toMSecsSinceEpoch()))
-		{
-			event = mEvents[i];
-			break;
-		}
-	}
+	TimelineEvent event = this->findEvent(mTimer->getTime().toMSecsSinceEpoch());
 
 	this->loadFullData(event.mUid);
 	this->updateFrame(event.mUid);
@@ -180,6 +216,7 @@ void USAcquisitionVideoPlayback::loadFullData(QString filename)
 
 	// clear data
 	mCurrentData = USReconstructInputData();
+	mCurrentFrames.reset();
 
 	// if no new data, return
 	if (filename.isEmpty())
@@ -214,6 +251,11 @@ void USAcquisitionVideoPlayback::usDataLoadFinishedSlot()
 			probe->setProbeDefinition(mCurrentData.mProbeDefinition.mData);
 	}
 
+	// frames are read on demand, with read-ahead in the playback direction
+	mCurrentFrames.reset();
+	if (mCurrentData.mUsRaw)
+		mCurrentFrames.reset(new PrefetchImageDataContainer(mCurrentData.mUsRaw->getImageContainer()));
+
 	// create a vector to allow for quick search
 	mCurrentTimestamps.clear();
 	for (unsigned i=0; i<mCurrentData.mFrames.size(); ++i)
@@ -232,7 +274,7 @@ void  USAcquisitionVideoPlayback::updateFrame(QString filename)
 		return;
 	}
 
-	if (mCurrentData.mFilename.isEmpty() || !mCurrentData.mUsRaw || filename!=mCurrentData.mFilename)
+	if (mCurrentData.mFilename.isEmpty() || !mCurrentFrames || filename!=mCurrentData.mFilename)
 	{
 		mVideoSource->setInfoString(QString(""));
 		mVideoSource->setStatusString(QString("No US Acquisition"));
@@ -255,7 +297,7 @@ void  USAcquisitionVideoPlayback::updateFrame(QString filename)
 	int timeout = 1000; // invalidate data if timestamp differ from time too much
 	mVideoSource->overrideTimeout(fabs(timestamp-*iter)>timeout);
 
-	ImagePtr image(new Image(mVideoSourceUid, mCurrentData.mUsRaw->getImageContainer()->get(index)));
+	ImagePtr image(new Image(mVideoSourceUid, mCurrentFrames->get(index)));
 	image->setAcquisitionTime(QDateTime::fromMSecsSinceEpoch(timestamp));
 
 	mVideoSource->setInfoString(QString("%1 - Frame %2").arg(mCurrentData.mUsRaw->getName()).arg(index));
@@ -47,6 +47,7 @@ namespace cx
 {
 typedef boost::shared_ptr<class BasicVideoSource> BasicVideoSourcePtr;
 typedef boost::shared_ptr<class VideoServiceBackend> VideoServiceBackendPtr;
+typedef boost::shared_ptr<class PrefetchImageDataContainer> PrefetchImageDataContainerPtr;
 
 /**
  * \file
@@ -57,6 +58,10 @@ typedef boost::shared_ptr<class VideoServiceBackend> VideoServiceBackendPtr;
 /**\brief Handler for playback of US image data
  * from a US recording session.
  *
+ * The acquisition at the current time is read in the background,
+ * frames are then loaded on demand through a bounded cache
+ * reading ahead in the playback direction.
+ *
  * \ingroup org_custusx_core_video
  * \date Apr 11, 2012
  * \author Christian Askeland, SINTEF
@@ -84,15 +89,19 @@ private:
     void updateFrame(QString filename);
 	void loadFullData(QString filename);
 	QStringList getAbsolutePathToFtsFiles(QString folder);
+	void setEvents(std::vector<TimelineEvent> events);
+	TimelineEvent findEvent(double time) const;
 	QString mRoot;
     QString mType;
     PlaybackTimePtr mTimer;
 	BasicVideoSourcePtr mVideoSource;
-	std::vector<TimelineEvent> mEvents;
+	std::vector<TimelineEvent> mEvents; ///< sorted on start time
+	std::vector<double> mEventsMaxStopTime; ///< max stop time of mEvents[0..i], for interval search
     const QString mVideoSourceUid;
 
 	USReconstructInputData mCurrentData;
 	std::vector<double> mCurrentTimestamps; // copy of time frame timestamps from mCurrentData.
+	PrefetchImageDataContainerPtr mCurrentFrames; ///< frames from mCurrentData
 
 	UsReconstructionFileReaderPtr mUSImageDataReader;
 	QFuture<USReconstructInputData> mUSImageDataFutureResult;
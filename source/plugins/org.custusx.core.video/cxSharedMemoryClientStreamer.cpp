@@ -0,0 +1,149 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "cxSharedMemoryClientStreamer.h"
+
+#include "vtkImageData.h"
+#include "cxSharedMemoryWaiterThread.h"
+#include "cxIGTLinkConversionSonixCXLegacy.h"
+#include "cxProbeDefinition.h"
+#include "cxImage.h"
+#include "cxSender.h"
+#include "cxLogger.h"
+
+namespace cx
+{
+
+SharedMemoryClientStreamer::SharedMemoryClientStreamer(QString key) :
+	mKey(key)
+{
+}
+
+SharedMemoryClientStreamer::~SharedMemoryClientStreamer()
+{
+	this->stopStreaming();
+}
+
+bool SharedMemoryClientStreamer::attach()
+{
+	if (!mReader)
+		mReader = SharedMemoryVideoReader::create(mKey);
+	return this->isAttached();
+}
+
+bool SharedMemoryClientStreamer::isAttached() const
+{
+	return mReader ? true : false;
+}
+
+void SharedMemoryClientStreamer::startStreaming(SenderPtr sender)
+{
+	if (!this->attach())
+	{
+		reportError(QString("Failed to attach to shared memory video %1").arg(mKey));
+		return;
+	}
+	mSender = sender;
+
+	mWaiter.reset(new SharedMemoryWaiterThread(mReader->getClient()));
+	connect(mWaiter.get(), SIGNAL(newBuffer()), this, SLOT(newBufferSlot()), Qt::QueuedConnection);
+	mWaiter->start();
+	report(QString("Streaming from shared memory video %1").arg(mKey));
+}
+
+void SharedMemoryClientStreamer::stopStreaming()
+{
+	if (mWaiter)
+	{
+		mWaiter->stop();
+		mWaiter.reset();
+	}
+	mSender.reset();
+	// images may still refer to the shared memory, they keep it attached
+	mReader.reset();
+}
+
+bool SharedMemoryClientStreamer::isStreaming()
+{
+	return mWaiter && mWaiter->isRunning();
+}
+
+SharedMemoryVideoStatistics SharedMemoryClientStreamer::getStatistics() const
+{
+	if (!mReader)
+		return SharedMemoryVideoStatistics();
+	return mReader->getStatistics();
+}
+
+void SharedMemoryClientStreamer::newBufferSlot()
+{
+	if (!mWaiter || !mSender)
+		return;
+	mWaiter->bufferHandled();
+
+	ImagePtr image = mReader->readLatest();
+	if (!image)
+		return;
+
+	PackagePtr package(new Package());
+	package->mProbe = this->decodeProbeDefinition(image);
+	package->mImage = image;
+
+	IGTLinkConversionSonixCXLegacy cxconverter;
+	if (cxconverter.guessIsSonixLegacyFormat(image->getUid()))
+	{
+		package->mImage = cxconverter.decode(image);
+		if (package->mProbe)
+			package->mProbe = cxconverter.decode(package->mProbe);
+	}
+
+	mSender->send(package);
+}
+
+/** Return the probe definition if changed, with the
+ *  image properties updated as in the IGTLink stream.
+ */
+ProbeDefinitionPtr SharedMemoryClientStreamer::decodeProbeDefinition(ImagePtr image)
+{
+	ProbeDefinitionPtr retval = mReader->takeChangedProbeDefinition();
+	if (!retval)
+		return retval;
+
+	vtkImageDataPtr data = image->getBaseVtkImageData();
+	int* size = data->GetDimensions();
+	double* spacing = data->GetSpacing();
+	retval->setSpacing(Vector3D(spacing[0], spacing[1], spacing[2]));
+	retval->setSize(QSize(size[0], size[1]));
+	retval->setClipRect_p(DoubleBoundingBox3D(0, retval->getSize().width(), 0, retval->getSize().height(), 0, 0));
+	return retval;
+}
+
+} // namespace cx
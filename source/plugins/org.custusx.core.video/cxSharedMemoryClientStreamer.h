@@ -0,0 +1,85 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#ifndef CXSHAREDMEMORYCLIENTSTREAMER_H
+#define CXSHAREDMEMORYCLIENTSTREAMER_H
+
+#include "cxStreamer.h"
+#include "org_custusx_core_video_Export.h"
+#include "cxSharedMemoryVideo.h"
+
+namespace cx
+{
+typedef boost::shared_ptr<class SharedMemoryWaiterThread> SharedMemoryWaiterThreadPtr;
+
+/**
+ * Streamer that reads a shared memory video stream written by a
+ * video server on the same computer, i.e. OpenIGTLinkServer --shm <key>.
+ *
+ * A separate thread waits for new frames, thus there is no polling.
+ * Only the latest frame is read, and the images refer directly
+ * to the shared memory.
+ *
+ * \addtogroup org_custusx_core_video
+ */
+class org_custusx_core_video_EXPORT SharedMemoryClientStreamer: public Streamer
+{
+Q_OBJECT
+
+public:
+	explicit SharedMemoryClientStreamer(QString key);
+	virtual ~SharedMemoryClientStreamer();
+
+	bool attach(); ///< try to attach to the stream, return success.
+	bool isAttached() const;
+
+	virtual void startStreaming(SenderPtr sender);
+	virtual void stopStreaming();
+	virtual bool isStreaming();
+
+	SharedMemoryVideoStatistics getStatistics() const;
+
+private slots:
+	virtual void streamSlot() {}
+	void newBufferSlot();
+
+private:
+	ProbeDefinitionPtr decodeProbeDefinition(ImagePtr image);
+
+	QString mKey;
+	SharedMemoryVideoReaderPtr mReader;
+	SharedMemoryWaiterThreadPtr mWaiter;
+};
+typedef boost::shared_ptr<class SharedMemoryClientStreamer> SharedMemoryClientStreamerPtr;
+
+} // namespace cx
+
+#endif // CXSHAREDMEMORYCLIENTSTREAMER_H
@@ -41,6 +41,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxImageReceiverThread.h"
 #include "cxImage.h"
 #include "cxLogger.h"
+#include "cxSettings.h"
 #include <QApplication>
 #include "boost/function.hpp"
 #include "boost/bind.hpp"
@@ -58,6 +59,7 @@ VideoConnection::VideoConnection(VideoServiceBackendPtr backend)
 
 	connect(mBackend->tracking().get(), &TrackingService::stateChanged, this, &VideoConnection::connectVideoToProbe);
 	connect(mBackend->tracking().get(), SIGNAL(activeToolChanged(QString)), this, SLOT(connectVideoToProbe()));
+	connect(settings(), &Settings::valueChangedFor, this, &VideoConnection::settingsChangedSlot);
 }
 
 VideoConnection::~VideoConnection()
@@ -82,12 +84,47 @@ void VideoConnection::waitForClientFinished()
 	}
 }
 
-void VideoConnection::fpsSlot(QString source, double fpsNumber)
+void VideoConnection::fpsSlot(QString source, double fpsNumber, ImageRingBufferStatistics statistics)
 {
 	mFPS = fpsNumber;
+	mStatistics[source] = statistics;
+	if (statistics.mDropped)
+		reportDebug(QString("Video stream [%1] dropped %2 frames, %3").arg(source).arg(statistics.mDropped).arg(this->getStatisticsString(source)));
 	emit fps(source, fpsNumber);
 }
 
+QString VideoConnection::getStatisticsString(QString streamUid) const
+{
+	std::map<QString, ImageRingBufferStatistics>::const_iterator iter = mStatistics.find(streamUid);
+	if (iter == mStatistics.end())
+		return "";
+	ImageRingBufferStatistics statistics = iter->second;
+
+	QString retval = QString("queue %1/%2").arg(statistics.mDepth).arg(statistics.mCapacity);
+	if (statistics.mLatency >= 0)
+		retval += QString(", latency %1 ms").arg(statistics.mLatency, 0, 'f', 0);
+	if (statistics.mDropped)
+		retval += QString(", %1 dropped").arg(statistics.mDropped);
+	return retval;
+}
+
+void VideoConnection::settingsChangedSlot(QString key)
+{
+	if (!key.startsWith("Video/FrameQueueCapacity") || !mClient)
+		return;
+
+	mClient->setDefaultQueueCapacity(settings()->value("Video/FrameQueueCapacity").toInt());
+	for (unsigned i=0; i<mSources.size(); ++i)
+		this->updateQueueCapacity(mSources[i]->getUid());
+}
+
+void VideoConnection::updateQueueCapacity(QString streamUid)
+{
+	QString key = QString("Video/FrameQueueCapacity/%1").arg(streamUid);
+	if (mClient && settings()->contains(key))
+		mClient->setQueueCapacity(streamUid, settings()->value(key).toInt());
+}
+
 bool VideoConnection::isConnected() const
 {
 	return mThread;
@@ -128,6 +165,7 @@ void VideoConnection::runDirectLinkClient(StreamerServicePtr service)
 
     mStreamerInterface = service;
 	mClient = new ImageReceiverThread(mStreamerInterface);
+	mClient->setDefaultQueueCapacity(settings()->value("Video/FrameQueueCapacity").toInt());
 
 	connect(mClient.data(), &ImageReceiverThread::imageReceived, this, &VideoConnection::imageReceivedSlot); // thread-bridging connection
 	connect(mClient.data(), &ImageReceiverThread::sonixStatusReceived, this, &VideoConnection::statusReceivedSlot); // thread-bridging connection
@@ -152,7 +190,9 @@ void VideoConnection::imageReceivedSlot()
 {
 	if (!mClient)
 		return;
-	this->updateImage(mClient->getLastImageMessage());
+	std::vector<ImagePtr> images = mClient->popImageMessages();
+	for (unsigned i=0; i<images.size(); ++i)
+		this->updateImage(images[i]);
 }
 
 void VideoConnection::statusReceivedSlot()
@@ -207,6 +247,7 @@ void VideoConnection::onDisconnected()
 		this->removeSourceFromProbe(tool);
 
 	mSources.clear();
+	mStatistics.clear();
 	mStreamerInterface.reset();
 
 	emit connected(false);
@@ -316,10 +357,14 @@ void VideoConnection::updateImage(ImagePtr message)
 	source->setInput(message);
 
 	QString info = mClient->hostDescription() + " - " + QString::number(mFPS, 'f', 1) + " fps";
+	QString statistics = this->getStatisticsString(source->getUid());
+	if (!statistics.isEmpty())
+		info += ", " + statistics;
 	source->setInfoString(info);
 
 	if (newSource)
 	{
+		this->updateQueueCapacity(source->getUid());
 		this->connectVideoToProbe();
 		emit videoSourcesChanged();
 	}
@@ -38,6 +38,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <map>
 #include <boost/array.hpp>
 #include "cxForwardDeclarations.h"
+#include "cxImageRingBuffer.h"
 
 typedef vtkSmartPointer<class vtkImageImport> vtkImageImportPtr;
 typedef vtkSmartPointer<class vtkImageAlgorithm> vtkImageAlgorithmPtr;
@@ -65,6 +66,10 @@ typedef boost::shared_ptr<class VideoServiceBackend> VideoServiceBackendPtr;
  * Video Streams are also available directly from this
  * object.
  *
+ * The number of frames queued for each stream is limited by the settings
+ * Video/FrameQueueCapacity, or Video/FrameQueueCapacity/\<streamUid\> for
+ * a specific stream. If the receiver falls behind, the oldest frames are dropped.
+ *
  * Refactored from old class OpenIGTLinkRTSource.
  *
  *  \ingroup org_custusx_core_video
@@ -94,7 +99,8 @@ private slots:
 	void onDisconnected();
 	void imageReceivedSlot();
 	void statusReceivedSlot();
-	void fpsSlot(QString, double fps);
+	void fpsSlot(QString, double fps, ImageRingBufferStatistics statistics);
+	void settingsChangedSlot(QString key);
 	void connectVideoToProbe();
 	void useUnusedProbeDefinitionSlot();///< If no probe is available the ProbeDefinition is saved and this slot is called when a probe becomes available
 
@@ -108,11 +114,14 @@ private:
 	void startAllSources();
 	void stopAllSources();
 	void removeSourceFromProbe(ToolPtr tool);
+	void updateQueueCapacity(QString streamUid);
+	QString getStatisticsString(QString streamUid) const;
 
 	QPointer<ImageReceiverThread> mClient;
 	QPointer<QThread> mThread;
 
 	double mFPS;
+	std::map<QString, ImageRingBufferStatistics> mStatistics;
 	std::vector<ProbeDefinitionPtr> mUnusedProbeDefinitionVector;
 	std::vector<BasicVideoSourcePtr> mSources;
 	VideoServiceBackendPtr mBackend;
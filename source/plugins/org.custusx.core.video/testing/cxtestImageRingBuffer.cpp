@@ -0,0 +1,145 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "catch.hpp"
+#include <QtConcurrentRun>
+#include "cxImageRingBuffer.h"
+#include "cxImage.h"
+#include "cxVolumeHelpers.h"
+
+namespace cxtest
+{
+
+namespace
+{
+cx::ImagePtr createImage(int index)
+{
+	vtkImageDataPtr data = cx::generateVtkImageData(Eigen::Array3i(2,2,1), cx::Vector3D(1,1,1), 0);
+	return cx::ImagePtr(new cx::Image(QString::number(index), data));
+}
+
+/** Return true if the image index is in [0, count) and larger than last,
+  * then set last to the image index.
+  */
+bool isNextInSequence(int* last, cx::ImagePtr image, int count)
+{
+	int index = image->getUid().toInt();
+	bool retval = (index > *last) && (index < count);
+	*last = index;
+	return retval;
+}
+
+void pushImages(cx::ImageRingBuffer* buffer, std::vector<cx::ImagePtr> images)
+{
+	for (unsigned i=0; i<images.size(); ++i)
+		buffer->push(images[i]);
+}
+}
+
+TEST_CASE("ImageRingBuffer: images are popped in order", "[unit][plugins][org.custusx.core.video]")
+{
+	cx::ImageRingBuffer buffer(4);
+	CHECK(!buffer.pop());
+
+	for (int i=0; i<3; ++i)
+		buffer.push(createImage(i));
+	CHECK(buffer.size() == 3);
+
+	for (int i=0; i<3; ++i)
+	{
+		cx::ImagePtr image = buffer.pop();
+		REQUIRE(image);
+		CHECK(image->getUid() == QString::number(i));
+	}
+	CHECK(!buffer.pop());
+	CHECK(buffer.size() == 0);
+
+	cx::ImageRingBufferStatistics statistics = buffer.takeStatistics();
+	CHECK(statistics.mCapacity == 4);
+	CHECK(statistics.mDropped == 0);
+	CHECK(statistics.mLatency >= 0);
+}
+
+TEST_CASE("ImageRingBuffer: oldest images are dropped when full", "[unit][plugins][org.custusx.core.video]")
+{
+	cx::ImageRingBuffer buffer(3);
+	for (int i=0; i<10; ++i)
+		buffer.push(createImage(i));
+	CHECK(buffer.size() == 3);
+
+	for (int i=7; i<10; ++i)
+	{
+		cx::ImagePtr image = buffer.pop();
+		REQUIRE(image);
+		CHECK(image->getUid() == QString::number(i));
+	}
+	CHECK(!buffer.pop());
+
+	cx::ImageRingBufferStatistics statistics = buffer.takeStatistics();
+	CHECK(statistics.mDropped == 7);
+	CHECK(buffer.takeStatistics().mDropped == 0);
+}
+
+TEST_CASE("ImageRingBuffer: concurrent push and pop loses no images except dropped", "[unit][plugins][org.custusx.core.video]")
+{
+	int count = 2000;
+	std::vector<cx::ImagePtr> images;
+	for (int i=0; i<count; ++i)
+		images.push_back(createImage(i));
+
+	cx::ImageRingBuffer buffer(16);
+	QFuture<void> producer = QtConcurrent::run(&pushImages, &buffer, images);
+
+	int popped = 0;
+	int last = -1;
+	bool inOrder = true;
+	while (!producer.isFinished() || buffer.size())
+	{
+		cx::ImagePtr image = buffer.pop();
+		if (!image)
+			continue;
+		++popped;
+		inOrder = inOrder && isNextInSequence(&last, image, count);
+	}
+	producer.waitForFinished();
+	for (cx::ImagePtr image = buffer.pop(); image; image = buffer.pop())
+	{
+		++popped;
+		inOrder = inOrder && isNextInSequence(&last, image, count);
+	}
+
+	cx::ImageRingBufferStatistics statistics = buffer.takeStatistics();
+	CHECK(popped + int(statistics.mDropped) == count);
+	CHECK(inOrder);
+}
+
+} // namespace cxtest
@@ -33,11 +33,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxCyclicActionLogger.h"
 #include <QTimer>
+#include <QColor>
 #include "cxView.h"
 #include "vtkRenderWindow.h"
 #include "cxTypeConversions.h"
 #include "cxLogger.h"
 #include "cxViewCollectionWidget.h"
+#include "cxRep.h"
+#include "cxDisplayTextRep.h"
 
 
 namespace cx
@@ -49,10 +52,13 @@ RenderLoop::RenderLoop() :
 	mPreRenderSignalRequested(false),
 	mSmartRender(false),
 	mLogging(false),
-	mBaseRenderInterval(40)
+	mBaseRenderInterval(40),
+	mTimingOverlay(false)
 {
 	mLastFullRender = QDateTime::currentDateTime();
 	mCyclicLogger.reset(new CyclicActionLogger("Main Render timer"));
+	mScheduler.reset(new RenderScheduler());
+	mScheduler->setBudget(mBaseRenderInterval);
 
 	mTimer = new QTimer(this);
 	connect(mTimer, SIGNAL(timeout()), this, SLOT(timeoutSlot()));
@@ -84,9 +90,26 @@ void RenderLoop::requestPreRenderSignal()
 void RenderLoop::setRenderingInterval(int interval)
 {
 	mBaseRenderInterval = interval;
+	mScheduler->setBudget(mBaseRenderInterval ? mBaseRenderInterval : 30);
 	this->sendRenderIntervalToTimer(mBaseRenderInterval);
 }
 
+void RenderLoop::setPriorityViews(const std::set<QString>& uids)
+{
+	mScheduler->setPriorityViews(uids);
+}
+
+void RenderLoop::setTimingOverlay(bool on)
+{
+	if (mTimingOverlay == on)
+		return;
+	mTimingOverlay = on;
+	if (mTimingOverlay)
+		this->updateTimingOverlays();
+	else
+		this->removeTimingOverlays();
+}
+
 void RenderLoop::setLogging(bool on)
 {
 	mLogging = on;
@@ -120,9 +143,23 @@ void RenderLoop::addLayout(ViewCollectionWidget* layout)
 
 void RenderLoop::clearViews()
 {
+	this->removeTimingOverlays();
 	mLayoutWidgets.clear();
 }
 
+std::vector<ViewPtr> RenderLoop::getViews()
+{
+	std::vector<ViewPtr> retval;
+	for (unsigned i=0; i<mLayoutWidgets.size(); ++i)
+	{
+		if (!mLayoutWidgets[i])
+			continue;
+		std::vector<ViewPtr> views = mLayoutWidgets[i]->getViews();
+		retval.insert(retval.end(), views.begin(), views.end());
+	}
+	return retval;
+}
+
 void RenderLoop::timeoutSlot()
 {
 	mCyclicLogger->begin();
@@ -153,17 +190,92 @@ void RenderLoop::renderViews()
 {
 	bool smart = this->pollForSmartRenderingThisCycle();
 
+	std::set<QString> deferred;
+	if (smart)
+		deferred = mScheduler->getDeferredViews();
+
 	for (unsigned i=0; i<mLayoutWidgets.size(); ++i)
 	{
 		if (mLayoutWidgets[i])
 		{
 			if (!smart)
 				mLayoutWidgets[i]->setModified();
+			mLayoutWidgets[i]->setDeferredViews(deferred);
 			mLayoutWidgets[i]->render();
 		}
 	}
 
 	mCyclicLogger->time("render");
+
+	this->collectRenderTimings(deferred);
+}
+
+void RenderLoop::collectRenderTimings(const std::set<QString>& deferred)
+{
+	std::vector<ViewPtr> views = this->getViews();
+	std::set<QString> uids;
+	for (unsigned i=0; i<views.size(); ++i)
+	{
+		QString uid = views[i]->getUid();
+		uids.insert(uid);
+		int renders = views[i]->getNumberOfRenders();
+		if (renders != mRenderCounts[uid])
+		{
+			std::vector<std::pair<QString, double> > reps;
+			std::vector<RepPtr> viewReps = views[i]->getReps();
+			for (unsigned j=0; j<viewReps.size(); ++j)
+				reps.push_back(std::make_pair(viewReps[j]->getType(), viewReps[j]->getLastUpdateTime()));
+			mScheduler->addRender(uid, views[i]->getName(), views[i]->getLastRenderTime(), reps);
+			mRenderCounts[uid] = renders;
+		}
+		else if (deferred.count(uid))
+		{
+			mScheduler->addDeferral(uid);
+		}
+		else
+		{
+			mScheduler->addIdle(uid);
+		}
+	}
+
+	// forget views removed from the layouts
+	std::vector<ViewRenderTiming> timings = mScheduler->getTimings();
+	for (unsigned i=0; i<timings.size(); ++i)
+	{
+		if (!uids.count(timings[i].mUid))
+			mScheduler->removeView(timings[i].mUid);
+	}
+}
+
+void RenderLoop::updateTimingOverlays()
+{
+	std::vector<ViewPtr> views = this->getViews();
+	for (unsigned i=0; i<views.size(); ++i)
+	{
+		QString uid = views[i]->getUid();
+		DisplayTextRepPtr& overlay = mTimingOverlays[uid];
+		if (!overlay)
+		{
+			overlay = DisplayTextRep::New();
+			overlay->addText(QColor(Qt::yellow), "", Vector3D(0.98, 0.98, 0.0));
+			overlay->setFontSize(12);
+		}
+		if (!views[i]->hasRep(overlay))
+			views[i]->addRep(overlay);
+		overlay->setText(0, mScheduler->getTimingText(uid));
+	}
+}
+
+void RenderLoop::removeTimingOverlays()
+{
+	std::vector<ViewPtr> views = this->getViews();
+	for (unsigned i=0; i<views.size(); ++i)
+	{
+		DisplayTextRepPtr overlay = mTimingOverlays[views[i]->getUid()];
+		if (overlay)
+			views[i]->removeRep(overlay);
+	}
+	mTimingOverlays.clear();
 }
 
 bool RenderLoop::pollForSmartRenderingThisCycle()
@@ -187,6 +299,8 @@ void RenderLoop::emitFPSIfRequired()
 	{
 		emit fps(mCyclicLogger->getFPS());
 		this->dumpStatistics();
+		if (mTimingOverlay)
+			this->updateTimingOverlays();
 //		static int counter=0;
 //		if (++counter%3==0)
 //			reportDebug(mCyclicLogger->dumpStatisticsSmall());
@@ -201,7 +315,10 @@ void RenderLoop::dumpStatistics()
 
 	static int counter=0;
 	if (++counter%3==0) // every third event
+	{
 		reportDebug(mCyclicLogger->dumpStatisticsSmall());
+		reportDebug(mScheduler->dumpTimings());
+	}
 }
 
 int RenderLoop::calculateTimeToNextRender()
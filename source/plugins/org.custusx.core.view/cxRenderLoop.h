@@ -39,16 +39,23 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 class QTimer;
 #include <QDateTime>
 #include <set>
+#include <map>
+#include "cxRenderScheduler.h"
 
 namespace cx
 {
 typedef boost::shared_ptr<class CyclicActionLogger> CyclicActionLoggerPtr;
+typedef boost::shared_ptr<class DisplayTextRep> DisplayTextRepPtr;
 class ViewCollectionWidget;
 
 /** Render a set of Views in a loop.
  *
  * This is the main render loop in Custus.
  *
+ * Render times for each View and Rep are collected in a RenderScheduler.
+ * With smart render on, views whose estimated render time do not fit
+ * inside the rendering interval are deferred, except the priority views.
+ *
  * \ingroup org_custusx_core_view
  * \date 2014-02-06
  * \author christiana
@@ -64,11 +71,14 @@ public:
 	void setRenderingInterval(int interval);
 	void setSmartRender(bool val); ///< If set: Render only views with modified props using the given interval, render nonmodified at a slower pace.
 	void setLogging(bool on);
+	void setPriorityViews(const std::set<QString>& uids); ///< views that are rendered every cycle, also when over budget
+	void setTimingOverlay(bool on); ///< show render timings in each view
 
 	void clearViews();
 	void addLayout(ViewCollectionWidget* layout);
 
 	CyclicActionLoggerPtr getRenderTimer() { return mCyclicLogger; }
+	RenderSchedulerPtr getScheduler() { return mScheduler; }
 
 public slots:
 	void requestPreRenderSignal();
@@ -88,12 +98,20 @@ private:
 	int calculateTimeToNextRender();
 	void emitFPSIfRequired();
 	void dumpStatistics();
+	std::vector<ViewPtr> getViews();
+	void collectRenderTimings(const std::set<QString>& deferred);
+	void updateTimingOverlays();
+	void removeTimingOverlays();
 
 	QTimer* mTimer; ///< timer that drives rendering
 	QDateTime mLastFullRender;
 	QDateTime mLastBeginRender;
 
 	CyclicActionLoggerPtr mCyclicLogger;
+	RenderSchedulerPtr mScheduler;
+	std::map<QString, int> mRenderCounts; ///< number of renders for each view, as of last cycle
+	std::map<QString, DisplayTextRepPtr> mTimingOverlays;
+	bool mTimingOverlay;
 
 	bool mSmartRender;
 	bool mPreRenderSignalRequested;
@@ -0,0 +1,214 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "cxRenderScheduler.h"
+
+#include <algorithm>
+#include <QStringList>
+
+namespace cx
+{
+
+namespace
+{
+/** Sort views by longest wait first.
+ */
+bool waitedLonger(const ViewRenderTiming* a, const ViewRenderTiming* b)
+{
+	return a->mWaiting > b->mWaiting;
+}
+}
+
+ViewRenderTiming::ViewRenderTiming() :
+	mLast(0),
+	mAverage(0),
+	mRenders(0),
+	mDeferrals(0),
+	mWaiting(0),
+	mPriority(false)
+{
+}
+
+RenderScheduler::RenderScheduler() :
+	mBudget(40),
+	mMaxDeferrals(4)
+{
+}
+
+void RenderScheduler::setBudget(double ms)
+{
+	mBudget = ms;
+}
+
+void RenderScheduler::setMaxDeferrals(int cycles)
+{
+	mMaxDeferrals = cycles;
+}
+
+void RenderScheduler::setPriorityViews(const std::set<QString>& uids)
+{
+	mPriorityViews = uids;
+	for (std::map<QString, ViewRenderTiming>::iterator iter=mTimings.begin(); iter!=mTimings.end(); ++iter)
+		iter->second.mPriority = mPriorityViews.count(iter->first);
+}
+
+std::set<QString> RenderScheduler::getDeferredViews()
+{
+	std::set<QString> retval;
+
+	double estimate = 0;
+	double priorityEstimate = 0;
+	std::vector<ViewRenderTiming*> candidates;
+	for (std::map<QString, ViewRenderTiming>::iterator iter=mTimings.begin(); iter!=mTimings.end(); ++iter)
+	{
+		ViewRenderTiming* timing = &iter->second;
+		if (!timing->mWaiting)
+			continue;
+		estimate += timing->mAverage;
+		if (timing->mPriority)
+			priorityEstimate += timing->mAverage;
+		else
+			candidates.push_back(timing);
+	}
+
+	if (estimate <= mBudget)
+		return retval;
+
+	std::stable_sort(candidates.begin(), candidates.end(), waitedLonger);
+	double available = mBudget - priorityEstimate;
+	for (unsigned i=0; i<candidates.size(); ++i)
+	{
+		bool forced = candidates[i]->mWaiting > mMaxDeferrals;
+		if (forced || (candidates[i]->mAverage <= available))
+			available -= candidates[i]->mAverage;
+		else
+			retval.insert(candidates[i]->mUid);
+	}
+
+	return retval;
+}
+
+void RenderScheduler::addRender(QString uid, QString name, double ms, std::vector<std::pair<QString, double> > reps)
+{
+	ViewRenderTiming& timing = mTimings[uid];
+	timing.mUid = uid;
+	timing.mName = name;
+	timing.mPriority = mPriorityViews.count(uid);
+	timing.mLast = ms;
+	if (timing.mRenders==0)
+		timing.mAverage = ms;
+	else
+		timing.mAverage = 0.8*timing.mAverage + 0.2*ms;
+	timing.mRenders++;
+	timing.mWaiting = 1; // assume modified again in the next cycle
+	timing.mReps = reps;
+}
+
+void RenderScheduler::addDeferral(QString uid)
+{
+	std::map<QString, ViewRenderTiming>::iterator iter = mTimings.find(uid);
+	if (iter==mTimings.end())
+		return;
+	iter->second.mDeferrals++;
+	iter->second.mWaiting++;
+}
+
+void RenderScheduler::addIdle(QString uid)
+{
+	std::map<QString, ViewRenderTiming>::iterator iter = mTimings.find(uid);
+	if (iter==mTimings.end())
+		return;
+	iter->second.mWaiting = 0;
+}
+
+void RenderScheduler::removeView(QString uid)
+{
+	mTimings.erase(uid);
+}
+
+std::vector<ViewRenderTiming> RenderScheduler::getTimings() const
+{
+	std::vector<ViewRenderTiming> retval;
+	for (std::map<QString, ViewRenderTiming>::const_iterator iter=mTimings.begin(); iter!=mTimings.end(); ++iter)
+		retval.push_back(iter->second);
+	return retval;
+}
+
+ViewRenderTiming RenderScheduler::getTiming(QString uid) const
+{
+	std::map<QString, ViewRenderTiming>::const_iterator iter = mTimings.find(uid);
+	if (iter==mTimings.end())
+		return ViewRenderTiming();
+	return iter->second;
+}
+
+QString RenderScheduler::getTimingText(QString uid) const
+{
+	ViewRenderTiming timing = this->getTiming(uid);
+	QString retval = QString("render %1 ms").arg(timing.mAverage, 0, 'f', 1);
+	if (timing.mDeferrals)
+		retval += QString(", deferred %1").arg(timing.mDeferrals);
+
+	// show the most expensive rep
+	std::pair<QString, double> slowest("", 0);
+	for (unsigned i=0; i<timing.mReps.size(); ++i)
+		if (timing.mReps[i].second > slowest.second)
+			slowest = timing.mReps[i];
+	if (!slowest.first.isEmpty())
+		retval += QString("\n%1 %2 ms").arg(slowest.first).arg(slowest.second, 0, 'f', 1);
+
+	return retval;
+}
+
+QString RenderScheduler::dumpTimings() const
+{
+	QStringList lines;
+	for (std::map<QString, ViewRenderTiming>::const_iterator iter=mTimings.begin(); iter!=mTimings.end(); ++iter)
+	{
+		const ViewRenderTiming& timing = iter->second;
+		QString line = QString("%1%2: avg=%3ms last=%4ms renders=%5 deferred=%6")
+				.arg(timing.mName)
+				.arg(timing.mPriority ? "*" : "")
+				.arg(timing.mAverage, 0, 'f', 1)
+				.arg(timing.mLast, 0, 'f', 1)
+				.arg(timing.mRenders)
+				.arg(timing.mDeferrals);
+		for (unsigned i=0; i<timing.mReps.size(); ++i)
+		{
+			if (timing.mReps[i].second > 0)
+				line += QString(" %1=%2ms").arg(timing.mReps[i].first).arg(timing.mReps[i].second, 0, 'f', 1);
+		}
+		lines << line;
+	}
+	return lines.join("\n");
+}
+
+} // namespace cx
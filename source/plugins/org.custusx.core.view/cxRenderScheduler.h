@@ -0,0 +1,117 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#ifndef CXRENDERSCHEDULER_H
+#define CXRENDERSCHEDULER_H
+
+#include "org_custusx_core_view_Export.h"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <QString>
+#include <boost/shared_ptr.hpp>
+
+namespace cx
+{
+
+/** Render statistics for one View.
+ *
+ * \ingroup org_custusx_core_view
+ */
+struct org_custusx_core_view_EXPORT ViewRenderTiming
+{
+	ViewRenderTiming();
+	QString mUid;
+	QString mName;
+	double mLast; ///< time used by the last render, ms
+	double mAverage; ///< running average of render time, ms
+	int mRenders; ///< number of renders recorded
+	int mDeferrals; ///< number of cycles the view has been deferred
+	int mWaiting; ///< number of cycles since last render, while modified
+	bool mPriority;
+	std::vector<std::pair<QString, double> > mReps; ///< update time for each rep at last render, ms
+};
+
+/** Frame budget scheduler for the RenderLoop.
+ *
+ * Collects render times for each View, and decides which views to defer
+ * in the next render cycle. As long as the estimated cost of rendering the
+ * modified views fits inside the budget (the rendering interval), nothing
+ * is deferred. Otherwise, the priority views (e.g. the active view group)
+ * are always rendered, while the remaining views are rendered in the order
+ * they have waited, as long as the budget allows. A view is never deferred
+ * more than getMaxDeferrals() cycles in a row.
+ *
+ * Views not rendered in the last cycle are assumed unmodified, and
+ * are not counted in the estimate.
+ *
+ * \ingroup org_custusx_core_view
+ * \date 2026-10-18
+ */
+class org_custusx_core_view_EXPORT RenderScheduler
+{
+public:
+	RenderScheduler();
+	void setBudget(double ms);
+	double getBudget() const { return mBudget; }
+	void setPriorityViews(const std::set<QString>& uids);
+	void setMaxDeferrals(int cycles);
+	int getMaxDeferrals() const { return mMaxDeferrals; }
+
+	std::set<QString> getDeferredViews(); ///< views to defer in the next cycle
+	/** Record a rendered view. Call after each cycle for all rendered views.
+	 */
+	void addRender(QString uid, QString name, double ms, std::vector<std::pair<QString, double> > reps);
+	/** Record a view that was deferred in the last cycle.
+	 */
+	void addDeferral(QString uid);
+	/** Record a view that was not rendered in the last cycle because it was unmodified.
+	 */
+	void addIdle(QString uid);
+	void removeView(QString uid);
+
+	std::vector<ViewRenderTiming> getTimings() const;
+	ViewRenderTiming getTiming(QString uid) const;
+	QString getTimingText(QString uid) const; ///< short description for display in the view
+	QString dumpTimings() const;
+
+private:
+	double mBudget;
+	int mMaxDeferrals;
+	std::set<QString> mPriorityViews;
+	std::map<QString, ViewRenderTiming> mTimings;
+};
+typedef boost::shared_ptr<RenderScheduler> RenderSchedulerPtr;
+
+} // namespace cx
+
+#endif // CXRENDERSCHEDULER_H
@@ -99,6 +99,7 @@ ViewManager::ViewManager(VisServicesPtr backend) :
 
 	mRenderLoop->setLogging(settings()->value("renderSpeedLogging").toBool());
 	mRenderLoop->setSmartRender(settings()->value("smartRender", true).toBool());
+	mRenderLoop->setTimingOverlay(settings()->value("renderTimingOverlay").toBool());
 	connect(settings(), SIGNAL(valueChangedFor(QString)), this, SLOT(settingsChangedSlot(QString)));
 
 	const unsigned VIEW_GROUP_COUNT = 5; // set this to enough
@@ -118,6 +119,7 @@ ViewManager::ViewManager(VisServicesPtr backend) :
 	mInteractiveCropper.reset(new InteractiveCropper(mBackend->patient()->getActiveData()));
 	connect(mInteractiveCropper.get(), SIGNAL(changed()), mRenderLoop.get(), SLOT(requestPreRenderSignal()));
 	connect(this, SIGNAL(activeViewChanged()), this, SLOT(updateCameraStyleActions()));
+	connect(this, SIGNAL(activeViewChanged()), this, SLOT(updateRenderPriorities()));
 
     this->loadGlobalSettings();
 	// connect to layoutrepo after load of global
@@ -263,6 +265,10 @@ void ViewManager::settingsChangedSlot(QString key)
 	{
 		mRenderLoop->setLogging(settings()->value("renderSpeedLogging").toBool());
 	}
+	if (key == "renderTimingOverlay")
+	{
+		mRenderLoop->setTimingOverlay(settings()->value("renderTimingOverlay").toBool());
+	}
 }
 
 InteractiveCropperPtr ViewManager::getCropper()
@@ -448,6 +454,27 @@ void ViewManager::rebuildLayouts()
 	this->setSlicePlanesProxyInViewsUpTo2DViewgroup();
 
 	mCameraControl->refreshView(this->get3DView());
+	this->updateRenderPriorities();
+}
+
+/**
+ * The views in the active view group, along with all real time views,
+ * are rendered every cycle even when rendering is over budget.
+ */
+void ViewManager::updateRenderPriorities()
+{
+	int activeGroup = std::max(0, this->getActiveViewGroup());
+	std::set<QString> priority;
+	for (unsigned i = 0; i < mViewGroups.size(); ++i)
+	{
+		std::vector<ViewPtr> views = mViewGroups[i]->getViews();
+		for (unsigned j = 0; j < views.size(); ++j)
+		{
+			if ((int(i) == activeGroup) || (views[j]->getType() == View::VIEW_REAL_TIME))
+				priority.insert(views[j]->getUid());
+		}
+	}
+	mRenderLoop->setPriorityViews(priority);
 }
 
 void ViewManager::setSlicePlanesProxyInViewsUpTo2DViewgroup()
@@ -669,6 +696,11 @@ CyclicActionLoggerPtr ViewManager::getRenderTimer()
 	return mRenderLoop->getRenderTimer();
 }
 
+RenderSchedulerPtr ViewManager::getRenderScheduler()
+{
+	return mRenderLoop->getScheduler();
+}
+
 void ViewManager::setCameraStyle(CAMERA_STYLE_TYPE style, int groupIdx)
 {
 	//Set active view before changing camerastyle
@@ -63,6 +63,7 @@ typedef boost::shared_ptr<class InteractiveCropper> InteractiveCropperPtr;
 typedef boost::shared_ptr<class CyclicActionLogger> CyclicActionLoggerPtr;
 typedef boost::shared_ptr<class CameraStyleInteractor> CameraStyleInteractorPtr;
 typedef boost::shared_ptr<class RenderLoop> RenderLoopPtr;
+typedef boost::shared_ptr<class RenderScheduler> RenderSchedulerPtr;
 typedef boost::shared_ptr<class LayoutRepository> LayoutRepositoryPtr;
 typedef boost::shared_ptr<class VisServices> VisServicesPtr;
 typedef boost::shared_ptr<class Navigation> NavigationPtr;
@@ -166,6 +167,7 @@ public:
 	InteractiveCropperPtr getCropper();
 
 	CyclicActionLoggerPtr getRenderTimer();
+	RenderSchedulerPtr getRenderScheduler(); ///< render timings for each view
 
 	void deactivateCurrentLayout();///< deactivate the current layout, leaving an empty layout
 	void autoShowData(DataPtr data);
@@ -192,6 +194,7 @@ protected slots:
 	void updateViews();
 	void updateCameraStyleActions();
 	void setActiveView(QString viewUid);
+	void updateRenderPriorities();
 
 protected:
 	ViewManager(VisServicesPtr backend);
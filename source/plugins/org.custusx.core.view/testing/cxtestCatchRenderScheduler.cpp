@@ -0,0 +1,101 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "catch.hpp"
+#include "cxRenderScheduler.h"
+
+namespace cxtest
+{
+
+namespace
+{
+std::vector<std::pair<QString, double> > noReps()
+{
+	return std::vector<std::pair<QString, double> >();
+}
+}
+
+TEST_CASE("RenderScheduler: Nothing is deferred when inside budget", "[unit][plugins][org.custusx.core.view]")
+{
+	cx::RenderScheduler scheduler;
+	scheduler.setBudget(40);
+	scheduler.addRender("a", "a", 10, noReps());
+	scheduler.addRender("b", "b", 20, noReps());
+
+	CHECK(scheduler.getDeferredViews().empty());
+	CHECK(scheduler.getTiming("b").mAverage == Approx(20));
+	CHECK(scheduler.getTiming("b").mRenders == 1);
+}
+
+TEST_CASE("RenderScheduler: Priority views are rendered, others deferred a limited number of cycles", "[unit][plugins][org.custusx.core.view]")
+{
+	cx::RenderScheduler scheduler;
+	scheduler.setBudget(40);
+	scheduler.setMaxDeferrals(2);
+	std::set<QString> priority;
+	priority.insert("p");
+	scheduler.setPriorityViews(priority);
+
+	scheduler.addRender("p", "p", 30, noReps());
+	scheduler.addRender("a", "a", 20, noReps());
+	scheduler.addRender("b", "b", 5, noReps());
+
+	for (int i=0; i<2; ++i)
+	{
+		std::set<QString> deferred = scheduler.getDeferredViews();
+		CHECK(deferred.size() == 1);
+		CHECK(deferred.count("a"));
+		scheduler.addRender("p", "p", 30, noReps());
+		scheduler.addRender("b", "b", 5, noReps());
+		scheduler.addDeferral("a");
+	}
+
+	// a has waited long enough
+	CHECK(!scheduler.getDeferredViews().count("a"));
+	CHECK(scheduler.getTiming("a").mDeferrals == 2);
+}
+
+TEST_CASE("RenderScheduler: Unmodified views are not counted", "[unit][plugins][org.custusx.core.view]")
+{
+	cx::RenderScheduler scheduler;
+	scheduler.setBudget(40);
+	scheduler.addRender("a", "a", 30, noReps());
+	scheduler.addRender("b", "b", 30, noReps());
+	scheduler.addIdle("b");
+
+	CHECK(scheduler.getDeferredViews().empty());
+
+	scheduler.removeView("a");
+	CHECK(scheduler.getTimings().size() == 1);
+}
+
+} // namespace cxtest
@@ -33,6 +33,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "catch.hpp"
 #include "cxTestRenderSpeed.h"
 #include "cxtestJenkinsMeasurement.h"
+#include "cxLayoutRepository.h"
 
 namespace cxtest
 {
@@ -49,5 +50,23 @@ TEST_CASE("Speed: Render 10 empty viewWidgets", "[speed][gui][integration]")
 //    helper.printResult();
 }
 
+TEST_CASE("Speed: Render all default layouts", "[speed][gui][integration]")
+{
+	cx::LayoutRepository repository;
+	std::vector<QString> layouts = repository.getAvailable();
+	REQUIRE(!layouts.empty());
+
+	for (unsigned i=0; i<layouts.size(); ++i)
+	{
+		TestRenderSpeed helper;
+		helper.testLayout(repository.get(layouts[i]), 50);
+		helper.printResult();
+
+		JenkinsMeasurement jenkins;
+		jenkins.createOutput("FPS_"+layouts[i], QString::number(helper.getRenderFPS()));
+		CHECK(helper.getRenderFPS() > 0);
+	}
+}
+
 
 } //namespace cxtest
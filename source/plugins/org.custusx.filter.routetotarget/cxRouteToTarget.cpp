@@ -5,6 +5,7 @@
 //#include "cxDoubleDataAdapterXml.h"
 #include "cxBranchList.h"
 #include "cxBranch.h"
+#include "cxPointKDTree.h"
 #include <vtkCellArray.h>
 #include "vtkCardinalSpline.h"
 
@@ -56,6 +57,7 @@ void RouteToTarget::processCenterline(vtkPolyDataPtr centerline)
 
 	mBranchListPtr->calculateOrientations();
 	mBranchListPtr->smoothOrientations();
+	mBranchPositionsIndex.reset();
 
 	std::cout << "Number of branches in CT centerline: " << mBranchListPtr->getBranches().size() << std::endl;
 }
@@ -63,28 +65,40 @@ void RouteToTarget::processCenterline(vtkPolyDataPtr centerline)
 
 void RouteToTarget::findClosestPointInBranches(Vector3D targetCoordinate)
 {
+	if (!mBranchPositionsIndex)
+		this->buildBranchPositionsIndex();
 
-	double minDistance = 100000;
-	int minDistancePositionIndex;
-	BranchPtr minDistanceBranch;
+	std::pair<int, double> closest = mBranchPositionsIndex->findNearest(targetCoordinate);
+	if (closest.first < 0)
+		return;
+
+	mProjectedBranchPtr = mBranchPositionsIndexLookup[closest.first].first;
+	mProjectedIndex = mBranchPositionsIndexLookup[closest.first].second;
+}
+
+/** Collect the positions of all branches in a kd-tree,
+ *  reused for all searches until the centerline changes.
+ */
+void RouteToTarget::buildBranchPositionsIndex()
+{
+	mBranchPositionsIndexLookup.clear();
+	std::vector<Eigen::Vector3d> allPositions;
 	std::vector<BranchPtr> branches = mBranchListPtr->getBranches();
 	for (int i = 0; i < branches.size(); i++)
 	{
 		Eigen::MatrixXd positions = branches[i]->getPositions();
 		for (int j = 0; j < positions.cols(); j++)
 		{
-			double D = findDistance(positions.col(j), targetCoordinate);
-			if (D < minDistance)
-			{
-				minDistance = D;
-				minDistanceBranch = branches[i];
-				minDistancePositionIndex = j;
-			}
+			allPositions.push_back(positions.col(j));
+			mBranchPositionsIndexLookup.push_back(std::make_pair(branches[i], j));
 		}
 	}
 
-		mProjectedBranchPtr = minDistanceBranch;
-		mProjectedIndex = minDistancePositionIndex;
+	Eigen::MatrixXd positions(3, allPositions.size());
+	for (int i = 0; i < allPositions.size(); i++)
+		positions.col(i) = allPositions[i];
+
+	mBranchPositionsIndex.reset(new PointKDTree(positions));
 }
 
 
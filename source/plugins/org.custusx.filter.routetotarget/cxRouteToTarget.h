@@ -12,6 +12,7 @@ typedef std::vector< Eigen::Matrix4d > M4Vector;
 typedef boost::shared_ptr<class RouteToTarget> RouteToTargetPtr;
 typedef boost::shared_ptr<class BranchList> BranchListPtr;
 typedef boost::shared_ptr<class Branch> BranchPtr;
+typedef boost::shared_ptr<class PointKDTree> PointKDTreePtr;
 
 
 class RouteToTarget
@@ -36,7 +37,10 @@ private:
 	std::vector< Eigen::Vector3d > mRoutePositions;
 	std::vector<BranchPtr> mSearchBranchPtrVector;
 	std::vector<int> mSearchIndexVector;
+	PointKDTreePtr mBranchPositionsIndex; ///< all branch positions, for fast search
+	std::vector<std::pair<BranchPtr, int> > mBranchPositionsIndexLookup; ///< branch and position index for each point in mBranchPositionsIndex
 	void smoothPositions();
+	void buildBranchPositionsIndex();
 };
 
 double findDistance(Eigen::MatrixXd p1, Eigen::MatrixXd p2);
@@ -35,6 +35,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxVector3D.h"
 #include <vtkPolyData.h>
 #include "vtkCardinalSpline.h"
+#include <algorithm>
+#include <limits>
 
 typedef vtkSmartPointer<class vtkCardinalSpline> vtkCardinalSplinePtr;
 
@@ -207,41 +209,41 @@ void BranchList::smoothBranchPositions()
 void BranchList::findBranchesInCenterline(Eigen::MatrixXd positions)
 {
 	positions = sortMatrix(2,positions);
-	Eigen::MatrixXd positionsNotUsed = positions;
+	PointKDTree positionsNotUsed(positions);
 
-//	int minIndex;
-	int index;
 	int splitIndex;
-	Eigen::MatrixXd::Index startIndex;
+	int startIndex;
+	int topIndex = positions.cols() - 1;
 	BranchPtr branchToSplit;
-    while (positionsNotUsed.cols() > 0)
+	while (!positionsNotUsed.empty())
 	{
 		if (!mBranches.empty())
 		{
 			double minDistance = 1000;
 			for (int i = 0; i < mBranches.size(); i++)
 			{
-				std::pair<std::vector<Eigen::MatrixXd::Index>, Eigen::VectorXd> distances;
-				distances = dsearchn(positionsNotUsed, mBranches[i]->getPositions());
-				double d = distances.second.minCoeff(&index);
+				std::pair<int, double> closest = findClosestPoint(mBranches[i]->getPositions(), positionsNotUsed);
+				double d = closest.second;
 				if (d < minDistance)
 				{
 					minDistance = d;
 					branchToSplit = mBranches[i];
-					startIndex = index;
+					startIndex = closest.first;
 					if (minDistance < 2)
 						break;
 				}
 			}
-			std::pair<Eigen::MatrixXd::Index, double> dsearchResult = dsearch(positionsNotUsed.col(startIndex) , branchToSplit->getPositions());
+			std::pair<Eigen::MatrixXd::Index, double> dsearchResult = dsearch(positions.col(startIndex) , branchToSplit->getPositions());
 			splitIndex = dsearchResult.first;
 		}
 		else //if this is the first branch. Select the top position (Trachea).
-			startIndex = positionsNotUsed.cols() - 1;
+		{
+			while (!positionsNotUsed.contains(topIndex))
+				--topIndex;
+			startIndex = topIndex;
+		}
 
-		std::pair<Eigen::MatrixXd,Eigen::MatrixXd > connectedPointsResult = findConnectedPointsInCT(startIndex , positionsNotUsed);
-		Eigen::MatrixXd branchPositions = connectedPointsResult.first;
-		positionsNotUsed = connectedPointsResult.second;
+		Eigen::MatrixXd branchPositions = findConnectedPointsInCT(startIndex , &positionsNotUsed);
 
 		if (branchPositions.cols() >= 5) //only include brances of length >= 5 points
 		{
@@ -307,39 +309,59 @@ BranchListPtr BranchList::removePositionsForLocalRegistration(Eigen::MatrixXd tr
 	}
 
 	std::vector<BranchPtr> branches = retval->getBranches();
+	PointKDTree trackingPositionsIndex(trackingPositions);
 	Eigen::MatrixXd positions;
 	Eigen::MatrixXd orientations;
 	for (int i = 0; i < branches.size(); i++)
 	{
 		positions = branches[i]->getPositions();
 		orientations = branches[i]->getOrientations();
-		std::pair<std::vector<Eigen::MatrixXd::Index>, Eigen::VectorXd> distanceData;
-		distanceData = dsearchn(positions, trackingPositions);
-		Eigen::VectorXd distance = distanceData.second;
-        for (int j = positions.cols() - 1; j >= 0; j--)
+		std::vector<int> keep;
+		for (int j = 0; j < positions.cols(); j++)
 		{
-			if (distance(j) > maxDistance)
-			{
-				positions = eraseCol(j, positions);
-				orientations = eraseCol(j, orientations);
-			}
+			double distance = trackingPositionsIndex.findNearest(positions.col(j)).second;
+			if (distance <= maxDistance)
+				keep.push_back(j);
 		}
-		branches[i]->setPositions(positions);
-		branches[i]->setOrientations(orientations);
+		branches[i]->setPositions(selectCols(keep, positions));
+		branches[i]->setOrientations(selectCols(keep, orientations));
 	}
 	return retval;
 }
 
-Eigen::MatrixXd sortMatrix(int rowNumber, Eigen::MatrixXd matrix)
+namespace
+{
+/** Order column indices after the values in one row.
+ */
+class RowValueLess
 {
-	for (int i = 0; i < matrix.cols() - 1; i++)  {
-	   for (int j = i + 1; j < matrix.cols(); j++) {
-		  if (matrix(rowNumber,i) > matrix(rowNumber,j)){
-			  matrix.col(i).swap(matrix.col(j));
-		  }
-	   }
+public:
+	RowValueLess(const Eigen::MatrixXd& matrix, int rowNumber) : mMatrix(matrix), mRowNumber(rowNumber) {}
+	bool operator()(int a, int b) const
+	{
+		return mMatrix(mRowNumber, a) < mMatrix(mRowNumber, b);
 	}
-return matrix;
+private:
+	const Eigen::MatrixXd& mMatrix;
+	int mRowNumber;
+};
+}
+
+Eigen::MatrixXd sortMatrix(int rowNumber, Eigen::MatrixXd matrix)
+{
+	std::vector<int> order(matrix.cols());
+	for (int i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), RowValueLess(matrix, rowNumber));
+	return selectCols(order, matrix);
+}
+
+Eigen::MatrixXd selectCols(const std::vector<int>& indices, const Eigen::MatrixXd& matrix)
+{
+	Eigen::MatrixXd retval(matrix.rows(), indices.size());
+	for (int i = 0; i < indices.size(); i++)
+		retval.col(i) = matrix.col(indices[i]);
+	return retval;
 }
 
 
@@ -376,38 +398,45 @@ std::pair<std::vector<Eigen::MatrixXd::Index>, Eigen::VectorXd > dsearchn(Eigen:
 	return std::make_pair(indexVector , D);
 }
 
-std::pair<Eigen::MatrixXd,Eigen::MatrixXd > findConnectedPointsInCT(int startIndex , Eigen::MatrixXd positionsNotUsed)
+std::pair<int, double> findClosestPoint(Eigen::MatrixXd positions, const PointKDTree& points)
+{
+	std::pair<int, double> retval(-1, std::numeric_limits<double>::max());
+	for (int i = 0; i < positions.cols(); i++)
+	{
+		std::pair<int, double> closest = points.findNearest(positions.col(i));
+		if (closest.first < 0)
+			break;
+		if ((closest.second < retval.second) || (closest.second == retval.second && closest.first < retval.first))
+			retval = closest;
+	}
+	return retval;
+}
+
+Eigen::MatrixXd findConnectedPointsInCT(int startIndex , PointKDTree* positionsNotUsed)
 {
-    //Eigen::MatrixXd branchPositions(positionsNotUsed.rows(), positionsNotUsed.cols());
-	Eigen::MatrixXd thisPosition(3,1);
-    std::vector<Eigen::MatrixXd> branchPositionsVector;
-	thisPosition = positionsNotUsed.col(startIndex);
-    branchPositionsVector.push_back(thisPosition); //add first position to branch
-	positionsNotUsed = eraseCol(startIndex,positionsNotUsed);; //remove first position from list of remaining points
-
-    while (positionsNotUsed.cols() > 0)
+	std::vector<int> branchIndices;
+	int thisIndex = startIndex;
+	branchIndices.push_back(thisIndex); //add first position to branch
+	positionsNotUsed->remove(thisIndex); //remove first position from list of remaining points
+
+	while (!positionsNotUsed->empty())
 	{
-		std::pair<Eigen::MatrixXd::Index, double > minDistance = dsearch(thisPosition, positionsNotUsed);
-		Eigen::MatrixXd::Index index = minDistance.first;
-        double d = minDistance.second;
+		std::pair<int, double> minDistance = positionsNotUsed->findNearest(positionsNotUsed->getPoint(thisIndex));
+		double d = minDistance.second;
 		if (d > 3) // more than 3 mm distance to closest point --> branch is compledted
 			break;
 
-		thisPosition = positionsNotUsed.col(index);
-		positionsNotUsed = eraseCol(index,positionsNotUsed);
+		thisIndex = minDistance.first;
+		positionsNotUsed->remove(thisIndex);
 		//add position to branch
-        branchPositionsVector.push_back(thisPosition);
-
+		branchIndices.push_back(thisIndex);
 	}
 
-    Eigen::MatrixXd branchPositions(3,branchPositionsVector.size());
-
-    for (int j = 0; j < branchPositionsVector.size(); j++)
-    {
-        branchPositions.block(0,j,3,1) = branchPositionsVector[j];
-    }
+	Eigen::MatrixXd branchPositions(3,branchIndices.size());
+	for (int j = 0; j < branchIndices.size(); j++)
+		branchPositions.col(j) = positionsNotUsed->getPoint(branchIndices[j]);
 
-    return std::make_pair(branchPositions, positionsNotUsed);
+	return branchPositions;
 }
 
 
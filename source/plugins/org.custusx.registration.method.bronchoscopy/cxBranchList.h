@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxBranch.h"
 #include "cxMesh.h"
 #include "cxVector3D.h"
+#include "cxPointKDTree.h"
 #include <vtkPolyData.h>
 #include "org_custusx_registration_method_bronchoscopy_Export.h"
 
@@ -65,8 +66,18 @@ public:
 
 };
 
-std::pair<Eigen::MatrixXd,Eigen::MatrixXd > findConnectedPointsInCT(int startIndex , Eigen::MatrixXd positionsNotUsed);
-Eigen::MatrixXd sortMatrix(int rowNumber, Eigen::MatrixXd matrix);
+/** Trace a branch from startIndex by repeatedly stepping to the closest unused point,
+ *  until no unused point is within 3 mm. The branch points are removed from positionsNotUsed.
+ */
+Eigen::MatrixXd findConnectedPointsInCT(int startIndex , PointKDTree* positionsNotUsed);
+/** Return the point in points closest to any of positions, and the distance.
+ */
+std::pair<int, double> findClosestPoint(Eigen::MatrixXd positions, const PointKDTree& points);
+/** Return matrix with the columns sorted after the values in row rowNumber.
+ *  Columns with equal values keep their order.
+ */
+org_custusx_registration_method_bronchoscopy_EXPORT Eigen::MatrixXd sortMatrix(int rowNumber, Eigen::MatrixXd matrix);
+Eigen::MatrixXd selectCols(const std::vector<int>& indices, const Eigen::MatrixXd& matrix);
 Eigen::MatrixXd eraseCol(int removeIndex, Eigen::MatrixXd positions);
 std::pair<Eigen::MatrixXd::Index, double> dsearch(Eigen::Vector3d p, Eigen::MatrixXd positions);
 std::pair<std::vector<Eigen::MatrixXd::Index>, Eigen::VectorXd > dsearchn(Eigen::MatrixXd p1, Eigen::MatrixXd p2);
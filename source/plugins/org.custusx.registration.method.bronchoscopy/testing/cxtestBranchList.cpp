@@ -0,0 +1,75 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "catch.hpp"
+#include "cxBranchList.h"
+
+namespace cxtest
+{
+
+TEST_CASE("BranchList: sortMatrix orders columns after one row", "[unit][plugins][org.custusx.registration.method.bronchoscopy]")
+{
+	Eigen::MatrixXd positions(3, 4);
+	positions << 0, 1, 2, 3,
+				 0, 0, 0, 0,
+				 7, 5, 6, 4;
+
+	Eigen::MatrixXd sorted = cx::sortMatrix(2, positions);
+
+	REQUIRE( sorted.cols() == 4 );
+	CHECK( sorted(0,0) == 3 );
+	CHECK( sorted(0,1) == 1 );
+	CHECK( sorted(0,2) == 2 );
+	CHECK( sorted(0,3) == 0 );
+}
+
+TEST_CASE("BranchList: sortMatrix keeps the input order of columns with equal values", "[unit][plugins][org.custusx.registration.method.bronchoscopy]")
+{
+	// The previous swap sort gave a data dependent order among equal z values,
+	// here x = 3, 1, 2, 0, 4. The stable sort keeps the input order.
+	Eigen::MatrixXd positions(3, 5);
+	positions << 0, 1, 2, 3, 4,
+				 0, 0, 0, 0, 0,
+				 5, 5, 5, 1, 9;
+
+	Eigen::MatrixXd sorted = cx::sortMatrix(2, positions);
+
+	REQUIRE( sorted.cols() == 5 );
+	CHECK( sorted(0,0) == 3 );
+	CHECK( sorted(0,1) == 0 );
+	CHECK( sorted(0,2) == 1 );
+	CHECK( sorted(0,3) == 2 );
+	CHECK( sorted(0,4) == 4 );
+	CHECK( sorted.row(2).maxCoeff() == 9 );
+}
+
+} // namespace cxtest
@@ -42,9 +42,31 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "vesselReg/SeansVesselReg.hxx"
 #include "cxRegistrationTransform.h"
 #include "cxTypeConversions.h"
+#include "cxtestPatientModelServiceMock.h"
 #include <QFileInfo>
 #include <QDir>
 
+namespace
+{
+cx::Transform3D registerVessels(cx::Transform3D perturbation, QString filenameSource, QString filenameTarget, int coarseToFineMinimumPoints)
+{
+	cxtest::PatientModelServiceMock pasm;
+	QString dummy;
+	cx::DataPtr source = pasm.importData(filenameSource, dummy);
+	cx::DataPtr target = pasm.importData(filenameTarget, dummy);
+	REQUIRE(source);
+	REQUIRE(target);
+	source->get_rMd_History()->setRegistration(perturbation);
+
+	cx::SeansVesselReg vesselReg;
+	vesselReg.mt_doOnlyLinear = true;
+	vesselReg.mt_coarseToFineMinimumPoints = coarseToFineMinimumPoints;
+	REQUIRE(vesselReg.initialize(source, target, cx::DataLocations::getTestDataPath() + "/Log"));
+	REQUIRE(vesselReg.execute());
+	return vesselReg.getLinearResult();
+}
+}
+
 
 TEST_CASE_METHOD(cxtest::SeansVesselRegFixture, "SeansVesselReg: V2V syntectic data", "[integration][modules][registration][not_win32]")
 //void TestRegistrationV2V::testV2V_synthetic_data()
@@ -93,6 +115,33 @@ TEST_CASE_METHOD(cxtest::SeansVesselRegFixture, "SeansVesselReg: V2V syntectic d
 //	}
 }
 
+TEST_CASE("SeansVesselReg: Coarse-to-fine gives the same result as full resolution", "[integration][modules][registration][not_win32]")
+{
+	QString fname1 = cx::DataLocations::getTestDataPath() + "/testing/Centerline/US_aneurism_cl_size1.vtk";
+	QString fname2 = cx::DataLocations::getTestDataPath() + "/testing/Centerline/US_aneurism_cl_size2.vtk";
+	double tol_dist = 0.5;
+	double tol_angle = 0.5/180.0*M_PI;
+
+	cx::Transform3D T_center = cx::createTransformTranslate(cx::Vector3D(-33,-47,-17));
+	cx::Transform3D R_xy3 = cx::createTransformRotateY(3 / 180.0 * M_PI) * cx::createTransformRotateX(3 / 180.0 * M_PI);
+	std::vector<cx::Transform3D> pert;
+	pert.push_back(cx::createTransformTranslate(cx::Vector3D(1,1,1)));
+	pert.push_back(T_center * R_xy3 * T_center.inv());
+
+	for (unsigned i = 0; i < pert.size(); ++i)
+	{
+		cx::Transform3D full = registerVessels(pert[i], fname1, fname2, 0);
+		cx::Transform3D coarseToFine = registerVessels(pert[i], fname1, fname2, 200);
+
+		cx::Transform3D diff = coarseToFine * full.inv();
+		double dist = cx::Vector3D(diff.matrix().block<3, 1>(0, 3)).norm();
+		double angle = Eigen::AngleAxisd(diff.matrix().block<3, 3>(0, 0)).angle();
+		INFO("perturbation " << i << ": distance " << dist << ", angle " << angle);
+		CHECK(dist < tol_dist);
+		CHECK(angle < tol_angle);
+	}
+}
+
 TEST_CASE_METHOD(cxtest::SeansVesselRegFixture, "SeansVesselReg: V2V registration", "[integration][modules][registration][not_win32]")
 //void TestRegistrationV2V::testVessel2VesselRegistration()
 {
@@ -41,6 +41,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vtkImageData.h>
 #include "cxImage.h"
 #include "cxDoubleProperty.h"
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <boost/bind.hpp>
 
 namespace cx
 {
@@ -60,6 +63,7 @@ std::vector<PropertyPtr> PNNReconstructionMethodService::getSettings(QDomElement
 {
 	std::vector<PropertyPtr> retval;
 	retval.push_back(this->getInterpolationStepsOption(root));
+	retval.push_back(this->getNumberOfThreadsOption(root));
 	return retval;
 }
 
@@ -71,17 +75,160 @@ DoublePropertyPtr PNNReconstructionMethodService::getInterpolationStepsOption(QD
 	return retval;
 }
 
-void optimizedCoordTransform(Vector3D* p, boost::array<double, 16> tt)
+DoublePropertyPtr PNNReconstructionMethodService::getNumberOfThreadsOption(QDomElement root)
 {
-	double* t = tt.begin();
-	double x = (*p)[0];
-	double y = (*p)[1];
-	double z = (*p)[2];
-	(*p)[0] = t[0] * x + t[1] * y + t[2] * z + t[3];
-	(*p)[1] = t[4] * x + t[5] * y + t[6] * z + t[7];
-	(*p)[2] = t[8] * x + t[9] * y + t[10] * z + t[11];
+	DoublePropertyPtr retval;
+	retval = DoubleProperty::initialize("numberOfThreads", "Threads",
+		"Number of threads used for reconstruction. 0 means use all available cores.", 0, DoubleRange(0, 64, 1), 0, root);
+	return retval;
+}
+
+int PNNReconstructionMethodService::getNumberOfThreads(QDomElement root)
+{
+	int retval = static_cast<int> (this->getNumberOfThreadsOption(root)->getValue());
+	if (retval <= 0)
+		retval = QThread::idealThreadCount();
+	return std::max(retval, 1);
+}
+
+namespace
+{
+/**Input to the forward projection of the PNN algorithm,
+ * shared read-only between all threads.
+ */
+struct PNNForwardProjectionData
+{
+	std::vector<unsigned char*> mFrames;
+	std::vector<boost::array<double, 16> > mTransforms;
+	Eigen::Array3i mInputDims;
+	Vector3D mInputSpacing;
+	unsigned char* mMask;
+	Eigen::Array3i mOutputDims;
+	Vector3D mOutputSpacing;
+	unsigned char* mOutput;
+};
+
+/**Find the range of z values in output voxel coordinates covered by
+ * the frame with the given transform.
+ */
+void findFrameZRange(const PNNForwardProjectionData& data, const double* t, double* zMin, double* zMax)
+{
+	double xMax = (data.mInputDims[0]-1) * data.mInputSpacing[0];
+	double yMax = (data.mInputDims[1]-1) * data.mInputSpacing[1];
+	double corners[4] = { t[11],
+						  t[8]*xMax + t[11],
+						  t[9]*yMax + t[11],
+						  t[8]*xMax + t[9]*yMax + t[11] };
+	*zMin = *std::min_element(corners, corners+4) / data.mOutputSpacing[2];
+	*zMax = *std::max_element(corners, corners+4) / data.mOutputSpacing[2];
+}
+
+/**Find the range of samples along a beam that can hit the output slab [zStart, zStop>.
+ * The range is conservative: Each sample inside it must still be tested.
+ *
+ * z0 is the beam start and dz the beam z increment per sample, in output voxel coordinates.
+ */
+bool findSampleRange(double z0, double dz, int zStart, int zStop, int numberOfSamples, int* sampleStart, int* sampleStop)
+{
+	// padded with more than the rounding distance, the rounding towards zero of negative values
+	// and the accumulated round-off in the per-sample coordinate computation.
+	double low = zStart - 2.0;
+	double high = zStop + 1.0;
+
+	if (std::fabs(dz) < 1.0E-9)
+	{
+		*sampleStart = 0;
+		*sampleStop = numberOfSamples;
+		return (low <= z0) && (z0 <= high);
+	}
+
+	double a = (low - z0) / dz;
+	double b = (high - z0) / dz;
+	double first = std::floor(std::min(a, b)) - 1;
+	double last = std::ceil(std::max(a, b)) + 1;
+	first = std::max<double>(first, 0);
+	last = std::min<double>(last, numberOfSamples-1);
+	if (first > last)
+		return false;
+	*sampleStart = static_cast<int> (first);
+	*sampleStop = static_cast<int> (last) + 1;
+	return true;
 }
 
+/**Forward project all input pixels into the output slab z=[zStart, zStop>.
+ *
+ * Each output voxel is owned by exactly one slab, and each slab traverses the
+ * input in the same record-beam-sample order as a single threaded run.
+ * The result is thus identical regardless of how the volume is split.
+ *
+ * The pixel position is computed from a per-beam base point plus the
+ * sample offset along the beam direction. The arithmetic is kept identical
+ * to a full transform of (x,y,0), so that voxel rounding is unchanged.
+ *
+ * Optimized code: Change with care!
+ */
+void forwardProjectSlab(const PNNForwardProjectionData& data, int zStart, int zStop)
+{
+	const Eigen::Array3i& inputDims = data.mInputDims;
+	const Eigen::Array3i& outputDims = data.mOutputDims;
+	const Vector3D& inputSpacing = data.mInputSpacing;
+	const Vector3D& outputSpacing = data.mOutputSpacing;
+	unsigned char* maskPointer = data.mMask;
+	unsigned char* outputPointer = data.mOutput;
+
+	for (unsigned record = 0; record < data.mFrames.size(); record++)
+	{
+		unsigned char *inputPointer = data.mFrames[record];
+		const double* t = data.mTransforms[record].data();
+
+		double frameZMin, frameZMax;
+		findFrameZRange(data, t, &frameZMin, &frameZMax);
+		if ((frameZMax < zStart - 2) || (frameZMin > zStop + 1))
+			continue;
+
+		for (int beam = 0; beam < inputDims[0]; beam++)
+		{
+			double x = beam * inputSpacing[0];
+			// base point of beam, excluding the translation
+			double baseX = t[0] * x;
+			double baseY = t[4] * x;
+			double baseZ = t[8] * x;
+
+			int sampleStart = 0;
+			int sampleStop = 0;
+			double z0 = (baseZ + t[11]) / outputSpacing[2];
+			double dz = t[9] * inputSpacing[1] / outputSpacing[2];
+			if (!findSampleRange(z0, dz, zStart, zStop, inputDims[1], &sampleStart, &sampleStop))
+				continue;
+
+			for (int sample = sampleStart; sample < sampleStop; sample++)
+			{
+				if (!(maskPointer[beam + sample * inputDims[0]] != 0))
+					continue;
+				double y = sample * inputSpacing[1];
+				int outputVoxelX = static_cast<int> ((((baseX + t[1] * y) + t[3]) / outputSpacing[0]) + 0.5);
+				int outputVoxelY = static_cast<int> ((((baseY + t[5] * y) + t[7]) / outputSpacing[1]) + 0.5);
+				int outputVoxelZ = static_cast<int> ((((baseZ + t[9] * y) + t[11]) / outputSpacing[2]) + 0.5);
+
+				if ((outputVoxelZ < zStart) || (outputVoxelZ >= zStop))
+					continue;
+				if ((outputVoxelX < 0) || (outputVoxelX >= outputDims[0]) || (outputVoxelY < 0) || (outputVoxelY >= outputDims[1]))
+					continue;
+
+				int outputIndex = outputVoxelX + outputVoxelY * outputDims[0] + outputVoxelZ * outputDims[0]
+					* outputDims[1];
+				int inputIndex = beam + sample * inputDims[0];
+
+				// assign the max value found from all frames hitting this voxel. This removes black areas where (some of) multiple sweeps contains shadows.
+				outputPointer[outputIndex] = std::max<unsigned char>(inputPointer[inputIndex], outputPointer[outputIndex]);
+				// set minimum intensity value to 1. This separates "zero intensity" from "no intensity".
+				outputPointer[outputIndex] = std::max<unsigned char>(inputPointer[inputIndex], 1); //
+			}//sample
+		}//beam
+	}//record
+}
+} // unnamed namespace
+
 bool PNNReconstructionMethodService::reconstruct(ProcessedUSInputDataPtr input,
 		vtkImageDataPtr outputData, QDomElement settings)
 {
@@ -104,54 +251,54 @@ bool PNNReconstructionMethodService::reconstruct(ProcessedUSInputDataPtr input,
 	vtkImageDataPtr tempOutput = generateVtkImageData(targetDims, targetSpacing, 0);
 	ImagePtr tempOutputData = ImagePtr(new Image("tempOutput", tempOutput, "tempOutput"));
 
-	int* outputDims = tempOutput->GetDimensions();
-	//int* outputDims = target->GetDimensions();
-
 	if (inputDims[2] != static_cast<int> (frameInfo.size()))
 		reportWarning("inputDims[2] != frameInfo.size()" + qstring_cast(inputDims[2]) + " != "
 			+ qstring_cast(frameInfo.size()));
 
-	Vector3D inputSpacing(input->getSpacing());
-	Vector3D outputSpacing(tempOutput->GetSpacing());
-
-	//Get raw data pointers
-	unsigned char *outputPointer = static_cast<unsigned char*> (tempOutput->GetScalarPointer());
-	unsigned char* maskPointer = static_cast<unsigned char*> (input->getMask()->GetScalarPointer());
-
-	// Traverse all input pixels
+	// Collect all input in one place before spreading it to the threads,
+	// in order to avoid touching vtk objects from several threads.
+	PNNForwardProjectionData data;
+	data.mInputDims = inputDims;
+	data.mInputSpacing = input->getSpacing();
+	data.mMask = static_cast<unsigned char*> (input->getMask()->GetScalarPointer());
+	data.mOutputDims = Eigen::Array3i(tempOutput->GetDimensions());
+	data.mOutputSpacing = Vector3D(tempOutput->GetSpacing());
+	data.mOutput = static_cast<unsigned char*> (tempOutput->GetScalarPointer());
 	for (int record = 0; record < inputDims[2]; record++)
 	{
-		unsigned char *inputPointer = input->getFrame(record);
-		boost::array<double, 16> recordTransform = frameInfo[record].mPos.flatten();
+		data.mFrames.push_back(input->getFrame(record));
+		data.mTransforms.push_back(frameInfo[record].mPos.flatten());
+	}
 
-		for (int beam = 0; beam < inputDims[0]; beam++)
-		{
-			for (int sample = 0; sample < inputDims[1]; sample++)
-			{
-				if (!validPixel(beam, sample, inputDims, maskPointer))
-					continue;
-				Vector3D inputPoint(beam * inputSpacing[0], sample * inputSpacing[1], 0.0);
-				Vector3D outputPoint = inputPoint;
-				optimizedCoordTransform(&outputPoint, recordTransform);
-				int outputVoxelX = static_cast<int> ((outputPoint[0] / outputSpacing[0]) + 0.5);
-				int outputVoxelY = static_cast<int> ((outputPoint[1] / outputSpacing[1]) + 0.5);
-				int outputVoxelZ = static_cast<int> ((outputPoint[2] / outputSpacing[2]) + 0.5);
-
-				if (validVoxel(outputVoxelX, outputVoxelY, outputVoxelZ, outputDims))
-				{
-					int outputIndex = outputVoxelX + outputVoxelY * outputDims[0] + outputVoxelZ * outputDims[0]
-						* outputDims[1];
-					int inputIndex = beam + sample * inputDims[0];
+	TimeKeeper timer;
+	int numberOfThreads = std::min(this->getNumberOfThreads(settings), data.mOutputDims[2]);
 
-					// assign the max value found from all frames hitting this voxel. This removes black areas where (some of) multiple sweeps contains shadows.
-					outputPointer[outputIndex] = std::max<unsigned char>(inputPointer[inputIndex], outputPointer[outputIndex]);
-					// set minimum intensity value to 1. This separates "zero intensity" from "no intensity".
-					outputPointer[outputIndex] = std::max<unsigned char>(inputPointer[inputIndex], 1); //
-				}//validVoxel
+	if (numberOfThreads <= 1)
+	{
+		forwardProjectSlab(data, 0, data.mOutputDims[2]);
+	}
+	else
+	{
+		// Split the volume into more slabs than threads, as the
+		// frames usually cover only parts of the volume.
+		int numberOfSlabs = std::min(4*numberOfThreads, data.mOutputDims[2]);
+		QThreadPool pool;
+		pool.setMaxThreadCount(numberOfThreads);
+		std::vector<QFuture<void> > slabs;
+		for (int i = 0; i < numberOfSlabs; ++i)
+		{
+			int zStart = (i * data.mOutputDims[2]) / numberOfSlabs;
+			int zStop = ((i+1) * data.mOutputDims[2]) / numberOfSlabs;
+			slabs.push_back(QtConcurrent::run(&pool, boost::bind(&forwardProjectSlab, boost::cref(data), zStart, zStop)));
+		}
+		for (unsigned i = 0; i < slabs.size(); ++i)
+			slabs[i].waitForFinished();
+	}
 
-			}//sample
-		}//beam
-	}//record
+	reportDebug(QString("PNN: Forward projected %1 frames using %2 threads [%3s]")
+				.arg(data.mFrames.size())
+				.arg(numberOfThreads)
+				.arg(timer.getElapsedSecondsAsString()));
 
 	// Fill holes
 	this->interpolate(tempOutputData, outputData, settings);
@@ -160,6 +307,62 @@ bool PNNReconstructionMethodService::reconstruct(ProcessedUSInputDataPtr input,
 	return true;
 }
 
+IncrementalReconstructionPtr PNNReconstructionMethodService::createIncrementalReconstruction(QDomElement settings)
+{
+	return IncrementalReconstructionPtr(new PNNIncrementalReconstruction(this, settings));
+}
+
+PNNIncrementalReconstruction::PNNIncrementalReconstruction(PNNReconstructionMethodService* service, QDomElement settings) :
+	mService(service),
+	mSettings(settings)
+{
+}
+
+void PNNIncrementalReconstruction::setInput(vtkImageDataPtr mask)
+{
+	mMask = mask;
+}
+
+void PNNIncrementalReconstruction::setOutput(vtkImageDataPtr outputData)
+{
+	mOutput = outputData;
+}
+
+void PNNIncrementalReconstruction::addFrame(unsigned char* frame, Transform3D dMu)
+{
+	if (!mMask || !mOutput)
+		return;
+
+	PNNForwardProjectionData data;
+	data.mInputDims = Eigen::Array3i(mMask->GetDimensions());
+	data.mInputDims[2] = 1;
+	data.mInputSpacing = Vector3D(mMask->GetSpacing());
+	data.mMask = static_cast<unsigned char*> (mMask->GetScalarPointer());
+	data.mOutputDims = Eigen::Array3i(mOutput->GetDimensions());
+	data.mOutputSpacing = Vector3D(mOutput->GetSpacing());
+	data.mOutput = static_cast<unsigned char*> (mOutput->GetScalarPointer());
+	data.mFrames.push_back(frame);
+	data.mTransforms.push_back(dMu.flatten());
+
+	forwardProjectSlab(data, 0, data.mOutputDims[2]);
+}
+
+vtkImageDataPtr PNNIncrementalReconstruction::finish()
+{
+	if (!mOutput)
+		return vtkImageDataPtr();
+
+	Eigen::Array3i dims(mOutput->GetDimensions());
+	Vector3D spacing(mOutput->GetSpacing());
+	vtkImageDataPtr retval = generateVtkImageData(dims, spacing, 0);
+	ImagePtr forwardProjected = ImagePtr(new Image("tempOutput", mOutput, "tempOutput"));
+
+	mService->interpolate(forwardProjected, retval, mSettings);
+
+	setDeepModified(retval);
+	return retval;
+}
+
 namespace
 {
 /**Used in createMask()
@@ -248,123 +451,232 @@ vtkImageDataPtr PNNReconstructionMethodService::createMask(vtkImageDataPtr input
 	return mask;
 }
 
-void PNNReconstructionMethodService::interpolate(ImagePtr inputData, vtkImageDataPtr outputData, QDomElement settings)
+namespace
 {
-	TimeKeeper timer;
-	DoublePropertyPtr interpolationStepsOption = this->getInterpolationStepsOption(settings);
-	int interpolationSteps = static_cast<int> (interpolationStepsOption->getValue());
+/**Input to the hole filling of the PNN algorithm,
+ * shared read-only between all threads.
+ */
+struct PNNHoleFillData
+{
+	unsigned char* mInput;
+	unsigned char* mOutput;
+	unsigned char* mMask;
+	Eigen::Array3i mDims;
+	int mInterpolationSteps;
+};
+
+/**Voxel counts from the hole filling of one slab.
+ */
+struct PNNHoleFillCount
+{
+	PNNHoleFillCount() : mRemoved(0), mIgnored(0) {}
+	long mRemoved;
+	long mIgnored;
+};
 
-	vtkImageDataPtr input = inputData->getBaseVtkImageData();
-	vtkImageDataPtr output = outputData;
-	vtkImageDataPtr mask = this->createMask(input);
+/**Summed volume table of the value and the number of nonzero voxels,
+ * covering all x,y and a range of z in a volume.
+ *
+ * The tables are stored in unsigned ints with wraparound. A box sum is exact
+ * as long as the sum itself fits in an unsigned int, which holds for
+ * all boxes up to the max interpolation steps.
+ */
+class SummedVolumeTable
+{
+public:
+	SummedVolumeTable(unsigned char* volume, const Eigen::Array3i& dims, int zStart, int zStop) :
+		mZStart(zStart)
+	{
+		mStride[0] = 1;
+		mStride[1] = dims[0]+1;
+		mStride[2] = (dims[0]+1)*(dims[1]+1);
+		mSum.resize(mStride[2]*(zStop-zStart+1), 0);
+		mCount.resize(mSum.size(), 0);
 
-	Eigen::Array3i outputDims(output->GetDimensions());
+		for (int z = zStart; z < zStop; z++)
+		{
+			unsigned char* slice = volume + z*dims[0]*dims[1];
+			for (int y = 0; y < dims[1]; y++)
+			{
+				unsigned char* row = slice + y*dims[0];
+				unsigned int rowSum = 0;
+				unsigned int rowCount = 0;
+				int index = this->getIndex(0, y+1, z+1);
+				for (int x = 0; x < dims[0]; x++)
+				{
+					rowSum += row[x];
+					rowCount += (row[x]>0) ? 1 : 0;
+					index++;
+					// add the row prefix to the table one line and one slice back
+					mSum[index] = rowSum
+								  + mSum[index - mStride[1]] + mSum[index - mStride[2]]
+								  - mSum[index - mStride[1] - mStride[2]];
+					mCount[index] = rowCount
+								  + mCount[index - mStride[1]] + mCount[index - mStride[2]]
+								  - mCount[index - mStride[1] - mStride[2]];
+				}
+			}
+		}
+	}
 
-	Eigen::Array3i inputDims(input->GetDimensions());
+	/** Find sum and nonzero count inside the box [x0,x1]x[y0,y1]x[z0,z1], inclusive.
+	  */
+	void getBoxSum(int x0, int x1, int y0, int y1, int z0, int z1, unsigned int* sum, unsigned int* count) const
+	{
+		int i111 = this->getIndex(x1, y1, z1) + mStride[0] + mStride[1] + mStride[2];
+		int i011 = i111 - (x1-x0+1)*mStride[0];
+		int i101 = i111 - (y1-y0+1)*mStride[1];
+		int i110 = i111 - (z1-z0+1)*mStride[2];
+		int i001 = i011 + i101 - i111;
+		int i010 = i011 + i110 - i111;
+		int i100 = i101 + i110 - i111;
+		int i000 = i001 + i110 - i111;
+
+		*sum = mSum[i111] - mSum[i011] - mSum[i101] - mSum[i110] + mSum[i001] + mSum[i010] + mSum[i100] - mSum[i000];
+		*count = mCount[i111] - mCount[i011] - mCount[i101] - mCount[i110] + mCount[i001] + mCount[i010] + mCount[i100] - mCount[i000];
+	}
 
-	unsigned char *inputPointer = static_cast<unsigned char*> (input->GetScalarPointer());
-	unsigned char *outputPointer = static_cast<unsigned char*> (output->GetScalarPointer());
-	unsigned char *maskPointer = static_cast<unsigned char*> (mask->GetScalarPointer());
+private:
+	/** Index of the table element preceeding volume voxel (x,y,z) in all directions.
+	  */
+	int getIndex(int x, int y, int z) const
+	{
+		return x*mStride[0] + y*mStride[1] + (z-mZStart)*mStride[2];
+	}
 
-	if ((outputDims[0] != inputDims[0]) || (outputDims[1] != inputDims[1]) || (outputDims[2] != inputDims[2]))
-		reportWarning("outputDims != inputDims. output: " + qstring_cast(outputDims[0]) + " "
-			+ qstring_cast(outputDims[1]) + " " + qstring_cast(outputDims[2]) + " input: " + qstring_cast(inputDims[0])
-			+ " " + qstring_cast(inputDims[1]) + " " + qstring_cast(inputDims[2]));
+	int mZStart;
+	int mStride[3];
+	std::vector<unsigned int> mSum;
+	std::vector<unsigned int> mCount;
+};
+
+/**Fill the holes in the slab z=[zStart, zStop>.
+ *
+ * An empty voxel is given the average of the nonzero voxels inside the surrounding box.
+ * The box is as small a possible, up to a maximum of 2*interpolationSteps+1.
+ * Only the input is used for the averaging, i.e. filled holes are not used
+ * to fill other holes, thus the result is independent of the slab split.
+ *
+ * Optimized code: Change with care!
+ */
+PNNHoleFillCount fillHolesInSlab(const PNNHoleFillData& data, int zStart, int zStop)
+{
+	PNNHoleFillCount retval;
+	const Eigen::Array3i& dim = data.mDims;
+	int steps = data.mInterpolationSteps;
 
-	int total = outputDims[0] * outputDims[1] * outputDims[2];
-	int removed = 0;
-	int ignored = 0;
-	// Traverse all voxels
-	for (int x = 0; x < outputDims[0]; x++)
+	// table covering the slab and all boxes centered in the slab.
+	SummedVolumeTable table(data.mInput,
+							dim,
+							std::max(zStart-steps, 0),
+							std::min(zStop+steps, dim[2]));
+
+	for (int z = zStart; z < zStop; z++)
 	{
-		for (int y = 0; y < outputDims[1]; y++)
+		for (int y = 0; y < dim[1]; y++)
 		{
-			for (int z = 0; z < outputDims[2]; z++)
+			int outputIndex = y * dim[0] + z * dim[0] * dim[1];
+			for (int x = 0; x < dim[0]; x++, outputIndex++)
 			{
-				int outputIndex = x + y * outputDims[0] + z * outputDims[0] * outputDims[1];
-
 				// ignore if outside volume of interest
-				if (maskPointer[outputIndex]==0)
+				if (data.mMask[outputIndex]==0)
 				{
-					removed++;
+					retval.mRemoved++;
+					continue;
 				}
 				// copy if value already exists
-				else if (inputPointer[outputIndex]>0)
+				if (data.mInput[outputIndex]>0)
 				{
-					outputPointer[outputIndex] = inputPointer[outputIndex];
-					ignored++;
+					data.mOutput[outputIndex] = data.mInput[outputIndex];
+					retval.mIgnored++;
+					continue;
 				}
-				// fill hole otherwise (empty space within the volume)
-				else
+				// fill hole otherwise (empty space within the volume).
+				// The box of size 1 is the hole itself, start at the next.
+				for (int localArea = 1; localArea <= steps; localArea++)
 				{
-					this->fillHole(inputPointer, outputPointer, x, y, z, outputDims, interpolationSteps);
+					unsigned int sum = 0;
+					unsigned int count = 0;
+					table.getBoxSum(std::max(x-localArea, 0), std::min(x+localArea, dim[0]-1),
+									std::max(y-localArea, 0), std::min(y+localArea, dim[1]-1),
+									std::max(z-localArea, 0), std::min(z+localArea, dim[2]-1),
+									&sum, &count);
+					if (count > 0)
+					{
+						data.mOutput[outputIndex] = static_cast<int> ((double(sum) / count) + 0.5);
+						data.mOutput[outputIndex] = std::max<unsigned char>(1, data.mOutput[outputIndex]);
+						break;
+					}
 				}
-			}//z
+			}//x
 		}//y
-	}//x
+	}//z
 
-	int valid = 100*double(ignored)/double(total);
-	int outside = 100*double(removed)/double(total);
-	int holes = 100*double(total-ignored-removed)/double(total);
-	reportDebug(
-				QString("PNN: Size: %1Mb, Valid voxels: %2\%, Outside mask: %3\%  Filled holes [steps=%4, %5s]: %6\%")
-				.arg(total/1024/1024)
-				.arg(valid)
-				.arg(outside)
-				.arg(interpolationSteps)
-				.arg(timer.getElapsedSecondsAsString())
-				.arg(holes));
+	return retval;
 }
+} // unnamed namespace
 
-/**Fill the empty voxel (x,y,z) with the average value of the surrounding box.
- * The box is as small a possible, up to a maximum of 2*interpolationSteps+1.
- *
- */
-void PNNReconstructionMethodService::fillHole(unsigned char *inputPointer, unsigned char *outputPointer, int x, int y, int z, const Eigen::Array3i& dim, int interpolationSteps)
+void PNNReconstructionMethodService::interpolate(ImagePtr inputData, vtkImageDataPtr outputData, QDomElement settings)
 {
-	int outputIndex = x + y * dim[0] + z * dim[0] * dim[1];
-	bool interpolated = false;
-	int localArea = 0;
+	TimeKeeper timer;
+	DoublePropertyPtr interpolationStepsOption = this->getInterpolationStepsOption(settings);
+	int interpolationSteps = static_cast<int> (interpolationStepsOption->getValue());
 
-	int count = 0;
-	double tempVal = 0;
+	vtkImageDataPtr input = inputData->getBaseVtkImageData();
+	vtkImageDataPtr output = outputData;
+	vtkImageDataPtr mask = this->createMask(input);
 
-	do
-	{
-		for (int i = -localArea; i < localArea + 1; i++)
-		{
-			for (int j = -localArea; j < localArea + 1; j++)
-			{
-				for (int k = -localArea; k < localArea + 1; k++)
-				{
-					int localIndex = outputIndex + i + j*dim[0] + k*dim[0]*dim[1];
+	Eigen::Array3i outputDims(output->GetDimensions());
 
-					if (validVoxel(x + i, y + j, z + k, dim.data()) && inputPointer[localIndex] > 0.1)
-					{
-						tempVal += inputPointer[localIndex];
-						count++;
-					}
-				}//local voxel area
-			}
-		}
+	Eigen::Array3i inputDims(input->GetDimensions());
 
-		if (count > 0)
-		{
-			interpolated = true;
-			if (tempVal == 0)
-			{
-				// keep noneness of index
-			}
-			else
-			{
-				outputPointer[outputIndex] = static_cast<int> ((tempVal / count) + 0.5);
-				outputPointer[outputIndex] = std::max<unsigned char>(1, outputPointer[outputIndex]);
-			}
-		}
+	if ((outputDims[0] != inputDims[0]) || (outputDims[1] != inputDims[1]) || (outputDims[2] != inputDims[2]))
+		reportWarning("outputDims != inputDims. output: " + qstring_cast(outputDims[0]) + " "
+			+ qstring_cast(outputDims[1]) + " " + qstring_cast(outputDims[2]) + " input: " + qstring_cast(inputDims[0])
+			+ " " + qstring_cast(inputDims[1]) + " " + qstring_cast(inputDims[2]));
 
-		localArea++;
+	PNNHoleFillData data;
+	data.mInput = static_cast<unsigned char*> (input->GetScalarPointer());
+	data.mOutput = static_cast<unsigned char*> (output->GetScalarPointer());
+	data.mMask = static_cast<unsigned char*> (mask->GetScalarPointer());
+	data.mDims = outputDims;
+	data.mInterpolationSteps = interpolationSteps;
+
+	// Traverse all voxels, in slabs along z.
+	// Small slabs keep the memory used by the summed volume tables down.
+	int slabThickness = std::max(8, 2*interpolationSteps);
+	int numberOfSlabs = (outputDims[2] + slabThickness - 1) / slabThickness;
+	QThreadPool pool;
+	pool.setMaxThreadCount(this->getNumberOfThreads(settings));
+	std::vector<QFuture<PNNHoleFillCount> > slabs;
+	for (int i = 0; i < numberOfSlabs; ++i)
+	{
+		int zStart = i * slabThickness;
+		int zStop = std::min(zStart + slabThickness, outputDims[2]);
+		slabs.push_back(QtConcurrent::run(&pool, boost::bind(&fillHolesInSlab, boost::cref(data), zStart, zStop)));
+	}
+
+	long removed = 0;
+	long ignored = 0;
+	for (unsigned i = 0; i < slabs.size(); ++i)
+	{
+		PNNHoleFillCount count = slabs[i].result();
+		removed += count.mRemoved;
+		ignored += count.mIgnored;
+	}
 
-	} while (localArea <= interpolationSteps && !interpolated);
+	double total = double(outputDims[0]) * outputDims[1] * outputDims[2];
+	int valid = 100*double(ignored)/total;
+	int outside = 100*double(removed)/total;
+	int holes = 100*(total-ignored-removed)/total;
+	reportDebug(
+				QString("PNN: Size: %1Mb, Valid voxels: %2\%, Outside mask: %3\%  Filled holes [steps=%4, %5s]: %6\%")
+				.arg(int(total/1024/1024))
+				.arg(valid)
+				.arg(outside)
+				.arg(interpolationSteps)
+				.arg(timer.getElapsedSecondsAsString())
+				.arg(holes));
 }
 
 }//namespace
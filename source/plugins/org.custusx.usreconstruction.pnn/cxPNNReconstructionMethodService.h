@@ -63,10 +63,14 @@ public:
 
 	virtual std::vector<PropertyPtr> getSettings(QDomElement root);
 	virtual bool reconstruct(ProcessedUSInputDataPtr input, vtkImageDataPtr outputData, QDomElement settings);
+	virtual IncrementalReconstructionPtr createIncrementalReconstruction(QDomElement settings);
 
 
 private:
+	friend class PNNIncrementalReconstruction;
 	DoublePropertyPtr getInterpolationStepsOption(QDomElement root);
+	DoublePropertyPtr getNumberOfThreadsOption(QDomElement root);
+	int getNumberOfThreads(QDomElement root);
 	bool validPixel(int x, int y, const Eigen::Array3i& dims, unsigned char* rawPointer)
 	{
 		return (x >= 0) && (x < dims[0]) && (y >= 0) && (y < dims[1]) && (rawPointer[x + y * dims[0]] != 0);
@@ -79,12 +83,36 @@ private:
 
 	void interpolate(ImagePtr inputData, vtkImageDataPtr outputData, QDomElement settings);
 	vtkImageDataPtr createMask(vtkImageDataPtr inputData);
-	void fillHole(unsigned char *inputPointer, unsigned char *outputPointer, int x, int y, int z, const Eigen::Array3i& dim, int interpolationSteps);
 
 
 };
 //typedef boost::shared_ptr<PNNReconstructionMethodService> PNNReconstructionMethodService*;
 
+/**
+ * Incremental version of the PNN algorithm:
+ * Each frame is forward projected into the output as it is added,
+ * holes are filled in finish().
+ *
+ * \ingroup org_custusx_usreconstruction_pnn
+ */
+class org_custusx_usreconstruction_pnn_EXPORT PNNIncrementalReconstruction : public IncrementalReconstruction
+{
+public:
+	PNNIncrementalReconstruction(PNNReconstructionMethodService* service, QDomElement settings);
+	virtual ~PNNIncrementalReconstruction() {}
+
+	virtual void setInput(vtkImageDataPtr mask);
+	virtual void setOutput(vtkImageDataPtr outputData);
+	virtual void addFrame(unsigned char* frame, Transform3D dMu);
+	virtual vtkImageDataPtr finish();
+
+private:
+	PNNReconstructionMethodService* mService;
+	QDomElement mSettings;
+	vtkImageDataPtr mMask;
+	vtkImageDataPtr mOutput;
+};
+
 } /* namespace cx */
 
 #endif /* CXPNNRECONSTRUCTIONMETHODSERVICE_H_ */
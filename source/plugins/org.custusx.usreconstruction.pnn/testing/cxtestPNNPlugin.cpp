@@ -32,16 +32,68 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "catch.hpp"
 #include <QDomElement>
+#include <cstring>
 #include "cxPNNReconstructionMethodService.h"
 #include "cxDummyTool.h"
 
 #include "cxtestReconstructionAlgorithmFixture.h"
 #include "cxtestUtilities.h"
 #include "cxLogicManager.h"
+#include "cxImage.h"
+#include "cxDoubleProperty.h"
+#include "cxLiveReconstruction.h"
+#include "cxRegistrationTransform.h"
+#include "cxVolumeHelpers.h"
+#include "cxUSFrameData.h"
+#include "cxtestSyntheticVolumeComparer.h"
+#include "vtkImageData.h"
 
 namespace cxtest
 {
 
+namespace
+{
+void setPNNOption(cx::ReconstructionMethodService* algorithm, QDomElement settings, QString uid, double value)
+{
+	std::vector<cx::PropertyPtr> properties = algorithm->getSettings(settings);
+	for (unsigned i=0; i<properties.size(); ++i)
+		if (properties[i]->getUid()==uid)
+			properties[i]->setValueFromVariant(value);
+}
+
+/** Run the frames through a LiveReconstructionThread, return the result in space r.
+  */
+cx::ImagePtr reconstructLive(cx::IncrementalReconstructionPtr algorithm, cx::ProcessedUSInputDataPtr input)
+{
+	std::vector<cx::TimedPosition> positions = input->getFrames();
+	Eigen::Array3i dim = input->getDimensions();
+	cx::LiveReconstructionFrameRingPtr frames(new cx::LiveReconstructionFrameRing(positions.size()));
+	for (unsigned i=0; i<positions.size(); ++i)
+	{
+		cx::LiveReconstructionFrame frame;
+		frame.mTime = positions[i].mTime;
+		frame.m_prMu = positions[i].mPos;
+		frame.mImage = cx::generateVtkImageData(Eigen::Array3i(dim[0], dim[1], 1), input->getSpacing(), 0);
+		memcpy(frame.mImage->GetScalarPointer(), input->getFrame(i), dim[0]*dim[1]);
+		frames->push(frame);
+	}
+	frames->close();
+
+	cx::LiveReconstructionThread thread(algorithm, frames, input->getMask(), 1E7);
+	thread.start();
+	thread.wait();
+	CHECK(thread.getNumberOfReconstructedFrames() == positions.size());
+
+	cx::Transform3D prMd = cx::Transform3D::Identity();
+	vtkImageDataPtr volume = thread.finish(&prMd);
+	if (!volume)
+		return cx::ImagePtr();
+	cx::ImagePtr retval(new cx::Image("live", volume));
+	retval->get_rMd_History()->setRegistration(prMd);
+	return retval;
+}
+}
+
 TEST_CASE("ReconstructAlgorithm: PNN on sphere","[unit][usreconstruction][synthetic][pnn]")
 {
 	cx::LogicManager::initialize();
@@ -104,6 +156,84 @@ TEST_CASE("ReconstructAlgorithm: PNN on sphere, tilt","[unit][usreconstruction][
 	cx::LogicManager::shutdown();
 }
 
+TEST_CASE("ReconstructAlgorithm: PNN multithreaded output is identical to single threaded","[unit][usreconstruction][synthetic][pnn]")
+{
+	cx::LogicManager::initialize();
+	ctkPluginContext* pluginContext = cx::logicManager()->getPluginContext();
+
+	QDomDocument domdoc;
+	QDomElement settings = domdoc.createElement("PNN");
+
+	ReconstructionAlgorithmFixture fixture;
+	SyntheticReconstructInputPtr generator = fixture.getInputGenerator();
+	generator->defineProbeMovementSteps(40);
+	generator->defineProbeMovementNormalizedTranslationRange(0.8);
+	generator->defineProbeMovementAngleRange(M_PI/6);
+	generator->defineProbe(cx::DummyToolTestUtilities::createProbeDefinitionLinear(100, 100, Eigen::Array2i(150,150)));
+	generator->setSpherePhantom();
+	fixture.defineOutputVolume(100, 2);
+
+	cx::PNNReconstructionMethodService* algorithm = new cx::PNNReconstructionMethodService(pluginContext);
+	fixture.setAlgorithm(algorithm);
+
+	setPNNOption(algorithm, settings, "numberOfThreads", 1);
+	fixture.reconstruct(settings);
+	vtkImageDataPtr singleThreaded = vtkImageDataPtr::New();
+	singleThreaded->DeepCopy(fixture.getOutput()->getBaseVtkImageData());
+
+	fixture.resetOutput();
+	setPNNOption(algorithm, settings, "numberOfThreads", 4);
+	fixture.reconstruct(settings);
+	vtkImageDataPtr multiThreaded = fixture.getOutput()->getBaseVtkImageData();
+
+	Eigen::Array3i dim(singleThreaded->GetDimensions());
+	REQUIRE((Eigen::Array3i(multiThreaded->GetDimensions())==dim).all());
+	int size = dim[0]*dim[1]*dim[2];
+	CHECK(memcmp(singleThreaded->GetScalarPointer(), multiThreaded->GetScalarPointer(), size)==0);
+
+	delete algorithm;
+	cx::LogicManager::shutdown();
+}
+
+TEST_CASE("LiveReconstruction: PNN live output matches the offline reconstruction","[unit][usreconstruction][synthetic][pnn]")
+{
+	cx::LogicManager::initialize();
+	ctkPluginContext* pluginContext = cx::logicManager()->getPluginContext();
+
+	QDomDocument domdoc;
+	QDomElement settings = domdoc.createElement("PNN");
+
+	ReconstructionAlgorithmFixture fixture;
+	SyntheticReconstructInputPtr generator = fixture.getInputGenerator();
+	generator->defineProbeMovementSteps(40);
+	generator->defineProbeMovementNormalizedTranslationRange(0.8);
+	generator->defineProbeMovementAngleRange(M_PI/6);
+	generator->defineProbe(cx::DummyToolTestUtilities::createProbeDefinitionLinear(100, 100, Eigen::Array2i(150,150)));
+	generator->setSpherePhantom();
+	fixture.defineOutputVolume(100, 2);
+
+	cx::PNNReconstructionMethodService* algorithm = new cx::PNNReconstructionMethodService(pluginContext);
+	fixture.setAlgorithm(algorithm);
+	fixture.reconstruct(settings);
+	fixture.checkRMSBelow(30.0);
+	fixture.checkCentroidDifferenceBelow(2);
+	fixture.checkMassDifferenceBelow(0.01);
+
+	// the same frames, reconstructed one at a time, must meet the same bounds
+	cx::ImagePtr live = reconstructLive(algorithm->createIncrementalReconstruction(settings),
+										generator->generateSynthetic_ProcessedUSInputData(cx::Transform3D::Identity()));
+	REQUIRE(live);
+	SyntheticVolumeComparer comparer;
+	comparer.setPhantom(fixture.getPhantom());
+	comparer.setTestImage(live);
+	comparer.checkRMSBelow(30.0);
+	comparer.checkCentroidDifferenceBelow(2);
+	comparer.checkMassDifferenceBelow(0.01);
+
+	delete algorithm;
+	cx::LogicManager::shutdown();
+}
+
 } // namespace cxtest
 
 
@@ -0,0 +1,760 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxLiveReconstruction.h"
+
+#include <algorithm>
+#include <limits>
+#include <QTimer>
+#include <vtkImageData.h>
+#include "cxLogger.h"
+#include "cxTypeConversions.h"
+#include "cxVolumeHelpers.h"
+#include "cxTimeKeeper.h"
+#include "cxImage.h"
+#include "cxTool.h"
+#include "cxProbe.h"
+#include "cxProbeSector.h"
+#include "cxVideoSource.h"
+#include "cxRegistrationTransform.h"
+#include "cxTransferFunctions3DPresets.h"
+#include "cxPatientModelService.h"
+#include "cxUSReconstructInputDataAlgoritms.h"
+
+namespace cx
+{
+
+LiveReconstructionFrameRing::LiveReconstructionFrameRing(unsigned capacity) :
+	mBuffer(std::max<unsigned>(capacity, 1)),
+	mFirst(0),
+	mSize(0),
+	mDropped(0),
+	mClosed(false)
+{
+}
+
+void LiveReconstructionFrameRing::push(const LiveReconstructionFrame& frame)
+{
+	QMutexLocker sentry(&mMutex);
+	if (mSize == mBuffer.size())
+	{
+		// drop the oldest
+		mBuffer[mFirst] = LiveReconstructionFrame();
+		mFirst = (mFirst+1) % mBuffer.size();
+		--mSize;
+		++mDropped;
+	}
+	mBuffer[(mFirst+mSize) % mBuffer.size()] = frame;
+	++mSize;
+	mNotEmpty.wakeOne();
+}
+
+bool LiveReconstructionFrameRing::pop(LiveReconstructionFrame* frame, unsigned long timeout)
+{
+	QMutexLocker sentry(&mMutex);
+	if (!mSize && !mClosed)
+		mNotEmpty.wait(&mMutex, timeout);
+	if (!mSize)
+		return false;
+
+	*frame = mBuffer[mFirst];
+	mBuffer[mFirst] = LiveReconstructionFrame(); // release image
+	mFirst = (mFirst+1) % mBuffer.size();
+	--mSize;
+	return true;
+}
+
+void LiveReconstructionFrameRing::close()
+{
+	QMutexLocker sentry(&mMutex);
+	mClosed = true;
+	mNotEmpty.wakeAll();
+}
+
+bool LiveReconstructionFrameRing::isClosed() const
+{
+	QMutexLocker sentry(&mMutex);
+	return mClosed;
+}
+
+unsigned LiveReconstructionFrameRing::size() const
+{
+	QMutexLocker sentry(&mMutex);
+	return mSize;
+}
+
+unsigned LiveReconstructionFrameRing::getCapacity() const
+{
+	return mBuffer.size();
+}
+
+unsigned LiveReconstructionFrameRing::getNumberOfDroppedFrames() const
+{
+	QMutexLocker sentry(&mMutex);
+	return mDropped;
+}
+
+//---------------------------------------------------------
+//---------------------------------------------------------
+//---------------------------------------------------------
+
+LiveReconstructionThread::LiveReconstructionThread(IncrementalReconstructionPtr algorithm,
+												   LiveReconstructionFrameRingPtr frames,
+												   vtkImageDataPtr mask,
+												   double maxVolumeSize) :
+	mAlgorithm(algorithm),
+	mFrames(frames),
+	mMask(mask),
+	mMaxVolumeSize(maxVolumeSize),
+	mCancel(0),
+	mInitialized(false),
+	m_prMdd(Transform3D::Identity()),
+	mNumberOfFrames(0),
+	mNumberOfSkippedFrames(0),
+	mVolumeMutex(QMutex::Recursive),
+	mOrigin_dd(Vector3D::Zero()),
+	mResult_prMd(Transform3D::Identity()),
+	mSnapshotRequested(true),
+	mSnapshot_prMd(Transform3D::Identity())
+{
+	this->setObjectName("org.custusx.usreconstruction.live"); // becomes the thread name
+	mInputRectangle = this->generateInputRectangle();
+	mAlgorithm->setInput(mMask);
+}
+
+LiveReconstructionThread::~LiveReconstructionThread()
+{
+}
+
+void LiveReconstructionThread::cancel()
+{
+	mCancel.storeRelease(1);
+	mFrames->close();
+}
+
+unsigned LiveReconstructionThread::getNumberOfReconstructedFrames() const
+{
+	QMutexLocker sentry(&mVolumeMutex);
+	return mNumberOfFrames;
+}
+
+void LiveReconstructionThread::run()
+{
+	LiveReconstructionFrame frame;
+	while (!mCancel.loadAcquire())
+	{
+		if (mFrames->pop(&frame, 100))
+			this->reconstructFrame(frame);
+		else if (mFrames->isClosed())
+			break;
+		this->updateSnapshot();
+	}
+
+	// fill holes here, not in the caller of finish()
+	QMutexLocker sentry(&mVolumeMutex);
+	if (mCancel.loadAcquire() || !mVolume)
+		return;
+	mResult_prMd = this->get_prMd();
+	mResult = mAlgorithm->finish();
+}
+
+/**Generate the corners of the valid frame area, in u space.
+ */
+std::vector<Vector3D> LiveReconstructionThread::generateInputRectangle() const
+{
+	Eigen::Array3i dims(mMask->GetDimensions());
+	Vector3D spacing(mMask->GetSpacing());
+	unsigned char* ptr = static_cast<unsigned char*> (mMask->GetScalarPointer());
+
+	int xmin = dims[0];
+	int xmax = 0;
+	int ymin = dims[1];
+	int ymax = 0;
+	for (int y = 0; y < dims[1]; y++)
+		for (int x = 0; x < dims[0]; x++)
+			if (ptr[x + y * dims[0]] != 0)
+			{
+				xmin = std::min(xmin, x);
+				ymin = std::min(ymin, y);
+				xmax = std::max(xmax, x);
+				ymax = std::max(ymax, y);
+			}
+
+	std::vector<Vector3D> retval;
+	retval.push_back(Vector3D(xmin * spacing[0], ymin * spacing[1], 0));
+	retval.push_back(Vector3D(xmax * spacing[0], ymin * spacing[1], 0));
+	retval.push_back(Vector3D(xmin * spacing[0], ymax * spacing[1], 0));
+	retval.push_back(Vector3D(xmax * spacing[0], ymax * spacing[1], 0));
+	return retval;
+}
+
+/**Convert the frame to 8 bit grayscale, using the same weights as vtkImageLuminance.
+ * Return null if the frame cannot be used.
+ */
+unsigned char* LiveReconstructionThread::convertTo8bit(vtkImageDataPtr image)
+{
+	Eigen::Array3i dims(image->GetDimensions());
+	Eigen::Array3i maskDims(mMask->GetDimensions());
+	if ((dims[0]!=maskDims[0]) || (dims[1]!=maskDims[1]))
+	{
+		this->reportSkippedFrame(QString("frame size %1x%2 differs from probe sector size %3x%4")
+								 .arg(dims[0]).arg(dims[1]).arg(maskDims[0]).arg(maskDims[1]));
+		return NULL;
+	}
+	if (image->GetScalarType() != VTK_UNSIGNED_CHAR)
+	{
+		this->reportSkippedFrame(QString("frame scalar type %1 is not unsigned char")
+								 .arg(image->GetScalarTypeAsString()));
+		return NULL;
+	}
+
+	int components = image->GetNumberOfScalarComponents();
+	unsigned char* ptr = static_cast<unsigned char*> (image->GetScalarPointer());
+	if (components == 1)
+		return ptr;
+	if (components < 3)
+	{
+		this->reportSkippedFrame(QString("frame has %1 components").arg(components));
+		return NULL;
+	}
+
+	int size = dims[0]*dims[1];
+	mFrameBuffer.resize(size);
+	for (int i = 0; i < size; ++i, ptr += components)
+		mFrameBuffer[i] = static_cast<unsigned char>(0.30*ptr[0] + 0.59*ptr[1] + 0.11*ptr[2]);
+	return &*mFrameBuffer.begin();
+}
+
+/**Warn about frames that cannot be reconstructed. Only the first frame
+ * of each kind is reported, as the rest of the stream usually is the same.
+ */
+void LiveReconstructionThread::reportSkippedFrame(QString reason)
+{
+	++mNumberOfSkippedFrames;
+	if (reason == mLastSkipReason)
+		return;
+	mLastSkipReason = reason;
+	reportWarning(QString("Live reconstruction: Skipping frames, %1.").arg(reason));
+}
+
+unsigned LiveReconstructionThread::getNumberOfSkippedFrames() const
+{
+	QMutexLocker sentry(&mVolumeMutex);
+	return mNumberOfSkippedFrames;
+}
+
+Transform3D LiveReconstructionThread::get_prMd() const
+{
+	return m_prMdd * createTransformTranslate(mOrigin_dd);
+}
+
+void LiveReconstructionThread::reconstructFrame(const LiveReconstructionFrame& frame)
+{
+	QMutexLocker sentry(&mVolumeMutex);
+
+	unsigned char* frameData = this->convertTo8bit(frame.mImage);
+	if (!frameData)
+		return;
+
+	if (!mInitialized)
+	{
+		// orient the volume along the first frame
+		m_prMdd = frame.m_prMu;
+		mInitialized = true;
+	}
+
+	Transform3D ddMu = m_prMdd.inv() * frame.m_prMu;
+	std::vector<Vector3D> corners;
+	for (unsigned i = 0; i < mInputRectangle.size(); ++i)
+		corners.push_back(ddMu.coord(mInputRectangle[i]));
+	if (!this->growVolumeToInclude(DoubleBoundingBox3D::fromCloud(corners)))
+		return;
+
+	Transform3D dMu = createTransformTranslate(-mOrigin_dd) * ddMu;
+	mAlgorithm->addFrame(frameData, dMu);
+	++mNumberOfFrames;
+}
+
+/**Ensure the volume contains the box, by increasing the volume if necessary.
+ * The volume is enlarged with a margin in order to avoid reallocating for each frame.
+ */
+bool LiveReconstructionThread::growVolumeToInclude(DoubleBoundingBox3D bb_dd)
+{
+	if (mVolume)
+	{
+		Eigen::Array3i dim(mVolume->GetDimensions());
+		double spacing = mVolume->GetSpacing()[0];
+		DoubleBoundingBox3D current(mOrigin_dd, mOrigin_dd + (dim.cast<double>()-1).matrix()*spacing);
+		if (current.contains(bb_dd.bottomLeft()) && current.contains(bb_dd.topRight()))
+			return true;
+		bb_dd = bb_dd.unionWith(current);
+	}
+
+	double spacing = mVolume ? mVolume->GetSpacing()[0] : std::min(mMask->GetSpacing()[0], mMask->GetSpacing()[1]);
+	if (spacing <= 0)
+		return false;
+
+	Eigen::Array3i dim;
+	Vector3D origin;
+	while (true)
+	{
+		Vector3D margin = (bb_dd.range()*0.25).cwiseMax(Vector3D::Ones()*16*spacing);
+		Vector3D bottomLeft = bb_dd.bottomLeft() - margin;
+		Vector3D topRight = bb_dd.topRight() + margin;
+		for (unsigned i = 0; i < 3; ++i)
+		{
+			// align new origin to the existing grid, thus existing voxels can be copied directly
+			if (mVolume)
+				bottomLeft[i] = mOrigin_dd[i] + std::floor((bottomLeft[i] - mOrigin_dd[i])/spacing)*spacing;
+			dim[i] = static_cast<int>(std::ceil((topRight[i] - bottomLeft[i])/spacing)) + 1;
+		}
+		origin = bottomLeft;
+
+		if (double(dim[0])*dim[1]*dim[2] <= mMaxVolumeSize)
+			break;
+		spacing *= 2;
+	}
+
+	this->reallocateVolume(origin, dim, spacing);
+	return true;
+}
+
+/**Create a new volume with the given geometry. Copy the contents of the old volume into the new.
+ */
+void LiveReconstructionThread::reallocateVolume(Vector3D origin_dd, Eigen::Array3i dim, double spacing)
+{
+	TimeKeeper timer;
+	vtkImageDataPtr volume = generateVtkImageData(dim, Vector3D::Ones()*spacing, 0);
+	unsigned char* newPtr = static_cast<unsigned char*> (volume->GetScalarPointer());
+
+	if (mVolume)
+	{
+		Eigen::Array3i oldDim(mVolume->GetDimensions());
+		double oldSpacing = mVolume->GetSpacing()[0];
+		unsigned char* oldPtr = static_cast<unsigned char*> (mVolume->GetScalarPointer());
+
+		for (int z = 0; z < oldDim[2]; ++z)
+			for (int y = 0; y < oldDim[1]; ++y)
+				for (int x = 0; x < oldDim[0]; ++x)
+				{
+					unsigned char value = oldPtr[x + y*oldDim[0] + z*oldDim[0]*oldDim[1]];
+					if (!value)
+						continue;
+					Vector3D p = mOrigin_dd + Vector3D(x, y, z)*oldSpacing;
+					Eigen::Array3i i = (((p - origin_dd)/spacing).array() + 0.5).cast<int>();
+					if ((i < 0).any() || (i >= dim).any())
+						continue;
+					unsigned char* target = newPtr + i[0] + i[1]*dim[0] + i[2]*dim[0]*dim[1];
+					*target = std::max(*target, value);
+				}
+	}
+
+	mVolume = volume;
+	mOrigin_dd = origin_dd;
+	mAlgorithm->setOutput(mVolume);
+
+	reportDebug(QString("Live reconstruction: Resized volume to %1 %2 %3, spacing %4 [%5s]")
+				.arg(dim[0]).arg(dim[1]).arg(dim[2])
+				.arg(spacing)
+				.arg(timer.getElapsedSecondsAsString()));
+}
+
+vtkImageDataPtr LiveReconstructionThread::getSnapshot(Transform3D* prMd)
+{
+	QMutexLocker sentry(&mSnapshotMutex);
+	mSnapshotRequested = true;
+	vtkImageDataPtr retval = mSnapshot;
+	mSnapshot = vtkImageDataPtr(); // hand over, the next snapshot is a new copy
+	if (retval)
+		*prMd = mSnapshot_prMd;
+	return retval;
+}
+
+/**Copy the volume if a snapshot has been requested. Runs in the worker thread
+ * between frames, thus the copy does not block the caller of getSnapshot().
+ */
+void LiveReconstructionThread::updateSnapshot()
+{
+	{
+		QMutexLocker sentry(&mSnapshotMutex);
+		if (!mSnapshotRequested)
+			return;
+	}
+
+	vtkImageDataPtr snapshot;
+	Transform3D prMd;
+	{
+		QMutexLocker sentry(&mVolumeMutex);
+		if (!mVolume)
+			return;
+		snapshot = vtkImageDataPtr::New();
+		snapshot->DeepCopy(mVolume);
+		prMd = this->get_prMd();
+	}
+
+	QMutexLocker sentry(&mSnapshotMutex);
+	mSnapshot = snapshot;
+	mSnapshot_prMd = prMd;
+	mSnapshotRequested = false;
+}
+
+vtkImageDataPtr LiveReconstructionThread::finish(Transform3D* prMd)
+{
+	QMutexLocker sentry(&mVolumeMutex);
+	if (mResult)
+		*prMd = mResult_prMd;
+	return mResult;
+}
+
+//---------------------------------------------------------
+//---------------------------------------------------------
+//---------------------------------------------------------
+
+LiveReconstruction::LiveReconstruction(PatientModelServicePtr patientModelService,
+									   ReconstructionMethodService* algorithm,
+									   ReconstructCore::InputParams params) :
+	mPatientModelService(patientModelService),
+	mAlgorithm(algorithm),
+	mParams(params),
+	m_tMu(Transform3D::Identity()),
+	mMaxTimeDiff(100), // same as ReconstructPreprocessor
+	mQueueCapacity(64),
+	mDroppedFrames(0),
+	mStopping(false)
+{
+	mPreviewTimer = new QTimer(this);
+	mPreviewTimer->setInterval(1000);
+	connect(mPreviewTimer, &QTimer::timeout, this, &LiveReconstruction::updatePreviewSlot);
+}
+
+LiveReconstruction::~LiveReconstruction()
+{
+	if (mStopping)
+		this->completeStop();
+	else
+		this->cancel();
+}
+
+void LiveReconstruction::setPreviewInterval(int ms)
+{
+	mPreviewTimer->setInterval(ms);
+}
+
+void LiveReconstruction::setQueueCapacity(unsigned frames)
+{
+	mQueueCapacity = frames;
+}
+
+bool LiveReconstruction::isRunning() const
+{
+	return mThread ? true : false;
+}
+
+unsigned LiveReconstruction::getNumberOfDroppedFrames() const
+{
+	unsigned retval = mDroppedFrames;
+	if (mQueue)
+		retval += mQueue->getNumberOfDroppedFrames();
+	return retval;
+}
+
+bool LiveReconstruction::start(ToolPtr probe, VideoSourcePtr source)
+{
+	if (mStopping)
+		this->completeStop();
+	this->cancel();
+
+	if (!mAlgorithm || !probe || !probe->getProbe() || !source)
+		return false;
+
+	IncrementalReconstructionPtr algorithm = mAlgorithm->createIncrementalReconstruction(mParams.mAlgoSettings);
+	if (!algorithm)
+	{
+		reportWarning(QString("Live reconstruction not supported by algorithm %1").arg(mAlgorithm->getName()));
+		return false;
+	}
+
+	ProbeSector sector;
+	sector.setData(probe->getProbe()->getProbeDefinition(source->getUid()));
+	vtkImageDataPtr mask = sector.getMask();
+	if (!mask)
+	{
+		reportWarning("Live reconstruction requires a probe definition");
+		return false;
+	}
+	// same conversion as USReconstructInputDataAlgorithm::transformTrackingPositionsTo_prMu()
+	m_tMu = sector.get_tMu() * sector.get_uMv();
+
+	mProbe = probe;
+	mSource = source;
+	mDroppedFrames = 0;
+	mPendingFrames.clear();
+	mPositions.clear();
+	mOutput.reset();
+
+	mQueue.reset(new LiveReconstructionFrameRing(mQueueCapacity));
+	mThread.reset(new LiveReconstructionThread(algorithm, mQueue, mask, mParams.mMaxOutputVolumeSize));
+	mThread->start();
+
+	connect(mSource.get(), &VideoSource::newFrame, this, &LiveReconstruction::newFrameSlot);
+	connect(mProbe.get(), &Tool::toolTransformAndTimestamp, this, &LiveReconstruction::newPositionSlot);
+	if (mPreviewTimer->interval() > 0)
+		mPreviewTimer->start();
+
+	report("Live reconstruction started.");
+	return true;
+}
+
+void LiveReconstruction::disconnectSources()
+{
+	mPreviewTimer->stop();
+	if (mSource)
+		disconnect(mSource.get(), &VideoSource::newFrame, this, &LiveReconstruction::newFrameSlot);
+	if (mProbe)
+		disconnect(mProbe.get(), &Tool::toolTransformAndTimestamp, this, &LiveReconstruction::newPositionSlot);
+	mSource.reset();
+	mProbe.reset();
+}
+
+void LiveReconstruction::stop()
+{
+	if (!mThread || mStopping)
+		return;
+
+	this->disconnectSources();
+	this->processPendingFrames(true);
+
+	mStopping = true;
+	mStopTimer.start();
+	connect(mThread.get(), &QThread::finished, this, &LiveReconstruction::threadFinishedSlot);
+	mQueue->close();
+}
+
+void LiveReconstruction::threadFinishedSlot()
+{
+	if (mStopping)
+		this->completeStop();
+}
+
+/**Publish the final volume. Waits for the thread if it is still running.
+ */
+void LiveReconstruction::completeStop()
+{
+	mStopping = false;
+	mThread->wait();
+
+	Transform3D prMd = Transform3D::Identity();
+	vtkImageDataPtr volume = mThread->finish(&prMd);
+	unsigned frames = mThread->getNumberOfReconstructedFrames();
+	unsigned dropped = this->getNumberOfDroppedFrames() + mThread->getNumberOfSkippedFrames();
+	mThread.reset();
+	mQueue.reset();
+
+	if (!volume)
+	{
+		reportWarning("Live reconstruction: No frames reconstructed.");
+		emit reconstructFinished();
+		return;
+	}
+
+	bool inserted = mOutput ? true : false;
+	this->updateOutputImage(volume, prMd);
+	if (inserted)
+		mPatientModelService->insertData(mOutput); // save the final volume
+	report(QString("Live reconstruction complete: %1 frames, %2 dropped, output=%3 [%4s after stop]")
+		   .arg(frames)
+		   .arg(dropped)
+		   .arg(mOutput->getName())
+		   .arg(mStopTimer.elapsed()/1000.0, 0, 'f', 3));
+
+	emit reconstructFinished();
+}
+
+void LiveReconstruction::cancel()
+{
+	if (!mThread)
+		return;
+
+	this->disconnectSources();
+	mPendingFrames.clear();
+	mStopping = false;
+	mThread->cancel();
+	mThread->wait();
+	mThread.reset();
+	mQueue.reset();
+
+	if (mOutput)
+		mPatientModelService->removeData(mOutput->getUid());
+	mOutput.reset();
+}
+
+void LiveReconstruction::newFrameSlot()
+{
+	if (!mSource || !mSource->validData())
+		return;
+
+	LiveReconstructionFrame frame;
+	frame.mTime = mSource->getAdvancedTimeInfo().getAcquisitionTime();
+	frame.mImage = vtkImageDataPtr::New();
+	frame.mImage->DeepCopy(mSource->getVtkImageData());
+	frame.m_prMu = Transform3D::Identity();
+	mPendingFrames.push_back(frame);
+
+	// dont wait forever for missing tracking data
+	while (mPendingFrames.size() > mQueueCapacity)
+	{
+		mPendingFrames.pop_front();
+		++mDroppedFrames;
+	}
+
+	this->processPendingFrames(false);
+}
+
+void LiveReconstruction::newPositionSlot(Transform3D prMt, double timestamp)
+{
+	TimedPosition position;
+	position.mTime = timestamp + mParams.mExtraTimeCalibration; // same as ReconstructPreprocessor::applyTimeCalibration()
+	position.mPos = prMt;
+	if (!mPositions.empty() && (position.mTime <= mPositions.back().mTime))
+		return;
+	mPositions.push_back(position);
+
+	this->processPendingFrames(false);
+}
+
+/**Find positions for all frames that have tracking data on both sides,
+ * and send them to reconstruction. Frames too far from tracking data are removed,
+ * as in ReconstructPreprocessor::interpolatePositions().
+ *
+ * If flush, use the last position for the remaining frames.
+ */
+void LiveReconstruction::processPendingFrames(bool flush)
+{
+	while (!mPendingFrames.empty() && !mPositions.empty())
+	{
+		LiveReconstructionFrame& frame = mPendingFrames.front();
+		TimedPosition key;
+		key.mTime = frame.mTime;
+		std::deque<TimedPosition>::iterator next = std::lower_bound(mPositions.begin(), mPositions.end(), key);
+
+		if (next == mPositions.end())
+		{
+			if (!flush)
+				break; // wait for more tracking data
+			if (fabs(frame.mTime - mPositions.back().mTime) <= mMaxTimeDiff)
+				this->addToQueue(frame, mPositions.back().mPos);
+			else
+				++mDroppedFrames;
+		}
+		else if (next == mPositions.begin())
+		{
+			if (fabs(frame.mTime - next->mTime) <= mMaxTimeDiff)
+				this->addToQueue(frame, next->mPos);
+			else
+				++mDroppedFrames;
+		}
+		else
+		{
+			std::deque<TimedPosition>::iterator prev = next - 1;
+			if ((fabs(frame.mTime - prev->mTime) > mMaxTimeDiff) || (fabs(frame.mTime - next->mTime) > mMaxTimeDiff))
+			{
+				++mDroppedFrames;
+			}
+			else
+			{
+				double t_delta_tracking = next->mTime - prev->mTime;
+				double t = 0;
+				if (!similar(t_delta_tracking, 0))
+					t = (frame.mTime - prev->mTime) / t_delta_tracking;
+				Transform3D prMt = USReconstructInputDataAlgorithm::slerpInterpolate(prev->mPos, next->mPos, t);
+				this->addToQueue(frame, prMt);
+			}
+		}
+
+		mPendingFrames.pop_front();
+	}
+
+	// keep only the positions that can be used by the remaining frames
+	double oldestTime = mPendingFrames.empty() ? std::numeric_limits<double>::max() : mPendingFrames.front().mTime;
+	while ((mPositions.size() > 2) && (mPositions[1].mTime < oldestTime))
+		mPositions.pop_front();
+}
+
+void LiveReconstruction::addToQueue(LiveReconstructionFrame frame, Transform3D prMt)
+{
+	frame.m_prMu = prMt * m_tMu;
+	mQueue->push(frame);
+}
+
+void LiveReconstruction::updatePreviewSlot()
+{
+	if (!mThread)
+		return;
+	Transform3D prMd = Transform3D::Identity();
+	vtkImageDataPtr volume = mThread->getSnapshot(&prMd);
+	if (!volume)
+		return;
+	this->updateOutputImage(volume, prMd);
+	emit previewUpdated();
+}
+
+/**Set the volume into the output image, create and insert the image if required.
+ * The setup mimics ReconstructCore::generateOutputVolume().
+ *
+ * Inserting saves the image to disk, thus the image is inserted only once
+ * and later updates are published through Image::vtkImageDataChanged().
+ */
+void LiveReconstruction::updateOutputImage(vtkImageDataPtr volume, Transform3D prMd)
+{
+	setDeepModified(volume);
+	bool created = false;
+	if (!mOutput)
+	{
+		mOutput = mPatientModelService->createSpecificData<Image>("US_live_%1", "US live %1");
+		mOutput->setModality("US");
+		mOutput->setImageType("B-Mode");
+		created = true;
+	}
+
+	mOutput->setVtkImageData(volume, created); // keep the users transfer functions after the first update
+	mOutput->get_rMd_History()->setRegistration(mPatientModelService->get_rMpr() * prMd);
+
+	if (created)
+	{
+		PresetTransferFunctions3DPtr presets = mPatientModelService->getPresetTransferFunctions3D();
+		presets->load(mParams.mTransferFunctionPreset, mOutput, true, false);//Only apply to 2D, not 3D
+		presets->load("US B-Mode", mOutput, false, true);//Only apply to 3D, not 2D
+		mPatientModelService->insertData(mOutput);
+	}
+}
+
+} // namespace cx
@@ -0,0 +1,266 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#ifndef CXLIVERECONSTRUCTION_H
+#define CXLIVERECONSTRUCTION_H
+
+#include "org_custusx_usreconstruction_Export.h"
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include "cxForwardDeclarations.h"
+#include "cxTransform3D.h"
+#include "cxBoundingBox3D.h"
+#include "cxReconstructCore.h"
+#include "cxReconstructionMethodService.h"
+#include "cxUSReconstructInputData.h"
+
+class QTimer;
+
+namespace cx
+{
+
+/**
+ * \file
+ * \addtogroup org_custusx_usreconstruction
+ * @{
+ */
+
+/** A frame with its interpolated position, ready for live reconstruction.
+ */
+struct org_custusx_usreconstruction_EXPORT LiveReconstructionFrame
+{
+	double mTime;
+	vtkImageDataPtr mImage;
+	Transform3D m_prMu;
+};
+
+/**
+ * \brief Bounded frame queue between the acquisition and the live reconstruction.
+ *
+ * The queue holds at most capacity frames. When full, the oldest
+ * frame is dropped, keeping memory use and latency bounded if
+ * the reconstruction falls behind.
+ *
+ * Thread-safe.
+ */
+class org_custusx_usreconstruction_EXPORT LiveReconstructionFrameRing
+{
+public:
+	explicit LiveReconstructionFrameRing(unsigned capacity);
+
+	void push(const LiveReconstructionFrame& frame); ///< add frame, drop the oldest if full.
+	/** Wait at most timeout ms for a frame.
+	  * Return false if no frame was available.
+	  */
+	bool pop(LiveReconstructionFrame* frame, unsigned long timeout);
+	void close(); ///< Wake up all waiting readers. Remaining frames can still be popped.
+	bool isClosed() const;
+
+	unsigned size() const;
+	unsigned getCapacity() const;
+	unsigned getNumberOfDroppedFrames() const;
+
+private:
+	std::vector<LiveReconstructionFrame> mBuffer;
+	unsigned mFirst;
+	unsigned mSize;
+	unsigned mDropped;
+	bool mClosed;
+	mutable QMutex mMutex; ///< protects all members
+	QWaitCondition mNotEmpty;
+};
+typedef boost::shared_ptr<LiveReconstructionFrameRing> LiveReconstructionFrameRingPtr;
+
+/**
+ * \brief Worker thread for LiveReconstruction.
+ *
+ * Pulls frames from the ring and adds them to the output volume using an
+ * IncrementalReconstruction. The output volume is oriented along the first
+ * frame, and grows when new frames fall outside it. If the volume would exceed
+ * the max size, the spacing is increased.
+ *
+ * When the ring is closed and emptied, the reconstruction is completed
+ * (i.e. holes are filled) before the thread completes.
+ */
+class org_custusx_usreconstruction_EXPORT LiveReconstructionThread : public QThread
+{
+	Q_OBJECT
+public:
+	LiveReconstructionThread(IncrementalReconstructionPtr algorithm,
+							 LiveReconstructionFrameRingPtr frames,
+							 vtkImageDataPtr mask,
+							 double maxVolumeSize);
+	virtual ~LiveReconstructionThread();
+
+	void cancel(); ///< stop as soon as possible, discard remaining frames.
+	/** Return a copy of the volume along with its position, or null if none is ready.
+	  * The copy is made by the worker thread after the previous call, thus the
+	  * caller never waits for a copy of the full volume. Thread-safe.
+	  */
+	vtkImageDataPtr getSnapshot(Transform3D* prMd);
+	/** Return the completed reconstruction, null if cancelled or no frames
+	  * were reconstructed. Call after the thread has completed.
+	  */
+	vtkImageDataPtr finish(Transform3D* prMd);
+	unsigned getNumberOfReconstructedFrames() const;
+	unsigned getNumberOfSkippedFrames() const; ///< frames with a format that cannot be reconstructed
+
+protected:
+	virtual void run();
+
+private:
+	void reconstructFrame(const LiveReconstructionFrame& frame);
+	unsigned char* convertTo8bit(vtkImageDataPtr image);
+	void reportSkippedFrame(QString reason);
+	void updateSnapshot();
+	bool growVolumeToInclude(DoubleBoundingBox3D bb_dd);
+	void reallocateVolume(Vector3D origin_dd, Eigen::Array3i dim, double spacing);
+	Transform3D get_prMd() const;
+	std::vector<Vector3D> generateInputRectangle() const;
+
+	IncrementalReconstructionPtr mAlgorithm;
+	LiveReconstructionFrameRingPtr mFrames;
+	vtkImageDataPtr mMask;
+	double mMaxVolumeSize;
+	std::vector<Vector3D> mInputRectangle; ///< corners of the valid frame area in u space
+	std::vector<unsigned char> mFrameBuffer; ///< frame converted to 8 bit
+	QAtomicInt mCancel; ///< written by cancel(), read by the worker
+	bool mInitialized;
+	Transform3D m_prMdd; ///< orientation of volume, i.e. first frame position
+	unsigned mNumberOfFrames;
+	unsigned mNumberOfSkippedFrames;
+	QString mLastSkipReason;
+
+	mutable QMutex mVolumeMutex; ///< protects the members below
+	vtkImageDataPtr mVolume;
+	Vector3D mOrigin_dd; ///< position of voxel 0 in oriented space dd
+	vtkImageDataPtr mResult; ///< completed volume, set at the end of run()
+	Transform3D mResult_prMd;
+
+	QMutex mSnapshotMutex; ///< protects the members below
+	bool mSnapshotRequested;
+	vtkImageDataPtr mSnapshot; ///< copy of mVolume, ready for getSnapshot()
+	Transform3D mSnapshot_prMd;
+};
+typedef boost::shared_ptr<LiveReconstructionThread> LiveReconstructionThreadPtr;
+
+/**
+ * \brief Reconstruct ultrasound during acquisition.
+ *
+ * Each frame from the video source is paired with the probe tracking
+ * data as it arrives, using the same slerp interpolation between the
+ * surrounding tracking positions as the offline reconstruction. The frame
+ * is then reconstructed in a separate thread into a growing volume.
+ *
+ * A preview of the volume is published in the patient model at regular
+ * intervals. After stop() only hole filling remains. It runs in the worker
+ * thread, and reconstructFinished() is emitted when the final volume is ready.
+ *
+ * Only 8 bit B-mode reconstruction is supported, color input is
+ * converted to grayscale. Requires an algorithm that supports
+ * ReconstructionMethodService::createIncrementalReconstruction().
+ *
+ * Main thread only.
+ */
+class org_custusx_usreconstruction_EXPORT LiveReconstruction : public QObject
+{
+	Q_OBJECT
+public:
+	LiveReconstruction(PatientModelServicePtr patientModelService, ReconstructionMethodService* algorithm, ReconstructCore::InputParams params);
+	virtual ~LiveReconstruction();
+
+	bool start(ToolPtr probe, VideoSourcePtr source);
+	/** Complete the reconstruction in the background. reconstructFinished()
+	  * is emitted when the final volume is available in getOutput().
+	  * If deleted before that, the destructor waits for the final volume.
+	  */
+	void stop();
+	void cancel();
+	bool isRunning() const;
+
+	ImagePtr getOutput() { return mOutput; }
+	unsigned getNumberOfDroppedFrames() const;
+
+	void setPreviewInterval(int ms); ///< time between each preview update, 0 means no preview.
+	void setQueueCapacity(unsigned frames); ///< max number of frames waiting for reconstruction.
+
+signals:
+	void previewUpdated();
+	void reconstructFinished();
+
+private slots:
+	void newFrameSlot();
+	void newPositionSlot(Transform3D prMt, double timestamp);
+	void updatePreviewSlot();
+	void threadFinishedSlot();
+
+private:
+	void completeStop();
+	void processPendingFrames(bool flush);
+	void addToQueue(LiveReconstructionFrame frame, Transform3D prMt);
+	void disconnectSources();
+	void updateOutputImage(vtkImageDataPtr volume, Transform3D prMd);
+
+	PatientModelServicePtr mPatientModelService;
+	ReconstructionMethodService* mAlgorithm;
+	ReconstructCore::InputParams mParams;
+	ToolPtr mProbe;
+	VideoSourcePtr mSource;
+	Transform3D m_tMu;
+	double mMaxTimeDiff;
+	unsigned mQueueCapacity;
+	unsigned mDroppedFrames; ///< frames dropped due to missing tracking
+
+	std::list<LiveReconstructionFrame> mPendingFrames; ///< frames waiting for tracking data
+	std::deque<TimedPosition> mPositions; ///< latest tracking positions, prMt
+	LiveReconstructionFrameRingPtr mQueue;
+	LiveReconstructionThreadPtr mThread;
+	QTimer* mPreviewTimer;
+	ImagePtr mOutput;
+	bool mStopping; ///< stop() called, waiting for the thread to complete
+	QElapsedTimer mStopTimer;
+};
+typedef boost::shared_ptr<LiveReconstruction> LiveReconstructionPtr;
+
+/**
+* @}
+*/
+} // namespace cx
+
+#endif // CXLIVERECONSTRUCTION_H
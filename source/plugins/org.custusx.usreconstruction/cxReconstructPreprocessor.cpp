@@ -76,7 +76,8 @@ std::vector<ProcessedUSInputDataPtr> ReconstructPreprocessor::createProcessedInp
 											 mFileData.mFrames,
 											 mFileData.getMask(),
 											 mFileData.mFilename,
-											 QFileInfo(mFileData.mFilename).completeBaseName() ));
+											 QFileInfo(mFileData.mFilename).completeBaseName(),
+											 mFileData.mUsRaw->getImageContainer()));
 		CX_ASSERT(Eigen::Array3i(frames[i][0]->GetDimensions()).isApprox(Eigen::Array3i(mFileData.getMask()->GetDimensions())));
 		retval.push_back(input);
 	}
@@ -41,6 +41,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vtkSmartPointer.h>
 #include "cxProperty.h"
 #include  "boost/shared_ptr.hpp"
+#include "cxTransform3D.h"
 
 
 class QDomElement;
@@ -61,6 +62,43 @@ typedef boost::shared_ptr<class ProcessedUSInputData> ProcessedUSInputDataPtr;
  */
 
 typedef boost::shared_ptr<class ReconstructionMethodService> ReconstructionMethodServicePtr;
+typedef boost::shared_ptr<class IncrementalReconstruction> IncrementalReconstructionPtr;
+
+/**
+ * \brief Interface for reconstructing one frame at a time.
+ *
+ * Created by a ReconstructionMethodService that supports it,
+ * used for live reconstruction during acquisition.
+ *
+ * Call setInput() and setOutput(), then addFrame() for each frame
+ * as it arrives. finish() completes the reconstruction.
+ *
+ * Not thread-safe: Call all methods from the same thread.
+ */
+class org_custusx_usreconstruction_EXPORT IncrementalReconstruction
+{
+public:
+	virtual ~IncrementalReconstruction() {}
+	/**
+	 * \param mask Valid pixels in the frames. All frames have the dimensions and spacing of the mask.
+	 */
+	virtual void setInput(vtkImageDataPtr mask) = 0;
+	/**
+	 * Set the volume the frames are reconstructed into. Memory must be allocated in advance.
+	 * The volume can be replaced by a (larger) copy at any time between frames.
+	 */
+	virtual void setOutput(vtkImageDataPtr outputData) = 0;
+	/**
+	 * \param frame 8 bit frame data
+	 * \param dMu Transform from frame space u to output volume space d
+	 */
+	virtual void addFrame(unsigned char* frame, Transform3D dMu) = 0;
+	/**
+	 * Complete the reconstruction of the output set in setOutput(), i.e. fill holes.
+	 * Return the final volume.
+	 */
+	virtual vtkImageDataPtr finish() = 0;
+};
 
 /**
  * \brief Abstract interface for reconstruction algorithm.
@@ -89,6 +127,12 @@ public:
 	 * \param settings Reference to settings file containing algorithm-specific settings
 	 */
 	virtual bool reconstruct(ProcessedUSInputDataPtr input, vtkImageDataPtr outputData, QDomElement settings) = 0;
+	/**
+	 * Create an object for reconstructing one frame at a time,
+	 * or return null if this algorithm does not support it.
+	 * \param settings Reference to settings file containing algorithm-specific settings
+	 */
+	virtual IncrementalReconstructionPtr createIncrementalReconstruction(QDomElement settings) { return IncrementalReconstructionPtr(); }
 };
 
 /**
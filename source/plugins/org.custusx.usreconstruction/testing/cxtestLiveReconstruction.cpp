@@ -0,0 +1,100 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "catch.hpp"
+#include "cxLiveReconstruction.h"
+
+namespace cxtest
+{
+
+namespace
+{
+cx::LiveReconstructionFrame createFrame(double time)
+{
+	cx::LiveReconstructionFrame frame;
+	frame.mTime = time;
+	frame.m_prMu = cx::Transform3D::Identity();
+	return frame;
+}
+}
+
+TEST_CASE("LiveReconstructionFrameRing: frames are popped in order", "[unit][usreconstruction]")
+{
+	cx::LiveReconstructionFrameRing ring(4);
+	CHECK(ring.getCapacity() == 4);
+
+	for (unsigned i=0; i<3; ++i)
+		ring.push(createFrame(i));
+	CHECK(ring.size() == 3);
+
+	cx::LiveReconstructionFrame frame;
+	for (unsigned i=0; i<3; ++i)
+	{
+		REQUIRE(ring.pop(&frame, 0));
+		CHECK(frame.mTime == Approx(i));
+	}
+	CHECK(ring.size() == 0);
+	CHECK(!ring.pop(&frame, 10));
+	CHECK(ring.getNumberOfDroppedFrames() == 0);
+}
+
+TEST_CASE("LiveReconstructionFrameRing: drops oldest frame when full", "[unit][usreconstruction]")
+{
+	cx::LiveReconstructionFrameRing ring(3);
+
+	for (unsigned i=0; i<5; ++i)
+		ring.push(createFrame(i));
+	CHECK(ring.size() == 3);
+	CHECK(ring.getNumberOfDroppedFrames() == 2);
+
+	cx::LiveReconstructionFrame frame;
+	for (unsigned i=2; i<5; ++i)
+	{
+		REQUIRE(ring.pop(&frame, 0));
+		CHECK(frame.mTime == Approx(i));
+	}
+}
+
+TEST_CASE("LiveReconstructionFrameRing: close keeps remaining frames", "[unit][usreconstruction]")
+{
+	cx::LiveReconstructionFrameRing ring(3);
+	ring.push(createFrame(1));
+	ring.close();
+	CHECK(ring.isClosed());
+
+	cx::LiveReconstructionFrame frame;
+	REQUIRE(ring.pop(&frame, 1000));
+	CHECK(frame.mTime == Approx(1));
+	CHECK(!ring.pop(&frame, 1000));
+}
+
+} // namespace cxtest
@@ -120,6 +120,12 @@ void ReconstructionAlgorithmFixture::generateOutputVolume()
 	mOutputData = this->createOutputVolume("output");
 }
 
+void ReconstructionAlgorithmFixture::resetOutput()
+{
+	mOutputData.reset();
+	mComparer.reset();
+}
+
 void ReconstructionAlgorithmFixture::reconstruct(QDomElement root)
 {
 	if (this->getVerbose())
@@ -78,6 +78,8 @@ public:
 	cx::cxSyntheticVolumePtr getPhantom() { return mInputGenerator->getPhantom(); }
 
 	SyntheticReconstructInputPtr getInputGenerator() { return mInputGenerator; }
+	cx::ImagePtr getOutput() { return mOutputData; }
+	void resetOutput(); ///< discard the output volume, keep the input. Next reconstruct() will use a new, empty output.
 
 private:
 	void generateInput();
@@ -45,6 +45,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ==========================================================================*/
 #include "cxIGTLinkConversionImage.h"
 #include "vtkImageData.h"
+#include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkSmartPointer.h"
 
 #include <igtl_util.h>
 #include "cxLogger.h"
@@ -70,6 +73,23 @@ igtl::ImageMessage::Pointer IGTLinkConversionImage::encode(ImagePtr image, PATIE
 ImagePtr IGTLinkConversionImage::decode(igtl::ImageMessage *msg)
 {
 	vtkImageDataPtr vtkImage = this->decode_vtkImageData(msg);
+	return this->createImage(msg, vtkImage);
+}
+
+ImagePtr IGTLinkConversionImage::decode(igtl::ImageMessage::Pointer msg, IGTLinkImageMessagePoolPtr pool)
+{
+	vtkImageDataPtr vtkImage = this->decode_vtkImageDataSharingMessage(msg, pool);
+	if (vtkImage)
+		return this->createImage(msg, vtkImage);
+
+	vtkImage = this->decode_vtkImageData(msg);
+	ImagePtr retval = this->createImage(msg, vtkImage);
+	pool->release(msg);
+	return retval;
+}
+
+ImagePtr IGTLinkConversionImage::createImage(igtl::ImageMessage* msg, vtkImageDataPtr vtkImage)
+{
 	QDateTime timestamp = IGTLinkConversionBase().decode_timestamp(msg);
 	QString deviceName = msg->GetDeviceName();
 
@@ -288,6 +308,49 @@ vtkImageDataPtr IGTLinkConversionImage::decode_vtkImageData(igtl::ImageMessage *
 	return imageData;
 }
 
+bool IGTLinkConversionImage::needsByteSwap(igtl::ImageMessage* msg) const
+{
+	int endian = msg->GetEndian();
+	return msg->GetScalarSize() > 1 &&
+			((igtl_is_little_endian() && endian == igtl::ImageMessage::ENDIAN_BIG) ||
+			 (!igtl_is_little_endian() && endian == igtl::ImageMessage::ENDIAN_LITTLE));
+}
+
+/** Create an image referring to the message body. Return null if
+ * the data must be copied, i.e. byte swap or sub-volume.
+ */
+vtkImageDataPtr IGTLinkConversionImage::decode_vtkImageDataSharingMessage(igtl::ImageMessage::Pointer imgMsg, IGTLinkImageMessagePoolPtr pool)
+{
+	if (!pool)
+		return vtkImageDataPtr();
+	if (imgMsg->GetImageSize() != imgMsg->GetSubVolumeImageSize())
+		return vtkImageDataPtr();
+	if (this->needsByteSwap(imgMsg))
+		return vtkImageDataPtr();
+
+	int   size[3];
+	float spacing[3];
+	int scalarType = IGTLToVTKScalarType( imgMsg->GetScalarType() );
+	int numComponents = imgMsg->GetNumComponents();
+	imgMsg->GetDimensions(size);
+	imgMsg->GetSpacing(spacing);
+
+	vtkSmartPointer<vtkDataArray> scalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(scalarType));
+	if (!scalars)
+		return vtkImageDataPtr();
+	vtkIdType numberOfTuples = vtkIdType(size[0])*size[1]*size[2];
+	scalars->SetNumberOfComponents(numComponents);
+	scalars->SetVoidArray(imgMsg->GetScalarPointer(), numberOfTuples*numComponents, 1);
+	pool->releaseOnDelete(imgMsg, scalars);
+
+	vtkImageDataPtr imageData = vtkImageDataPtr::New();
+	imageData->SetExtent(0, size[0]-1, 0, size[1]-1, 0, size[2]-1);
+	imageData->SetOrigin(0.0, 0.0, 0.0);
+	imageData->SetSpacing(spacing[0], spacing[1], spacing[2]);
+	imageData->GetPointData()->SetScalars(scalars);
+	return imageData;
+}
+
 void IGTLinkConversionImage::encode_vtkImageData(vtkImageDataPtr in, igtl::ImageMessage *outmsg)
 {
 	// NOTE: This method is mostly a copy-paste from Slicer.
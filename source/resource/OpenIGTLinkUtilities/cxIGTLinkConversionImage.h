@@ -49,6 +49,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "igtlImageMessage.h"
 #include "cxImage.h"
 #include "cxOpenIGTLinkUtilitiesExport.h"
+#include "cxIGTLinkImageMessagePool.h"
 
 
 namespace cx
@@ -70,9 +71,21 @@ class cxOpenIGTLinkUtilities_EXPORT IGTLinkConversionImage
 public:
 	igtl::ImageMessage::Pointer encode(ImagePtr in, PATIENT_COORDINATE_SYSTEM externalSpace);
 	ImagePtr decode(igtl::ImageMessage *in);
+	/** Decode without copying the image data if possible:
+	 * The image data refers to the message body, and the message is
+	 * released to the pool when the image data is deleted.
+	 * If a copy is required (byte swap or sub-volume), the
+	 * message is released immediately.
+	 *
+	 * The message must have been acquired from the pool.
+	 */
+	ImagePtr decode(igtl::ImageMessage::Pointer in, IGTLinkImageMessagePoolPtr pool);
 
 private:
+	ImagePtr createImage(igtl::ImageMessage* msg, vtkImageDataPtr vtkImage);
 	vtkImageDataPtr decode_vtkImageData(igtl::ImageMessage* in);
+	vtkImageDataPtr decode_vtkImageDataSharingMessage(igtl::ImageMessage::Pointer in, IGTLinkImageMessagePoolPtr pool);
+	bool needsByteSwap(igtl::ImageMessage* msg) const;
 	void decode_rMd(igtl::ImageMessage* msg, ImagePtr out);
 //	void encode_Transform3D(Transform3D rMd, igtl::ImageMessage *outmsg);
 	void encode_rMd(ImagePtr image, igtl::ImageMessage *outmsg, PATIENT_COORDINATE_SYSTEM externalSpace);
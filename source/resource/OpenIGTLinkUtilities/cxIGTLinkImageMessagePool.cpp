@@ -0,0 +1,151 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxIGTLinkImageMessagePool.h"
+
+#include <boost/weak_ptr.hpp>
+#include <vtkCommand.h>
+#include <vtkDataArray.h>
+#include <vtkSmartPointer.h>
+#include "igtl_header.h"
+
+namespace cx
+{
+
+namespace
+{
+/** Return a message to its pool when the observed object is deleted.
+ */
+class ReleaseMessageOnDelete : public vtkCommand
+{
+public:
+	static ReleaseMessageOnDelete* New()
+	{
+		return new ReleaseMessageOnDelete;
+	}
+	virtual void Execute(vtkObject* caller, unsigned long, void*)
+	{
+		IGTLinkImageMessagePoolPtr pool = mPool.lock();
+		if (pool && mMessage)
+			pool->release(mMessage);
+		mMessage = igtl::ImageMessage::Pointer();
+	}
+	boost::weak_ptr<IGTLinkImageMessagePool> mPool;
+	igtl::ImageMessage::Pointer mMessage;
+};
+} // namespace
+
+IGTLinkImageMessagePoolStatistics::IGTLinkImageMessagePoolStatistics() :
+	mAcquired(0),
+	mAllocations(0),
+	mInUse(0),
+	mFree(0)
+{
+}
+
+IGTLinkImageMessagePoolPtr IGTLinkImageMessagePool::create(unsigned maxFree)
+{
+	return IGTLinkImageMessagePoolPtr(new IGTLinkImageMessagePool(maxFree));
+}
+
+IGTLinkImageMessagePool::IGTLinkImageMessagePool(unsigned maxFree) :
+	mMaxFree(maxFree)
+{
+}
+
+igtl::ImageMessage::Pointer IGTLinkImageMessagePool::acquire(igtl::MessageHeader* header)
+{
+	int packSize = IGTL_HEADER_SIZE + header->GetBodySizeToRead();
+	igtl::ImageMessage::Pointer retval;
+
+	{
+		QMutexLocker sentry(&mMutex);
+		// prefer a message with a buffer of the correct size
+		for (unsigned i=0; i<mFree.size(); ++i)
+		{
+			if (mFree[i]->GetPackSize() == packSize)
+			{
+				retval = mFree[i];
+				mFree.erase(mFree.begin()+i);
+				break;
+			}
+		}
+		if (!retval && !mFree.empty())
+		{
+			retval = mFree.back();
+			mFree.pop_back();
+		}
+	}
+
+	if (!retval)
+		retval = igtl::ImageMessage::New();
+
+	void* oldPack = retval->GetPackPointer();
+	retval->SetMessageHeader(header);
+	retval->AllocatePack();
+	bool allocated = (retval->GetPackPointer() != oldPack);
+
+	QMutexLocker sentry(&mMutex);
+	++mStatistics.mAcquired;
+	++mStatistics.mInUse;
+	if (allocated)
+		++mStatistics.mAllocations;
+	return retval;
+}
+
+void IGTLinkImageMessagePool::release(igtl::ImageMessage::Pointer msg)
+{
+	if (!msg)
+		return;
+	QMutexLocker sentry(&mMutex);
+	--mStatistics.mInUse;
+	if (mFree.size() < mMaxFree)
+		mFree.push_back(msg);
+}
+
+void IGTLinkImageMessagePool::releaseOnDelete(igtl::ImageMessage::Pointer msg, vtkDataArray* array)
+{
+	vtkSmartPointer<ReleaseMessageOnDelete> command = vtkSmartPointer<ReleaseMessageOnDelete>::New();
+	command->mPool = this->shared_from_this();
+	command->mMessage = msg;
+	array->AddObserver(vtkCommand::DeleteEvent, command);
+}
+
+IGTLinkImageMessagePoolStatistics IGTLinkImageMessagePool::getStatistics() const
+{
+	QMutexLocker sentry(&mMutex);
+	IGTLinkImageMessagePoolStatistics retval = mStatistics;
+	retval.mFree = mFree.size();
+	return retval;
+}
+
+} //namespace cx
@@ -0,0 +1,101 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXIGTLINKIMAGEMESSAGEPOOL_H
+#define CXIGTLINKIMAGEMESSAGEPOOL_H
+
+#include "cxOpenIGTLinkUtilitiesExport.h"
+
+#include <vector>
+#include <QMutex>
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include "igtlImageMessage.h"
+
+class vtkDataArray;
+
+namespace cx
+{
+
+struct cxOpenIGTLinkUtilities_EXPORT IGTLinkImageMessagePoolStatistics
+{
+	IGTLinkImageMessagePoolStatistics();
+	int mAcquired; ///< number of messages handed out
+	int mAllocations; ///< number of message buffers allocated, stays constant in steady state.
+	int mInUse; ///< messages handed out and not yet released
+	int mFree; ///< messages available for reuse
+};
+
+typedef boost::shared_ptr<class IGTLinkImageMessagePool> IGTLinkImageMessagePoolPtr;
+
+/** Pool of igtl::ImageMessage for receiving a stream of images.
+ *
+ * A message is acquired before the body is read from the socket, and
+ * released when the image data decoded from it is no longer in use,
+ * thus a stream of equally sized images are received into recycled buffers.
+ *
+ * Thread-safe.
+ *
+ * \ingroup cx_resource_OpenIGTLinkUtilities
+ */
+class cxOpenIGTLinkUtilities_EXPORT IGTLinkImageMessagePool : public boost::enable_shared_from_this<IGTLinkImageMessagePool>
+{
+public:
+	static IGTLinkImageMessagePoolPtr create(unsigned maxFree = 8);
+
+	/** Return a message with the given header and an allocated pack,
+	  * ready for receiving the body. A released message of equal size is
+	  * reused if available.
+	  */
+	igtl::ImageMessage::Pointer acquire(igtl::MessageHeader* header);
+	/** Return the message to the pool. It must not be used afterwards.
+	  */
+	void release(igtl::ImageMessage::Pointer msg);
+	/** Release the message when array is deleted. Use this when the array
+	  * refers to the message body. If the pool has been deleted by then,
+	  * the message is just deleted.
+	  */
+	void releaseOnDelete(igtl::ImageMessage::Pointer msg, vtkDataArray* array);
+
+	IGTLinkImageMessagePoolStatistics getStatistics() const;
+
+private:
+	explicit IGTLinkImageMessagePool(unsigned maxFree);
+	mutable QMutex mMutex;
+	unsigned mMaxFree;
+	std::vector<igtl::ImageMessage::Pointer> mFree;
+	IGTLinkImageMessagePoolStatistics mStatistics;
+};
+
+} //namespace cx
+
+#endif // CXIGTLINKIMAGEMESSAGEPOOL_H
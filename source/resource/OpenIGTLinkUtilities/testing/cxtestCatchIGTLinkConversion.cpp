@@ -33,6 +33,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "catch.hpp"
 
 #include "cxIGTLinkConversionImage.h"
+#include "cxIGTLinkImageMessagePool.h"
+#include "igtl_header.h"
 
 
 #include "cxtestIGTLinkConversionFixture.h"
@@ -172,3 +174,83 @@ TEST_CASE_METHOD(IGTLinkConversionFixture, "IGTLinkConversion: Decode/encode Pro
 	//not supported CHECK(input->getTemporalCalibration() == output->getTemporalCalibration());
 }
 
+namespace
+{
+/** Simulate receiving the packed message over a socket, using a message from the pool.
+ */
+igtl::ImageMessage::Pointer receiveFromPool(igtl::ImageMessage::Pointer sent, IGTLinkImageMessagePoolPtr pool)
+{
+	igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+	header->InitPack();
+	memcpy(header->GetPackPointer(), sent->GetPackPointer(), IGTL_HEADER_SIZE);
+	header->Unpack();
+
+	igtl::ImageMessage::Pointer retval = pool->acquire(header);
+	memcpy(retval->GetPackBodyPointer(), sent->GetPackBodyPointer(), retval->GetPackBodySize());
+	retval->Unpack();
+	return retval;
+}
+}
+
+TEST_CASE_METHOD(IGTLinkConversionFixture, "IGTLinkConversion: Decode image without copy, using pooled messages", "[unit][resource][OpenIGTLinkUtilities]")
+{
+	vtkImageDataPtr rawImage = cx::generateVtkImageData(Eigen::Array3i(100, 120, 1), cx::Vector3D(0.5, 0.6, 0.7), 0);
+	this->setValue(rawImage, 10, 20, 0, 4);
+	cx::ImagePtr input(new cx::Image("my_uid", rawImage));
+
+	cx::IGTLinkConversionImage converter;
+	igtl::ImageMessage::Pointer sent = converter.encode(input, pcsLPS);
+	sent->Pack();
+
+	IGTLinkImageMessagePoolPtr pool = IGTLinkImageMessagePool::create();
+
+	for (int i=0; i<5; ++i)
+	{
+		igtl::ImageMessage::Pointer received = receiveFromPool(sent, pool);
+		void* buffer = received->GetScalarPointer();
+		cx::ImagePtr output = converter.decode(received, pool);
+		received = igtl::ImageMessage::Pointer();
+
+		REQUIRE(output);
+		CHECK(output->getBaseVtkImageData()->GetScalarPointer() == buffer);
+		CHECK(input->getUid() == output->getUid());
+		CHECK(cx::similar(Eigen::Array3i(rawImage->GetDimensions()), Eigen::Array3i(output->getBaseVtkImageData()->GetDimensions())));
+		CHECK(this->getValue(output, 10, 20, 0) == 4);
+		CHECK(this->getValue(output, 11, 20, 0) == 0);
+		CHECK(pool->getStatistics().mInUse == 1);
+
+		output.reset();
+		CHECK(pool->getStatistics().mInUse == 0);
+	}
+
+	IGTLinkImageMessagePoolStatistics stats = pool->getStatistics();
+	CHECK(stats.mAcquired == 5);
+	CHECK(stats.mAllocations == 1);
+	CHECK(stats.mFree == 1);
+}
+
+TEST_CASE_METHOD(IGTLinkConversionFixture, "IGTLinkConversion: Pooled message is not reused while image is alive", "[unit][resource][OpenIGTLinkUtilities]")
+{
+	vtkImageDataPtr rawImage = cx::generateVtkImageData(Eigen::Array3i(30, 20, 1), cx::Vector3D(1, 1, 1), 0);
+	cx::ImagePtr input(new cx::Image("my_uid", rawImage));
+	cx::IGTLinkConversionImage converter;
+	IGTLinkImageMessagePoolPtr pool = IGTLinkImageMessagePool::create();
+
+	std::vector<cx::ImagePtr> outputs;
+	for (int i=0; i<3; ++i)
+	{
+		this->setValue(rawImage, 5, 5, 0, i+1);
+		igtl::ImageMessage::Pointer sent = converter.encode(input, pcsLPS);
+		sent->Pack();
+		outputs.push_back(converter.decode(receiveFromPool(sent, pool), pool));
+	}
+
+	for (int i=0; i<3; ++i)
+		CHECK(this->getValue(outputs[i], 5, 5, 0) == i+1);
+	CHECK(pool->getStatistics().mInUse == 3);
+	CHECK(pool->getStatistics().mAllocations == 3);
+
+	outputs.clear();
+	CHECK(pool->getStatistics().mInUse == 0);
+	CHECK(pool->getStatistics().mFree == 3);
+}
@@ -50,6 +50,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vtkPNGReader.h>
 
 #include <QtCore>
+#include <QtConcurrentRun>
 #include <QDomDocument>
 #include <QFileInfo>
 #include <QFile>
@@ -171,9 +172,6 @@ bool MetaImageReader::readInto(ImagePtr image, QString filename)
 	if (!image)
 		return false;
 
-	CustomMetaImagePtr customReader = CustomMetaImage::create(filename);
-	Transform3D rMd = customReader->readTransform();
-
 	vtkImageDataPtr raw = this->loadVtkImageData(filename);
 	if(!raw)
 		return false;
@@ -181,6 +179,72 @@ bool MetaImageReader::readInto(ImagePtr image, QString filename)
 	image->setVtkImageData(raw);
 //	ImagePtr image(new Image(uid, raw));
 
+	this->readMetaInformationInto(image, filename);
+	return true;
+}
+
+namespace
+{
+vtkImageDataPtr loadMetaImageInBackground(QString filename)
+{
+	return MetaImageReader().loadVtkImageData(filename);
+}
+
+/** Read dimension and spacing from the meta header, return false if not found.
+ */
+bool readMetaImageDimensions(CustomMetaImagePtr header, Eigen::Array3i* dim, Eigen::Array3d* spacing)
+{
+	QRegExp separator("\\s+");
+	QStringList dimSize = header->readKey("DimSize").split(separator, QString::SkipEmptyParts);
+	QString spacingText = header->readKey("ElementSpacing");
+	if (spacingText.isEmpty())
+		spacingText = header->readKey("ElementSize");
+	QStringList elementSpacing = spacingText.split(separator, QString::SkipEmptyParts);
+
+	if (dimSize.size() < 2 || dimSize.size() > 3 || elementSpacing.size() != dimSize.size())
+		return false;
+
+	*dim = Eigen::Array3i(1, 1, 1);
+	*spacing = Eigen::Array3d(1, 1, 1);
+	for (int i=0; i<dimSize.size(); ++i)
+	{
+		bool ok1 = false;
+		bool ok2 = false;
+		(*dim)[i] = dimSize[i].toInt(&ok1);
+		(*spacing)[i] = elementSpacing[i].toDouble(&ok2);
+		if (!ok1 || !ok2 || (*dim)[i] <= 0)
+			return false;
+	}
+	return true;
+}
+} // namespace
+
+bool MetaImageReader::readIntoInBackground(ImagePtr image, QString filename)
+{
+	if (!image)
+		return false;
+	if (!QFileInfo(filename).exists())
+	{
+		reportError("Load of data [" + filename + "] failed: file not found");
+		return false;
+	}
+
+	Eigen::Array3i dim;
+	Eigen::Array3d spacing;
+	if (!readMetaImageDimensions(CustomMetaImage::create(filename), &dim, &spacing))
+		return this->readInto(image, filename);
+
+	image->setVtkImageDataInBackground(QtConcurrent::run(&loadMetaImageInBackground, filename), dim, spacing);
+
+	this->readMetaInformationInto(image, filename);
+	return true;
+}
+
+void MetaImageReader::readMetaInformationInto(ImagePtr image, QString filename)
+{
+	CustomMetaImagePtr customReader = CustomMetaImage::create(filename);
+	Transform3D rMd = customReader->readTransform();
+
 	//  RegistrationTransform regTrans(rMd, QFileInfo(filename).lastModified(), "From MHD file");
 	//  image->get_rMd_History()->addRegistration(regTrans);
 	image->get_rMd_History()->setRegistration(rMd);
@@ -195,10 +259,10 @@ bool MetaImageReader::readInto(ImagePtr image, QString filename)
 	if (ok1 && ok2)
 	{
 		image->setInitialWindowLevel(window, level);
-		image->resetTransferFunctions();
+		// when loading in the background, the transfer functions are reset when loaded
+		if (!image->isLoadingInBackground())
+			image->resetTransferFunctions();
 	}
-
-	return true;
 }
 
 //-----
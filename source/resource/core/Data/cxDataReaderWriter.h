@@ -114,10 +114,16 @@ public:
 	virtual QString canLoadDataType() const { return "image"; }
 	virtual bool readInto(DataPtr data, QString path);
 	bool readInto(ImagePtr image, QString filename);
+	/** Read the meta information into image, and the voxel data in a background thread.
+	  * See Image::setVtkImageDataInBackground().
+	  */
+	bool readIntoInBackground(ImagePtr image, QString filename);
 	virtual DataPtr load(const QString& uid, const QString& filename);
 //	vtkImageDataPtr load(const QString& filename) { return this->loadVtkImageData(filename); }
 	virtual vtkImageDataPtr loadVtkImageData(QString filename);
 	void saveImage(ImagePtr image, const QString& filename);
+private:
+	void readMetaInformationInto(ImagePtr image, QString filename);
 };
 
 /**\brief Reader for portable network graphics .png files.
@@ -35,13 +35,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QDomDocument>
 #include <QDir>
-#include <vtkImageAccumulate.h>
+#include <QFutureWatcher>
 #include <vtkImageReslice.h>
 #include <vtkImageData.h>
 #include <vtkMatrix4x4.h>
 #include <vtkPlane.h>
 #include <vtkPlanes.h>
-#include <vtkImageResample.h>
 #include <vtkImageChangeInformation.h>
 #include <vtkImageClip.h>
 #include <vtkImageIterator.h>
@@ -125,7 +124,7 @@ Image::~Image()
 }
 
 Image::Image(const QString& uid, const vtkImageDataPtr& data, const QString& name) :
-	Data(uid, name), mBaseImageData(data), mMaxRGBIntensity(-1), mThresholdPreview(false)
+	Data(uid, name), mBaseImageData(data), mPyramidCacheMTime(0), mThresholdPreview(false)
 {
 	mInitialWindowWidth = -1;
 	mInitialWindowLevel = -1;
@@ -143,6 +142,7 @@ Image::Image(const QString& uid, const vtkImageDataPtr& data, const QString& nam
 
 ImagePtr Image::copy()
 {
+	this->completeBackgroundLoad();
 	vtkImageDataPtr baseImageDataCopy;
 	if(mBaseImageData)
 	{
@@ -155,7 +155,6 @@ ImagePtr Image::copy()
 	retval->mUnsigned = mUnsigned;
 	retval->mModality = mModality;
 	retval->mImageType = mImageType;
-	retval->mMaxRGBIntensity = mMaxRGBIntensity;
 	retval->mInterpolationType = mInterpolationType;
 	retval->mImageLookupTable2D = mImageLookupTable2D;
 	retval->mImageTransferFunctions3D = mImageTransferFunctions3D;
@@ -209,6 +208,7 @@ ImagePtr Image::getUnsigned(ImagePtr self)
 
 void Image::resetTransferFunctions(bool _2D, bool _3D)
 {
+	this->completeBackgroundLoad();
 	if (!mBaseImageData)
 	{
 		reportWarning("Image has no image data");
@@ -216,7 +216,6 @@ void Image::resetTransferFunctions(bool _2D, bool _3D)
 	}
 
 	mBaseImageData->GetScalarRange(); // this line updates some internal vtk value, and (on fedora) removes 4.5s in the second render().
-	mMaxRGBIntensity = -1;
 
 	ImageDefaultTFGenerator tfGenerator(ImagePtr(this, null_deleter()));
 	if (_3D)
@@ -290,7 +289,8 @@ void Image::setVtkImageData(const vtkImageDataPtr& data, bool resetTransferFunct
 {
 	mBaseImageData = data;
 	mBaseGrayScaleImageData = NULL;
-	mHistogramPtr = NULL;
+	mStatistics.reset();
+	this->resetPyramid();
 
 	if (resetTransferFunctions)
 		this->resetTransferFunctions();
@@ -324,6 +324,7 @@ ImageTF3DPtr Image::getTransferFunctions3D()
 
 ImageTF3DPtr Image::getUnmodifiedTransferFunctions3D()
 {
+	this->completeBackgroundLoad(); // restores the saved transfer functions
 	if(!this->mImageTransferFunctions3D)
 		this->resetTransferFunctions(false, true);
 	return mImageTransferFunctions3D;
@@ -343,6 +344,7 @@ ImageLUT2DPtr Image::getLookupTable2D()
 
 ImageLUT2DPtr Image::getUnmodifiedLookupTable2D()
 {
+	this->completeBackgroundLoad(); // restores the saved transfer functions
 	if(!mImageLookupTable2D)
 		this->resetTransferFunctions(true, false);
 	return mImageLookupTable2D;
@@ -355,11 +357,14 @@ void Image::setLookupTable2D(ImageLUT2DPtr imageLookupTable2D)
 
 vtkImageDataPtr Image::getBaseVtkImageData()
 {
+	this->completeBackgroundLoad();
 	return mBaseImageData;
 }
 
 DoubleBoundingBox3D Image::boundingBox() const
 {
+	if (mBackgroundLoad)
+		return mBackgroundLoad->mBounds;
 //	mBaseImageData->UpdateInformation();
 	DoubleBoundingBox3D bounds(mBaseImageData->GetBounds());
 	return bounds;
@@ -367,84 +372,30 @@ DoubleBoundingBox3D Image::boundingBox() const
 
 Eigen::Array3d Image::getSpacing() const
 {
+	if (mBackgroundLoad)
+		return mBackgroundLoad->mSpacing;
 	return Eigen::Array3d(mBaseImageData->GetSpacing());
 }
 
-vtkImageAccumulatePtr Image::getHistogram()
+ImageStatisticsPtr Image::getStatistics()
 {
-	if (mHistogramPtr.GetPointer() == NULL)
-	{
-		mHistogramPtr = vtkImageAccumulatePtr::New();
-		mHistogramPtr->SetInputData(this->getGrayScaleVtkImageData());
-		mHistogramPtr->IgnoreZeroOn(); // required for Sonowand CT volumes, where data are placed between 31K and 35K.
-		// Set up only a 1D histogram for now, so y and z values are set to 0
-		mHistogramPtr->SetComponentExtent(0, this->getRange(), 0, 0, 0, 0);
-		mHistogramPtr->SetComponentOrigin(this->getMin(), 0, 0);
-		mHistogramPtr->SetComponentSpacing(1, 0, 0);
-	}
-	mHistogramPtr->Update();
-	return mHistogramPtr;
+	this->completeBackgroundLoad();
+	if (!mStatistics || !mStatistics->isValidFor(mBaseImageData))
+		mStatistics = ImageStatistics::create(mBaseImageData);
+	return mStatistics;
 }
 
-template<typename scalartype> static int getRGBMax(vtkImageDataPtr image)
-{
-	int max = 0;
-	vtkImageIterator<scalartype> iter(image, image->GetExtent());
-	while (!iter.IsAtEnd())
-	{
-		typename vtkImageIterator<scalartype>::SpanIterator siter = iter.BeginSpan();
-		while (siter != iter.EndSpan())
-		{
-			int value = *siter;
-			++siter;
-			value += *siter;
-			++siter;
-			value += *siter;
-			++siter;
-			if (value > max)
-			{
-				max = value;
-			}
-		}
-		iter.NextSpan();
-	}
-	return max/3;
-}
-
-
 int Image::getMax()
 {
 	// Alternatively create max from histogram
 	//IntIntMap::iterator iter = this->getHistogram()->end();
 	//iter--;
 	//return (*iter).first;
+	ImageStatisticsPtr statistics = this->getStatistics();
 	if (mBaseImageData->GetNumberOfScalarComponents() == 3)
-	{
-		if (mMaxRGBIntensity != -1)
-		{
-			return mMaxRGBIntensity;
-		}
-		double max = 0.0;
-		switch (mBaseImageData->GetScalarType())
-		{
-		case VTK_UNSIGNED_CHAR:
-			max = getRGBMax<unsigned char>(mBaseImageData);
-			break;
-		case VTK_UNSIGNED_SHORT:
-			max = getRGBMax<unsigned short>(mBaseImageData);
-			break;
-		default:
-			CX_LOG_ERROR() << "Unhandled RGB data type in image " << this->getUid();
-			break;
-		}
-		mMaxRGBIntensity = max;
-		return (int)mMaxRGBIntensity;
-	}
+		return statistics->getRGBMax();
 	else
-	{
-//		return (int) this->getTransferFunctions3D()->getScalarMax();
-		return mBaseImageData->GetScalarRange()[1];
-	}
+		return statistics->getMax();
 }
 
 int Image::getMin()
@@ -452,8 +403,7 @@ int Image::getMin()
 	// Alternatively create min from histogram
 	//IntIntMap::iterator iter = this->getHistogram()->begin();
 	//return (*iter).first;
-	return mBaseImageData->GetScalarRange()[0];
-//	return (int) this->getTransferFunctions3D()->getScalarMin();
+	return this->getStatistics()->getMin();
 }
 
 int Image::getRange()
@@ -468,6 +418,7 @@ int Image::getMaxAlphaValue()
 
 int Image::getVTKMinValue()
 {
+	this->completeBackgroundLoad();
 	int vtkScalarType = mBaseImageData->GetScalarType();
 
 	if (vtkScalarType==VTK_CHAR)
@@ -491,6 +442,7 @@ int Image::getVTKMinValue()
 
 int Image::getVTKMaxValue()
 {
+	this->completeBackgroundLoad();
 	int vtkScalarType = mBaseImageData->GetScalarType();
 
 	if (vtkScalarType==VTK_CHAR)
@@ -583,9 +535,85 @@ bool Image::load(QString path)
 {
 	ImagePtr self = ImagePtr(this, null_deleter());
 	DataReaderWriter().readInto(self, path);
+	this->setPyramidCacheFilename(path);
 	return this->getBaseVtkImageData()!=0;
 }
 
+bool Image::loadInBackground(QString path)
+{
+	ImagePtr self = ImagePtr(this, null_deleter());
+	MetaImageReader reader;
+	if (!reader.canLoad(this->getType(), path))
+		return this->load(path);
+
+	bool success = reader.readIntoInBackground(self, path);
+	if (mBackgroundLoad)
+		mBackgroundLoad->mFilename = path;
+	else
+		this->setPyramidCacheFilename(path);
+	return success;
+}
+
+void Image::setVtkImageDataInBackground(QFuture<vtkImageDataPtr> data, Eigen::Array3i dim, Eigen::Array3d spacing)
+{
+	this->completeBackgroundLoad();
+
+	mBackgroundLoad.reset(new BackgroundLoad());
+	mBackgroundLoad->mData = data;
+	mBackgroundLoad->mDim = dim;
+	mBackgroundLoad->mSpacing = spacing;
+	mBackgroundLoad->mThumbnailRead = false;
+	mBackgroundLoad->mBounds = DoubleBoundingBox3D(0, (dim[0]-1)*spacing[0],
+												   0, (dim[1]-1)*spacing[1],
+												   0, (dim[2]-1)*spacing[2]);
+
+	QFutureWatcher<vtkImageDataPtr>* watcher = new QFutureWatcher<vtkImageDataPtr>(this);
+	connect(watcher, &QFutureWatcherBase::finished, this, &Image::completeBackgroundLoad);
+	watcher->setFuture(data);
+	mBackgroundLoad->mWatcher = watcher;
+}
+
+bool Image::isLoadingInBackground() const
+{
+	return mBackgroundLoad ? true : false;
+}
+
+void Image::completeBackgroundLoad()
+{
+	if (!mBackgroundLoad)
+		return;
+	boost::shared_ptr<BackgroundLoad> load = mBackgroundLoad;
+	mBackgroundLoad.reset();
+	load->mWatcher->deleteLater();
+
+	vtkImageDataPtr data = load->mData.result(); // waits for the load to complete
+	if (!data)
+	{
+		reportError(QString("Failed to load voxel data for image %1").arg(this->getName()));
+		data = createDummyImageData(2, 0);
+	}
+
+	// set the cache before setVtkImageData(), as listeners rebuild the pyramid from it
+	mPyramidCacheFilename = load->mFilename;
+	mPyramidCacheMTime = data->GetMTime();
+	QDomNode xml = load->mXml.documentElement();
+	ShadingStruct shading = mShading;
+
+	// emit once, after the saved transfer functions are restored
+	this->blockSignals(true);
+	this->setVtkImageData(data, xml.isNull());
+	if (!xml.isNull())
+	{
+		this->parseTransferFunctionsXml(xml);
+		mShading = shading; // parsed with the image, keep instead of the default for the modality
+	}
+	this->blockSignals(false);
+
+	emit vtkImageDataChanged();
+	emit transferFunctionsChanged();
+	emit backgroundLoadFinished();
+}
+
 void Image::parseXml(QDomNode& dataNode)
 {
 	Data::parseXml(dataNode);
@@ -596,21 +624,17 @@ void Image::parseXml(QDomNode& dataNode)
 	if (dataNode.isNull())
 		return;
 
-	//transferefunctions
-	QDomNode transferfunctionsNode = dataNode.namedItem("transferfunctions");
-	if (!transferfunctionsNode.isNull())
-		this->getUnmodifiedTransferFunctions3D()->parseXml(transferfunctionsNode);
+	if (mBackgroundLoad)
+	{
+		// the transfer functions depend on the voxel data: parse when loaded
+		mBackgroundLoad->mXml = QDomDocument();
+		mBackgroundLoad->mXml.appendChild(mBackgroundLoad->mXml.importNode(dataNode, true));
+	}
 	else
 	{
-		std::cout << "Warning: Image::parseXml() found no transferfunctions";
-		std::cout << std::endl;
+		this->parseTransferFunctionsXml(dataNode);
 	}
 
-	mInitialWindowWidth = this->loadAttribute(dataNode.namedItem("initialWindow"), "width", mInitialWindowWidth);
-	mInitialWindowLevel = this->loadAttribute(dataNode.namedItem("initialWindow"), "level", mInitialWindowLevel);
-
-	this->getUnmodifiedLookupTable2D()->parseXml(dataNode.namedItem("lookuptable2D"));
-
 	// backward compatibility:
 	mShading.on = dataNode.namedItem("shading").toElement().text().toInt();
 	//Assign default values if the shading nodes don't exists to allow backward compability
@@ -658,6 +682,24 @@ void Image::parseXml(QDomNode& dataNode)
 	}
 }
 
+void Image::parseTransferFunctionsXml(QDomNode& dataNode)
+{
+	//transferefunctions
+	QDomNode transferfunctionsNode = dataNode.namedItem("transferfunctions");
+	if (!transferfunctionsNode.isNull())
+		this->getUnmodifiedTransferFunctions3D()->parseXml(transferfunctionsNode);
+	else
+	{
+		std::cout << "Warning: Image::parseXml() found no transferfunctions";
+		std::cout << std::endl;
+	}
+
+	mInitialWindowWidth = this->loadAttribute(dataNode.namedItem("initialWindow"), "width", mInitialWindowWidth);
+	mInitialWindowLevel = this->loadAttribute(dataNode.namedItem("initialWindow"), "level", mInitialWindowLevel);
+
+	this->getUnmodifiedLookupTable2D()->parseXml(dataNode.namedItem("lookuptable2D"));
+}
+
 void Image::setInitialWindowLevel(double width, double level)
 {
 	mInitialWindowWidth = width;
@@ -780,6 +822,7 @@ void Image::mergevtkSettingsIntosscTransform()
 {
 	// the internal CustusX format does not handle extents starting at non-zero.
 	// Move extent to zero and change rMd.
+	this->completeBackgroundLoad();
 	Vector3D origin(mBaseImageData->GetOrigin());
 	Vector3D spacing(mBaseImageData->GetSpacing());
 	IntBoundingBox3D extent(mBaseImageData->GetExtent());
@@ -881,50 +924,61 @@ int Image::getInterpolationType() const
 
 vtkImageDataPtr Image::resample(long maxVoxels)
 {
+	if ((maxVoxels>0) && mBackgroundLoad)
+	{
+		vtkImageDataPtr thumbnail = this->getThumbnail();
+		if (thumbnail && (thumbnail->GetNumberOfPoints() <= maxVoxels))
+			return thumbnail;
+	}
+
 	// also use grayscale as vtk is incapable of rendering 3component color.
 	vtkImageDataPtr retval = this->getGrayScaleVtkImageData();
+	if ((maxVoxels==0) || (retval->GetNumberOfPoints() <= maxVoxels))
+		return retval;
+	return this->getPyramid()->getLevelBelow(maxVoxels);
+}
 
-	double factor = computeResampleFactor(maxVoxels);
-
-	if (fabs(1.0-factor)>0.01) // resampling
+vtkImageDataPtr Image::getThumbnail()
+{
+	if (!mBackgroundLoad)
+		return vtkImageDataPtr();
+	if (!mBackgroundLoad->mThumbnailRead)
 	{
-		vtkImageResamplePtr resampler = vtkImageResamplePtr::New();
-		resampler->SetInterpolationModeToLinear();
-		resampler->SetAxisMagnificationFactor(0, factor);
-		resampler->SetAxisMagnificationFactor(1, factor);
-		resampler->SetAxisMagnificationFactor(2, factor);
-		resampler->SetInputData(retval);
-//		resampler->GetOutput()->Update();
-		resampler->Update();
-		resampler->GetOutput()->GetScalarRange();
-		retval = resampler->GetOutput();
-
-//		long voxelsDown = retval->GetNumberOfPoints();
-//		long voxelsOrig = this->getBaseVtkImageData()->GetNumberOfPoints();
-//		report("Created downsampled volume in Image: "
-//									 + this->getName()
-//									 + " below " + qstring_cast(voxelsDown/1000/1000) + "M. "
-//									 + "Ratio: " + QString::number(factor, 'g', 2) + ", "
-//									 + "Original size: " + qstring_cast(voxelsOrig/1000/1000) + "M.");
+		mBackgroundLoad->mThumbnail = ImagePyramid::readThumbnail(mBackgroundLoad->mFilename,
+																  mBackgroundLoad->mDim,
+																  mBackgroundLoad->mSpacing);
+		mBackgroundLoad->mThumbnailRead = true;
 	}
-	return retval;
+	return mBackgroundLoad->mThumbnail;
 }
 
-double Image::computeResampleFactor(long maxVoxels)
+ImagePyramidPtr Image::getPyramid()
 {
-	if (maxVoxels==0)
-		return 1.0;
+	vtkImageDataPtr source = this->getGrayScaleVtkImageData();
+	if (mPyramid && mPyramid->isValidFor(source))
+		return mPyramid;
 
-	long voxels = this->getBaseVtkImageData()->GetNumberOfPoints();
-	double factor = (double)maxVoxels/(double)voxels;
-	factor = pow(factor, 1.0/3.0);
-	// cubic function leads to trouble for 138M-volume - must downsample to as low as 5-10 Mv in order to succeed on Mac.
+	this->resetPyramid();
+	// cache only if the data are unchanged since read from file
+	QString cacheFilename;
+	if (mBaseImageData->GetMTime() == mPyramidCacheMTime)
+		cacheFilename = mPyramidCacheFilename;
+	mPyramid = ImagePyramid::create(source, cacheFilename);
+	connect(mPyramid.get(), &ImagePyramid::levelsChanged, this, &Image::pyramidChanged);
+	return mPyramid;
+}
 
-	if (factor<0.99)
-	{
-		return factor;
-	}
-	return 1.0;
+void Image::resetPyramid()
+{
+	if (mPyramid)
+		disconnect(mPyramid.get(), &ImagePyramid::levelsChanged, this, &Image::pyramidChanged);
+	mPyramid.reset();
+}
+
+void Image::setPyramidCacheFilename(QString filename)
+{
+	mPyramidCacheFilename = filename;
+	mPyramidCacheMTime = mBaseImageData ? mBaseImageData->GetMTime() : 0;
 }
 
 void Image::save(const QString& basePath)
@@ -934,6 +988,10 @@ void Image::save(const QString& basePath)
 
 	ImagePtr self = ImagePtr(this, null_deleter());
 	MetaImageReader().saveImage(self, filename);
+	this->setPyramidCacheFilename(filename);
+	// keep the built levels, cached next to the saved file
+	if (mPyramid && mPyramid->isValidFor(this->getGrayScaleVtkImageData()))
+		mPyramid->setCacheFilename(filename);
 }
 
 void Image::startThresholdPreview(const Eigen::Vector2d &threshold)
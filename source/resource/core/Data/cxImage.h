@@ -40,15 +40,17 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <map>
 #include <vector>
 #include <boost/shared_ptr.hpp>
+#include <QFuture>
+#include <QDomDocument>
 #include "cxBoundingBox3D.h"
+#include "cxImageStatistics.h"
+#include "cxImagePyramid.h"
 #include "vtkForwardDeclarations.h"
 #include "cxForwardDeclarations.h"
 #include "cxData.h"
 
 typedef boost::shared_ptr<std::map<int, int> > HistogramMapPtr;
 
-class QDomNode;
-class QDomDocument;
 
 
 namespace cx
@@ -119,7 +121,11 @@ public:
 
 	virtual DoubleBoundingBox3D boundingBox() const; ///< bounding box in image space
 	virtual Eigen::Array3d getSpacing() const;
-	virtual vtkImageAccumulatePtr getHistogram();///< \return The histogram for the image
+	/** Range, histogram and RGB max of the voxels. Computed once and
+	  * reused until the image data are modified. This is also the histogram
+	  * of the image.
+	  */
+	ImageStatisticsPtr getStatistics();
 	virtual int getMax();	///< \return Return highest used value in the image
 	virtual int getMin();	///< \return Return lowest used value in the image
 	virtual int getRange();///< For convenience: getMax() - getMin()
@@ -140,6 +146,18 @@ public:
 	void addXml(QDomNode& dataNode); ///< adds xml information about the image and its variabels \param dataNode Data node in the XML tree \return The created subnode
 	virtual void parseXml(QDomNode& dataNode);///< Use a XML node to load data. \param dataNode A XML data representation of this object.
 	virtual bool load(QString path);
+	/** Read the meta information now and the voxel data in a background thread.
+	  * Formats without background support are loaded immediately.
+	  * Main thread only.
+	  */
+	bool loadInBackground(QString path);
+	/** Use voxel data loaded in a background thread. Until the load has completed,
+	  * boundingBox() and getSpacing() use dim and spacing, and image specific xml
+	  * requiring the voxel data is stored and parsed later.
+	  * Other access to the voxel data waits for the load to complete.
+	  */
+	void setVtkImageDataInBackground(QFuture<vtkImageDataPtr> data, Eigen::Array3i dim, Eigen::Array3d spacing);
+	bool isLoadingInBackground() const;
 	virtual QString getType() const
 	{
 		return getTypeName();
@@ -169,7 +187,18 @@ public:
 	void setInterpolationType(int val);
 	int getInterpolationType() const;
 
+	/** Return a grayscale version with at most maxVoxels voxels, from the pyramid.
+	  * While the pyramid is building, a subsampled preview is returned, and
+	  * pyramidChanged() is emitted when better levels are available.
+	  * While loading in the background, the thumbnail is returned if present,
+	  * and vtkImageDataChanged() is emitted when the load completes.
+	  */
 	vtkImageDataPtr resample(long maxVoxels);
+	/** Return a low resolution grayscale version read from the pyramid cache,
+	  * available while loading in the background, NULL otherwise.
+	  */
+	vtkImageDataPtr getThumbnail();
+	ImagePyramidPtr getPyramid(); ///< multi-resolution version of the grayscale image data
 
 	virtual void save(const QString &basePath);
 
@@ -181,9 +210,13 @@ signals:
 	void vtkImageDataChanged(); ///< emitted when the vktimagedata are invalidated and must be retrieved anew.
 	void transferFunctionsChanged(); ///< emitted when image transfer functions in 2D or 3D are changed.
 	void cropBoxChanged();
+	void backgroundLoadFinished(); ///< emitted when voxel data loaded in the background are in place.
+	void pyramidChanged(); ///< emitted when new levels are available in getPyramid()
 
 protected slots:
 	virtual void transformChangedSlot();
+private slots:
+	void completeBackgroundLoad(); ///< set voxel data loaded in the background, wait for them if necessary.
 
 protected:
 	vtkImageDataPtr mBaseImageData; ///< image data in data space
@@ -191,7 +224,6 @@ protected:
 //	vtkImageReslicePtr mOrientator; ///< converts imagedata to outputimagedata
 //	vtkMatrix4x4Ptr mOrientatorMatrix;
 //	vtkImageDataPtr mReferenceImageData; ///< imagedata after filtering through the orientatior, given in reference space
-	vtkImageAccumulatePtr mHistogramPtr;///< Histogram
 	ImagePtr mUnsigned; ///< version of this containing unsigned data.
 
 //	LandmarksPtr mLandmarks;
@@ -203,7 +235,7 @@ protected:
 
 	QString mModality; ///< modality of the image, defined as DICOM tag (0008,0060), Section 3, C.7.3.1.1.1
 	QString mImageType; ///< type of the image, defined as DICOM tag (0008,0008) (mainly value 3, but might be a merge of value 4), Section 3, C.7.6.1.1.2
-	double mMaxRGBIntensity;
+	ImageStatisticsPtr mStatistics; ///< cached statistics for mBaseImageData
 	int mInterpolationType; ///< mirror the interpolationType in vtkVolumeProperty
 
 
@@ -216,7 +248,27 @@ private:
 	DoubleBoundingBox3D getInitialBoundingBox() const;
 	double loadAttribute(QDomNode dataNode, QString name, double defVal);
 
-	double computeResampleFactor(long maxVoxels);
+	void parseTransferFunctionsXml(QDomNode& dataNode);
+	void setPyramidCacheFilename(QString filename);
+	void resetPyramid();
+
+	struct BackgroundLoad
+	{
+		QFuture<vtkImageDataPtr> mData;
+		QObject* mWatcher;
+		DoubleBoundingBox3D mBounds;
+		Eigen::Array3i mDim;
+		Eigen::Array3d mSpacing;
+		vtkImageDataPtr mThumbnail;
+		bool mThumbnailRead;
+		QDomDocument mXml; ///< image xml to parse when data are loaded
+		QString mFilename;
+	};
+	boost::shared_ptr<BackgroundLoad> mBackgroundLoad; ///< non-null while loading in the background
+
+	ImagePyramidPtr mPyramid;
+	QString mPyramidCacheFilename; ///< file containing the image data, used as pyramid cache
+	unsigned long mPyramidCacheMTime; ///< mtime of the image data when read from/written to mPyramidCacheFilename
 
 	ColorMap createPreviewColorMap(const Eigen::Vector2d &threshold);
 	IntIntMap createPreviewOpacityMap(const Eigen::Vector2d &threshold);
@@ -0,0 +1,541 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxImagePyramid.h"
+
+#include <math.h>
+#include <string.h>
+#include <limits>
+#include <algorithm>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTextStream>
+#include <QRegExp>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <vtkImageData.h>
+#include <vtkMetaImageWriter.h>
+#include "cxDataReaderWriter.h"
+#include "cxCustomMetaImage.h"
+#include "cxTypeConversions.h"
+
+namespace cx
+{
+
+namespace
+{
+
+const long minimumLevelVoxels = 64*64*64;
+
+struct VolumeGeometry
+{
+	int mDim[3];
+	double mSpacing[3];
+	double mOrigin[3]; ///< position of the first voxel
+};
+
+VolumeGeometry getGeometry(vtkImageDataPtr image)
+{
+	VolumeGeometry retval;
+	int* extent = image->GetExtent();
+	image->GetDimensions(retval.mDim);
+	image->GetSpacing(retval.mSpacing);
+	image->GetOrigin(retval.mOrigin);
+	for (int i=0; i<3; ++i)
+		retval.mOrigin[i] += extent[2*i]*retval.mSpacing[i];
+	return retval;
+}
+
+/** Voxel j in the output is centered between voxel 2j and 2j+1 in the input.
+  * Axes with a single voxel are kept as is.
+  */
+VolumeGeometry getReducedGeometry(VolumeGeometry input)
+{
+	VolumeGeometry retval = input;
+	for (int i=0; i<3; ++i)
+	{
+		if (input.mDim[i] <= 1)
+			continue;
+		retval.mDim[i] = (input.mDim[i]+1)/2;
+		retval.mSpacing[i] = 2*input.mSpacing[i];
+		retval.mOrigin[i] = input.mOrigin[i] + 0.5*input.mSpacing[i];
+	}
+	return retval;
+}
+
+vtkImageDataPtr createVolume(VolumeGeometry geometry, int scalarType, int components)
+{
+	vtkImageDataPtr retval = vtkImageDataPtr::New();
+	retval->SetSpacing(geometry.mSpacing);
+	retval->SetOrigin(geometry.mOrigin);
+	retval->SetExtent(0, geometry.mDim[0]-1, 0, geometry.mDim[1]-1, 0, geometry.mDim[2]-1);
+	retval->AllocateScalars(scalarType, components);
+	return retval;
+}
+
+template<class T> T averageOf8(double sum)
+{
+	if (std::numeric_limits<T>::is_integer)
+		return T(floor(sum/8 + 0.5));
+	return T(sum/8);
+}
+
+template<class T>
+void reduceVolume(const T* input, const int* inDim, T* output, const int* outDim, int components)
+{
+	std::vector<int> x0(outDim[0]), x1(outDim[0]);
+	for (int x=0; x<outDim[0]; ++x)
+	{
+		x0[x] = std::min(2*x, inDim[0]-1)*components;
+		x1[x] = std::min(2*x+1, inDim[0]-1)*components;
+	}
+
+	T* out = output;
+	for (int z=0; z<outDim[2]; ++z)
+	{
+		int z0 = std::min(2*z, inDim[2]-1);
+		int z1 = std::min(2*z+1, inDim[2]-1);
+		for (int y=0; y<outDim[1]; ++y)
+		{
+			int y0 = std::min(2*y, inDim[1]-1);
+			int y1 = std::min(2*y+1, inDim[1]-1);
+			const T* r00 = input + (vtkIdType(z0*inDim[1]+y0))*inDim[0]*components;
+			const T* r01 = input + (vtkIdType(z0*inDim[1]+y1))*inDim[0]*components;
+			const T* r10 = input + (vtkIdType(z1*inDim[1]+y0))*inDim[0]*components;
+			const T* r11 = input + (vtkIdType(z1*inDim[1]+y1))*inDim[0]*components;
+			for (int x=0; x<outDim[0]; ++x)
+			{
+				for (int c=0; c<components; ++c)
+				{
+					int i0 = x0[x]+c;
+					int i1 = x1[x]+c;
+					double sum = double(r00[i0]) + double(r00[i1]) + double(r01[i0]) + double(r01[i1])
+							   + double(r10[i0]) + double(r10[i1]) + double(r11[i0]) + double(r11[i1]);
+					*out++ = averageOf8<T>(sum);
+				}
+			}
+		}
+	}
+}
+
+bool canReduce(VolumeGeometry geometry)
+{
+	const int* dim = geometry.mDim;
+	bool hasAxisToReduce = (dim[0]>1) || (dim[1]>1) || (dim[2]>1);
+	return hasAxisToReduce && (qint64(dim[0])*dim[1]*dim[2] > minimumLevelVoxels);
+}
+
+QString getCacheFolder(QString cacheFilename)
+{
+	return QFileInfo(cacheFilename).path() + "/pyramid";
+}
+
+QString getLevelFilename(QString cacheFilename, int level)
+{
+	QString base = QFileInfo(cacheFilename).completeBaseName();
+	return QString("%1/%2_level%3.mhd").arg(getCacheFolder(cacheFilename)).arg(base).arg(level);
+}
+
+QString getStampFilename(QString cacheFilename)
+{
+	QString base = QFileInfo(cacheFilename).completeBaseName();
+	return QString("%1/%2_level.stamp").arg(getCacheFolder(cacheFilename)).arg(base);
+}
+
+/** Return a stamp identifying the contents of the source volume.
+  * The source file is rewritten on each save, thus its time cannot be used.
+  */
+QString getContentStamp(vtkImageDataPtr source)
+{
+	int* dim = source->GetDimensions();
+	qint64 bytes = qint64(source->GetNumberOfPoints()) * source->GetScalarSize() * source->GetNumberOfScalarComponents();
+	const char* data = static_cast<const char*>(source->GetScalarPointer());
+
+	// 64 bit FNV-1a, one word at a time
+	quint64 hash = Q_UINT64_C(14695981039346656037);
+	qint64 i = 0;
+	for (; i+8 <= bytes; i += 8)
+	{
+		quint64 word;
+		memcpy(&word, data+i, 8);
+		hash = (hash ^ word) * Q_UINT64_C(1099511628211);
+	}
+	for (; i < bytes; ++i)
+		hash = (hash ^ quint64(static_cast<unsigned char>(data[i]))) * Q_UINT64_C(1099511628211);
+
+	return QString("%1 %2 %3 %4 %5 %6")
+			.arg(dim[0]).arg(dim[1]).arg(dim[2])
+			.arg(source->GetScalarType())
+			.arg(source->GetNumberOfScalarComponents())
+			.arg(hash, 16, 16, QChar('0'));
+}
+
+/** Return a stamp identifying the file holding the source voxels,
+  * used to validate the cache before the source is loaded.
+  */
+QString getSourceFileStamp(QString cacheFilename)
+{
+	QFileInfo info(cacheFilename);
+	if (info.suffix().toLower() == "mhd")
+	{
+		QString dataFile = CustomMetaImage::create(cacheFilename)->readKey("ElementDataFile").trimmed();
+		if (!dataFile.isEmpty() && (dataFile != "LOCAL"))
+			info = QFileInfo(info.dir(), dataFile);
+	}
+	if (!info.exists())
+		return QString();
+	return QString("%1 %2").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+/** Return the stamp lines: the content stamp followed by the source file stamp.
+  */
+QStringList readStamp(QString cacheFilename)
+{
+	QStringList retval;
+	QFile file(getStampFilename(cacheFilename));
+	if (!file.open(QIODevice::ReadOnly))
+		return retval;
+	QTextStream stream(&file);
+	while (!stream.atEnd())
+		retval << stream.readLine();
+	return retval;
+}
+
+void writeStamp(QString cacheFilename, QString contentStamp, QString fileStamp)
+{
+	QString filename = getStampFilename(cacheFilename);
+	if (contentStamp.isEmpty())
+	{
+		QFile::remove(filename);
+		return;
+	}
+	QDir().mkpath(QFileInfo(filename).path());
+	QFile file(filename);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+	QTextStream(&file) << contentStamp << "\n" << fileStamp << "\n";
+}
+
+/** Read a level from the cache, return NULL if not present
+  * or different from the expected geometry.
+  */
+vtkImageDataPtr readCachedLevel(QString cacheFilename, int level, VolumeGeometry expected)
+{
+	QString filename = getLevelFilename(cacheFilename, level);
+	if (!QFileInfo(filename).exists())
+		return vtkImageDataPtr();
+
+	vtkImageDataPtr retval = MetaImageReader().loadVtkImageData(filename);
+	if (!retval)
+		return vtkImageDataPtr();
+
+	int* dim = retval->GetDimensions();
+	if ((dim[0]!=expected.mDim[0]) || (dim[1]!=expected.mDim[1]) || (dim[2]!=expected.mDim[2]))
+		return vtkImageDataPtr();
+
+	retval->SetSpacing(expected.mSpacing); // the reader does not keep the origin
+	retval->SetOrigin(expected.mOrigin);
+	return retval;
+}
+
+void writeCachedLevel(QString cacheFilename, int level, vtkImageDataPtr image)
+{
+	QString filename = getLevelFilename(cacheFilename, level);
+	QDir().mkpath(QFileInfo(filename).path());
+
+	vtkMetaImageWriterPtr writer = vtkMetaImageWriterPtr::New();
+	writer->SetInputData(image);
+	writer->SetFileDimensionality(3);
+	writer->SetFileName(cstring_cast(filename));
+	writer->SetCompression(false);
+	writer->Write();
+}
+
+/** Write all levels and the stamp to the cache, e.g. after the source has been saved to a new file.
+  */
+void writeCache(QString cacheFilename, vtkImageDataPtr source, const std::vector<vtkImageDataPtr>& levels)
+{
+	writeStamp(cacheFilename, QString(), QString()); // invalid until all levels are written
+	for (unsigned i=0; i<levels.size(); ++i)
+		writeCachedLevel(cacheFilename, i+1, levels[i]);
+	writeStamp(cacheFilename, getContentStamp(source), getSourceFileStamp(cacheFilename));
+}
+
+/** Build the levels, reusing the cache if it was written from the same contents.
+  * Stop without writing to the cache if cancel is set.
+  */
+std::vector<vtkImageDataPtr> buildLevels(vtkImageDataPtr source, QString cacheFilename, boost::shared_ptr<QAtomicInt> cancel)
+{
+	QString stamp;
+	QString fileStamp;
+	bool useCache = false;
+	bool fileStampChanged = false;
+	if (!cacheFilename.isEmpty())
+	{
+		stamp = getContentStamp(source);
+		fileStamp = getSourceFileStamp(cacheFilename);
+		QStringList cachedStamp = readStamp(cacheFilename);
+		useCache = !cachedStamp.isEmpty() && (cachedStamp[0] == stamp);
+		fileStampChanged = (cachedStamp.size() < 2) || (cachedStamp[1] != fileStamp);
+	}
+
+	bool written = false;
+	std::vector<vtkImageDataPtr> retval;
+	vtkImageDataPtr current = source;
+	for (int level=1; canReduce(getGeometry(current)); ++level)
+	{
+		if (cancel->loadAcquire())
+			return std::vector<vtkImageDataPtr>();
+
+		vtkImageDataPtr next;
+		if (useCache)
+			next = readCachedLevel(cacheFilename, level, getReducedGeometry(getGeometry(current)));
+		if (next && ((next->GetScalarType() != current->GetScalarType())
+					 || (next->GetNumberOfScalarComponents() != current->GetNumberOfScalarComponents())))
+			next = vtkImageDataPtr();
+		if (!next)
+		{
+			next = ImagePyramid::reduce(current);
+			if (!cacheFilename.isEmpty() && !cancel->loadAcquire())
+			{
+				if (!written)
+					writeStamp(cacheFilename, QString(), QString()); // invalid until all levels are written
+				writeCachedLevel(cacheFilename, level, next);
+				written = true;
+			}
+		}
+		retval.push_back(next);
+		current = next;
+	}
+
+	// the source file is rewritten on save: keep the stamp up to date for readThumbnail()
+	if ((written || (useCache && fileStampChanged)) && !cancel->loadAcquire())
+		writeStamp(cacheFilename, stamp, fileStamp);
+	return retval;
+}
+
+} // namespace
+
+ImagePyramidPtr ImagePyramid::create(vtkImageDataPtr source, QString cacheFilename)
+{
+	return ImagePyramidPtr(new ImagePyramid(source, cacheFilename));
+}
+
+ImagePyramid::ImagePyramid(vtkImageDataPtr source, QString cacheFilename) :
+	mSource(source),
+	mSourceMTime(source->GetMTime()),
+	mCacheFilename(cacheFilename),
+	mWatcher(NULL),
+	mBuilt(false),
+	mCancel(new QAtomicInt(0))
+{
+}
+
+ImagePyramid::~ImagePyramid()
+{
+	// a running build stops in the background without writing to the cache.
+	mCancel->fetchAndStoreOrdered(1);
+}
+
+bool ImagePyramid::isValidFor(vtkImageDataPtr source) const
+{
+	return source && (source == mSource) && (source->GetMTime() == mSourceMTime);
+}
+
+vtkImageDataPtr ImagePyramid::getLevelBelow(long maxVoxels)
+{
+	if ((maxVoxels <= 0) || (mSource->GetNumberOfPoints() <= maxVoxels))
+		return mSource;
+
+	for (unsigned i=0; i<mLevels.size(); ++i)
+		if (mLevels[i]->GetNumberOfPoints() <= maxVoxels)
+			return mLevels[i];
+
+	this->build();
+
+	if (mPreview && (mPreview->GetNumberOfPoints() <= maxVoxels))
+		return mPreview;
+
+	vtkImageDataPtr coarsest = mLevels.empty() ? mSource : mLevels.back();
+	int stride = int(ceil(pow(double(coarsest->GetNumberOfPoints())/maxVoxels, 1.0/3.0)));
+	mPreview = subsample(coarsest, std::max(stride, 2));
+	while (mPreview->GetNumberOfPoints() > maxVoxels)
+		mPreview = subsample(coarsest, ++stride);
+	return mPreview;
+}
+
+vtkImageDataPtr ImagePyramid::getLevel(int level) const
+{
+	if (level == 0)
+		return mSource;
+	if ((level < 0) || (level > int(mLevels.size())))
+		return vtkImageDataPtr();
+	return mLevels[level-1];
+}
+
+int ImagePyramid::getNumberOfLevels() const
+{
+	return int(mLevels.size()) + 1;
+}
+
+void ImagePyramid::build()
+{
+	if (mWatcher)
+		return;
+	mWatcher = new QFutureWatcher<std::vector<vtkImageDataPtr> >(this);
+	connect(mWatcher, &QFutureWatcherBase::finished, this, &ImagePyramid::buildFinishedSlot);
+	mBuildCacheFilename = mCacheFilename;
+	mWatcher->setFuture(QtConcurrent::run(&buildLevels, mSource, mBuildCacheFilename, mCancel));
+}
+
+bool ImagePyramid::isBuilding() const
+{
+	return mWatcher && !mBuilt;
+}
+
+void ImagePyramid::waitForBuild()
+{
+	if (!mWatcher)
+		return;
+	mWatcher->waitForFinished();
+	this->buildFinishedSlot();
+}
+
+void ImagePyramid::buildFinishedSlot()
+{
+	if (!mWatcher || mBuilt)
+		return;
+	mBuilt = true;
+	mLevels = mWatcher->result();
+	mPreview = vtkImageDataPtr();
+	// the cache file changed during the build
+	if (!mCacheFilename.isEmpty() && (mCacheFilename != mBuildCacheFilename))
+		writeCache(mCacheFilename, mSource, mLevels);
+	emit levelsChanged();
+}
+
+void ImagePyramid::setCacheFilename(QString cacheFilename)
+{
+	if (cacheFilename == mCacheFilename)
+		return;
+	mCacheFilename = cacheFilename;
+	if (mBuilt && !mCacheFilename.isEmpty())
+		writeCache(mCacheFilename, mSource, mLevels);
+}
+
+vtkImageDataPtr ImagePyramid::reduce(vtkImageDataPtr input)
+{
+	VolumeGeometry inGeometry = getGeometry(input);
+	VolumeGeometry outGeometry = getReducedGeometry(inGeometry);
+	int components = input->GetNumberOfScalarComponents();
+	vtkImageDataPtr retval = createVolume(outGeometry, input->GetScalarType(), components);
+
+	switch (input->GetScalarType())
+	{
+	vtkTemplateMacro(reduceVolume(static_cast<VTK_TT*>(input->GetScalarPointer()), inGeometry.mDim,
+								  static_cast<VTK_TT*>(retval->GetScalarPointer()), outGeometry.mDim, components));
+	}
+	return retval;
+}
+
+vtkImageDataPtr ImagePyramid::subsample(vtkImageDataPtr input, int stride)
+{
+	VolumeGeometry inGeometry = getGeometry(input);
+	VolumeGeometry outGeometry = inGeometry;
+	for (int i=0; i<3; ++i)
+	{
+		outGeometry.mDim[i] = (inGeometry.mDim[i]+stride-1)/stride;
+		outGeometry.mSpacing[i] = inGeometry.mSpacing[i]*stride;
+	}
+	vtkImageDataPtr retval = createVolume(outGeometry, input->GetScalarType(), input->GetNumberOfScalarComponents());
+
+	int voxelSize = input->GetScalarSize()*input->GetNumberOfScalarComponents();
+	const char* in = static_cast<const char*>(input->GetScalarPointer());
+	char* out = static_cast<char*>(retval->GetScalarPointer());
+	const int* inDim = inGeometry.mDim;
+	for (int z=0; z<outGeometry.mDim[2]; ++z)
+	{
+		for (int y=0; y<outGeometry.mDim[1]; ++y)
+		{
+			const char* row = in + (vtkIdType(z*stride)*inDim[1] + y*stride)*inDim[0]*voxelSize;
+			for (int x=0; x<outGeometry.mDim[0]; ++x)
+			{
+				memcpy(out, row + vtkIdType(x*stride)*voxelSize, voxelSize);
+				out += voxelSize;
+			}
+		}
+	}
+	return retval;
+}
+
+vtkImageDataPtr ImagePyramid::readThumbnail(QString cacheFilename, Eigen::Array3i dim, Eigen::Array3d spacing)
+{
+	if (cacheFilename.isEmpty())
+		return vtkImageDataPtr();
+	QStringList stamp = readStamp(cacheFilename);
+	if ((stamp.size() < 2) || stamp[1].isEmpty() || (stamp[1] != getSourceFileStamp(cacheFilename)))
+		return vtkImageDataPtr();
+
+	VolumeGeometry geometry;
+	for (int i=0; i<3; ++i)
+	{
+		geometry.mDim[i] = dim[i];
+		geometry.mSpacing[i] = spacing[i];
+		geometry.mOrigin[i] = 0;
+	}
+	int level = 0;
+	for (; canReduce(geometry); ++level)
+		geometry = getReducedGeometry(geometry);
+	if (level == 0)
+		return vtkImageDataPtr();
+
+	return readCachedLevel(cacheFilename, level, geometry);
+}
+
+QStringList ImagePyramid::getCacheFiles(QString cacheFilename)
+{
+	QStringList retval;
+	QDir folder(getCacheFolder(cacheFilename));
+	QString base = QFileInfo(cacheFilename).completeBaseName();
+	// other images may share the prefix, e.g. <base>_level1 has <base>_level1_level1.mhd
+	QRegExp levelFile(QRegExp::escape(base) + "_level[0-9]+\\.(mhd|raw)");
+	QString stampFile = QFileInfo(getStampFilename(cacheFilename)).fileName();
+	QStringList files = folder.entryList(QStringList() << base+"_level*", QDir::Files);
+	for (int i=0; i<files.size(); ++i)
+		if (levelFile.exactMatch(files[i]) || (files[i] == stampFile))
+			retval << folder.absoluteFilePath(files[i]);
+	return retval;
+}
+
+} // namespace cx
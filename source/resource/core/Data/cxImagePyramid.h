@@ -0,0 +1,131 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXIMAGEPYRAMID_H
+#define CXIMAGEPYRAMID_H
+
+#include "cxResourceExport.h"
+#include "cxPrecompiledHeader.h"
+
+#include <vector>
+#include <QObject>
+#include <QFuture>
+#include <QStringList>
+#include <QAtomicInt>
+#include <boost/shared_ptr.hpp>
+#include "vtkForwardDeclarations.h"
+#include "cxVector3D.h"
+
+template<class T> class QFutureWatcher;
+
+namespace cx
+{
+typedef boost::shared_ptr<class ImagePyramid> ImagePyramidPtr;
+
+/** Multi-resolution version of a volume.
+ *
+ * Level 0 is the source volume. Each following level is reduced by a
+ * factor 2 along each axis using a 2x2x2 box filter, down to about
+ * 64^3 voxels. The levels are built in a background thread.
+ *
+ * If a cache file is given, the levels are stored on disk in a
+ * folder next to it, along with a stamp of the source contents. They
+ * are reused as long as the stamp matches, thus saving the source
+ * again does not invalidate them. The coarsest cached level can be
+ * read as a thumbnail before the source itself is loaded.
+ *
+ * Main thread only.
+ *
+ * \ingroup cx_resource_core_data
+ * \date 2026-10-18
+ */
+class cxResource_EXPORT ImagePyramid : public QObject
+{
+	Q_OBJECT
+public:
+	/** Create a pyramid for source. cacheFilename is the file containing
+	  * the source, or empty if the levels should not be cached.
+	  */
+	static ImagePyramidPtr create(vtkImageDataPtr source, QString cacheFilename = QString());
+	virtual ~ImagePyramid();
+
+	bool isValidFor(vtkImageDataPtr source) const; ///< true if built from source in its current state
+
+	/** Return the finest level with at most maxVoxels voxels.
+	  * Starts the build if necessary. If no such level is ready yet, a
+	  * nearest neighbour subsampling of the source is returned.
+	  */
+	vtkImageDataPtr getLevelBelow(long maxVoxels);
+	vtkImageDataPtr getLevel(int level) const; ///< return level, NULL if not ready
+	int getNumberOfLevels() const; ///< number of ready levels, including the source
+
+	/** Move the cache to the file now containing the source, e.g. after Save As.
+	  * Built levels are written to the new cache, the old cache is left as is.
+	  */
+	void setCacheFilename(QString cacheFilename);
+	void build(); ///< start building levels in the background, if not already started
+	bool isBuilding() const;
+	void waitForBuild(); ///< block until the build has completed
+
+	static vtkImageDataPtr reduce(vtkImageDataPtr input); ///< halve the resolution using a 2x2x2 box filter
+	static vtkImageDataPtr subsample(vtkImageDataPtr input, int stride); ///< nearest neighbour, keep every stride voxel
+	/** Return the coarsest cached level of the volume in cacheFilename, with
+	  * the given dimension and spacing, NULL if the cache is missing or the file
+	  * has changed since the cache was written. Cheap, intended for use while
+	  * the full volume loads.
+	  */
+	static vtkImageDataPtr readThumbnail(QString cacheFilename, Eigen::Array3i dim, Eigen::Array3d spacing);
+	static QStringList getCacheFiles(QString cacheFilename); ///< all files in the cache for cacheFilename
+
+signals:
+	void levelsChanged(); ///< emitted when new levels are ready
+
+private slots:
+	void buildFinishedSlot();
+
+private:
+	ImagePyramid(vtkImageDataPtr source, QString cacheFilename);
+
+	vtkImageDataPtr mSource;
+	unsigned long mSourceMTime;
+	QString mCacheFilename;
+	QString mBuildCacheFilename; ///< cache used by the build
+	std::vector<vtkImageDataPtr> mLevels; ///< reduced levels, mLevels[0] is level 1
+	vtkImageDataPtr mPreview; ///< used while building
+	QFutureWatcher<std::vector<vtkImageDataPtr> >* mWatcher;
+	bool mBuilt;
+	boost::shared_ptr<QAtomicInt> mCancel; ///< set when discarded, shared with the build
+};
+
+} // namespace cx
+
+#endif // CXIMAGEPYRAMID_H
@@ -0,0 +1,312 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxImageStatistics.h"
+
+#include <limits>
+#include <algorithm>
+#include <QThread>
+#include <QtConcurrentRun>
+#include <boost/bind.hpp>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+
+namespace cx
+{
+
+namespace
+{
+
+/** Partial statistics for one range of voxels.
+ */
+struct ImageStatisticsChunk
+{
+	ImageStatisticsChunk() : mMin(0), mMax(0), mRGBMax(0) {}
+	double mMin;
+	double mMax;
+	double mRGBMax; ///< max of sum of the first three components
+	std::vector<qint64> mHistogram;
+};
+
+/** 8 and 16 bit integer types are binned directly on their full type range,
+  * thus the histogram and range can be found in one pass.
+  */
+template<class T> bool hasDirectHistogram()
+{
+	return std::numeric_limits<T>::is_integer && (sizeof(T) <= 2);
+}
+
+template<class T> double getRGBSum(const T* p)
+{
+	return double(p[0]) + double(p[1]) + double(p[2]);
+}
+
+template<class T>
+void accumulateChunk(const T* data, vtkIdType begin, vtkIdType end, int components, ImageStatisticsChunk* chunk)
+{
+	const T* first = data + begin*components;
+	const T* last = data + end*components;
+
+	if (hasDirectHistogram<T>())
+	{
+		int offset = std::numeric_limits<T>::min();
+		chunk->mHistogram.assign(1 << (8*std::min(int(sizeof(T)), 2)), 0);
+		qint64* histogram = &chunk->mHistogram[0];
+		for (const T* p = first; p < last; p += components)
+			++histogram[int(*p) - offset];
+	}
+	else
+	{
+		T minVal = *first;
+		T maxVal = *first;
+		if (components == 1)
+		{
+			// branch free, allows the compiler to vectorize
+			for (const T* p = first; p != last; ++p)
+			{
+				minVal = (*p < minVal) ? *p : minVal;
+				maxVal = (*p > maxVal) ? *p : maxVal;
+			}
+		}
+		else
+		{
+			for (const T* p = first; p < last; p += components)
+			{
+				minVal = (*p < minVal) ? *p : minVal;
+				maxVal = (*p > maxVal) ? *p : maxVal;
+			}
+		}
+		chunk->mMin = minVal;
+		chunk->mMax = maxVal;
+	}
+
+	if (components >= 3)
+	{
+		double rgbMax = 0;
+		for (const T* p = first; p < last; p += components)
+			rgbMax = std::max(rgbMax, getRGBSum(p));
+		chunk->mRGBMax = rgbMax;
+	}
+}
+
+template<class T>
+void histogramChunk(const T* data, vtkIdType begin, vtkIdType end, int components,
+					double origin, double binWidth, int bins, ImageStatisticsChunk* chunk)
+{
+	chunk->mHistogram.assign(bins, 0);
+	qint64* histogram = &chunk->mHistogram[0];
+	double scale = 1.0/binWidth;
+	const T* last = data + end*components;
+	for (const T* p = data + begin*components; p < last; p += components)
+	{
+		int bin = int((double(*p) - origin)*scale);
+		++histogram[std::min(std::max(bin, 0), bins-1)];
+	}
+}
+
+void waitForAll(std::vector<QFuture<void> >& futures)
+{
+	for (unsigned i=0; i<futures.size(); ++i)
+		futures[i].waitForFinished();
+	futures.clear();
+}
+
+void addHistogram(std::vector<qint64>* sum, const std::vector<qint64>& value)
+{
+	if (sum->empty())
+		sum->assign(value.size(), 0);
+	for (unsigned i=0; i<value.size(); ++i)
+		(*sum)[i] += value[i];
+}
+
+/** Compute statistics for the scalars in data, split among threads.
+  */
+template<class T>
+void computeStatistics(const T* data, vtkIdType voxels, int components,
+					   double* minVal, double* maxVal, double* rgbMax, double* binWidth,
+					   std::vector<qint64>* histogram)
+{
+	int threads = (voxels < 65536) ? 1 : std::max(1, QThread::idealThreadCount());
+	std::vector<ImageStatisticsChunk> chunks(threads);
+	std::vector<vtkIdType> limits(threads+1);
+	for (int i=0; i<=threads; ++i)
+		limits[i] = voxels*i/threads;
+
+	std::vector<QFuture<void> > futures;
+	for (int i=0; i<threads; ++i)
+		futures.push_back(QtConcurrent::run(boost::bind(&accumulateChunk<T>, data, limits[i], limits[i+1], components, &chunks[i])));
+	waitForAll(futures);
+
+	*rgbMax = 0;
+	for (int i=0; i<threads; ++i)
+		*rgbMax = std::max(*rgbMax, chunks[i].mRGBMax/3);
+
+	if (hasDirectHistogram<T>())
+	{
+		std::vector<qint64> full;
+		for (int i=0; i<threads; ++i)
+			addHistogram(&full, chunks[i].mHistogram);
+		int firstBin = 0;
+		while (full[firstBin] == 0)
+			++firstBin;
+		int lastBin = int(full.size()) - 1;
+		while (full[lastBin] == 0)
+			--lastBin;
+		int offset = std::numeric_limits<T>::min();
+		*minVal = firstBin + offset;
+		*maxVal = lastBin + offset;
+		*binWidth = 1;
+		histogram->assign(full.begin()+firstBin, full.begin()+lastBin+1);
+		return;
+	}
+
+	*minVal = chunks[0].mMin;
+	*maxVal = chunks[0].mMax;
+	for (int i=1; i<threads; ++i)
+	{
+		*minVal = std::min(*minVal, chunks[i].mMin);
+		*maxVal = std::max(*maxVal, chunks[i].mMax);
+	}
+
+	const int maxBins = 65536;
+	double range = *maxVal - *minVal;
+	int bins = maxBins;
+	*binWidth = range/maxBins;
+	if (std::numeric_limits<T>::is_integer && range < maxBins)
+	{
+		bins = int(range) + 1;
+		*binWidth = 1;
+	}
+	else if (range <= 0)
+	{
+		bins = 1;
+		*binWidth = 1;
+	}
+
+	for (int i=0; i<threads; ++i)
+		futures.push_back(QtConcurrent::run(boost::bind(&histogramChunk<T>, data, limits[i], limits[i+1], components,
+														 *minVal, *binWidth, bins, &chunks[i])));
+	waitForAll(futures);
+
+	histogram->clear();
+	for (int i=0; i<threads; ++i)
+		addHistogram(histogram, chunks[i].mHistogram);
+}
+
+} // namespace
+
+ImageStatisticsPtr ImageStatistics::create(vtkImageDataPtr image)
+{
+	ImageStatisticsPtr retval(new ImageStatistics());
+	retval->mImage = image;
+	retval->compute();
+	return retval;
+}
+
+ImageStatistics::ImageStatistics() :
+	mMTime(0),
+	mMin(0),
+	mMax(0),
+	mRGBMax(0),
+	mBinWidth(1)
+{
+}
+
+bool ImageStatistics::isValidFor(vtkImageDataPtr image) const
+{
+	// the image mtime includes modification of the scalar array
+	return image && (image == mImage) && (image->GetMTime() == mMTime);
+}
+
+void ImageStatistics::compute()
+{
+	if (!mImage)
+		return;
+	mMTime = mImage->GetMTime();
+
+	vtkDataArray* scalars = mImage->GetPointData()->GetScalars();
+	vtkIdType voxels = mImage->GetNumberOfPoints();
+	if (!scalars || !voxels)
+		return;
+	int components = mImage->GetNumberOfScalarComponents();
+
+	switch (mImage->GetScalarType())
+	{
+	vtkTemplateMacro(computeStatistics(static_cast<VTK_TT*>(mImage->GetScalarPointer()), voxels, components,
+									   &mMin, &mMax, &mRGBMax, &mBinWidth, &mHistogram));
+	}
+
+	if (components < 3)
+		mRGBMax = 0;
+}
+
+int ImageStatistics::getBin(double value) const
+{
+	return int((value - mMin)/mBinWidth);
+}
+
+qint64 ImageStatistics::getCount(double value) const
+{
+	if (value < mMin || value > mMax || mHistogram.empty())
+		return 0;
+	int bin = std::min(this->getBin(value), int(mHistogram.size())-1);
+	return mHistogram[bin];
+}
+
+double ImageStatistics::getPercentile(double fraction, bool ignoreZero) const
+{
+	if (mHistogram.empty())
+		return mMin;
+
+	qint64 total = 0;
+	for (unsigned i=0; i<mHistogram.size(); ++i)
+		total += mHistogram[i];
+	if (ignoreZero)
+		total -= this->getCount(0);
+
+	int zeroBin = -1;
+	if (ignoreZero && mMin <= 0 && 0 <= mMax)
+		zeroBin = std::min(this->getBin(0), int(mHistogram.size())-1);
+	double target = std::min(std::max(fraction, 0.0), 1.0) * total;
+	qint64 accumulated = 0;
+	for (unsigned i=0; i<mHistogram.size(); ++i)
+	{
+		if (int(i) != zeroBin)
+			accumulated += mHistogram[i];
+		if ((accumulated > 0) && (accumulated >= target))
+			return std::min(mMin + i*mBinWidth, mMax);
+	}
+	return mMax;
+}
+
+} // namespace cx
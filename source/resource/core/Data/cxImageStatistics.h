@@ -0,0 +1,103 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXIMAGESTATISTICS_H
+#define CXIMAGESTATISTICS_H
+
+#include "cxResourceExport.h"
+#include "cxPrecompiledHeader.h"
+
+#include <vector>
+#include <QtGlobal>
+#include <boost/shared_ptr.hpp>
+#include "vtkForwardDeclarations.h"
+
+namespace cx
+{
+typedef boost::shared_ptr<class ImageStatistics> ImageStatisticsPtr;
+
+/** Scalar statistics for a vtkImageData.
+ *
+ * Range, histogram and RGB max are computed together in one pass
+ * over the voxels, split among several threads. The statistics are
+ * valid as long as the image is unmodified, see isValidFor().
+ *
+ * Only the first component is used for range and histogram, as
+ * vtkImageData::GetScalarRange().
+ *
+ * \ingroup cx_resource_core_data
+ * \date 2026-10-18
+ */
+class cxResource_EXPORT ImageStatistics
+{
+public:
+	static ImageStatisticsPtr create(vtkImageDataPtr image);
+
+	bool isValidFor(vtkImageDataPtr image) const; ///< true if computed from image in its current state
+
+	double getMin() const { return mMin; }
+	double getMax() const { return mMax; }
+	/** Highest mean of the first three components in any voxel,
+	  * or 0 if less than three components.
+	  */
+	double getRGBMax() const { return mRGBMax; }
+
+	/** Histogram of the first component. Bin i contains values in
+	  * [origin+i*width, origin+(i+1)*width). Integer images with less
+	  * than 2^16 distinct values get one bin per value.
+	  */
+	const std::vector<qint64>& getHistogram() const { return mHistogram; }
+	double getHistogramOrigin() const { return mMin; }
+	double getHistogramBinWidth() const { return mBinWidth; }
+	qint64 getCount(double value) const; ///< number of voxels in the histogram bin containing value
+	/** Return the lowest value v where at least fraction of the voxels are <= v.
+	  * Zero voxels are not counted if ignoreZero is set.
+	  */
+	double getPercentile(double fraction, bool ignoreZero = false) const;
+
+private:
+	ImageStatistics();
+	void compute();
+	int getBin(double value) const;
+
+	vtkImageDataPtr mImage;
+	unsigned long mMTime;
+	double mMin;
+	double mMax;
+	double mRGBMax;
+	double mBinWidth;
+	std::vector<qint64> mHistogram;
+};
+
+} // namespace cx
+
+#endif // CXIMAGESTATISTICS_H
@@ -0,0 +1,223 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "cxPointKDTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cx
+{
+
+namespace
+{
+/** Order point indices along one axis, used for partitioning the tree.
+ *  Ties are broken on index in order to get a deterministic tree.
+ */
+class AxisLess
+{
+public:
+	AxisLess(const Eigen::MatrixXd& positions, int axis) : mPositions(positions), mAxis(axis) {}
+	bool operator()(int a, int b) const
+	{
+		double va = mPositions(mAxis, a);
+		double vb = mPositions(mAxis, b);
+		if (va != vb)
+			return va < vb;
+		return a < b;
+	}
+private:
+	const Eigen::MatrixXd& mPositions;
+	int mAxis;
+};
+} // namespace
+
+PointKDTree::PointKDTree()
+{
+}
+
+PointKDTree::PointKDTree(const Eigen::MatrixXd& positions) :
+	mPositions(positions)
+{
+	int N = mPositions.cols();
+	mTree.resize(N);
+	for (int i=0; i<N; ++i)
+		mTree[i] = i;
+	mActiveInSubtree.assign(N, 0);
+	mActive.assign(N, true);
+
+	this->build(0, N, 0);
+
+	mTreePosition.resize(N);
+	for (int i=0; i<N; ++i)
+		mTreePosition[mTree[i]] = i;
+}
+
+void PointKDTree::build(int begin, int end, int depth)
+{
+	if (begin >= end)
+		return;
+	int mid = (begin+end)/2;
+	std::nth_element(mTree.begin()+begin, mTree.begin()+mid, mTree.begin()+end, AxisLess(mPositions, depth%3));
+	mActiveInSubtree[mid] = end-begin;
+	this->build(begin, mid, depth+1);
+	this->build(mid+1, end, depth+1);
+}
+
+unsigned PointKDTree::size() const
+{
+	if (mTree.empty())
+		return 0;
+	return mActiveInSubtree[mTree.size()/2];
+}
+
+bool PointKDTree::empty() const
+{
+	return this->size()==0;
+}
+
+unsigned PointKDTree::getNumberOfPoints() const
+{
+	return mTree.size();
+}
+
+Vector3D PointKDTree::getPoint(int index) const
+{
+	return mPositions.col(index);
+}
+
+bool PointKDTree::contains(int index) const
+{
+	if (index < 0 || index >= int(mActive.size()))
+		return false;
+	return mActive[index];
+}
+
+void PointKDTree::remove(int index)
+{
+	if (!this->contains(index))
+		return;
+	mActive[index] = false;
+
+	// walk from the root down to the point, updating the counts on the way
+	int target = mTreePosition[index];
+	int begin = 0;
+	int end = mTree.size();
+	while (begin < end)
+	{
+		int mid = (begin+end)/2;
+		--mActiveInSubtree[mid];
+		if (target == mid)
+			break;
+		if (target < mid)
+			end = mid;
+		else
+			begin = mid+1;
+	}
+}
+
+std::pair<int, double> PointKDTree::findNearest(const Vector3D& p) const
+{
+	int best = -1;
+	double bestDist2 = std::numeric_limits<double>::max();
+	this->findNearest(p, 0, mTree.size(), 0, &best, &bestDist2);
+	if (best < 0)
+		return std::make_pair(-1, std::numeric_limits<double>::max());
+	return std::make_pair(best, sqrt(bestDist2));
+}
+
+void PointKDTree::findNearest(const Vector3D& p, int begin, int end, int depth, int* best, double* bestDist2) const
+{
+	if (begin >= end)
+		return;
+	int mid = (begin+end)/2;
+	if (mActiveInSubtree[mid]==0)
+		return;
+
+	int index = mTree[mid];
+	if (mActive[index])
+	{
+		double dist2 = (mPositions.col(index) - p).squaredNorm();
+		if ((dist2 < *bestDist2) || (dist2 == *bestDist2 && index < *best))
+		{
+			*bestDist2 = dist2;
+			*best = index;
+		}
+	}
+
+	int axis = depth%3;
+	double diff = p[axis] - mPositions(axis, index);
+
+	// search the side containing p first, then the other side if it might contain a closer point.
+	if (diff < 0)
+	{
+		this->findNearest(p, begin, mid, depth+1, best, bestDist2);
+		if (diff*diff <= *bestDist2)
+			this->findNearest(p, mid+1, end, depth+1, best, bestDist2);
+	}
+	else
+	{
+		this->findNearest(p, mid+1, end, depth+1, best, bestDist2);
+		if (diff*diff <= *bestDist2)
+			this->findNearest(p, begin, mid, depth+1, best, bestDist2);
+	}
+}
+
+std::vector<int> PointKDTree::findWithinRadius(const Vector3D& p, double radius) const
+{
+	std::vector<int> retval;
+	this->findWithinRadius(p, radius*radius, 0, mTree.size(), 0, &retval);
+	std::sort(retval.begin(), retval.end());
+	return retval;
+}
+
+void PointKDTree::findWithinRadius(const Vector3D& p, double radius2, int begin, int end, int depth, std::vector<int>* result) const
+{
+	if (begin >= end)
+		return;
+	int mid = (begin+end)/2;
+	if (mActiveInSubtree[mid]==0)
+		return;
+
+	int index = mTree[mid];
+	if (mActive[index] && (mPositions.col(index) - p).squaredNorm() <= radius2)
+		result->push_back(index);
+
+	int axis = depth%3;
+	double diff = p[axis] - mPositions(axis, index);
+	if (diff <= 0 || diff*diff <= radius2)
+		this->findWithinRadius(p, radius2, begin, mid, depth+1, result);
+	if (diff >= 0 || diff*diff <= radius2)
+		this->findWithinRadius(p, radius2, mid+1, end, depth+1, result);
+}
+
+} // namespace cx
@@ -0,0 +1,111 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#ifndef CXPOINTKDTREE_H_
+#define CXPOINTKDTREE_H_
+
+#include "cxResourceExport.h"
+#include "cxPrecompiledHeader.h"
+
+#include <vector>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+#include "cxVector3D.h"
+
+namespace cx
+{
+
+/**
+ * \addtogroup cx_resource_core_math
+ * @{
+ */
+
+/** \brief Spatial index for nearest neighbour search in a fixed point set.
+ *
+ * A balanced kd-tree built over the columns of a 3xN matrix. Points
+ * can be removed from the search, making the tree useful for algorithms
+ * that consume points one by one, such as tracing a centerline.
+ *
+ * The tree is stored implicitly: The subtree for the index range [b,e)
+ * has its root at (b+e)/2, thus no node pointers are needed.
+ *
+ * Search results are identical to a brute force search over the remaining
+ * points: Among points with equal distance, the one with the lowest
+ * index is returned.
+ *
+ * Build: O(N log N). Search and removal: O(log N) for well distributed points.
+ */
+class cxResource_EXPORT PointKDTree
+{
+public:
+	PointKDTree();
+	/** Build from the columns of a 3xN matrix.
+	  */
+	explicit PointKDTree(const Eigen::MatrixXd& positions);
+
+	unsigned size() const; ///< number of points remaining in the search
+	bool empty() const;
+	unsigned getNumberOfPoints() const; ///< number of points, including removed points
+	Vector3D getPoint(int index) const;
+	bool contains(int index) const; ///< true if index is still part of the search
+	/** Remove index from the search. Removed points are never returned from findNearest().
+	  */
+	void remove(int index);
+
+	/** Find the nearest remaining point to p.
+	  * Return the index of the point and the distance to p,
+	  * or index -1 if the tree is empty.
+	  */
+	std::pair<int, double> findNearest(const Vector3D& p) const;
+	/** Return the indices of all remaining points within radius of p, in increasing order.
+	  */
+	std::vector<int> findWithinRadius(const Vector3D& p, double radius) const;
+
+private:
+	void build(int begin, int end, int depth);
+	void findNearest(const Vector3D& p, int begin, int end, int depth, int* best, double* bestDist2) const;
+	void findWithinRadius(const Vector3D& p, double radius2, int begin, int end, int depth, std::vector<int>* result) const;
+
+	Eigen::MatrixXd mPositions;
+	std::vector<int> mTree; ///< point indices, ordered as an implicit kd-tree
+	std::vector<int> mTreePosition; ///< inverse of mTree: position in mTree for each point
+	std::vector<int> mActiveInSubtree; ///< number of remaining points in the subtree rooted at each tree position
+	std::vector<bool> mActive; ///< remaining state for each point
+};
+typedef boost::shared_ptr<PointKDTree> PointKDTreePtr;
+
+/**
+ * @}
+ */
+
+} // namespace cx
+
+#endif /* CXPOINTKDTREE_H_ */
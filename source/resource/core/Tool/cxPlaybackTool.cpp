@@ -59,18 +59,18 @@ void PlaybackTool::timeChangedSlot()
 	QDateTime time = mTime->getTime();
 	qint64 time_ms = time.toMSecsSinceEpoch();
 
-	TimedTransformMapPtr positions = mBase->getPositionHistory();
+	TimedTransformStorePtr positions = mBase->getPositionHistory();
 	if (positions->empty())
 		return;
 
 	// find last stored time before current time.
-	TimedTransformMap::iterator lastSample = positions->lower_bound(time_ms);
-	if (lastSample!=positions->begin())
+	unsigned lastSample = positions->lowerBound(time_ms);
+	if (lastSample!=0)
 		--lastSample;
 
 	// interpret as hidden if no samples has been received the last time:
 	qint64 timeout = 200;
-	bool visible = (lastSample!=positions->end()) && (fabs(time_ms - lastSample->first) < timeout);
+	bool visible = (lastSample < positions->getLoadedSize()) && (fabs(time_ms - positions->getTimestamp(lastSample)) < timeout);
 
 	// change visibility if applicable
 	if (mVisible!=visible)
@@ -82,8 +82,8 @@ void PlaybackTool::timeChangedSlot()
 	// emit new position if visible
 	if (this->getVisible())
 	{
-		m_rMpr = lastSample->second;
-		mTimestamp = lastSample->first;
+		m_rMpr = positions->getTransform(lastSample);
+		mTimestamp = positions->getTimestamp(lastSample);
 		emit toolTransformAndTimestamp(m_rMpr, mTimestamp);
 	}
 }
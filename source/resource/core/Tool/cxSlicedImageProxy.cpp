@@ -33,11 +33,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxSlicedImageProxy.h"
 
-#include <vtkImageReslice.h>
 #include <vtkImageMapToWindowLevelColors.h>
 #include <vtkWindowLevelLookupTable.h>
 #include <vtkImageData.h>
-#include <vtkMatrix4x4.h>
 #include <vtkImageAlgorithm.h>
 #include <vtkImageChangeInformation.h>
 #include <vtkImageExtractComponents.h>
@@ -141,18 +139,9 @@ vtkImageDataPtr ApplyLUTToImage2DProxy::getOutput()
 
 SlicedImageProxy::SlicedImageProxy()
 {
-	mMatrixAxes = vtkMatrix4x4Ptr::New();
-
-	mReslicer = vtkImageReslicePtr::New();
-	mReslicer->SetInterpolationModeToLinear();
-	mReslicer->SetOutputDimensionality(2);
-	mReslicer->SetResliceAxes(mMatrixAxes);
-	//mReslicer->SetAutoCropOutput(false); //faster update rate
-	mReslicer->AutoCropOutputOn(); // fix used in 2.0.9, but slower update rate
-
-	mImageWithLUTProxy.reset(new ApplyLUTToImage2DProxy());
-
-	mRedirecter = vtkImageChangeInformationPtr::New();
+	mEngine.reset(new SoftwareSlicer());
+	mRedirecter = vtkImageChangeInformationPtr::New(); // used for forwarding only.
+	mRedirecter->SetInputData(mEngine->getOutput());
 }
 
 SlicedImageProxy::~SlicedImageProxy()
@@ -161,12 +150,8 @@ SlicedImageProxy::~SlicedImageProxy()
 
 void SlicedImageProxy::setOutputFormat(Vector3D origin, Eigen::Array3i dim, Vector3D spacing)
 {
-	mReslicer->SetOutputOrigin(origin.data());
-	mReslicer->SetOutputExtent(0, dim[0], 0, dim[1], 0, 0);
-	// this looks like the correct way, but gives incorrect output (the way it is used)
-	// TODO investigate
-//	mReslicer->SetOutputExtent(0, dim[0]-1, 0, dim[1]-1, 0, 0);
-	mReslicer->SetOutputSpacing(spacing.data());
+	mEngine->setOutputFormat(origin, dim, spacing);
+	this->update();
 }
 
 void SlicedImageProxy::setSliceProxy(SliceProxyInterfacePtr slicer)
@@ -185,15 +170,8 @@ void SlicedImageProxy::setSliceProxy(SliceProxyInterfacePtr slicer)
 
 void SlicedImageProxy::transferFunctionsChangedSlot()
 {
-	mReslicer->SetInputData(mImage->getBaseVtkImageData());
-	mReslicer->SetBackgroundLevel(mImage->getMin());
-	mImageWithLUTProxy->setInput(mRedirecter, mImage->getLookupTable2D()->getOutputLookupTable());
-}
-
-void SlicedImageProxy::updateRedirecterSlot()
-{
-	mRedirecter->SetInputConnection(mReslicer->GetOutputPort());
-	update();
+	mEngine->setInput(mImage->getBaseVtkImageData(), mImage->getLookupTable2D()->getOutputLookupTable(), mImage->getMin());
+	this->update();
 }
 
 void SlicedImageProxy::setImage(ImagePtr image)
@@ -202,7 +180,7 @@ void SlicedImageProxy::setImage(ImagePtr image)
 	{
 		disconnect(mImage.get(), SIGNAL(transferFunctionsChanged()), this, SLOT(transferFunctionsChangedSlot()));
 		disconnect(mImage.get(), SIGNAL(transformChanged()), this, SLOT(transformChangedSlot()));
-		disconnect(mImage.get(), SIGNAL(vtkImageDataChanged()), this, SLOT(updateRedirecterSlot()));
+		disconnect(mImage.get(), SIGNAL(vtkImageDataChanged()), this, SLOT(transferFunctionsChangedSlot()));
 	}
 
 	mImage = image;
@@ -211,20 +189,18 @@ void SlicedImageProxy::setImage(ImagePtr image)
 	{
 		connect(mImage.get(), SIGNAL(transferFunctionsChanged()), this, SLOT(transferFunctionsChangedSlot()));
 		connect(mImage.get(), SIGNAL(transformChanged()), this, SLOT(transformChangedSlot()));
-		connect(mImage.get(), SIGNAL(vtkImageDataChanged()), this, SLOT(updateRedirecterSlot()));
+		connect(mImage.get(), SIGNAL(vtkImageDataChanged()), this, SLOT(transferFunctionsChangedSlot()));
 	}
 
 	if (mImage)
 	{
-		this->updateRedirecterSlot();
 		this->transferFunctionsChangedSlot();
 	}
 	else // no image
 	{
-		mImageWithLUTProxy->setInput(vtkImageAlgorithmPtr(), vtkLookupTablePtr());
+		mEngine->setInput(vtkImageDataPtr(), vtkLookupTablePtr(), 0);
+		this->update();
 	}
-
-	this->update();
 }
 
 ImagePtr SlicedImageProxy::getImage() const
@@ -233,37 +209,31 @@ ImagePtr SlicedImageProxy::getImage() const
 }
 
 vtkImageDataPtr SlicedImageProxy::getOutput()
-{
-	return mImageWithLUTProxy->getOutput();
-}
-
-vtkImageAlgorithmPtr SlicedImageProxy::getOutputPort()
-{
-	return mImageWithLUTProxy->getOutputPort();
-}
-
-vtkImageDataPtr SlicedImageProxy::getOutputWithoutLUT()
 {
 	return mRedirecter->GetOutput();
 }
 
-vtkImageAlgorithmPtr SlicedImageProxy::getOutputPortWithoutLUT()
+vtkImageAlgorithmPtr SlicedImageProxy::getOutputPort()
 {
 	return mRedirecter;
 }
 
 void SlicedImageProxy::update()
 {
-	if (!mImage)
-		return;
-
-	Transform3D rMs = Transform3D::Identity();
-	if (mSlicer)
-		rMs = mSlicer->get_sMr().inv();
-	Transform3D iMr = mImage->get_rMd().inv();
-	Transform3D M = iMr * rMs;
+	if (mImage)
+	{
+		Transform3D rMs = Transform3D::Identity();
+		if (mSlicer)
+			rMs = mSlicer->get_sMr().inv();
+		Transform3D iMr = mImage->get_rMd().inv();
+		Transform3D M = iMr * rMs;
+		mEngine->set_dMs(M);
+	}
 
-	mMatrixAxes->DeepCopy(M.getVtkMatrix());
+	vtkImageDataPtr output = mEngine->update();
+	if (mRedirecter->GetInput() != output.GetPointer())
+		mRedirecter->SetInputData(output);
+	mRedirecter->Update();
 }
 
 void SlicedImageProxy::transformChangedSlot()
@@ -280,12 +250,7 @@ void SlicedImageProxy::printSelf(std::ostream & os, Indent indent)
 	{
 		mSlicer->printSelf(os, indent.stepDown());
 	}
-	os << indent << "mReslicer->GetOutput(): " << mReslicer->GetOutput() << std::endl;
-	os << indent << "mReslicer->GetInput() : " << mReslicer->GetInput() << std::endl;
-	Transform3D test(mReslicer->GetResliceAxes());
-	os << indent << "resliceaxes: " << std::endl;
-	test.put(os, indent.getIndent() + 3);
-	os << std::endl;
+	os << indent << "output: " << mEngine->getOutput() << std::endl;
 	//os << indent << "rMs_debug: " << std::endl;
 	//rMs_debug.put(os, indent.getIndent()+3);
 
@@ -39,6 +39,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QObject>
 #include "cxIndent.h"
 #include "cxTransform3D.h"
+#include "cxSoftwareSlicer.h"
 #include "vtkForwardDeclarations.h"
 
 namespace cx
@@ -85,7 +86,8 @@ private:
 /**\brief Helper class for slicing an image given a SliceProxy and an image.
  *
  * The image is sliced in software using the slice definition from
- * the SliceProxy
+ * the SliceProxy, and the 2D lut is applied in the same pass,
+ * see SoftwareSlicer.
  *
  * Used internally by BlendedSliceRep and SlicerRepSW as the slice engine.
  * 
@@ -107,24 +109,17 @@ public:
 	void update();
 	vtkImageDataPtr getOutput(); ///< output 2D sliced image
 	vtkImageAlgorithmPtr getOutputPort(); ///< output 2D sliced image
-	vtkImageDataPtr getOutputWithoutLUT();
-	vtkImageAlgorithmPtr getOutputPortWithoutLUT();
 	void printSelf(std::ostream & os, Indent indent);
 
 private slots:
 	void transformChangedSlot();
 	void transferFunctionsChangedSlot();
-	void updateRedirecterSlot();
 
 private: 
-	ApplyLUTToImage2DProxyPtr mImageWithLUTProxy;
-
 	SliceProxyInterfacePtr mSlicer;
 	ImagePtr mImage;
 
-	vtkImageReslicePtr mReslicer;
-	vtkMatrix4x4Ptr mMatrixAxes;
-
+	SoftwareSlicerPtr mEngine;
 	vtkImageChangeInformationPtr mRedirecter;
 };
 
@@ -0,0 +1,377 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxSoftwareSlicer.h"
+
+#include <math.h>
+#include <limits>
+#include <algorithm>
+#include <QThread>
+#include <QtConcurrentRun>
+#include <boost/bind.hpp>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkLookupTable.h>
+
+namespace cx
+{
+
+namespace
+{
+
+const int tileSize = 64; ///< output is processed in tiles of tileSize^2 pixels, keeping the input samples in cache
+const int maxAutomaticDim = 4096;
+
+/** Everything needed to compute a slice, shared by all threads.
+ */
+struct SliceJob
+{
+	const void* mInput;
+	int mScalarType;
+	int mInDim[3];
+	int mComponents;
+	double mStart[3]; ///< voxel index of output pixel (0,0)
+	double mDx[3]; ///< voxel index step per output pixel along x
+	double mDy[3]; ///< voxel index step per output pixel along y
+
+	unsigned char* mOutput;
+	int mOutDim[2];
+
+	const unsigned char* mTable;
+	int mTableSize;
+	double mTableMin;
+	double mTableScale;
+	unsigned char mBackground[4];
+};
+
+/** Map value through the table, same as vtkLookupTable with linear scale.
+  */
+inline const unsigned char* lookup(const SliceJob& job, double value)
+{
+	double index = (value - job.mTableMin)*job.mTableScale;
+	int i = 0;
+	if (index >= job.mTableSize-1)
+		i = job.mTableSize-1;
+	else if (index > 0)
+		i = int(index);
+	return job.mTable + 4*i;
+}
+
+/** Luminance of a color, same as vtkImageMapToColors.
+  */
+inline unsigned char luminance(const unsigned char* rgba)
+{
+	return (unsigned char)(rgba[0]*0.30 + rgba[1]*0.59 + rgba[2]*0.11 + 0.5);
+}
+
+inline void mapColor(const SliceJob& job, const double* value, unsigned char* out)
+{
+	if (job.mComponents == 3)
+	{
+		out[0] = luminance(lookup(job, value[0]));
+		out[1] = luminance(lookup(job, value[1]));
+		const unsigned char* blue = lookup(job, value[2]);
+		out[2] = luminance(blue);
+		out[3] = blue[3];
+	}
+	else
+	{
+		const unsigned char* rgba = lookup(job, value[0]);
+		out[0] = rgba[0];
+		out[1] = rgba[1];
+		out[2] = rgba[2];
+		out[3] = rgba[3];
+	}
+}
+
+template<class T>
+inline double interpolate(const T* v, const vtkIdType* step, const double* f)
+{
+	double c00 = v[0]               + f[0]*(double(v[step[0]])                 - double(v[0]));
+	double c10 = v[step[1]]         + f[0]*(double(v[step[1]+step[0]])         - double(v[step[1]]));
+	double c01 = v[step[2]]         + f[0]*(double(v[step[2]+step[0]])         - double(v[step[2]]));
+	double c11 = v[step[2]+step[1]] + f[0]*(double(v[step[2]+step[1]+step[0]]) - double(v[step[2]+step[1]]));
+	double c0 = c00 + f[1]*(c10-c00);
+	double c1 = c01 + f[1]*(c11-c01);
+	return c0 + f[2]*(c1-c0);
+}
+
+template<class T>
+void sliceTile(const SliceJob& job, const T* input, int x0, int x1, int y0, int y1)
+{
+	const int* dim = job.mInDim;
+	int nc = job.mComponents;
+	int used = (nc == 3) ? 3 : 1;
+	vtkIdType stride[3] = { nc, vtkIdType(dim[0])*nc, vtkIdType(dim[0])*dim[1]*nc };
+	// step to the next neighbour, zero along axes with a single voxel
+	vtkIdType step[3];
+	double maxIndex[3];
+	for (int a=0; a<3; ++a)
+	{
+		step[a] = (dim[a] > 1) ? stride[a] : 0;
+		maxIndex[a] = dim[a]-1;
+	}
+	const double border = 0.5; // extend the volume by half a voxel, as vtkImageReslice
+
+	for (int y=y0; y<y1; ++y)
+	{
+		double p[3];
+		for (int a=0; a<3; ++a)
+			p[a] = job.mStart[a] + y*job.mDy[a] + x0*job.mDx[a];
+		unsigned char* out = job.mOutput + 4*(vtkIdType(y)*job.mOutDim[0] + x0);
+
+		for (int x=x0; x<x1; ++x, out+=4, p[0]+=job.mDx[0], p[1]+=job.mDx[1], p[2]+=job.mDx[2])
+		{
+			if ((p[0] < -border) || (p[0] > maxIndex[0]+border) ||
+				(p[1] < -border) || (p[1] > maxIndex[1]+border) ||
+				(p[2] < -border) || (p[2] > maxIndex[2]+border))
+			{
+				out[0] = job.mBackground[0];
+				out[1] = job.mBackground[1];
+				out[2] = job.mBackground[2];
+				out[3] = job.mBackground[3];
+				continue;
+			}
+
+			const T* v = input;
+			double f[3];
+			for (int a=0; a<3; ++a)
+			{
+				double c = std::min(std::max(p[a], 0.0), maxIndex[a]);
+				int i = std::min(int(c), std::max(dim[a]-2, 0));
+				f[a] = c - i;
+				v += i*stride[a];
+			}
+
+			double value[3];
+			for (int c=0; c<used; ++c)
+				value[c] = interpolate(v+c, step, f);
+			mapColor(job, value, out);
+		}
+	}
+}
+
+void sliceTiles(SliceJob job, int first, int increment)
+{
+	int tilesX = (job.mOutDim[0]+tileSize-1)/tileSize;
+	int tilesY = (job.mOutDim[1]+tileSize-1)/tileSize;
+	for (int t=first; t<tilesX*tilesY; t+=increment)
+	{
+		int x0 = (t%tilesX)*tileSize;
+		int y0 = (t/tilesX)*tileSize;
+		int x1 = std::min(x0+tileSize, job.mOutDim[0]);
+		int y1 = std::min(y0+tileSize, job.mOutDim[1]);
+		switch (job.mScalarType)
+		{
+		vtkTemplateMacro(sliceTile(job, static_cast<const VTK_TT*>(job.mInput), x0, x1, y0, y1));
+		}
+	}
+}
+
+} // namespace
+
+SoftwareSlicer::SoftwareSlicer() :
+	mBackground(0),
+	m_dMs(Transform3D::Identity()),
+	mAutomaticOutputFormat(true),
+	mOrigin(0, 0, 0),
+	mDim(1, 1, 1),
+	mSpacing(1, 1, 1),
+	mTableMTime(0),
+	mTableMin(0),
+	mTableScale(1)
+{
+}
+
+void SoftwareSlicer::setInput(vtkImageDataPtr image, vtkLookupTablePtr lut, double background)
+{
+	mInput = image;
+	mLut = lut;
+	mBackground = background;
+	mTableMTime = 0;
+}
+
+void SoftwareSlicer::set_dMs(Transform3D dMs)
+{
+	m_dMs = dMs;
+}
+
+void SoftwareSlicer::setOutputFormat(Vector3D origin, Eigen::Array3i dim, Vector3D spacing)
+{
+	mAutomaticOutputFormat = false;
+	mOrigin = origin;
+	mDim = dim;
+	mSpacing = spacing;
+}
+
+/** Cover the input bounds projected onto the slice plane. The spacing
+  * is found as in vtkImageReslice: the input spacing weighted by the
+  * squared direction cosines.
+  */
+void SoftwareSlicer::computeAutomaticOutputFormat()
+{
+	int* extent = mInput->GetExtent();
+	double* origin = mInput->GetOrigin();
+	double* spacing = mInput->GetSpacing();
+
+	Transform3D sMd = m_dMs.inv();
+	Vector3D bbmin = Vector3D::Constant(std::numeric_limits<double>::max());
+	Vector3D bbmax = Vector3D::Constant(-std::numeric_limits<double>::max());
+	for (int i=0; i<8; ++i)
+	{
+		Vector3D corner_d;
+		for (int a=0; a<3; ++a)
+			corner_d[a] = origin[a] + spacing[a]*extent[2*a + ((i>>a)&1)];
+		Vector3D corner_s = sMd.coord(corner_d);
+		bbmin = bbmin.cwiseMin(corner_s);
+		bbmax = bbmax.cwiseMax(corner_s);
+	}
+
+	mOrigin = Vector3D(bbmin[0], bbmin[1], 0);
+	mDim = Eigen::Array3i(1, 1, 1);
+	mSpacing = Vector3D(1, 1, 1);
+	for (int i=0; i<2; ++i)
+	{
+		double s = 0;
+		for (int j=0; j<3; ++j)
+			s += spacing[j]*m_dMs(j,i)*m_dMs(j,i);
+		double length = bbmax[i]-bbmin[i];
+		if (length/s + 1 > maxAutomaticDim)
+			s = length/(maxAutomaticDim-1);
+		mSpacing[i] = s;
+		mDim[i] = int(floor(length/s + 0.5)) + 1;
+	}
+}
+
+void SoftwareSlicer::updateOutputImage(Eigen::Array3i dim)
+{
+	if (!mOutput)
+		mOutput = vtkImageDataPtr::New();
+
+	int* current = mOutput->GetDimensions();
+	bool formatChanged = (current[0] != dim[0]) || (current[1] != dim[1]) || (current[2] != 1);
+	mOutput->SetOrigin(mOrigin.data());
+	mOutput->SetSpacing(mSpacing[0], mSpacing[1], 1);
+	if (formatChanged || !mOutput->GetPointData()->GetScalars())
+	{
+		mOutput->SetExtent(0, dim[0]-1, 0, dim[1]-1, 0, 0);
+		mOutput->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+	}
+}
+
+void SoftwareSlicer::updateTable()
+{
+	if (mTableMTime == mLut->GetMTime())
+		return;
+	mTableMTime = mLut->GetMTime();
+
+	int count = std::max<int>(mLut->GetNumberOfTableValues(), 1);
+	const unsigned char* table = mLut->GetPointer(0);
+	mTable.assign(table, table + 4*count);
+
+	double* range = mLut->GetRange();
+	mTableMin = range[0];
+	mTableScale = (range[1] > range[0]) ? count/(range[1]-range[0]) : VTK_DOUBLE_MAX;
+}
+
+vtkImageDataPtr SoftwareSlicer::update()
+{
+	if (!mInput || !mLut)
+	{
+		this->updateOutputImage(Eigen::Array3i(1, 1, 1));
+		std::fill_n(static_cast<unsigned char*>(mOutput->GetScalarPointer()), 4, 0);
+		mOutput->Modified();
+		return mOutput;
+	}
+
+	if (mAutomaticOutputFormat)
+		this->computeAutomaticOutputFormat();
+	this->updateOutputImage(mDim);
+	this->updateTable();
+
+	SliceJob job;
+	job.mInput = mInput->GetScalarPointer();
+	job.mScalarType = mInput->GetScalarType();
+	mInput->GetDimensions(job.mInDim);
+	job.mComponents = mInput->GetNumberOfScalarComponents();
+	job.mOutput = static_cast<unsigned char*>(mOutput->GetScalarPointer());
+	job.mOutDim[0] = mDim[0];
+	job.mOutDim[1] = mDim[1];
+	job.mTable = &mTable[0];
+	job.mTableSize = int(mTable.size()/4);
+	job.mTableMin = mTableMin;
+	job.mTableScale = mTableScale;
+	double background[3] = { mBackground, mBackground, mBackground };
+	mapColor(job, background, job.mBackground);
+
+	// positions in voxel index space
+	int* extent = mInput->GetExtent();
+	double* inOrigin = mInput->GetOrigin();
+	double* inSpacing = mInput->GetSpacing();
+	Vector3D start = m_dMs.coord(mOrigin);
+	Vector3D dx = m_dMs.vector(Vector3D(mSpacing[0], 0, 0));
+	Vector3D dy = m_dMs.vector(Vector3D(0, mSpacing[1], 0));
+	for (int a=0; a<3; ++a)
+	{
+		job.mStart[a] = (start[a] - inOrigin[a])/inSpacing[a] - extent[2*a];
+		job.mDx[a] = dx[a]/inSpacing[a];
+		job.mDy[a] = dy[a]/inSpacing[a];
+	}
+
+	int tiles = ((mDim[0]+tileSize-1)/tileSize) * ((mDim[1]+tileSize-1)/tileSize);
+	int threads = std::min(QThread::idealThreadCount(), tiles);
+	if (threads <= 1)
+	{
+		sliceTiles(job, 0, 1);
+	}
+	else
+	{
+		std::vector<QFuture<void> > futures;
+		for (int i=1; i<threads; ++i)
+			futures.push_back(QtConcurrent::run(boost::bind(&sliceTiles, job, i, threads)));
+		sliceTiles(job, 0, threads);
+		for (unsigned i=0; i<futures.size(); ++i)
+			futures[i].waitForFinished();
+	}
+
+	mOutput->Modified();
+	return mOutput;
+}
+
+vtkImageDataPtr SoftwareSlicer::getOutput()
+{
+	if (!mOutput)
+		this->update();
+	return mOutput;
+}
+
+} // namespace cx
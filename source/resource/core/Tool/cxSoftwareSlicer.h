@@ -0,0 +1,105 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXSOFTWARESLICER_H
+#define CXSOFTWARESLICER_H
+
+#include "cxResourceExport.h"
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "cxTransform3D.h"
+#include "vtkForwardDeclarations.h"
+
+namespace cx
+{
+typedef boost::shared_ptr<class SoftwareSlicer> SoftwareSlicerPtr;
+
+/** \brief Slice a volume along an oblique plane in software.
+ *
+ * Computes the 2D slice z=0 in slice space s, using trilinear
+ * interpolation, and maps it through a vtkLookupTable to RGBA
+ * in the same pass. This replaces a vtkImageReslice followed
+ * by vtkImageMapToColors.
+ *
+ * Color input is mapped per component, and the alpha is taken
+ * from the last component, as in ApplyLUTToImage2DProxy.
+ *
+ * The output is processed in tiles, split among several threads.
+ * The output image is reused between updates as long as the
+ * output format is unchanged.
+ *
+ * \ingroup cx_resource_core_tool
+ * \date 2026-10-18
+ */
+class cxResource_EXPORT SoftwareSlicer
+{
+public:
+	SoftwareSlicer();
+	/** Set the volume to slice. Samples outside the volume get
+	  * the background value before being mapped through the lut.
+	  */
+	void setInput(vtkImageDataPtr image, vtkLookupTablePtr lut, double background);
+	void set_dMs(Transform3D dMs); ///< transform from slice space to image data space
+	/** Set a fixed output grid in slice space. If not set, the output
+	  * covers the projection of the volume onto the slice plane.
+	  */
+	void setOutputFormat(Vector3D origin, Eigen::Array3i dim, Vector3D spacing);
+	vtkImageDataPtr update(); ///< compute the slice, return the output.
+	vtkImageDataPtr getOutput(); ///< RGBA slice in slice space
+
+private:
+	void computeAutomaticOutputFormat();
+	void updateOutputImage(Eigen::Array3i dim);
+	void updateTable();
+
+	vtkImageDataPtr mInput;
+	vtkLookupTablePtr mLut;
+	double mBackground;
+	Transform3D m_dMs;
+
+	bool mAutomaticOutputFormat;
+	Vector3D mOrigin;
+	Eigen::Array3i mDim;
+	Vector3D mSpacing;
+
+	unsigned long mTableMTime;
+	std::vector<unsigned char> mTable; ///< RGBA copy of the lut
+	double mTableMin;
+	double mTableScale; ///< table index = (value-min)*scale
+
+	vtkImageDataPtr mOutput;
+};
+
+} // namespace cx
+
+#endif // CXSOFTWARESLICER_H
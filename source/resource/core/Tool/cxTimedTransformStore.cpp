@@ -0,0 +1,448 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "cxTimedTransformStore.h"
+
+#include <limits>
+#include <algorithm>
+#include "cxLogger.h"
+
+namespace cx
+{
+
+namespace
+{
+bool isRigidTransform(const Transform3D& transform)
+{
+	const Eigen::Matrix4d& m = transform.matrix();
+	if ((m(3,0)!=0) || (m(3,1)!=0) || (m(3,2)!=0) || (m(3,3)!=1))
+		return false;
+	Eigen::Matrix3d R = transform.linear();
+	Eigen::Matrix3d deviation = R.transpose()*R - Eigen::Matrix3d::Identity();
+	return (deviation.cwiseAbs().maxCoeff() < 1.0E-6) && (R.determinant() > 0);
+}
+} // namespace
+
+TimedTransformRange::TimedTransformRange(const TimedTransformStore* store, unsigned begin, unsigned end) :
+	mStore(store),
+	mBegin(begin),
+	mEnd(end)
+{
+}
+
+double TimedTransformRange::getTimestamp(unsigned i) const
+{
+	return mStore->getTimestamp(mBegin+i);
+}
+
+Transform3D TimedTransformRange::getTransform(unsigned i) const
+{
+	return mStore->getTransform(mBegin+i);
+}
+
+TimedTransformMap TimedTransformRange::toMap() const
+{
+	TimedTransformMap retval;
+	for (unsigned i=0; i<this->size(); ++i)
+		retval.insert(retval.end(), std::make_pair(this->getTimestamp(i), this->getTransform(i)));
+	return retval;
+}
+
+///--------------------------------------------------------
+///--------------------------------------------------------
+///--------------------------------------------------------
+
+TimedTransformStore::TimedTransformStore() :
+	mChunkIndexModified(false),
+	mFileBlocksStopTime(-std::numeric_limits<double>::max())
+{
+}
+
+void TimedTransformStore::set(double timestamp, const Transform3D& transform)
+{
+	this->loadFileBlocks(timestamp, timestamp);
+	this->setSample(timestamp, transform);
+}
+
+void TimedTransformStore::setSample(double timestamp, const Transform3D& transform)
+{
+	// fast path: tracking positions arrive in time order.
+	if (mTimestamps.empty() || (timestamp > mTimestamps.back()))
+	{
+		this->insert(mTimestamps.size(), timestamp, transform);
+		return;
+	}
+
+	unsigned index = this->searchChunkIndex(timestamp, false);
+	if ((index < mTimestamps.size()) && (mTimestamps[index]==timestamp))
+	{
+		mPoses[index] = this->toPose(timestamp, transform);
+		return;
+	}
+	this->insert(index, timestamp, transform);
+}
+
+void TimedTransformStore::insert(unsigned index, double timestamp, const Transform3D& transform)
+{
+	Pose pose = this->toPose(timestamp, transform);
+
+	if (index==mTimestamps.size())
+	{
+		mTimestamps.push_back(timestamp);
+		mPoses.push_back(pose);
+		if (!mChunkIndexModified && (index % mChunkSize == 0))
+			mChunkIndex.push_back(timestamp);
+	}
+	else
+	{
+		mTimestamps.insert(mTimestamps.begin()+index, timestamp);
+		mPoses.insert(mPoses.begin()+index, pose);
+		mChunkIndexModified = true;
+	}
+}
+
+/** Insert samples read from file.
+  */
+void TimedTransformStore::insert(const std::vector<double>& timestamps, const std::vector<Transform3D>& transforms)
+{
+	if (timestamps.empty())
+		return;
+
+	// Blocks are normally sorted and do not overlap the samples in memory: insert in one go.
+	bool sorted = true;
+	for (unsigned i=1; i<timestamps.size(); ++i)
+		sorted = sorted && (timestamps[i-1] < timestamps[i]);
+
+	unsigned index = this->searchChunkIndex(timestamps.front(), false);
+	bool fits = (index==mTimestamps.size()) || (timestamps.back() < mTimestamps[index]);
+
+	if (sorted && fits)
+	{
+		std::vector<Pose> poses(timestamps.size());
+		for (unsigned i=0; i<timestamps.size(); ++i)
+			poses[i] = this->toPose(timestamps[i], transforms[i]);
+		mTimestamps.insert(mTimestamps.begin()+index, timestamps.begin(), timestamps.end());
+		mPoses.insert(mPoses.begin()+index, poses.begin(), poses.end());
+		mChunkIndexModified = true;
+		return;
+	}
+
+	for (unsigned i=0; i<timestamps.size(); ++i)
+		this->setSample(timestamps[i], transforms[i]);
+}
+
+/** Convert to a Pose. Transforms that are not rigid are stored in mNonRigid.
+  */
+TimedTransformStore::Pose TimedTransformStore::toPose(double timestamp, const Transform3D& transform)
+{
+	Pose retval;
+	for (unsigned i=0; i<3; ++i)
+		retval.mTranslation[i] = transform.translation()[i];
+
+	if (!isRigidTransform(transform))
+	{
+		mNonRigid[timestamp] = transform;
+		std::fill(retval.mRotation, retval.mRotation+4, std::numeric_limits<float>::quiet_NaN());
+		return retval;
+	}
+
+	if (!mNonRigid.empty())
+		mNonRigid.erase(timestamp);
+
+	Eigen::Quaterniond q(transform.linear());
+	retval.mRotation[0] = q.x();
+	retval.mRotation[1] = q.y();
+	retval.mRotation[2] = q.z();
+	retval.mRotation[3] = q.w();
+	return retval;
+}
+
+Transform3D TimedTransformStore::getTransform(unsigned index) const
+{
+	const Pose& pose = mPoses[index];
+	if (pose.mRotation[3] != pose.mRotation[3]) // NaN: not rigid
+		return mNonRigid.find(mTimestamps[index])->second;
+
+	Eigen::Quaterniond q(pose.mRotation[3], pose.mRotation[0], pose.mRotation[1], pose.mRotation[2]);
+	q.normalize();
+	Transform3D retval = Transform3D::Identity();
+	retval.linear() = q.toRotationMatrix();
+	retval.translation() = Eigen::Vector3d(pose.mTranslation[0], pose.mTranslation[1], pose.mTranslation[2]);
+	return retval;
+}
+
+void TimedTransformStore::updateChunkIndex()
+{
+	if (!mChunkIndexModified)
+		return;
+
+	mChunkIndex.clear();
+	mChunkIndex.reserve(mTimestamps.size()/mChunkSize + 1);
+	for (unsigned i=0; i<mTimestamps.size(); i+=mChunkSize)
+		mChunkIndex.push_back(mTimestamps[i]);
+	mChunkIndexModified = false;
+}
+
+/** Find the lower or upper bound of timestamp in the loaded samples:
+  * First find the chunk in the sparse chunk index, then search inside the chunk.
+  */
+unsigned TimedTransformStore::searchChunkIndex(double timestamp, bool upper)
+{
+	this->updateChunkIndex();
+
+	std::vector<double>::iterator chunk = upper
+			? std::upper_bound(mChunkIndex.begin(), mChunkIndex.end(), timestamp)
+			: std::lower_bound(mChunkIndex.begin(), mChunkIndex.end(), timestamp);
+	if (chunk==mChunkIndex.begin())
+		return 0;
+
+	// the bound is inside the previous chunk, or the first element of this chunk.
+	unsigned first = (chunk - mChunkIndex.begin() - 1) * mChunkSize;
+	unsigned last = std::min<unsigned>(first + mChunkSize, mTimestamps.size());
+	std::deque<double>::iterator iter = upper
+			? std::upper_bound(mTimestamps.begin()+first, mTimestamps.begin()+last, timestamp)
+			: std::lower_bound(mTimestamps.begin()+first, mTimestamps.begin()+last, timestamp);
+	return iter - mTimestamps.begin();
+}
+
+void TimedTransformStore::addFileBlock(QString filename, const PositionStorageBlock& block)
+{
+	if (block.mCount==0)
+		return;
+	if (!mAddedFileBlocks.insert(std::make_pair(filename, block.mOffset)).second)
+		return;
+
+	std::vector<FileBlock>::iterator iter = mFileBlocks.begin();
+	while ((iter!=mFileBlocks.end()) && (iter->mBlock.mStartTime <= block.mStartTime))
+		++iter;
+
+	FileBlock fileBlock;
+	fileBlock.mFilename = filename;
+	fileBlock.mBlock = block;
+	mFileBlocks.insert(iter, fileBlock);
+	mFileBlocksStopTime = std::max(mFileBlocksStopTime, block.mStopTime);
+}
+
+bool TimedTransformStore::empty() const
+{
+	return mTimestamps.empty() && mFileBlocks.empty();
+}
+
+unsigned TimedTransformStore::size()
+{
+	return this->getAll().size();
+}
+
+double TimedTransformStore::getFirstTimestamp() const
+{
+	double retval = std::numeric_limits<double>::max();
+	if (!mTimestamps.empty())
+		retval = mTimestamps.front();
+	if (!mFileBlocks.empty())
+		retval = std::min(retval, mFileBlocks.front().mBlock.mStartTime);
+	return this->empty() ? 0 : retval;
+}
+
+double TimedTransformStore::getLastTimestamp() const
+{
+	double retval = mFileBlocksStopTime;
+	if (!mTimestamps.empty())
+		retval = std::max(retval, mTimestamps.back());
+	return this->empty() ? 0 : retval;
+}
+
+bool TimedTransformStore::find(double timestamp, Transform3D* transform)
+{
+	this->loadFileBlocks(timestamp, timestamp);
+	unsigned index = this->searchChunkIndex(timestamp, false);
+	if ((index >= mTimestamps.size()) || (mTimestamps[index]!=timestamp))
+		return false;
+	*transform = this->getTransform(index);
+	return true;
+}
+
+unsigned TimedTransformStore::lowerBound(double timestamp)
+{
+	this->loadFileBlocksAround(timestamp);
+	return this->searchChunkIndex(timestamp, false);
+}
+
+unsigned TimedTransformStore::upperBound(double timestamp)
+{
+	this->loadFileBlocksAround(timestamp);
+	return this->searchChunkIndex(timestamp, true);
+}
+
+TimedTransformRange TimedTransformStore::getRange(double startTime, double stopTime)
+{
+	this->loadFileBlocks(startTime, stopTime);
+	unsigned begin = this->searchChunkIndex(startTime, false);
+	unsigned end = this->searchChunkIndex(stopTime, true);
+	return TimedTransformRange(this, begin, std::max(begin, end));
+}
+
+TimedTransformRange TimedTransformStore::getLast(unsigned count)
+{
+	if (count==0)
+		return TimedTransformRange(this, mTimestamps.size(), mTimestamps.size());
+
+	// load file blocks until none of them can contain any of the last count samples.
+	while (!mFileBlocks.empty())
+	{
+		double first = -std::numeric_limits<double>::max();
+		if (mTimestamps.size() >= count)
+			first = mTimestamps[mTimestamps.size()-count];
+		if (mFileBlocksStopTime < first)
+			break;
+		this->loadFileBlocks(first, std::numeric_limits<double>::max());
+	}
+
+	unsigned size = mTimestamps.size();
+	return TimedTransformRange(this, size - std::min(count, size), size);
+}
+
+TimedTransformRange TimedTransformStore::getAll()
+{
+	this->loadFileBlocks(-std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+	return TimedTransformRange(this, 0, mTimestamps.size());
+}
+
+std::vector<std::pair<double, double> > TimedTransformStore::getTimeSpans(double maxGap) const
+{
+	typedef std::pair<double, double> Span;
+	std::vector<Span> spans;
+	for (unsigned i=0; i<mTimestamps.size(); ++i)
+	{
+		double current = mTimestamps[i];
+		if (spans.empty() || (current - spans.back().second > maxGap))
+			spans.push_back(Span(current, current));
+		else
+			spans.back().second = current;
+	}
+	for (unsigned i=0; i<mFileBlocks.size(); ++i)
+		spans.push_back(Span(mFileBlocks[i].mBlock.mStartTime, mFileBlocks[i].mBlock.mStopTime));
+	std::sort(spans.begin(), spans.end());
+
+	std::vector<Span> retval;
+	for (unsigned i=0; i<spans.size(); ++i)
+	{
+		if (retval.empty() || (spans[i].first - retval.back().second > maxGap))
+			retval.push_back(spans[i]);
+		else
+			retval.back().second = std::max(retval.back().second, spans[i].second);
+	}
+	return retval;
+}
+
+/** Load all file blocks overlapping the time range.
+  */
+void TimedTransformStore::loadFileBlocks(double startTime, double stopTime)
+{
+	if (mFileBlocks.empty() || (startTime > mFileBlocksStopTime))
+		return;
+
+	std::vector<FileBlock> load;
+	std::vector<FileBlock> remaining;
+	for (unsigned i=0; i<mFileBlocks.size(); ++i)
+	{
+		if (mFileBlocks[i].mBlock.overlaps(startTime, stopTime))
+			load.push_back(mFileBlocks[i]);
+		else
+			remaining.push_back(mFileBlocks[i]);
+	}
+
+	if (load.empty())
+		return;
+	mFileBlocks.swap(remaining);
+	this->loadFileBlocks(load);
+}
+
+/** Load the file blocks needed to find the samples before and after timestamp:
+  * The blocks overlapping timestamp, the last block before and the first block after.
+  */
+void TimedTransformStore::loadFileBlocksAround(double timestamp)
+{
+	if (mFileBlocks.empty())
+		return;
+
+	int before = -1;
+	int after = -1;
+	std::vector<FileBlock> load;
+	std::vector<FileBlock> remaining;
+	for (unsigned i=0; i<mFileBlocks.size(); ++i)
+	{
+		const PositionStorageBlock& block = mFileBlocks[i].mBlock;
+		if (block.overlaps(timestamp, timestamp))
+			load.push_back(mFileBlocks[i]);
+		else if (block.mStopTime < timestamp)
+		{
+			if ((before<0) || (block.mStopTime > mFileBlocks[before].mBlock.mStopTime))
+				before = i;
+		}
+		else if (after<0) // sorted by start time
+			after = i;
+	}
+
+	for (unsigned i=0; i<mFileBlocks.size(); ++i)
+	{
+		if ((int(i)==before) || (int(i)==after))
+			load.push_back(mFileBlocks[i]);
+		else if (!mFileBlocks[i].mBlock.overlaps(timestamp, timestamp))
+			remaining.push_back(mFileBlocks[i]);
+	}
+
+	if (load.empty())
+		return;
+	mFileBlocks.swap(remaining);
+	this->loadFileBlocks(load);
+}
+
+void TimedTransformStore::loadFileBlocks(const std::vector<FileBlock>& blocks)
+{
+	for (unsigned i=0; i<blocks.size(); ++i)
+	{
+		std::vector<double> timestamps;
+		std::vector<Transform3D> transforms;
+		timestamps.reserve(blocks[i].mBlock.mCount);
+		transforms.reserve(blocks[i].mBlock.mCount);
+
+		PositionStorageReader reader(blocks[i].mFilename);
+		if (!reader.read(blocks[i].mBlock, &timestamps, &transforms))
+			CX_LOG_WARNING() << QString("Failed to read positions for %1 from %2").arg(blocks[i].mBlock.mToolUid).arg(blocks[i].mFilename);
+		this->insert(timestamps, transforms);
+	}
+
+	mFileBlocksStopTime = -std::numeric_limits<double>::max();
+	for (unsigned i=0; i<mFileBlocks.size(); ++i)
+		mFileBlocksStopTime = std::max(mFileBlocksStopTime, mFileBlocks[i].mBlock.mStopTime);
+}
+
+} // namespace cx
@@ -0,0 +1,171 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#ifndef CXTIMEDTRANSFORMSTORE_H
+#define CXTIMEDTRANSFORMSTORE_H
+
+#include "cxResourceExport.h"
+
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "cxTransform3D.h"
+#include "cxPositionStorageFile.h"
+
+namespace cx
+{
+typedef std::map<double, Transform3D> TimedTransformMap;
+class TimedTransformStore;
+
+/** A range of samples in a TimedTransformStore.
+ *
+ * Valid until the store is modified.
+ *
+ * \ingroup cx_resource_core_tool
+ */
+class cxResource_EXPORT TimedTransformRange
+{
+public:
+	TimedTransformRange(const TimedTransformStore* store, unsigned begin, unsigned end);
+	unsigned size() const { return mEnd - mBegin; }
+	bool empty() const { return mBegin==mEnd; }
+	double getTimestamp(unsigned i) const; ///< timestamp of sample i in the range
+	Transform3D getTransform(unsigned i) const; ///< transform of sample i in the range
+	unsigned getBegin() const { return mBegin; } ///< index of the first sample in the store
+	unsigned getEnd() const { return mEnd; } ///< index past the last sample in the store
+	TimedTransformMap toMap() const;
+
+private:
+	const TimedTransformStore* mStore;
+	unsigned mBegin;
+	unsigned mEnd;
+};
+
+/** \brief Time-sorted history of tool positions.
+ *
+ * Timestamps and poses are stored in separate columns. A pose is a rotation
+ * quaternion (float) and a translation (double), i.e. 48 bytes per sample
+ * including the timestamp, compared to more than 170 bytes for each node in a
+ * std::map<double, Transform3D>. The rare transforms that are not rigid are
+ * stored unchanged in a separate map. Samples are normally appended, as
+ * tracking positions arrive in time order, but inserting at any time is
+ * supported.
+ *
+ * Lookup by time is a binary search in a sparse index holding the first
+ * timestamp of each chunk of samples, followed by a search inside the chunk.
+ *
+ * Positions saved to the position file can be added as blocks, see
+ * PositionStorageIndex. A block is read from file the first time a query
+ * touches its time range, thus loading only the time windows in use.
+ *
+ * Indices into the store are valid until it is modified, either by set() or
+ * by a query that loads file blocks.
+ *
+ * Not thread-safe.
+ *
+ * \ingroup cx_resource_core_tool
+ */
+class cxResource_EXPORT TimedTransformStore
+{
+public:
+	TimedTransformStore();
+
+	/** Add a sample, replacing any sample with the same timestamp.
+	  */
+	void set(double timestamp, const Transform3D& transform);
+	/** Add the positions in a block of the position file.
+	  * They are read when needed. Blocks already added are ignored.
+	  */
+	void addFileBlock(QString filename, const PositionStorageBlock& block);
+
+	bool empty() const; ///< true if there are no samples, loaded or in file
+	unsigned size(); ///< number of samples, loads all file blocks
+	double getFirstTimestamp() const; ///< first timestamp, loaded or in file
+	double getLastTimestamp() const; ///< last timestamp, loaded or in file
+
+	bool find(double timestamp, Transform3D* transform); ///< get sample at timestamp, return false if missing
+	unsigned lowerBound(double timestamp); ///< index of first sample not before timestamp
+	unsigned upperBound(double timestamp); ///< index of first sample after timestamp
+	TimedTransformRange getRange(double startTime, double stopTime); ///< samples in [startTime, stopTime]
+	TimedTransformRange getLast(unsigned count); ///< the last count samples, or all if fewer.
+	TimedTransformRange getAll(); ///< all samples, loads all file blocks
+	/** Return the time spans covered by samples, split where the time between
+	  * two samples exceeds maxGap. File blocks are not loaded, each is taken
+	  * to cover its whole time range.
+	  */
+	std::vector<std::pair<double, double> > getTimeSpans(double maxGap) const;
+
+	double getTimestamp(unsigned index) const { return mTimestamps[index]; }
+	Transform3D getTransform(unsigned index) const;
+	unsigned getLoadedSize() const { return mTimestamps.size(); } ///< number of samples currently in memory
+
+private:
+	/** Compact representation of a rigid transform.
+	  * mRotation is a quaternion (x,y,z,w). If not rigid, mRotation[3] is NaN.
+	  */
+	struct Pose
+	{
+		float mRotation[4];
+		double mTranslation[3];
+	};
+	struct FileBlock
+	{
+		QString mFilename;
+		PositionStorageBlock mBlock;
+	};
+
+	Pose toPose(double timestamp, const Transform3D& transform);
+	unsigned searchChunkIndex(double timestamp, bool upper);
+	void updateChunkIndex();
+	void setSample(double timestamp, const Transform3D& transform);
+	void insert(unsigned index, double timestamp, const Transform3D& transform);
+	void insert(const std::vector<double>& timestamps, const std::vector<Transform3D>& transforms);
+	void loadFileBlocks(double startTime, double stopTime);
+	void loadFileBlocksAround(double timestamp);
+	void loadFileBlocks(const std::vector<FileBlock>& blocks);
+
+	std::deque<double> mTimestamps;
+	std::deque<Pose> mPoses;
+	std::map<double, Transform3D> mNonRigid; ///< transforms that cannot be represented by a Pose
+	std::vector<double> mChunkIndex; ///< timestamp of the first sample in each chunk
+	bool mChunkIndexModified; ///< mChunkIndex must be rebuilt
+	std::vector<FileBlock> mFileBlocks; ///< unloaded blocks, sorted by start time
+	double mFileBlocksStopTime; ///< last stop time in mFileBlocks
+	std::set<std::pair<QString, qint64> > mAddedFileBlocks; ///< filename and offset of all added blocks
+	static const unsigned mChunkSize = 256;
+};
+typedef boost::shared_ptr<TimedTransformStore> TimedTransformStorePtr;
+
+} // namespace cx
+
+#endif // CXTIMEDTRANSFORMSTORE_H
@@ -54,7 +54,7 @@ namespace cx
 typedef boost::shared_ptr<class Tool> ToolPtr;
 typedef std::map<QString, ToolPtr> ToolMap;
 typedef std::map<double, Transform3D> TimedTransformMap;
-typedef boost::shared_ptr<TimedTransformMap> TimedTransformMapPtr;
+typedef boost::shared_ptr<class TimedTransformStore> TimedTransformStorePtr;
 typedef boost::shared_ptr<class TrackingPositionFilter> TrackingPositionFilterPtr;
 
 /**
@@ -121,7 +121,7 @@ public:
 		return this->getTypes().count(type);
 	}
 	virtual vtkPolyDataPtr getGraphicsPolyData() const = 0; ///< get geometric 3D description
-	virtual TimedTransformMapPtr getPositionHistory() = 0; ///< get historical positions
+	virtual TimedTransformStorePtr getPositionHistory() = 0; ///< get historical positions
 
 	virtual bool getVisible() const = 0; ///< \return the visibility status of the tool
 	virtual bool isInitialized() const	{ return true; }
@@ -39,7 +39,7 @@ namespace cx
 
 ToolImpl::ToolImpl(const QString& uid, const QString& name) :
 	Tool(uid, name),
-	mPositionHistory(new TimedTransformMap()),
+	mPositionHistory(new TimedTransformStore()),
 	m_prMt(Transform3D::Identity()),
 	mTooltipOffset(0)
 {
@@ -75,18 +75,14 @@ void ToolImpl::setTooltipOffset(double val)
 	emit tooltipOffset(mTooltipOffset);
 }
 
-TimedTransformMapPtr ToolImpl::getPositionHistory()
+TimedTransformStorePtr ToolImpl::getPositionHistory()
 {
 	return mPositionHistory;
 }
 
 TimedTransformMap ToolImpl::getSessionHistory(double startTime, double stopTime)
 {
-	TimedTransformMap::iterator startIt = mPositionHistory->lower_bound(startTime);
-	TimedTransformMap::iterator stopIt = mPositionHistory->upper_bound(stopTime);
-
-	TimedTransformMap retval(startIt, stopIt);
-	return retval;
+	return mPositionHistory->getRange(startTime, stopTime).toMap();
 }
 
 Transform3D ToolImpl::get_prMt() const
@@ -96,16 +92,14 @@ Transform3D ToolImpl::get_prMt() const
 
 void ToolImpl::set_prMt(const Transform3D& prMt, double timestamp)
 {
-	if (mPositionHistory->count(timestamp))
-	{
-		if (similar(mPositionHistory->find(timestamp)->second, prMt))
-			return;
-	}
+	Transform3D previous;
+	if (mPositionHistory->find(timestamp, &previous) && similar(previous, prMt))
+		return;
 
 	m_prMt = prMt;
 	// Store positions in history, but only if visible - the history has no concept of visibility
 	if (this->getVisible())
-		(*mPositionHistory)[timestamp] = m_prMt;
+		mPositionHistory->set(timestamp, m_prMt);
 	emit toolTransformAndTimestamp(m_prMt, timestamp);
 }
 
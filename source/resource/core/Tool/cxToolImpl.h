@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxResourceExport.h"
 
 #include "cxTool.h"
+#include "cxTimedTransformStore.h"
 
 namespace cx
 {
@@ -54,7 +55,7 @@ public:
 	explicit ToolImpl(const QString& uid="", const QString& name ="");
 	virtual ~ToolImpl();
 
-	virtual TimedTransformMapPtr getPositionHistory();
+	virtual TimedTransformStorePtr getPositionHistory();
 	virtual TimedTransformMap getSessionHistory(double startTime, double stopTime);
 	virtual Transform3D get_prMt() const;
 
@@ -72,7 +73,7 @@ public:
 
 protected:
 	virtual void set_prMt(const Transform3D& prMt, double timestamp);
-	TimedTransformMapPtr mPositionHistory;
+	TimedTransformStorePtr mPositionHistory;
 	Transform3D m_prMt; ///< the transform from the tool to the patient reference
 	TrackingPositionFilterPtr mTrackingPositionFilter;
 	std::map<double, ToolPositionMetadata> mMetadata;
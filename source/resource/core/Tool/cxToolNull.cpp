@@ -13,9 +13,9 @@ vtkPolyDataPtr ToolNull::getGraphicsPolyData() const
 	return vtkPolyDataPtr();
 }
 
-TimedTransformMapPtr ToolNull::getPositionHistory()
+TimedTransformStorePtr ToolNull::getPositionHistory()
 {
-	return TimedTransformMapPtr();
+	return TimedTransformStorePtr();
 }
 
 ToolPositionMetadata ToolNull::getMetadata() const
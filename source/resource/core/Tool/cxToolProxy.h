@@ -55,7 +55,7 @@ public:
 
 	virtual std::set<Type> getTypes() const;
 	virtual vtkPolyDataPtr getGraphicsPolyData() const;
-	virtual TimedTransformMapPtr getPositionHistory();
+	virtual TimedTransformStorePtr getPositionHistory();
 	virtual ToolPositionMetadata getMetadata() const;
 	virtual const std::map<double, ToolPositionMetadata>& getMetadataHistory();
 
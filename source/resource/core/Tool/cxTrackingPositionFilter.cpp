@@ -39,103 +39,91 @@ TrackingPositionFilter::TrackingPositionFilter()
 {
 	mCutOffFrequency = 3;
 	mResampleFrequency = 100;
+	this->reset();
+}
 
-	fx.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);  // Lag perker isteden
-	fx.reset ();
-	fy.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);
-	fy.reset ();
-	fz.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);
-	fz.reset ();
+void TrackingPositionFilter::reset()
+{
+	mHasPosition = false;
+	mLastPosition = Transform3D::Identity();
+	mLastTimestamp = 0;
+	mLastResampledTimestamp = 0;
+	mLastFiltered = Transform3D::Identity();
+	mNumberOfFiltered = 0;
+
+	for (int i=0; i<3; ++i)
+	{
+		mFilters[i].setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);  // Lag perker isteden
+		mFilters[i].reset ();
+	}
 }
 
 void TrackingPositionFilter::addPosition(Transform3D pos, double timestamp)
 {
-
 	this->clearIfTimestampIsOlderThanHead(pos, timestamp);
 	this->clearIfJumpInTimestamps(pos, timestamp);
 
-	if (mResampled.empty()){
-		mResampled[timestamp] = pos;
-		mHistory[timestamp] = pos;
-		return;
+	if (!mHasPosition){
+		mLastResampledTimestamp = timestamp;
+	}
+	else
+	{
+		this->interpolateAndFilterPositions(pos, timestamp);
 	}
 
-	this->interpolateAndFilterPositions(pos, timestamp);
-	mHistory[timestamp] = pos;
+	mHasPosition = true;
+	mLastPosition = pos;
+	mLastTimestamp = timestamp;
 }
 
 Transform3D TrackingPositionFilter::getFilteredPosition()
 {
-	if (mFiltered.size() > mResampleFrequency) //check if mFiltered contains enough positions for the filter to be stable
-		return mFiltered.rbegin()->second;
-	else if (!mHistory.empty())
-		return mHistory.rbegin()->second;
+	if (mNumberOfFiltered > mResampleFrequency) //check if enough positions have been filtered for the filter to be stable
+		return mLastFiltered;
+	else if (mHasPosition)
+		return mLastPosition;
 	else
 		return Transform3D::Identity();
 }
 
 void TrackingPositionFilter::clearIfTimestampIsOlderThanHead(Transform3D pos, double timestamp)
 {
-	if (mResampled.empty())
+	if (!mHasPosition)
 		return;
 
-	if (timestamp < mResampled.rbegin()->first){ // clear history if old timestamps appear
-		mHistory.clear();
-		mResampled.clear();
-		mFiltered.clear();
-
-		fx.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);  // Lag perker isteden
-		fx.reset ();
-		fy.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);
-		fy.reset ();
-		fz.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);
-		fz.reset ();
-	}
-
+	if (timestamp < mLastResampledTimestamp) // clear history if old timestamps appear
+		this->reset();
 }
 
 void TrackingPositionFilter::clearIfJumpInTimestamps(Transform3D pos, double timestamp)
 {
-	if (mResampled.empty())
+	if (!mHasPosition)
 		return;
 
-	double timeStep = timestamp - mResampled.rbegin()->first;
-	if ( timeStep > 1000){ // clear history of resampled and filtered data if jump in timestamps of more than 1 second
-		mHistory.clear();
-		mResampled.clear();
-		mFiltered.clear();
-
-		fx.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);  // Lag perker isteden
-		fx.reset ();
-		fy.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);
-		fy.reset ();
-		fz.setup (mFilterOrder, mResampleFrequency, mCutOffFrequency);
-		fz.reset ();
-	}
+	double timeStep = timestamp - mLastResampledTimestamp;
+	if ( timeStep > 1000) // clear history of resampled and filtered data if jump in timestamps of more than 1 second
+		this->reset();
 }
 
 void TrackingPositionFilter::interpolateAndFilterPositions(Transform3D pos, double timestamp)
 {
-	Transform3D previousPositionMatrix = mHistory.rbegin()->second;
-	double deltaT = timestamp - mHistory.rbegin()->first; //time from previous measured position to this position
-	int numberOfInterpolationPoints = floor( (timestamp - mResampled.rbegin()->first)/1000 * mResampleFrequency ); // interpolate from last resampled position to current measured position
-	Transform3D interpolatedPosition;
-	Transform3D filteredPosition;
+	double deltaT = timestamp - mLastTimestamp; //time from previous measured position to this position
+	int numberOfInterpolationPoints = floor( (timestamp - mLastResampledTimestamp)/1000 * mResampleFrequency ); // interpolate from last resampled position to current measured position
 	for (int i=0; i < numberOfInterpolationPoints; i++)
 	{
-		double resampledTimestamp = mResampled.rbegin()->first + 1000/mResampleFrequency;
-		double deltaTpast = resampledTimestamp - mHistory.rbegin()->first;
+		double resampledTimestamp = mLastResampledTimestamp + 1000/mResampleFrequency;
+		double deltaTpast = resampledTimestamp - mLastTimestamp;
 		double deltaTfuture = timestamp - resampledTimestamp;
-		interpolatedPosition = pos.matrix() * deltaTpast/deltaT + previousPositionMatrix.matrix() * deltaTfuture/deltaT; // linear interpolation between previous and current measured position
-		mResampled[resampledTimestamp] = interpolatedPosition;
-
-		filteredPosition = interpolatedPosition;
-		filteredPosition(0,3) = fx.filter(interpolatedPosition(0,3));
-		filteredPosition(1,3) = fy.filter(interpolatedPosition(1,3));
-		filteredPosition(2,3) = fz.filter(interpolatedPosition(2,3));
-		mFiltered[resampledTimestamp] = filteredPosition;
+		Transform3D interpolatedPosition;
+		interpolatedPosition = pos.matrix() * deltaTpast/deltaT + mLastPosition.matrix() * deltaTfuture/deltaT; // linear interpolation between previous and current measured position
+		mLastResampledTimestamp = resampledTimestamp;
+
+		mLastFiltered = interpolatedPosition;
+		for (int j=0; j<3; ++j)
+			mLastFiltered(j,3) = mFilters[j].filter(interpolatedPosition(j,3));
+		if (mNumberOfFiltered <= mResampleFrequency)
+			++mNumberOfFiltered;
 	}
-
 }
 
 } // namespace cx
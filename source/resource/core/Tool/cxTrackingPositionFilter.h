@@ -35,7 +35,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxResourceExport.h"
 
 #include "cxTransform3D.h"
-#include <map>
 #include <boost/shared_ptr.hpp>
 #include "iir/Butterworth.h"
 
@@ -44,6 +43,15 @@ namespace cx
 
 /** Applies a smoothing filter to tracking positions.
  *
+ * The positions are resampled to a fixed rate using linear interpolation,
+ * then the translation is filtered using a low pass Butterworth filter.
+ *
+ * The IIR filter keeps its own state, thus only the last measured and the last
+ * filtered position are stored. Memory use is constant and addPosition()
+ * does not allocate, regardless of how long the tool has been tracking.
+ *
+ * The filter is reset if a timestamp is older than the previous one, or
+ * if there is a jump of more than one second.
  *
  * \ingroup cx_resource_core_tool
  * \date 2014-03-06
@@ -57,18 +65,22 @@ public:
 	Transform3D getFilteredPosition();
 
 private:
-	std::map<double, Transform3D> mHistory;
-	std::map<double, Transform3D> mResampled;
-	std::map<double, Transform3D> mFiltered;
+	void reset();
 	void clearIfTimestampIsOlderThanHead(Transform3D pos, double timestamp);
 	void clearIfJumpInTimestamps(Transform3D pos, double timestamp);
 	void interpolateAndFilterPositions(Transform3D pos, double timestamp);
+
+	bool mHasPosition; ///< true if mLastPosition is valid
+	Transform3D mLastPosition; ///< last measured position
+	double mLastTimestamp;
+	double mLastResampledTimestamp;
+	Transform3D mLastFiltered;
+	int mNumberOfFiltered; ///< number of filtered positions since reset, saturates when the filter is stable
+
 	float mCutOffFrequency;
 	float mResampleFrequency;
 	static const int mFilterOrder = 2;
-	Iir::Butterworth::LowPass<mFilterOrder> fx;
-	Iir::Butterworth::LowPass<mFilterOrder> fy;
-	Iir::Butterworth::LowPass<mFilterOrder> fz;
+	Iir::Butterworth::LowPass<mFilterOrder> mFilters[3]; ///< one for each translation component
 };
 typedef boost::shared_ptr<TrackingPositionFilter> TrackingPositionFilterPtr;
 
@@ -0,0 +1,320 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxSharedMemoryVideo.h"
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <QDomDocument>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkCommand.h>
+#include "cxImage.h"
+#include "cxProbeDefinition.h"
+#include "cxLogger.h"
+
+namespace cx
+{
+
+namespace
+{
+const qint32 SharedMemoryVideoMagic = 0x43580001;
+const int ProbeDefinitionReserve = 64*1024;
+
+int getDataOffset()
+{
+	// keep the pixels cache line aligned
+	return (sizeof(SharedMemoryVideoFrameHeader) + 63) & ~63;
+}
+
+/** Unlock a shared memory buffer when the vtkDataArray referring to it is deleted.
+ */
+class UnlockBufferOnDelete : public vtkCommand
+{
+public:
+	static UnlockBufferOnDelete* New()
+	{
+		return new UnlockBufferOnDelete;
+	}
+	virtual void Execute(vtkObject* caller, unsigned long, void*)
+	{
+		if (mReader)
+			mReader->unlockBuffer(mIndex);
+		mReader.reset();
+	}
+	SharedMemoryVideoReaderPtr mReader; ///< keep the memory attached as long as the array lives
+	int mIndex;
+};
+} // namespace
+
+///--------------------------------------------------------
+///--------------------------------------------------------
+///--------------------------------------------------------
+
+SharedMemoryVideoWriter::SharedMemoryVideoWriter(QString key, int buffers) :
+	mKey(key),
+	mBuffers(buffers),
+	mProbeVersion(0),
+	mDroppedFrames(0)
+{
+}
+
+SharedMemoryVideoWriter::~SharedMemoryVideoWriter()
+{
+}
+
+void SharedMemoryVideoWriter::setProbeDefinition(ProbeDefinitionPtr probe)
+{
+	if (!probe)
+		return;
+	QDomDocument doc;
+	QDomElement root = doc.createElement("probe");
+	doc.appendChild(root);
+	probe->addXml(root);
+	mProbe = doc.toByteArray();
+	++mProbeVersion;
+}
+
+bool SharedMemoryVideoWriter::createServer(qint64 dataSize)
+{
+	qint64 size = getDataOffset() + 2*dataSize + ProbeDefinitionReserve;
+	if (size > std::numeric_limits<int>::max()/mBuffers)
+	{
+		reportError(QString("Frame size %1 too large for shared memory video").arg(dataSize));
+		return false;
+	}
+	mServer.reset(new SharedMemoryServer(mKey, mBuffers, size));
+	return true;
+}
+
+bool SharedMemoryVideoWriter::write(ImagePtr image)
+{
+	vtkImageDataPtr data = image ? image->getBaseVtkImageData() : vtkImageDataPtr();
+	if (!data)
+		return false;
+
+	int dim[3];
+	data->GetDimensions(dim);
+	int components = data->GetNumberOfScalarComponents();
+	qint64 dataSize = qint64(dim[0])*dim[1]*dim[2]*components*data->GetScalarSize();
+
+	if (!mServer && !this->createServer(dataSize))
+		return false;
+
+	qint64 requiredSize = getDataOffset() + dataSize + mProbe.size();
+	if (requiredSize > mServer->size())
+	{
+		if (!mDroppedFrames)
+			reportWarning(QString("Frame size %1 exceeds shared memory buffer size %2, dropping frames").arg(requiredSize).arg(mServer->size()));
+		++mDroppedFrames;
+		return false;
+	}
+
+	char* buffer = static_cast<char*>(mServer->buffer());
+	if (!buffer)
+	{
+		++mDroppedFrames;
+		return false;
+	}
+
+	SharedMemoryVideoFrameHeader* header = reinterpret_cast<SharedMemoryVideoFrameHeader*>(buffer);
+	memset(header, 0, sizeof(SharedMemoryVideoFrameHeader));
+	header->mMagic = SharedMemoryVideoMagic;
+	header->mDataOffset = getDataOffset();
+	for (int i=0; i<3; ++i)
+	{
+		header->mDimensions[i] = dim[i];
+		header->mSpacing[i] = data->GetSpacing()[i];
+	}
+	header->mComponents = components;
+	header->mScalarType = data->GetScalarType();
+	header->mDataSize = dataSize;
+	header->mTimestamp = image->getAcquisitionTime().toMSecsSinceEpoch();
+	header->mProbeVersion = mProbeVersion;
+	header->mProbeSize = mProbe.size();
+	strncpy(header->mUid, image->getUid().toLatin1().constData(), sizeof(header->mUid)-1);
+
+	memcpy(buffer + header->mDataOffset, data->GetScalarPointer(), dataSize);
+	if (!mProbe.isEmpty())
+		memcpy(buffer + header->mDataOffset + dataSize, mProbe.constData(), mProbe.size());
+
+	mServer->release();
+	return true;
+}
+
+///--------------------------------------------------------
+///--------------------------------------------------------
+///--------------------------------------------------------
+
+SharedMemoryVideoReaderPtr SharedMemoryVideoReader::create(QString key)
+{
+	SharedMemoryVideoReaderPtr retval(new SharedMemoryVideoReader());
+	if (!retval->attach(key))
+		return SharedMemoryVideoReaderPtr();
+	return retval;
+}
+
+SharedMemoryVideoReader::SharedMemoryVideoReader() :
+	mLastSequence(0),
+	mProbeVersion(0)
+{
+}
+
+SharedMemoryVideoReader::~SharedMemoryVideoReader()
+{
+	// all images referring to the buffers are deleted at this point
+	mClient.detach();
+}
+
+bool SharedMemoryVideoReader::attach(QString key)
+{
+	if (!mClient.attach(key))
+		return false;
+	mLocks.assign(mClient.buffers(), 0);
+	return true;
+}
+
+ImagePtr SharedMemoryVideoReader::readLatest()
+{
+	qint64 sequence = 0;
+	int index = mClient.lockLatestBuffer(mLastSequence, &sequence, NULL);
+	if (index < 0)
+		return ImagePtr();
+	mLastSequence = sequence;
+
+	const SharedMemoryVideoFrameHeader* header = static_cast<const SharedMemoryVideoFrameHeader*>(mClient.getBuffer(index));
+	if (header->mMagic != SharedMemoryVideoMagic)
+	{
+		mClient.unlockBuffer(index);
+		return ImagePtr();
+	}
+
+	this->readProbeDefinition(header);
+
+	// leave one buffer for the writer to fill and one to switch to
+	bool copy = false;
+	{
+		QMutexLocker sentry(&mMutex);
+		int locked = mLocks.size() - std::count(mLocks.begin(), mLocks.end(), 0);
+		copy = (locked + 1 > int(mLocks.size()) - 2);
+		++mStatistics.mFrames;
+		if (copy)
+			++mStatistics.mCopiedFrames;
+	}
+
+	ImagePtr retval = this->createImage(index, header, copy);
+	if (copy || !retval)
+		mClient.unlockBuffer(index);
+	return retval;
+}
+
+ImagePtr SharedMemoryVideoReader::createImage(int index, const SharedMemoryVideoFrameHeader* header, bool copy)
+{
+	vtkSmartPointer<vtkDataArray> scalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(header->mScalarType));
+	if (!scalars)
+		return ImagePtr();
+	const int* dim = header->mDimensions;
+	vtkIdType numberOfTuples = vtkIdType(dim[0])*dim[1]*dim[2];
+	void* pixels = const_cast<char*>(reinterpret_cast<const char*>(header)) + header->mDataOffset;
+	scalars->SetNumberOfComponents(header->mComponents);
+
+	if (copy)
+	{
+		scalars->SetNumberOfTuples(numberOfTuples);
+		memcpy(scalars->GetVoidPointer(0), pixels, header->mDataSize);
+	}
+	else
+	{
+		scalars->SetVoidArray(pixels, numberOfTuples*header->mComponents, 1);
+		vtkSmartPointer<UnlockBufferOnDelete> command = vtkSmartPointer<UnlockBufferOnDelete>::New();
+		command->mReader = this->shared_from_this();
+		command->mIndex = index;
+		scalars->AddObserver(vtkCommand::DeleteEvent, command);
+		QMutexLocker sentry(&mMutex);
+		++mLocks[index];
+	}
+
+	vtkImageDataPtr imageData = vtkImageDataPtr::New();
+	imageData->SetExtent(0, dim[0]-1, 0, dim[1]-1, 0, dim[2]-1);
+	imageData->SetSpacing(header->mSpacing[0], header->mSpacing[1], header->mSpacing[2]);
+	imageData->GetPointData()->SetScalars(scalars);
+
+	QString uid = QString::fromLatin1(header->mUid, qstrnlen(header->mUid, sizeof(header->mUid)));
+	ImagePtr retval(new Image(uid, imageData));
+	retval->setAcquisitionTime(QDateTime::fromMSecsSinceEpoch(header->mTimestamp));
+	return retval;
+}
+
+void SharedMemoryVideoReader::readProbeDefinition(const SharedMemoryVideoFrameHeader* header)
+{
+	if (header->mProbeVersion == mProbeVersion || header->mProbeSize <= 0)
+		return;
+	mProbeVersion = header->mProbeVersion;
+
+	const char* xml = reinterpret_cast<const char*>(header) + header->mDataOffset + header->mDataSize;
+	QDomDocument doc;
+	if (!doc.setContent(QByteArray(xml, header->mProbeSize)))
+	{
+		reportWarning("Failed to parse probe definition from shared memory video");
+		return;
+	}
+	mChangedProbe.reset(new ProbeDefinition());
+	mChangedProbe->parseXml(doc.documentElement());
+}
+
+ProbeDefinitionPtr SharedMemoryVideoReader::takeChangedProbeDefinition()
+{
+	ProbeDefinitionPtr retval = mChangedProbe;
+	mChangedProbe.reset();
+	return retval;
+}
+
+void SharedMemoryVideoReader::unlockBuffer(int index)
+{
+	{
+		QMutexLocker sentry(&mMutex);
+		--mLocks[index];
+	}
+	mClient.unlockBuffer(index);
+}
+
+SharedMemoryVideoStatistics SharedMemoryVideoReader::getStatistics() const
+{
+	QMutexLocker sentry(&mMutex);
+	SharedMemoryVideoStatistics retval = mStatistics;
+	retval.mLockedBuffers = mLocks.size() - std::count(mLocks.begin(), mLocks.end(), 0);
+	return retval;
+}
+
+} // namespace cx
@@ -0,0 +1,169 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXSHAREDMEMORYVIDEO_H_
+#define CXSHAREDMEMORYVIDEO_H_
+
+#include "cxResourceExport.h"
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <QMutex>
+#include <QString>
+#include <QByteArray>
+#include "cxSharedMemory.h"
+#include "cxForwardDeclarations.h"
+
+namespace cx
+{
+
+/** Layout of the start of each buffer in a shared memory video stream.
+ *  The pixels follow at offset SharedMemoryVideoFrameHeader::mDataOffset,
+ *  the probe definition xml follows the pixels.
+ *
+ * \ingroup cx_resource_core_video
+ */
+struct SharedMemoryVideoFrameHeader
+{
+	qint32 mMagic; ///< identifies the layout version
+	qint32 mDataOffset; ///< pixels start here, relative to the start of the buffer
+	qint32 mDimensions[3];
+	qint32 mComponents;
+	qint32 mScalarType; ///< VTK scalar type
+	qint32 mProbeSize; ///< size of probe definition xml, 0 if none
+	qint64 mDataSize; ///< size of pixel data in bytes
+	qint64 mProbeVersion; ///< incremented each time the probe definition changes
+	double mSpacing[3];
+	double mTimestamp; ///< acquisition time, ms since epoch
+	char mUid[64]; ///< stream uid, zero terminated
+};
+
+/** Statistics for a SharedMemoryVideoReader.
+ */
+struct cxResource_EXPORT SharedMemoryVideoStatistics
+{
+	SharedMemoryVideoStatistics() : mFrames(0), mCopiedFrames(0), mLockedBuffers(0) {}
+	int mFrames; ///< frames read
+	int mCopiedFrames; ///< frames copied because too many buffers were locked
+	int mLockedBuffers; ///< buffers currently referenced by images
+};
+
+/** \brief Write a video stream into a shared memory ring of buffers.
+ *
+ * The ring is created on the first frame, with buffers large enough
+ * for twice the frame size. Frames larger than that are dropped.
+ * Each frame is copied once into the ring, and a waiting
+ * SharedMemoryVideoReader is woken up.
+ *
+ * \sa SharedMemoryVideoReader
+ * \ingroup cx_resource_core_video
+ */
+class cxResource_EXPORT SharedMemoryVideoWriter
+{
+public:
+	explicit SharedMemoryVideoWriter(QString key, int buffers = 8);
+	~SharedMemoryVideoWriter();
+
+	/** Write image and the current probe definition to the ring.
+	  * Return false if the frame was dropped.
+	  */
+	bool write(ImagePtr image);
+	void setProbeDefinition(ProbeDefinitionPtr probe);
+
+	QString getKey() const { return mKey; }
+	int getNumberOfDroppedFrames() const { return mDroppedFrames; }
+
+private:
+	bool createServer(qint64 dataSize);
+
+	QString mKey;
+	int mBuffers;
+	boost::shared_ptr<SharedMemoryServer> mServer;
+	QByteArray mProbe;
+	qint64 mProbeVersion;
+	int mDroppedFrames;
+};
+typedef boost::shared_ptr<SharedMemoryVideoWriter> SharedMemoryVideoWriterPtr;
+
+typedef boost::shared_ptr<class SharedMemoryVideoReader> SharedMemoryVideoReaderPtr;
+
+/** \brief Read a video stream written by a SharedMemoryVideoWriter.
+ *
+ * The images refer directly to the shared memory, the buffer is locked
+ * until the vtkImageData is deleted. The reader keeps at least two buffers
+ * free for the writer: If more are referenced, the frame is copied instead.
+ *
+ * The shared memory is kept attached as long as any image refers to it.
+ * Use from one thread only, images can be deleted from any thread.
+ *
+ * \sa SharedMemoryVideoWriter
+ * \ingroup cx_resource_core_video
+ */
+class cxResource_EXPORT SharedMemoryVideoReader : public boost::enable_shared_from_this<SharedMemoryVideoReader>
+{
+public:
+	/** Attach to the stream with the given key, return null on failure.
+	  */
+	static SharedMemoryVideoReaderPtr create(QString key);
+	~SharedMemoryVideoReader();
+
+	/** Return the latest frame if it is newer than the last returned frame, otherwise null.
+	  */
+	ImagePtr readLatest();
+	/** Return the probe definition if it changed in the last read frame, otherwise null.
+	  */
+	ProbeDefinitionPtr takeChangedProbeDefinition();
+
+	SharedMemoryClient* getClient() { return &mClient; } ///< use with SharedMemoryWaiterThread to wait for frames
+	SharedMemoryVideoStatistics getStatistics() const; ///< threadsafe
+	void unlockBuffer(int index); ///< internal, called when an image referring to the buffer is deleted.
+
+private:
+	SharedMemoryVideoReader();
+	bool attach(QString key);
+	ImagePtr createImage(int index, const SharedMemoryVideoFrameHeader* header, bool copy);
+	void readProbeDefinition(const SharedMemoryVideoFrameHeader* header);
+
+	SharedMemoryClient mClient;
+	qint64 mLastSequence; ///< sequence of last read frame
+	qint64 mProbeVersion;
+	ProbeDefinitionPtr mChangedProbe;
+
+	mutable QMutex mMutex; ///< protects the members below
+	std::vector<int> mLocks; ///< number of images referring to each buffer
+	SharedMemoryVideoStatistics mStatistics;
+};
+
+} // namespace cx
+
+#endif /* CXSHAREDMEMORYVIDEO_H_ */
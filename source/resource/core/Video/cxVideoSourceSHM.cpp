@@ -40,8 +40,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vtkImageImport.h>
 #include <vtkPNGReader.h>
 
-
-#include <qtimer.h>
+#include "cxSharedMemoryWaiterThread.h"
 
 namespace cx
 {
@@ -58,8 +57,8 @@ VideoSourceSHM::VideoSourceSHM(int width, int height, int depth)
 	mConnected = false;
 	mStreaming = false;
 
-	mPollTimer = new QTimer(this);
-	mPollTimer->setInterval(40);	// Polling interval (currently set @ 25 fps)
+	mWaiter = new SharedMemoryWaiterThread(&mSource, this);
+	connect(mWaiter, SIGNAL(newBuffer()), this, SLOT(newBufferSlot()), Qt::QueuedConnection);
 	mTimeStamp = 0;
 
 
@@ -114,7 +113,7 @@ void VideoSourceSHM::start()
 	mStartWhenConnected = false;
 	if (!mStreaming)
 	{
-		mPollTimer->start();
+		mWaiter->start();
 		// If all is well - tell the system we're streaming
 		mStreaming = true;
 
@@ -127,7 +126,7 @@ void VideoSourceSHM::stop()
 	mStartWhenConnected = false;
 	if (mStreaming)
 	{
-		mPollTimer->stop();
+		mWaiter->stop();
 		// If all is well - tell the system we've stopped streaming
 		mStreaming = false;
 
@@ -158,6 +157,7 @@ bool VideoSourceSHM::isStreaming() const
  */
 void VideoSourceSHM::update()
 {
+	mWaiter->bufferHandled();
 	unsigned char* buffer = (unsigned char*) mSource.isNew(); // Fetch new data from server - NULL if no new data present
 	if (!buffer)
 		return;
@@ -187,8 +187,7 @@ void VideoSourceSHM::connectServer(const QString& key)
 
 	if (mConnected)
 	{
-		connect(mPollTimer, SIGNAL(timeout()), this, SLOT(serverPollSlot()));
-		serverPollSlot(); // Pull in a new frame here, even if we may no be started yet to initialize the image import
+		this->update(); // Pull in a new frame here, even if we may no be started yet to initialize the image import
 	}
 	if (mStartWhenConnected)
 	{
@@ -206,7 +205,6 @@ void VideoSourceSHM::disconnectServer()
 
 	if (mConnected)
 	{
-		disconnect(mPollTimer, SIGNAL(timeout()), this, SLOT(serverPollSlot()));
 		mSource.release();
 	}
 
@@ -217,7 +215,7 @@ void VideoSourceSHM::disconnectServer()
 /**
  * Slot: calls update on this
  */
-void VideoSourceSHM::serverPollSlot()
+void VideoSourceSHM::newBufferSlot()
 {
 	this->update();
 }
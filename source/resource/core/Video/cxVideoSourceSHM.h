@@ -58,15 +58,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 typedef vtkSmartPointer<class vtkImageImport> vtkImageImportPtr;
 
-// Forward declaration
-class QTimer;
-
 namespace cx
 {
+class SharedMemoryWaiterThread;
 
 /** \brief VideoSource for connecting to shared memory.
  *
- * Contains data assosiated with a shared memory video stream
+ * Contains data assosiated with a shared memory video stream.
+ * A new frame is read each time the server releases a buffer.
  *
  * \ingroup cx_resource_core_video
  */
@@ -124,11 +123,11 @@ private:
 	bool mImportInitialized;
 	bool mStartWhenConnected;
 
-	QTimer* mPollTimer;
+	SharedMemoryWaiterThread* mWaiter;
 
 private slots:
 
-	void serverPollSlot();
+	void newBufferSlot();
 };
 
 typedef boost::shared_ptr<VideoSourceSHM> VideoSourceSHMPtr;
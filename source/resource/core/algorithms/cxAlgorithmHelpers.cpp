@@ -41,15 +41,154 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxDataLocations.h"
 #include "cxLogger.h"
 #include <itkGrayscaleFillholeImageFilter.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkShortArray.h>
+#include <vtkCommand.h>
+#include <vtkTypeTraits.h>
 
 namespace cx
 {
 
+namespace
+{
+/** Pixel container referencing the scalar buffer of a vtkImageData.
+ *  The vtkImageData and its scalar array are kept alive as long as the
+ *  container exists, thus the ITK image can outlive all other references
+ *  to the input, and the buffer stays valid even if the input gets new scalars.
+ */
+class VtkImagePixelContainer : public itkImageType::PixelContainer
+{
+public:
+	typedef VtkImagePixelContainer Self;
+	typedef itk::SmartPointer<Self> Pointer;
+	itkNewMacro(Self);
+
+	void setImage(vtkImageDataPtr image)
+	{
+		mImage = image;
+		mScalars = mImage->GetPointData()->GetScalars();
+		PixelType* buffer = static_cast<PixelType*>(mScalars->GetVoidPointer(0));
+		this->SetImportPointer(buffer, mImage->GetNumberOfPoints(), false);
+	}
+
+protected:
+	VtkImagePixelContainer() {}
+	virtual ~VtkImagePixelContainer() {}
+
+private:
+	vtkImageDataPtr mImage;
+	vtkDataArrayPtr mScalars; ///< the array owning the buffer
+};
+
+/** Holds a reference to an ITK image.
+ *  Add as observer to a vtkObject in order to keep the ITK image
+ *  alive as long as the vtkObject exists.
+ */
+class ItkImageKeepAlive : public vtkCommand
+{
+public:
+	static ItkImageKeepAlive* New()
+	{
+		return new ItkImageKeepAlive;
+	}
+	virtual void Execute(vtkObject* caller, unsigned long, void*) {}
+	itkImageType::ConstPointer mImage;
+};
+
+template<class T>
+void convertToPixelType(const T* in, PixelType* out, vtkIdType size)
+{
+	for (vtkIdType i = 0; i < size; ++i)
+		out[i] = static_cast<PixelType>(in[i]);
+}
+
+/** Create an ITK image with the same geometry as input.
+ *  The origin is shifted to the first voxel, as the ITK image always starts at index 0.
+ */
+itkImageType::Pointer createITKImageWithGeometry(vtkImageDataPtr input)
+{
+	int* extent = input->GetExtent();
+	double* spacing = input->GetSpacing();
+	double* origin = input->GetOrigin();
+
+	itkImageType::IndexType index;
+	itkImageType::SizeType size;
+	itkImageType::SpacingType itkSpacing;
+	itkImageType::PointType itkOrigin;
+	for (unsigned i = 0; i < Dimension; ++i)
+	{
+		index[i] = 0;
+		size[i] = extent[2*i+1] - extent[2*i] + 1;
+		itkSpacing[i] = spacing[i];
+		itkOrigin[i] = origin[i] + extent[2*i]*spacing[i];
+	}
+
+	itkImageType::RegionType region;
+	region.SetIndex(index);
+	region.SetSize(size);
+
+	itkImageType::Pointer retval = itkImageType::New();
+	retval->SetRegions(region);
+	retval->SetSpacing(itkSpacing);
+	retval->SetOrigin(itkOrigin);
+	return retval;
+}
+} // namespace
+
 //---------------------------------------------------------------------------------------------------------------------
-itkImageType::ConstPointer AlgorithmHelper::getITKfromVTKImage(vtkImageDataPtr image)
+
+/**Convert the vtkImageData to an ITK image, in memory.
+ *
+ * If the input scalar type equals PixelType, the ITK image uses the input
+ * buffer directly, without copying. Other scalar types are converted to
+ * PixelType. Multicomponent images are converted via file.
+ *
+ * The conversion uses only the scalar buffer and geometry of the input,
+ * it never updates the vtk pipeline. This avoids the crashes seen
+ * with itk::VTKImageToImageFilter.
+ */
+itkImageType::ConstPointer AlgorithmHelper::getITKfromVTKImage(vtkImageDataPtr input)
 {
-  //HACK
-  return AlgorithmHelper::getITKfromVTKImageViaFile(image);
+	if(!input)
+	{
+		std::cout << "getITKfromSSCImage(): NO image!!!" << std::endl;
+		return itkImageType::ConstPointer();
+	}
+
+	if (input->GetNumberOfScalarComponents() != 1 || !input->GetPointData()->GetScalars())
+		return AlgorithmHelper::getITKfromVTKImageViaFile(input);
+
+	itkImageType::Pointer retval = createITKImageWithGeometry(input);
+
+	if (input->GetScalarType() == vtkTypeTraits<PixelType>::VTKTypeID())
+	{
+		VtkImagePixelContainer::Pointer container = VtkImagePixelContainer::New();
+		container->setImage(input);
+		retval->SetPixelContainer(container);
+		return itkImageType::ConstPointer(retval);
+	}
+
+	double minVal = input->GetScalarRange()[0];
+	double maxVal = input->GetScalarRange()[1];
+	if(maxVal > SHRT_MAX || minVal < SHRT_MIN)
+		reportWarning("Image values out of range. max: " + qstring_cast(maxVal)
+				+ " min: " + qstring_cast(minVal) + " See bug #363 if this needs to be fixed");
+
+	retval->Allocate();
+	void* in = input->GetScalarPointer();
+	PixelType* out = retval->GetBufferPointer();
+	vtkIdType size = input->GetNumberOfPoints();
+	switch (input->GetScalarType())
+	{
+		vtkTemplateMacro(convertToPixelType(static_cast<VTK_TT*>(in), out, size));
+	default:
+		reportError(QString("getITKfromVTKImage(): Unknown scalar type %1").arg(input->GetScalarTypeAsString()));
+		return itkImageType::ConstPointer();
+	}
+
+	return itkImageType::ConstPointer(retval);
 }
 //---------------------------------------------------------------------------------------------------------------------
 
@@ -65,6 +204,7 @@ itkImageType::ConstPointer AlgorithmHelper::getITKfromSSCImage(ImagePtr input)
 /**This is a workaround for _unpredictable_ crashes
  * experienced when using the itk::VTKImageToImageFilter.
  *
+ * Used only for multicomponent images, where the reader converts to PixelType.
  */
 itkImageType::ConstPointer AlgorithmHelper::getITKfromVTKImageViaFile(vtkImageDataPtr input)
 {
@@ -116,7 +256,50 @@ itkImageType::ConstPointer AlgorithmHelper::getITKfromVTKImageViaFile(vtkImageDa
 }
 //---------------------------------------------------------------------------------------------------------------------
 
+/**Convert the ITK image to a vtkImageData, in memory.
+ *
+ * The output uses the buffer of the ITK image without copying,
+ * and keeps the ITK image alive as long as the scalars exist.
+ */
 vtkImageDataPtr AlgorithmHelper::getVTKFromITK(itkImageType::ConstPointer input)
+{
+	if (!input || !input->GetBufferPointer())
+		return vtkImageDataPtr();
+
+	itkImageType::RegionType region = input->GetBufferedRegion();
+	itkImageType::SpacingType spacing = input->GetSpacing();
+	itkImageType::PointType origin = input->GetOrigin();
+
+	vtkImageDataPtr retval = vtkImageDataPtr::New();
+	int extent[6];
+	double vtkSpacing[3];
+	double vtkOrigin[3];
+	for (unsigned i = 0; i < Dimension; ++i)
+	{
+		extent[2*i] = region.GetIndex()[i];
+		extent[2*i+1] = region.GetIndex()[i] + region.GetSize()[i] - 1;
+		vtkSpacing[i] = spacing[i];
+		vtkOrigin[i] = origin[i];
+	}
+	retval->SetExtent(extent);
+	retval->SetSpacing(vtkSpacing);
+	retval->SetOrigin(vtkOrigin);
+
+	vtkSmartPointer<ItkImageKeepAlive> keepAlive = vtkSmartPointer<ItkImageKeepAlive>::New();
+	keepAlive->mImage = input;
+
+	vtkSmartPointer<vtkShortArray> scalars = vtkSmartPointer<vtkShortArray>::New();
+	scalars->SetNumberOfComponents(1);
+	scalars->SetArray(const_cast<PixelType*>(input->GetBufferPointer()), region.GetNumberOfPixels(), 1);
+	scalars->AddObserver(vtkCommand::DeleteEvent, keepAlive);
+	retval->GetPointData()->SetScalars(scalars);
+
+	return retval;
+}
+
+/**Convert ITK to VTK using a copy of the ITK image.
+ */
+vtkImageDataPtr AlgorithmHelper::getVTKFromITKViaCopy(itkImageType::ConstPointer input)
 {
 	//Convert ITK to VTK
 	itkToVtkFilterType::Pointer itkToVtkFilter = itkToVtkFilterType::New();
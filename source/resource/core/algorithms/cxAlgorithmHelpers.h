@@ -57,6 +57,11 @@ typedef itk::VTKImageToImageFilter<itkImageType> itkVTKImageToImageFilterType;
  * \brief Class with helper functions for algorithms.
  * \ingroup cx_resource_core_algorithms
  *
+ * Conversion between vtk and itk images is done in memory, sharing the
+ * image buffer if possible. The converted image keeps the original alive.
+ * Because the buffer is shared, itk filters fed with a converted image must
+ * not run in place: call InPlaceOff() on any itk::InPlaceImageFilter.
+ *
  * \date Feb 16, 2011
  * \author Janne Beate Bakeng, SINTEF
  */
@@ -67,6 +72,7 @@ public:
   static itkImageType::ConstPointer getITKfromVTKImage(vtkImageDataPtr image);
 
   static vtkImageDataPtr getVTKFromITK(itkImageType::ConstPointer input);
+  static vtkImageDataPtr getVTKFromITKViaCopy(itkImageType::ConstPointer input);
   static vtkImageDataPtr execute_itk_GrayscaleFillholeImageFilter(vtkImageDataPtr input);
 
 private:
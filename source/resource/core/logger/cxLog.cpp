@@ -122,6 +122,9 @@ void Log::stopThread()
 		return;
 
 	disconnect(mWorker.get(), &LogThread::emittedMessage, this, &Log::onEmittedMessage);
+	// release resources owned by the log thread, such as timers, inside that thread.
+	if (mThread->isRunning())
+		QMetaObject::invokeMethod(mWorker.get(), "shutdown", Qt::BlockingQueuedConnection);
 	LogThreadPtr tempWorker = mWorker;
 	mWorker.reset();
 
@@ -33,6 +33,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxLogFile.h"
 
 #include <iostream>
+#include <algorithm>
+#include <QFile>
 #include <QTextStream>
 #include <QFileInfo>
 #include "cxTime.h"
@@ -44,16 +46,23 @@ namespace cx
 {
 
 LogFile::LogFile() :
-	mFilePosition(0)
+	mFilePosition(0),
+	mMaxInitialMessages(-1)
 {
 
 }
 
-LogFile LogFile::fromChannel(QString path, QString channel)
+void LogFile::setMaxInitialMessages(int count)
+{
+	mMaxInitialMessages = count;
+}
+
+LogFile LogFile::fromChannel(QString path, QString channel, LogFileWriterPtr writer)
 {
 	LogFile retval;
 	retval.mPath = path;
 	retval.mChannel = channel;
+	retval.mWriter = writer;
 	return retval;
 }
 
@@ -75,14 +84,17 @@ void LogFile::writeHeader()
 	QString timestamp = QDateTime::currentDateTime().toString(timestampMilliSecondsFormatNice());
 	QString formatInfo = "[timestamp][source info][severity][thread] <text> ";
 	QString text = QString("-------> Logging initialized [%1], format: %2\n").arg(timestamp).arg(formatInfo);
-	bool success = this->appendToLogfile(this->getFilename(), text);
-//	return success;
+	if (mWriter)
+		mWriter->writeHeader(this->getFilename(), text);
+	else
+		this->appendToLogfile(this->getFilename(), text);
 }
 
 void LogFile::write(Message message)
 {
 	QString text = this->formatMessage(message) + "\n";
-	this->appendToLogfile(this->getFilename(), text);
+	bool flush = message.getMessageLevel()==mlERROR;
+	this->appendToLogfile(this->getFilename(), text, flush);
 }
 
 bool LogFile::isWritable() const
@@ -128,13 +140,20 @@ QString LogFile::formatMessage(Message msg)
 	return retval;
 }
 
-/** Open the logfile and append the input text to it
+/** Open the logfile and append the input text to it,
+ *  or pass it to the writer if present.
  */
-bool LogFile::appendToLogfile(QString filename, QString text)
+bool LogFile::appendToLogfile(QString filename, QString text, bool flush)
 {
 	if (filename.isEmpty())
 		return false;
 
+	if (mWriter)
+	{
+		mWriter->write(filename, text, flush);
+		return true;
+	}
+
 	QFile file(filename);
 	QTextStream stream;
 
@@ -165,15 +184,15 @@ std::vector<Message> LogFile::readMessages()
 
 	QStringList lines = text.split("\n");
 
-	QRegExp rx_ts = this->getRX_Timestamp();
-
 	std::vector<Message> retval;
 
 	for (int i=0; i<lines.size(); ++i)
 	{
 		QString line = lines[i];
 
-		QDateTime timestamp = this->readTimestampFromSessionStartLine(lines[i]);
+		QDateTime timestamp;
+		if (line.startsWith('-'))
+			timestamp = this->readTimestampFromSessionStartLine(line);
 		if (timestamp.isValid())
 		{
 			mInitTimestamp = timestamp;
@@ -185,7 +204,7 @@ std::vector<Message> LogFile::readMessages()
 			continue;
 		}
 
-		if (line.count(rx_ts))
+		if (this->isMessageFirstLine(line))
 		{
 			Message msg = this->readMessageFirstLine(lines[i]);
 			msg.mChannel = mChannel;
@@ -201,8 +220,31 @@ std::vector<Message> LogFile::readMessages()
 	return retval;
 }
 
+/** Fast check for the timestamp at the start of each message,
+ *  equivalent to getRX_Timestamp() anchored to the line start.
+ */
+bool LogFile::isMessageFirstLine(const QString& line) const
+{
+	// [hh:mm:ss.zzz]
+	const char* pattern = "[00:00:00.000]";
+	if (line.size() < 14)
+		return false;
+	for (int i=0; i<14; ++i)
+	{
+		bool valid = (pattern[i]=='0') ? line[i].isDigit() : (line[i]==QChar(pattern[i]));
+		if (!valid)
+			return false;
+	}
+	return true;
+}
+
 Message LogFile::readMessageFirstLine(QString line)
 {
+	Message message;
+	if (this->parseMessageFirstLine(line, &message))
+		return message;
+
+	// fallback for lines not in the format written by formatMessage()
 	MESSAGE_LEVEL level = this->readMessageLevel(line);
 	if (level==mlCOUNT)
 		return Message(line, mlINFO);
@@ -225,11 +267,59 @@ Message LogFile::readMessageFirstLine(QString line)
 	return retval;
 }
 
+/** Parse the line formatted by formatMessage() without using regexps:
+ *  Four tab separated fields followed by the level and the text.
+ *  Return false if the line deviates from the format.
+ */
+bool LogFile::parseMessageFirstLine(const QString& line, Message* retval)
+{
+	int fieldStart[5];
+	fieldStart[0] = 0;
+	for (int i=1; i<5; ++i)
+	{
+		int tab = line.indexOf('\t', fieldStart[i-1]);
+		if (tab<0)
+			return false;
+		fieldStart[i] = tab+1;
+	}
+
+	int levelStart = fieldStart[4];
+	int levelEnd = line.indexOf(']', levelStart);
+	if (levelStart>=line.size() || line[levelStart]!='[' || levelEnd<0)
+		return false;
+	MESSAGE_LEVEL level = this->findMessageLevel(line.midRef(levelStart+1, levelEnd-levelStart-1));
+	if (level==mlCOUNT)
+		return false;
+
+	*retval = Message(line.mid(levelEnd+1), level);
+
+	QString fields[4];
+	for (int i=0; i<4; ++i)
+		fields[i] = this->removeBrackets(line.mid(fieldStart[i], fieldStart[i+1]-fieldStart[i]-1));
+	this->parseTimestamp(fields[0], retval);
+	this->parseThread(fields[1], retval);
+	this->parseSourceFileLine(fields[2], retval);
+	this->parseSourceFunction(fields[3], retval);
+	return true;
+}
+
+MESSAGE_LEVEL LogFile::findMessageLevel(const QStringRef& text) const
+{
+	for (int i=0; i<mlCOUNT; ++i)
+		if (text.compare(enum2string<MESSAGE_LEVEL>((MESSAGE_LEVEL)(i)), Qt::CaseInsensitive)==0)
+			return (MESSAGE_LEVEL)(i);
+	return mlCOUNT;
+}
+
 QString LogFile::getIndex(const QStringList& list, int index)
 {
 	if (0>index || index >= list.size())
 		return "";
-	QString field = list[index];
+	return this->removeBrackets(list[index]);
+}
+
+QString LogFile::removeBrackets(QString field)
+{
 	if (field.startsWith("["))
 		field.remove(0, 1);
 	if (field.endsWith("]"))
@@ -243,7 +333,14 @@ void LogFile::parseTimestamp(QString text, Message* retval)
 		return;
 
 	retval->mTimeStamp = mInitTimestamp; // reuse date from init, as this is not part of each line
-	QTime time = QTime::fromString(text, this->timestampFormat());
+
+	// fast path for the hh:mm:ss.zzz format, QTime::fromString() is slow.
+	QTime time;
+	bool ok = (text.size()==12);
+	if (ok)
+		time = QTime(text.midRef(0,2).toInt(&ok), text.midRef(3,2).toInt(), text.midRef(6,2).toInt(), text.midRef(9,3).toInt());
+	if (!ok || !time.isValid())
+		time = QTime::fromString(text, this->timestampFormat());
 	retval->mTimeStamp.setTime(time);
 }
 
@@ -306,16 +403,82 @@ QDateTime LogFile::readTimestampFromSessionStartLine(QString text)
 	return ts;
 }
 
+/** Read the text added since the last call, up to the last complete line.
+ */
 QString LogFile::readFileTail()
 {
 	QFile file(this->getFilename());
-	file.open(QIODevice::ReadOnly);
+	if (!file.open(QIODevice::ReadOnly))
+		return "";
+
+	if (file.size() < mFilePosition)
+		mFilePosition = 0; // file has been rotated, start from the beginning
+
+	if ((mFilePosition==0) && (mMaxInitialMessages>=0))
+		mFilePosition = this->findTailPosition(file, mMaxInitialMessages);
+	mMaxInitialMessages = -1; // only limit the first read
 
 	file.seek(mFilePosition);
-	QString text = file.readAll();
-	mFilePosition = file.pos();
+	QByteArray data = file.readAll();
+	int size = data.lastIndexOf('\n') + 1;
+	mFilePosition += size;
+
+	return QString::fromLocal8Bit(data.constData(), size);
+}
 
-	return text;
+/** Return the start position of the last count messages in the file,
+ *  scanning backwards without parsing. The session start line
+ *  preceding them is read in order to get the date.
+ */
+qint64 LogFile::findTailPosition(QFile& file, int count)
+{
+	const qint64 chunkSize = 1024*1024;
+	qint64 retval = (count==0) ? file.size() : 0;
+	int found = 0;
+	qint64 end = file.size();
+	char firstInLine = 0; // first char of the chunk following the current one
+
+	while (end > 0)
+	{
+		qint64 begin = std::max<qint64>(0, end-chunkSize);
+		file.seek(begin);
+		QByteArray chunk = file.read(end-begin);
+		if (chunk.isEmpty())
+			break;
+
+		// visit the start of each line in the chunk, backwards
+		for (int newline = chunk.lastIndexOf('\n'); ; newline = chunk.lastIndexOf('\n', newline-1))
+		{
+			if (newline<0 && begin>0)
+				break; // line starts in the previous chunk
+			qint64 lineStart = begin + newline + 1;
+			char first = (newline+1 < chunk.size()) ? chunk[newline+1] : firstInLine;
+
+			if (first=='[' && found<count)
+			{
+				if (++found == count)
+					retval = lineStart;
+			}
+			else if (first=='-' && found==count)
+			{
+				file.seek(lineStart);
+				QDateTime timestamp = this->readTimestampFromSessionStartLine(QString::fromLocal8Bit(file.readLine()));
+				if (timestamp.isValid())
+				{
+					mInitTimestamp = timestamp;
+					return retval;
+				}
+			}
+
+			if (newline<=0)
+				break;
+		}
+
+		firstInLine = chunk[0];
+		end = begin;
+	}
+
+	return retval;
 }
 
 
@@ -35,19 +35,25 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxResourceExport.h"
 #include "cxLogMessage.h"
+#include "cxLogFileWriter.h"
+
+class QFile;
 
 namespace cx
 {
 
 /**\brief Log file, format, read and write.
+ *
+ * If a LogFileWriter is given, writes are buffered in it,
+ * otherwise the file is opened for each write.
  *
  * \addtogroup cx_resource_core_logger
  */
-class LogFile
+class cxResource_EXPORT LogFile
 {
 public:
 	explicit LogFile();
-	static LogFile fromChannel(QString path, QString channel);
+	static LogFile fromChannel(QString path, QString channel, LogFileWriterPtr writer = LogFileWriterPtr());
 	static LogFile fromFilename(QString filename);
 	virtual ~LogFile() {}
 
@@ -56,20 +62,33 @@ public:
 	bool isWritable() const;
 	QString getFilename() const;
 
+	/** Read messages added since the last call.
+	 *  Only complete lines are read, the rest is read in the next call.
+	 */
 	std::vector<Message> readMessages();
+	/** Limit the first call to readMessages() to the last count messages in the file.
+	 *  <0 means all messages.
+	 */
+	void setMaxInitialMessages(int count);
 
 private:
 	QString mPath;
 	QString mChannel;
-	int mFilePosition;
+	qint64 mFilePosition;
+	int mMaxInitialMessages;
 	QDateTime mInitTimestamp;
+	LogFileWriterPtr mWriter;
 
+	bool isMessageFirstLine(const QString& line) const;
 	Message readMessageFirstLine(QString line);
+	bool parseMessageFirstLine(const QString& line, Message* retval);
 	MESSAGE_LEVEL readMessageLevel(QString line);
+	MESSAGE_LEVEL findMessageLevel(const QStringRef& text) const;
 	QRegExp getRX_Timestamp() const;
 	QString formatMessage(Message msg);
-	bool appendToLogfile(QString filename, QString text);
+	bool appendToLogfile(QString filename, QString text, bool flush=false);
 	QString readFileTail();
+	qint64 findTailPosition(QFile& file, int count);
 //	QString removeEarlierSessionsAndSetStartTime(QString text);
 //	std::vector<std::pair<QDateTime, QString> > splitIntoSessions(QString text);
 	QString timestampFormat() const;
@@ -80,6 +99,7 @@ private:
 	void parseSourceFileLine(QString text, Message* retval);
 	void parseSourceFunction(QString text, Message* retval);
 	QString getIndex(const QStringList& list, int index);
+	QString removeBrackets(QString field);
 
 };
 
@@ -41,8 +41,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QMutex>
 #include <QSound>
 #include <QDir>
+#include <QFileInfo>
 #include <QTextStream>
 #include <QTimer>
+#include <queue>
+#include <functional>
 #include "cxTypeConversions.h"
 #include "cxDefinitionStrings.h"
 #include "cxTime.h"
@@ -78,25 +81,79 @@ void LogFileWatcherThread::onDirectoryChanged(const QString& path)
 	current.sort();
 
 	if (current==mInitializedFiles)
+	{
+		// a rotated file is replaced by a new one, which the watcher does not know.
+		for (int i=0; i<current.size(); ++i)
+		{
+			QString filename = info.absoluteFilePath(current[i]);
+			if (!mWatcher.files().contains(filename))
+				this->onFileChanged(filename);
+		}
 		return;
+	}
 
 	if (!mWatcher.files().isEmpty())
 		mWatcher.removePaths(mWatcher.files());
 
 	mInitializedFiles = current;
-	std::multimap<QDateTime, Message> messages;
+	std::vector<std::vector<Message> > messages(mInitializedFiles.size());
 	for (int i=0; i<mInitializedFiles.size(); ++i)
 	{
 		QString filename = info.absoluteFilePath(mInitializedFiles[i]);
 		mWatcher.addPath(filename);
-		std::vector<Message> msg = this->readMessages(filename);
-		for (unsigned i=0; i<msg.size(); ++i)
-			messages.insert(std::make_pair(msg[i].mTimeStamp, msg[i]));
-		this->onFileChanged(filename);
+		messages[i] = this->readMessages(filename);
+	}
+
+	this->processMessagesInTimeOrder(messages);
+}
+
+namespace
+{
+/** Position in one of the message lists merged in processMessagesInTimeOrder()
+ */
+struct MergeCursor
+{
+	QDateTime mTimeStamp;
+	unsigned mList;
+	unsigned mIndex;
+	bool operator>(const MergeCursor& rhs) const
+	{
+		if (mTimeStamp != rhs.mTimeStamp)
+			return mTimeStamp > rhs.mTimeStamp;
+		if (mList != rhs.mList)
+			return mList > rhs.mList;
+		return mIndex > rhs.mIndex;
+	}
+};
+}
+
+/** Process messages from several files, each sorted in time,
+ *  as one sequence sorted in time. Uses a k-way merge.
+ */
+void LogFileWatcherThread::processMessagesInTimeOrder(const std::vector<std::vector<Message> >& messages)
+{
+	std::priority_queue<MergeCursor, std::vector<MergeCursor>, std::greater<MergeCursor> > heap;
+	for (unsigned i=0; i<messages.size(); ++i)
+	{
+		if (messages[i].empty())
+			continue;
+		MergeCursor cursor = { messages[i][0].mTimeStamp, i, 0 };
+		heap.push(cursor);
 	}
 
-	for (std::multimap<QDateTime, Message>::iterator i=messages.begin(); i!=messages.end(); ++i)
-		this->processMessage(i->second);
+	while (!heap.empty())
+	{
+		MergeCursor cursor = heap.top();
+		heap.pop();
+		const std::vector<Message>& list = messages[cursor.mList];
+		this->processMessage(list[cursor.mIndex]);
+
+		if (++cursor.mIndex < list.size())
+		{
+			cursor.mTimeStamp = list[cursor.mIndex].mTimeStamp;
+			heap.push(cursor);
+		}
+	}
 }
 
 void LogFileWatcherThread::onFileChanged(const QString& path)
@@ -108,12 +165,20 @@ void LogFileWatcherThread::onFileChanged(const QString& path)
 	std::vector<Message> messages = this->readMessages(path);
 	for (unsigned i=0; i<messages.size(); ++i)
 		this->processMessage(messages[i]);
+
+	// the watcher drops files that are renamed or removed, i.e. during rotation.
+	if (!mWatcher.files().contains(path) && QFileInfo(path).exists())
+		mWatcher.addPath(path);
 }
 
 std::vector<Message> LogFileWatcherThread::readMessages(const QString& path)
 {
 	if (!mFiles.count(path))
+	{
+		// initially read only the messages that fit in the repository
 		mFiles[path] = LogFile::fromFilename(path);
+		mFiles[path].setMaxInitialMessages(mRepository->getMessageQueueMaxSize());
+	}
 
 	std::vector<Message> messages = mFiles[path].readMessages();
 	return messages;
@@ -127,14 +192,15 @@ void LogFileWatcherThread::executeSetLoggingFolder(QString absoluteLoggingFolder
 	mLogPath = absoluteLoggingFolderPath;
 
 	mInitializedFiles.clear();
+	mFiles.clear();
 	mRepository->clearQueue();
 
-	mWatcher.addPath(mLogPath);
-
 	if (!mWatcher.directories().isEmpty())
 		mWatcher.removePaths(mWatcher.directories());
 	if (!mWatcher.files().isEmpty())
 		mWatcher.removePaths(mWatcher.files());
+
+	mWatcher.addPath(mLogPath);
 	this->onDirectoryChanged(mLogPath);
 }
 
@@ -90,6 +90,7 @@ private:
 	virtual void executeSetLoggingFolder(QString absoluteLoggingFolderPath);
 
 	std::vector<Message> readMessages(const QString& path);
+	void processMessagesInTimeOrder(const std::vector<std::vector<Message> >& messages);
 
 	QFileSystemWatcher mWatcher;
 	QString mLogPath;
@@ -0,0 +1,207 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxLogFileWriter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+
+namespace cx
+{
+
+LogFileWriter::LogFileWriter() :
+	mBacklog(0),
+	mDropCount(0),
+	mRotationCount(0),
+	mFlushBytes(64*1024),
+	mFlushInterval(1000),
+	mMaxFileSize(100*1024*1024),
+	mMaxRotatedFiles(5),
+	mMaxBacklog(8*1024*1024)
+{
+}
+
+LogFileWriter::~LogFileWriter()
+{
+	this->close();
+}
+
+void LogFileWriter::setFlushThreshold(int bytes, int ms)
+{
+	mFlushBytes = bytes;
+	mFlushInterval = ms;
+}
+
+void LogFileWriter::setMaxFileSize(qint64 bytes)
+{
+	mMaxFileSize = bytes;
+}
+
+void LogFileWriter::setMaxRotatedFiles(int count)
+{
+	mMaxRotatedFiles = count;
+}
+
+void LogFileWriter::setMaxBacklog(int bytes)
+{
+	mMaxBacklog = bytes;
+}
+
+QString LogFileWriter::getRotatedFilename(QString filename, int index)
+{
+	QFileInfo info(filename);
+	return QString("%1/rotated/%2.%3.%4")
+			.arg(info.path())
+			.arg(info.completeBaseName())
+			.arg(index)
+			.arg(info.suffix());
+}
+
+void LogFileWriter::writeHeader(QString filename, QString text)
+{
+	mChannels[filename].mHeader = text.toLocal8Bit();
+	this->write(filename, text);
+}
+
+void LogFileWriter::write(QString filename, QString text, bool flush)
+{
+	if (filename.isEmpty())
+		return;
+
+	QByteArray data = text.toLocal8Bit();
+	if (mBacklog + data.size() > mMaxBacklog)
+	{
+		// try to get rid of the backlog before giving up
+		this->flush();
+		if (mBacklog + data.size() > mMaxBacklog)
+		{
+			++mDropCount;
+			return;
+		}
+	}
+
+	if (!mBacklog)
+		mOldestBuffered.start();
+	mChannels[filename].mBuffer.append(data);
+	mBacklog += data.size();
+
+	if (flush || (mBacklog >= mFlushBytes))
+		this->flush();
+}
+
+void LogFileWriter::flushIfDue()
+{
+	if (mBacklog && mOldestBuffered.hasExpired(mFlushInterval))
+		this->flush();
+}
+
+void LogFileWriter::flush()
+{
+	mBacklog = 0;
+	for (std::map<QString, Channel>::iterator iter=mChannels.begin(); iter!=mChannels.end(); ++iter)
+	{
+		this->flush(iter->first, iter->second);
+		mBacklog += iter->second.mBuffer.size();
+	}
+	if (mBacklog)
+		mOldestBuffered.start(); // retry after the next interval
+}
+
+bool LogFileWriter::flush(QString filename, Channel& channel)
+{
+	if (channel.mBuffer.isEmpty())
+		return true;
+	if (!this->open(filename, channel))
+		return false;
+
+	if (channel.mFile->size() && (channel.mFile->size() + channel.mBuffer.size() > mMaxFileSize))
+	{
+		this->rotate(filename, channel);
+		if (!this->open(filename, channel))
+			return false;
+	}
+
+	qint64 written = channel.mFile->write(channel.mBuffer);
+	if (written < 0)
+	{
+		channel.mFile.reset(); // reopen next time
+		return false;
+	}
+	channel.mBuffer.remove(0, written);
+	channel.mFile->flush();
+	return channel.mBuffer.isEmpty();
+}
+
+bool LogFileWriter::open(QString filename, Channel& channel)
+{
+	if (channel.mFile && channel.mFile->isOpen())
+		return true;
+
+	channel.mFile.reset(new QFile(filename));
+	if (!channel.mFile->open(QFile::WriteOnly | QFile::Append))
+	{
+		channel.mFile.reset();
+		return false;
+	}
+	return true;
+}
+
+/** Move filename to rotated/filename.1, shifting older files up one index
+ *  and removing the oldest. The new file starts with the header.
+ */
+void LogFileWriter::rotate(QString filename, Channel& channel)
+{
+	channel.mFile.reset();
+
+	QFileInfo(this->getRotatedFilename(filename, 1)).absoluteDir().mkpath(".");
+	QFile::remove(this->getRotatedFilename(filename, mMaxRotatedFiles));
+	for (int i=mMaxRotatedFiles-1; i>0; --i)
+		QFile::rename(this->getRotatedFilename(filename, i), this->getRotatedFilename(filename, i+1));
+	if (mMaxRotatedFiles > 0)
+		QFile::rename(filename, this->getRotatedFilename(filename, 1));
+	else
+		QFile::remove(filename);
+	++mRotationCount;
+
+	if (!channel.mHeader.isEmpty())
+		channel.mBuffer.prepend(channel.mHeader);
+}
+
+void LogFileWriter::close()
+{
+	this->flush();
+	for (std::map<QString, Channel>::iterator iter=mChannels.begin(); iter!=mChannels.end(); ++iter)
+		iter->second.mFile.reset();
+}
+
+} //namespace cx
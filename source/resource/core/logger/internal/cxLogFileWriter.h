@@ -0,0 +1,116 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXLOGFILEWRITER_H
+#define CXLOGFILEWRITER_H
+
+#include "cxResourceExport.h"
+
+#include <map>
+#include <QString>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include "boost/shared_ptr.hpp"
+
+class QFile;
+
+namespace cx
+{
+
+/**\brief Buffered writer for the log files.
+ *
+ * Keeps one open file handle for each log file, and buffers the text
+ * written to them. The buffers are written to disk when their total size
+ * exceeds a threshold, when the oldest buffered text exceeds a max age
+ * (call flushIfDue() regularly), or when write() is called with flush=true,
+ * typically for errors.
+ *
+ * Files exceeding a max size are rotated into the subfolder rotated/,
+ * keeping a limited number of old files. The header set for a file is
+ * repeated at the start of each new file.
+ *
+ * If the files cannot be written, text is kept up to a max backlog,
+ * after that new text is dropped and counted.
+ *
+ * Not thread-safe: Use from the log thread only.
+ *
+ * \addtogroup cx_resource_core_logger
+ */
+class cxResource_EXPORT LogFileWriter
+{
+public:
+	LogFileWriter();
+	~LogFileWriter(); ///< flush and close all files
+
+	void setFlushThreshold(int bytes, int ms); ///< flush when buffered text exceeds bytes or is older than ms
+	void setMaxFileSize(qint64 bytes); ///< rotate files larger than this
+	void setMaxRotatedFiles(int count);
+	void setMaxBacklog(int bytes); ///< drop text when more than this is waiting
+
+	void writeHeader(QString filename, QString text); ///< write text and repeat it in rotated files
+	void write(QString filename, QString text, bool flush=false);
+	void flushIfDue();
+	void flush();
+	void close(); ///< flush and close all files
+
+	int getBacklog() const { return mBacklog; } ///< number of bytes buffered but not written to disk
+	int getDropCount() const { return mDropCount; } ///< number of writes dropped due to full backlog
+	int getRotationCount() const { return mRotationCount; }
+	static QString getRotatedFilename(QString filename, int index);
+
+private:
+	struct Channel
+	{
+		boost::shared_ptr<QFile> mFile;
+		QByteArray mBuffer;
+		QByteArray mHeader;
+	};
+	bool flush(QString filename, Channel& channel);
+	bool open(QString filename, Channel& channel);
+	void rotate(QString filename, Channel& channel);
+
+	std::map<QString, Channel> mChannels;
+	QElapsedTimer mOldestBuffered; ///< time since the first text was buffered after last flush
+	int mBacklog;
+	int mDropCount;
+	int mRotationCount;
+	int mFlushBytes;
+	int mFlushInterval;
+	qint64 mMaxFileSize;
+	int mMaxRotatedFiles;
+	int mMaxBacklog;
+};
+typedef boost::shared_ptr<LogFileWriter> LogFileWriterPtr;
+
+} //namespace cx
+
+#endif // CXLOGFILEWRITER_H
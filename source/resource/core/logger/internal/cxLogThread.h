@@ -118,6 +118,7 @@ signals:
 	void emittedMessage(Message message); ///< emitted for each new message, in addition to writing to observer.
 public slots:
 	virtual void logMessage(Message msg) {} // default impl do nothing (should be removed)
+	virtual void shutdown() {} ///< called in the log thread just before it stops
 
 protected:
 	virtual void executeSetLoggingFolder(QString absoluteLoggingFolderPath) = 0;
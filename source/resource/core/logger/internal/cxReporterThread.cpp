@@ -58,7 +58,10 @@ namespace cx
 {
 
 ReporterThread::ReporterThread(QObject *parent) :
-	LogThread(parent)
+	LogThread(parent),
+	mWriter(new LogFileWriter()),
+	mFlushTimer(NULL),
+	mReportedDropCount(0)
 {
 	qInstallMessageHandler(convertQtMessagesToCxMessages);
 	qRegisterMetaType<Message>("Message");
@@ -76,6 +79,7 @@ ReporterThread::ReporterThread(QObject *parent) :
 ReporterThread::~ReporterThread()
 {
 	qInstallMessageHandler(0);
+	mWriter->close();
 	mCout.reset();
 	mCerr.reset();
 }
@@ -101,15 +105,48 @@ bool ReporterThread::initializeLogFile(LogFile file)
 
 void ReporterThread::executeSetLoggingFolder(QString absoluteLoggingFolderPath)
 {
+	mWriter->close(); // release handles to files in the previous folder
 	mLogPath = absoluteLoggingFolderPath;
 
 	QFileInfo(mLogPath+"/").absoluteDir().mkpath(".");
 
+	// the timer must be created here, in the log thread.
+	if (!mFlushTimer)
+	{
+		mFlushTimer = new QTimer(this);
+		connect(mFlushTimer, &QTimer::timeout, this, &ReporterThread::onFlushTimer);
+		mFlushTimer->start(200);
+	}
+
 //	this->initializeLogFile(this->getFilenameForChannel("console"));
 //	this->initializeLogFile(this->getFilenameForChannel("all"));
 
-	this->initializeLogFile(LogFile::fromChannel(mLogPath, "console"));
-	this->initializeLogFile(LogFile::fromChannel(mLogPath, "all"));
+	this->initializeLogFile(LogFile::fromChannel(mLogPath, "console", mWriter));
+	this->initializeLogFile(LogFile::fromChannel(mLogPath, "all", mWriter));
+}
+
+/** The flush timer belongs to the log thread, and must be deleted there.
+ */
+void ReporterThread::shutdown()
+{
+	delete mFlushTimer;
+	mFlushTimer = NULL;
+	mWriter->flush();
+}
+
+/** Write buffered messages older than the writer threshold,
+ *  and report messages dropped because the backlog was full.
+ */
+void ReporterThread::onFlushTimer()
+{
+	mWriter->flushIfDue();
+
+	int dropped = mWriter->getDropCount() - mReportedDropCount;
+	if (dropped && !mWriter->getBacklog())
+	{
+		mReportedDropCount = mWriter->getDropCount();
+		this->processMessage(Message(QString("Log writer dropped %1 messages, backlog was full").arg(dropped), mlWARNING));
+	}
 }
 
 void ReporterThread::logMessage(Message msg)
@@ -135,8 +172,8 @@ void ReporterThread::sendToFile(Message message)
 		return;
 
 //	QString channelFile = this->getFilenameForChannel(message.mChannel);
-	LogFile channelLog = LogFile::fromChannel(mLogPath, message.mChannel);
-	LogFile allLog = LogFile::fromChannel(mLogPath, "all");
+	LogFile channelLog = LogFile::fromChannel(mLogPath, message.mChannel, mWriter);
+	LogFile allLog = LogFile::fromChannel(mLogPath, "all", mWriter);
 
 	this->initializeLogFile(channelLog);
 
@@ -53,12 +53,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QList>
 #include <QThread>
 #include "cxLogThread.h"
+#include "cxLogFileWriter.h"
 
 class QString;
 class QDomNode;
 class QDomDocument;
 class QFile;
 class QTextStream;
+class QTimer;
 
 /**
  * \file
@@ -83,6 +85,7 @@ public:
 
 public slots:
 	virtual void logMessage(Message msg);
+	virtual void shutdown();
 
 signals:
 	void emittedMessage(Message message); ///< emitted for each new message, in addition to writing to file.
@@ -92,6 +95,7 @@ protected:
 
 private slots:
 	void onMessageEmitted(Message msg);
+	void onFlushTimer();
 private:
 	bool initializeLogFile(LogFile file);
 
@@ -104,6 +108,9 @@ private:
 
 	QString mLogPath;
 	QStringList mInitializedFiles;
+	LogFileWriterPtr mWriter;
+	QTimer* mFlushTimer;
+	int mReportedDropCount;
 
 };
 
@@ -100,6 +100,9 @@ void StateService::fillDefaultSettings()
 	this->fillDefault("Ultrasound/acquisitionName", "US-Acq");
 	this->fillDefault("Ultrasound/8bitAcquisitionData", false);
 	this->fillDefault("Ultrasound/CompressAcquisition", true);
+	this->fillDefault("Ultrasound/LiveReconstruction", false);
+	this->fillDefault("Ultrasound/MaxRecordBacklog", 1000);
+	this->fillDefault("Video/FrameQueueCapacity", 8);
 	this->fillDefault("View3D/sphereRadius", 1.0);
 	this->fillDefault("View3D/labelSize", 2.5);
 	this->fillDefault("Navigation/anyplaneViewOffset", 0.25);
@@ -136,6 +139,7 @@ void StateService::fillDefaultSettings()
 	this->fillDefault("IGSTKDebugLogging", false);
 	this->fillDefault("giveManualToolPhysicalProperties", false);
 	this->fillDefault("renderSpeedLogging", false);
+	this->fillDefault("renderTimingOverlay", false);
 
 	this->fillDefault("applyTransferFunctionPresetsToAll", false);
 
@@ -0,0 +1,209 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "catch.hpp"
+#include "cxAlgorithmHelpers.h"
+
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <QtConcurrentRun>
+#include <itkBinaryThresholdImageFilter.h>
+#include "cxVolumeHelpers.h"
+
+using namespace cx;
+
+namespace
+{
+vtkImageDataPtr createTestImage(int scalarType)
+{
+	Eigen::Array3i dim(20, 30, 40);
+	Vector3D spacing(0.5, 0.6, 0.7);
+	vtkImageDataPtr retval;
+	if (scalarType == VTK_SHORT)
+		retval = generateVtkImageDataSignedShort(dim, spacing, 0);
+	else
+		retval = generateVtkImageData(dim, spacing, 0);
+	retval->SetOrigin(1, 2, 3);
+
+	for (int z = 0; z < dim[2]; ++z)
+		for (int y = 0; y < dim[1]; ++y)
+			for (int x = 0; x < dim[0]; ++x)
+				retval->SetScalarComponentFromDouble(x, y, z, 0, (x + y + z) % 100);
+	return retval;
+}
+
+void checkEqualImages(vtkImageDataPtr vtkImage, itkImageType::ConstPointer itkImage)
+{
+	int* dim = vtkImage->GetDimensions();
+	REQUIRE( itkImage->GetBufferedRegion().GetSize()[0] == dim[0] );
+	REQUIRE( itkImage->GetBufferedRegion().GetSize()[1] == dim[1] );
+	REQUIRE( itkImage->GetBufferedRegion().GetSize()[2] == dim[2] );
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		CHECK( similar(itkImage->GetSpacing()[i], vtkImage->GetSpacing()[i]) );
+		CHECK( similar(itkImage->GetOrigin()[i], vtkImage->GetOrigin()[i]) );
+	}
+
+	itkImageType::IndexType index;
+	for (index[2] = 0; index[2] < dim[2]; index[2] += 7)
+		for (index[1] = 0; index[1] < dim[1]; index[1] += 5)
+			for (index[0] = 0; index[0] < dim[0]; index[0] += 3)
+				REQUIRE( itkImage->GetPixel(index) == vtkImage->GetScalarComponentAsDouble(index[0], index[1], index[2], 0) );
+}
+
+/** Convert to itk, threshold, convert back. Return number of voxels above threshold.
+ */
+int thresholdViaITK(vtkImageDataPtr input)
+{
+	itkImageType::ConstPointer itkImage = AlgorithmHelper::getITKfromVTKImage(input);
+	input = vtkImageDataPtr(); // the itk image must keep the buffer alive
+
+	typedef itk::BinaryThresholdImageFilter<itkImageType, itkImageType> thresholdFilterType;
+	thresholdFilterType::Pointer thresholdFilter = thresholdFilterType::New();
+	thresholdFilter->InPlaceOff();
+	thresholdFilter->SetInput(itkImage);
+	thresholdFilter->SetOutsideValue(0);
+	thresholdFilter->SetInsideValue(1);
+	thresholdFilter->SetLowerThreshold(50);
+	thresholdFilter->SetUpperThreshold(1000);
+	thresholdFilter->Update();
+	itkImage = thresholdFilter->GetOutput();
+
+	vtkImageDataPtr output = AlgorithmHelper::getVTKFromITK(itkImage);
+	thresholdFilter = thresholdFilterType::Pointer(); // the vtk image must keep the buffer alive
+	itkImage = itkImageType::ConstPointer();
+
+	int count = 0;
+	short* data = static_cast<short*>(output->GetScalarPointer());
+	for (vtkIdType i = 0; i < output->GetNumberOfPoints(); ++i)
+		count += data[i];
+	return count;
+}
+}
+
+TEST_CASE("AlgorithmHelper: short vtk image is shared with itk", "[unit][resource][core]")
+{
+	vtkImageDataPtr input = createTestImage(VTK_SHORT);
+	itkImageType::ConstPointer itkImage = AlgorithmHelper::getITKfromVTKImage(input);
+
+	REQUIRE( itkImage );
+	CHECK( itkImage->GetBufferPointer() == input->GetScalarPointer() );
+	checkEqualImages(input, itkImage);
+}
+
+TEST_CASE("AlgorithmHelper: shared buffer survives new scalars in the vtk image", "[unit][resource][core]")
+{
+	vtkImageDataPtr input = createTestImage(VTK_SHORT);
+	vtkImageDataPtr original = vtkImageDataPtr::New();
+	original->DeepCopy(input);
+	itkImageType::ConstPointer itkImage = AlgorithmHelper::getITKfromVTKImage(input);
+
+	// replacing the scalars releases the old array, unless the itk image holds it
+	vtkDataArrayPtr scalars;
+	scalars.TakeReference(input->GetPointData()->GetScalars()->NewInstance());
+	scalars->DeepCopy(input->GetPointData()->GetScalars());
+	input->GetPointData()->SetScalars(scalars);
+	scalars->FillComponent(0, 0);
+
+	REQUIRE( itkImage );
+	CHECK( itkImage->GetBufferPointer() != input->GetScalarPointer() );
+	checkEqualImages(original, itkImage);
+}
+
+TEST_CASE("AlgorithmHelper: unsigned char vtk image is converted to itk", "[unit][resource][core]")
+{
+	vtkImageDataPtr input = createTestImage(VTK_UNSIGNED_CHAR);
+	itkImageType::ConstPointer itkImage = AlgorithmHelper::getITKfromVTKImage(input);
+
+	REQUIRE( itkImage );
+	checkEqualImages(input, itkImage);
+}
+
+TEST_CASE("AlgorithmHelper: itk image is shared with vtk", "[unit][resource][core]")
+{
+	vtkImageDataPtr input = createTestImage(VTK_SHORT);
+	itkImageType::ConstPointer itkImage = AlgorithmHelper::getITKfromVTKImage(input);
+	vtkImageDataPtr output = AlgorithmHelper::getVTKFromITK(itkImage);
+
+	REQUIRE( output );
+	CHECK( output->GetScalarPointer() == itkImage->GetBufferPointer() );
+	CHECK( output->GetScalarType() == VTK_SHORT );
+	checkEqualImages(output, itkImage);
+}
+
+TEST_CASE("AlgorithmHelper: converted images outlive their source", "[unit][resource][core]")
+{
+	int expected = 0;
+	{
+		vtkImageDataPtr input = createTestImage(VTK_SHORT);
+		short* data = static_cast<short*>(input->GetScalarPointer());
+		for (vtkIdType i = 0; i < input->GetNumberOfPoints(); ++i)
+			if (data[i] >= 50)
+				++expected;
+	}
+
+	CHECK( thresholdViaITK(createTestImage(VTK_SHORT)) == expected );
+	CHECK( thresholdViaITK(createTestImage(VTK_UNSIGNED_CHAR)) == expected );
+}
+
+TEST_CASE("AlgorithmHelper: thresholding leaves the source image unchanged", "[unit][resource][core]")
+{
+	vtkImageDataPtr input = createTestImage(VTK_SHORT);
+	vtkImageDataPtr original = vtkImageDataPtr::New();
+	original->DeepCopy(input);
+
+	thresholdViaITK(input);
+
+	short* data = static_cast<short*>(input->GetScalarPointer());
+	short* expected = static_cast<short*>(original->GetScalarPointer());
+	REQUIRE( input->GetNumberOfPoints() == original->GetNumberOfPoints() );
+	for (vtkIdType i = 0; i < input->GetNumberOfPoints(); ++i)
+		REQUIRE( data[i] == expected[i] );
+}
+
+TEST_CASE("AlgorithmHelper: vtk-itk conversion in several threads", "[unit][resource][core]")
+{
+	// The in-memory conversion replaces a conversion via file, used due to
+	// crashes in itk::VTKImageToImageFilter when run outside the main thread.
+	vtkImageDataPtr input = createTestImage(VTK_SHORT);
+	int expected = thresholdViaITK(input);
+
+	for (int iteration = 0; iteration < 10; ++iteration)
+	{
+		std::vector<QFuture<int> > results;
+		for (int i = 0; i < 8; ++i)
+			results.push_back(QtConcurrent::run(&thresholdViaITK, input));
+		for (unsigned i = 0; i < results.size(); ++i)
+			CHECK( results[i].result() == expected );
+	}
+}
@@ -0,0 +1,123 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxPointKDTree.h"
+#include "catch.hpp"
+#include <cstdlib>
+#include <limits>
+
+using namespace cx;
+
+namespace
+{
+Eigen::MatrixXd createRandomPoints(int n, int range)
+{
+	Eigen::MatrixXd retval(3, n);
+	for (int i=0; i<n; ++i)
+		for (int k=0; k<3; ++k)
+			retval(k,i) = rand()%range; // integer coordinates gives many ties
+	return retval;
+}
+
+std::pair<int, double> findNearestBruteForce(const Eigen::MatrixXd& positions, const std::vector<bool>& active, Vector3D p)
+{
+	int best = -1;
+	double bestDist = std::numeric_limits<double>::max();
+	for (int i=0; i<positions.cols(); ++i)
+	{
+		if (!active[i])
+			continue;
+		double d = (positions.col(i) - p).norm();
+		if (d < bestDist)
+		{
+			bestDist = d;
+			best = i;
+		}
+	}
+	return std::make_pair(best, bestDist);
+}
+}
+
+TEST_CASE("PointKDTree: empty tree", "[unit][resource][core]")
+{
+	PointKDTree tree(Eigen::MatrixXd(3,0));
+	CHECK( tree.empty() );
+	CHECK( tree.size() == 0 );
+	CHECK( tree.findNearest(Vector3D(0,0,0)).first == -1 );
+	CHECK( tree.findWithinRadius(Vector3D(0,0,0), 10).empty() );
+}
+
+TEST_CASE("PointKDTree: nearest neighbour equals brute force search while removing points", "[unit][resource][core]")
+{
+	srand(0);
+	int n = 500;
+	Eigen::MatrixXd positions = createRandomPoints(n, 20);
+	PointKDTree tree(positions);
+	std::vector<bool> active(n, true);
+
+	REQUIRE( int(tree.size()) == n );
+
+	for (int i=0; i<n; ++i)
+	{
+		Vector3D p(rand()%22-1, rand()%22-1, rand()%22-1);
+		std::pair<int, double> expected = findNearestBruteForce(positions, active, p);
+		std::pair<int, double> found = tree.findNearest(p);
+		REQUIRE( found.first == expected.first );
+		REQUIRE( similar(found.second, expected.second) );
+
+		tree.remove(found.first);
+		active[found.first] = false;
+		REQUIRE( !tree.contains(found.first) );
+		REQUIRE( int(tree.size()) == n-i-1 );
+	}
+
+	CHECK( tree.empty() );
+}
+
+TEST_CASE("PointKDTree: find within radius", "[unit][resource][core]")
+{
+	srand(0);
+	int n = 300;
+	Eigen::MatrixXd positions = createRandomPoints(n, 10);
+	PointKDTree tree(positions);
+	for (int i=0; i<n; i+=3)
+		tree.remove(i);
+
+	Vector3D p(5,5,5);
+	double radius = 3.5;
+	std::vector<int> expected;
+	for (int i=0; i<n; ++i)
+		if (tree.contains(i) && (positions.col(i)-p).norm() <= radius)
+			expected.push_back(i);
+
+	CHECK( tree.findWithinRadius(p, radius) == expected );
+}
@@ -31,6 +31,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 =========================================================================*/
 
 #include "cxSharedMemory.h"
+#include "cxSharedMemoryVideo.h"
+#include "cxImage.h"
+#include "cxProbeDefinition.h"
+#include "cxVolumeHelpers.h"
+#include "vtkImageData.h"
 #include "catch.hpp"
 
 using namespace cx;
@@ -60,5 +65,137 @@ TEST_CASE("SharedMemory works", "[unit][resource][core]")
 	}
 }
 
+TEST_CASE("SharedMemory numbers buffers and locks several buffers", "[unit][resource][core]")
+{
+	SharedMemoryServer srv("test_sequence_", 4, 100);
+	SharedMemoryClient cli;
+	REQUIRE( cli.attach(srv.key()) );
+
+	CHECK( cli.lockLatestBuffer(0, NULL, NULL) == -1 );
+
+	strcpy((char *)srv.buffer(), "first");
+	srv.release();
+	qint64 first = 0;
+	int firstIndex = cli.lockLatestBuffer(0, &first, NULL);
+	REQUIRE( firstIndex >= 0 );
+	CHECK( first == 1 );
+	CHECK( cli.lockLatestBuffer(first, NULL, NULL) == -1 );
+	CHECK( cli.waitForNewBuffer(0) == first ); // returns immediately when newer exists
+
+	strcpy((char *)srv.buffer(), "second");
+	srv.release();
+	qint64 second = 0;
+	int secondIndex = cli.lockLatestBuffer(first, &second, NULL);
+	REQUIRE( secondIndex >= 0 );
+	CHECK( second == 2 );
+	CHECK( secondIndex != firstIndex );
+
+	// both buffers stay locked: the server must write elsewhere
+	for (int i=0; i<4; ++i)
+	{
+		char* dst = (char *)srv.buffer();
+		REQUIRE( dst );
+		strcpy(dst, "other");
+		srv.release();
+	}
+	CHECK( strcmp((const char *)cli.getBuffer(firstIndex), "first") == 0 );
+	CHECK( strcmp((const char *)cli.getBuffer(secondIndex), "second") == 0 );
+
+	cli.unlockBuffer(firstIndex);
+	cli.unlockBuffer(secondIndex);
+}
+
+TEST_CASE("SharedMemory server continues the circle after the last buffer written", "[unit][resource][core]")
+{
+	SharedMemoryServer srv("test_circle_", 4, 100);
+	SharedMemoryClient cli;
+	REQUIRE( cli.attach(srv.key()) );
+
+	qint64 sequence = 0;
+	std::vector<int> written;
+	for (int i=0; i<6; ++i)
+	{
+		REQUIRE( srv.buffer() );
+		srv.release();
+		int index = cli.lockLatestBuffer(sequence, &sequence, NULL);
+		REQUIRE( index >= 0 );
+		cli.unlockBuffer(index);
+		written.push_back(index);
+	}
+	int expected[] = {0, 1, 2, 3, 0, 1};
+	CHECK( written == std::vector<int>(expected, expected+6) );
+}
+
+TEST_CASE("SharedMemory client wait returns on timeout", "[unit][resource][core]")
+{
+	SharedMemoryServer srv("test_timeout_", 4, 100);
+	SharedMemoryClient cli;
+	REQUIRE( cli.attach(srv.key()) );
 
+	// no buffer is released, as if the server had crashed
+	CHECK( cli.waitForNewBuffer(0, 50) == 0 );
+	CHECK( cli.waitForNewBuffer(0, 50) == 0 );
 
+	REQUIRE( srv.buffer() );
+	srv.release();
+	CHECK( cli.waitForNewBuffer(0, 50) == 1 );
+}
+
+namespace
+{
+ImagePtr createTestFrame(unsigned char value)
+{
+	vtkImageDataPtr raw = generateVtkImageData(Eigen::Array3i(64, 32, 1), Vector3D(0.5, 0.25, 1), value, 1);
+	ImagePtr retval(new Image("test_stream", raw));
+	retval->setAcquisitionTime(QDateTime::fromMSecsSinceEpoch(1000));
+	return retval;
+}
+}
+
+TEST_CASE("SharedMemoryVideo reads frames without copying", "[unit][resource][core]")
+{
+	SharedMemoryVideoWriter writer("test_video_", 4);
+
+	ProbeDefinitionPtr probe(new ProbeDefinition(ProbeDefinition::tLINEAR));
+	probe->setUid("test_stream");
+	writer.setProbeDefinition(probe);
+	REQUIRE( writer.write(createTestFrame(10)) );
+
+	SharedMemoryVideoReaderPtr reader = SharedMemoryVideoReader::create("test_video_");
+	REQUIRE( reader );
+
+	ImagePtr image = reader->readLatest();
+	REQUIRE( image );
+	CHECK( image->getUid() == "test_stream" );
+	CHECK( image->getAcquisitionTime().toMSecsSinceEpoch() == 1000 );
+	vtkImageDataPtr data = image->getBaseVtkImageData();
+	CHECK( data->GetDimensions()[0] == 64 );
+	CHECK( data->GetDimensions()[1] == 32 );
+	CHECK( data->GetSpacing()[0] == Approx(0.5) );
+	CHECK( static_cast<unsigned char*>(data->GetScalarPointer())[0] == 10 );
+
+	ProbeDefinitionPtr readProbe = reader->takeChangedProbeDefinition();
+	REQUIRE( readProbe );
+	CHECK( readProbe->getType() == ProbeDefinition::tLINEAR );
+	CHECK( !reader->takeChangedProbeDefinition() );
+
+	CHECK( !reader->readLatest() ); // nothing new
+
+	// hold images: the first ones refer to shared memory, the rest are copied
+	std::vector<ImagePtr> images(1, image);
+	for (unsigned char i=11; i<16; ++i)
+	{
+		REQUIRE( writer.write(createTestFrame(i)) );
+		images.push_back(reader->readLatest());
+		REQUIRE( images.back() );
+		CHECK( static_cast<unsigned char*>(images.back()->getBaseVtkImageData()->GetScalarPointer())[0] == i );
+	}
+	CHECK( writer.getNumberOfDroppedFrames() == 0 );
+	CHECK( reader->getStatistics().mLockedBuffers == 2 );
+	CHECK( reader->getStatistics().mCopiedFrames == 4 );
+
+	images.clear();
+	image.reset();
+	data = vtkImageDataPtr();
+	CHECK( reader->getStatistics().mLockedBuffers == 0 );
+}
@@ -0,0 +1,139 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "catch.hpp"
+#include <vtkImageData.h>
+#include <vtkImageReslice.h>
+#include <vtkImageMapToColors.h>
+#include <vtkLookupTable.h>
+#include <vtkMatrix4x4.h>
+#include "cxSoftwareSlicer.h"
+#include "cxVolumeHelpers.h"
+#include "cxTransform3D.h"
+
+namespace
+{
+
+vtkImageDataPtr createTestVolume()
+{
+	vtkImageDataPtr raw = cx::generateVtkImageDataDouble(Eigen::Array3i(40, 30, 20), cx::Vector3D(0.5, 0.7, 1.1), 0);
+	double* ptr = static_cast<double*>(raw->GetScalarPointer());
+	for (int z=0; z<20; ++z)
+		for (int y=0; y<30; ++y)
+			for (int x=0; x<40; ++x)
+				*ptr++ = 2*x + 3*y + 4*z;
+	raw->Modified();
+	return raw;
+}
+
+vtkLookupTablePtr createGrayRamp()
+{
+	vtkLookupTablePtr lut = vtkLookupTablePtr::New();
+	lut->SetNumberOfTableValues(256);
+	lut->SetTableRange(0, 255);
+	for (int i=0; i<256; ++i)
+		lut->SetTableValue(i, i/255.0, i/255.0, i/255.0, 1);
+	return lut;
+}
+
+} // namespace
+
+TEST_CASE("SoftwareSlicer: Oblique slice equals vtkImageReslice and vtkImageMapToColors", "[unit][resource][core]")
+{
+	vtkImageDataPtr raw = createTestVolume();
+	vtkLookupTablePtr lut = createGrayRamp();
+	cx::Transform3D dMs = cx::createTransformTranslate(cx::Vector3D(10, 10, 10))
+			* cx::createTransformRotateX(0.3) * cx::createTransformRotateZ(0.5);
+	cx::Vector3D origin(-15, -12, 0);
+	cx::Vector3D spacing(0.4, 0.3, 1);
+	Eigen::Array3i dim(80, 90, 1);
+
+	cx::SoftwareSlicer slicer;
+	slicer.setInput(raw, lut, 0);
+	slicer.set_dMs(dMs);
+	slicer.setOutputFormat(origin, dim, spacing);
+	vtkImageDataPtr output = slicer.update();
+
+	vtkImageReslicePtr reslicer = vtkImageReslicePtr::New();
+	reslicer->SetInputData(raw);
+	reslicer->SetInterpolationModeToLinear();
+	reslicer->SetOutputDimensionality(2);
+	reslicer->SetResliceAxes(dMs.getVtkMatrix());
+	reslicer->SetOutputOrigin(origin.data());
+	reslicer->SetOutputSpacing(spacing.data());
+	reslicer->SetOutputExtent(0, dim[0]-1, 0, dim[1]-1, 0, 0);
+	reslicer->SetBackgroundLevel(0);
+	vtkImageMapToColorsPtr colors = vtkImageMapToColorsPtr::New();
+	colors->SetInputConnection(reslicer->GetOutputPort());
+	colors->SetLookupTable(lut);
+	colors->SetOutputFormatToRGBA();
+	colors->Update();
+	vtkImageDataPtr expected = colors->GetOutput();
+
+	REQUIRE(output->GetNumberOfScalarComponents() == 4);
+	REQUIRE(output->GetDimensions()[0] == expected->GetDimensions()[0]);
+	REQUIRE(output->GetDimensions()[1] == expected->GetDimensions()[1]);
+
+	int differing = 0;
+	int inside = 0;
+	unsigned char* a = static_cast<unsigned char*>(output->GetScalarPointer());
+	unsigned char* b = static_cast<unsigned char*>(expected->GetScalarPointer());
+	for (int i=0; i<dim[0]*dim[1]*4; ++i)
+	{
+		if (abs(int(a[i]) - int(b[i])) > 1)
+			++differing;
+		if ((i%4==0) && (a[i] > 0))
+			++inside;
+	}
+	CHECK(inside > dim[0]*dim[1]/10);
+	// allow a few differences at the volume border
+	CHECK(differing < dim[0]*dim[1]*4/100);
+}
+
+TEST_CASE("SoftwareSlicer: Output is reused between updates", "[unit][resource][core]")
+{
+	cx::SoftwareSlicer slicer;
+	slicer.setInput(createTestVolume(), createGrayRamp(), 0);
+	vtkImageDataPtr first = slicer.update();
+	int* dim = first->GetDimensions();
+	// automatic format covers the volume: 40x30 voxels of spacing (0.5,0.7)
+	CHECK(dim[0] == 40);
+	CHECK(dim[1] == 30);
+	unsigned char* ptr = static_cast<unsigned char*>(first->GetScalarPointer());
+	CHECK(int(ptr[4*(5 + 40*7)]) == 2*5 + 3*7);
+
+	slicer.set_dMs(cx::createTransformTranslate(cx::Vector3D(0, 0, 1.1)));
+	vtkImageDataPtr second = slicer.update();
+	CHECK(second == first);
+	CHECK(second->GetScalarPointer() == static_cast<void*>(ptr));
+	CHECK(int(ptr[4*(5 + 40*7)]) == 2*5 + 3*7 + 4);
+}
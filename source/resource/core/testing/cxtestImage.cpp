@@ -36,7 +36,15 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxDataLocations.h"
 #include "cxDataReaderWriter.h"
 #include "cxImageTF3D.h"
+#include "cxImageLUT2D.h"
 #include "cxTransferFunctions3DPresets.h"
+#include "cxTransform3D.h"
+#include "cxVolumeHelpers.h"
+#include "cxImageStatistics.h"
+#include "cxImagePyramid.h"
+#include "cxFileHelpers.h"
+#include <QDir>
+#include <QFile>
 
 #include "cxProfile.h"
 
@@ -248,4 +256,299 @@ TEST_CASE("Image: Changed initial window is kept after using addXml and parseXml
 	helper.checkInitialWindow(image, initialWindowWidth, initialWindowlevel);
 }
 
+TEST_CASE("Image: Load in background gives same image as direct load", "[unit][resource][core]")
+{
+	QString filename = cx::DataLocations::getTestDataPath()+"/Phantoms/Kaisa/MetaImage/Kaisa.mhd";
+	cx::ImagePtr image = readTestImage("kaisaTestImage", filename);
+	cx::ImagePtr backgroundImage = cx::Image::create("kaisaBackgroundImage", "kaisaBackgroundImage");
+	REQUIRE(cx::MetaImageReader().readIntoInBackground(backgroundImage, filename));
+
+	// bounds and spacing are known before the voxels
+	CHECK(cx::similar(backgroundImage->boundingBox(), image->boundingBox()));
+	CHECK(cx::similar(cx::Vector3D(backgroundImage->getSpacing()), cx::Vector3D(image->getSpacing())));
+
+	vtkImageDataPtr raw = backgroundImage->getBaseVtkImageData();
+	REQUIRE(raw);
+	CHECK(!backgroundImage->isLoadingInBackground());
+	CHECK(backgroundImage->getMax() == image->getMax());
+	CHECK(backgroundImage->getInitialWindowWidth() == Approx(image->getInitialWindowWidth()));
+	CHECK(cx::similar(backgroundImage->get_rMd(), image->get_rMd()));
+}
+
+TEST_CASE("Image: Saved transfer functions are kept when read during background load", "[unit][resource][core]")
+{
+	QString filename = cx::DataLocations::getTestDataPath()+"/Phantoms/Kaisa/MetaImage/Kaisa.mhd";
+	cx::ImagePtr image = readTestImage("kaisaTestImage", filename);
+	image->getLookupTable2D()->setWindow(123);
+	image->getLookupTable2D()->setLevel(45);
+	image->getTransferFunctions3D()->setWindow(321);
+	image->setShadingOn(!image->getShadingOn());
+
+	QDomDocument domdoc;
+	QDomElement node = domdoc.createElement("Image test");
+	image->addXml(node);
+
+	cx::ImagePtr backgroundImage = cx::Image::create("kaisaTestImage", "kaisaTestImage");
+	REQUIRE(backgroundImage->loadInBackground(filename));
+	backgroundImage->parseXml(node);
+	REQUIRE(backgroundImage->isLoadingInBackground());
+
+	cx::ImageLUT2DPtr lut = backgroundImage->getLookupTable2D();
+	CHECK(!backgroundImage->isLoadingInBackground());
+	CHECK(lut->getWindow() == Approx(123));
+	CHECK(lut->getLevel() == Approx(45));
+	CHECK(backgroundImage->getTransferFunctions3D()->getWindow() == Approx(321));
+	CHECK(backgroundImage->getShadingOn() == image->getShadingOn());
+}
+
+TEST_CASE("ImageStatistics: Range and histogram equals vtk", "[unit][resource][core]")
+{
+	vtkImageDataPtr raw = cx::generateVtkImageDataSignedShort(Eigen::Array3i(50, 40, 30), cx::Vector3D(1, 1, 1), 0);
+	short* ptr = static_cast<short*>(raw->GetScalarPointer());
+	for (int i=0; i<50*40*30; ++i)
+		ptr[i] = (i%1000) - 200;
+	raw->Modified();
+
+	cx::ImageStatisticsPtr statistics = cx::ImageStatistics::create(raw);
+	CHECK(statistics->getMin() == raw->GetScalarRange()[0]);
+	CHECK(statistics->getMax() == raw->GetScalarRange()[1]);
+	CHECK(statistics->getHistogramBinWidth() == 1);
+	REQUIRE(statistics->getHistogram().size() == 1000);
+	CHECK(statistics->getCount(-200) == 60);
+	CHECK(statistics->getCount(799) == 60);
+	CHECK(statistics->getCount(800) == 0);
+	CHECK(statistics->getPercentile(0.5) == Approx(299));
+	CHECK(statistics->getRGBMax() == 0);
+
+	CHECK(statistics->isValidFor(raw));
+	ptr[0] = 2000;
+	raw->Modified();
+	CHECK(!statistics->isValidFor(raw));
+}
+
+TEST_CASE("ImageStatistics: Float images get a binned histogram", "[unit][resource][core]")
+{
+	vtkImageDataPtr raw = cx::generateVtkImageDataDouble(Eigen::Array3i(100, 100, 10), cx::Vector3D(1, 1, 1), 0);
+	double* ptr = static_cast<double*>(raw->GetScalarPointer());
+	for (int i=0; i<100*100*10; ++i)
+		ptr[i] = 0.001*i;
+	raw->Modified();
+
+	cx::ImageStatisticsPtr statistics = cx::ImageStatistics::create(raw);
+	CHECK(statistics->getMin() == Approx(0));
+	CHECK(statistics->getMax() == Approx(99.999));
+	qint64 total = 0;
+	for (unsigned i=0; i<statistics->getHistogram().size(); ++i)
+		total += statistics->getHistogram()[i];
+	CHECK(total == 100*100*10);
+	CHECK(statistics->getPercentile(0.25) == Approx(25).epsilon(0.01));
+}
+
+TEST_CASE("Image: Statistics are reused until the data changes", "[unit][resource][core]")
+{
+	vtkImageDataPtr raw = cx::generateVtkImageData(Eigen::Array3i(20, 20, 20), cx::Vector3D(1, 1, 1), 0, 3);
+	unsigned char* ptr = static_cast<unsigned char*>(raw->GetScalarPointer());
+	ptr[30] = 90;
+	ptr[31] = 60;
+	ptr[32] = 30;
+	raw->Modified();
+	cx::ImagePtr image = cx::Image::create("statisticsImage", "statisticsImage");
+	image->setVtkImageData(raw);
+
+	cx::ImageStatisticsPtr statistics = image->getStatistics();
+	CHECK(image->getMax() == 60);
+	CHECK(image->getMin() == 0);
+	CHECK(image->getStatistics() == statistics);
+
+	ptr[31] = 180;
+	raw->Modified();
+	CHECK(image->getStatistics() != statistics);
+	CHECK(image->getMax() == 100);
+}
+
+TEST_CASE("ImagePyramid: Reduce halves resolution using box filter", "[unit][resource][core]")
+{
+	vtkImageDataPtr raw = cx::generateVtkImageDataSignedShort(Eigen::Array3i(5, 4, 3), cx::Vector3D(1, 2, 3), 0);
+	short* ptr = static_cast<short*>(raw->GetScalarPointer());
+	for (int i=0; i<5*4*3; ++i)
+		ptr[i] = i;
+
+	vtkImageDataPtr reduced = cx::ImagePyramid::reduce(raw);
+	int* dim = reduced->GetDimensions();
+	CHECK(dim[0] == 3);
+	CHECK(dim[1] == 2);
+	CHECK(dim[2] == 2);
+	CHECK(cx::similar(cx::Vector3D(reduced->GetSpacing()), cx::Vector3D(2, 4, 6)));
+	CHECK(cx::similar(cx::Vector3D(reduced->GetOrigin()), cx::Vector3D(0.5, 1, 1.5)));
+	// mean of x,y,z in {0,1}: (0+1+5+6+20+21+25+26)/8
+	CHECK(reduced->GetScalarComponentAsDouble(0, 0, 0, 0) == Approx(13));
+	// last x is clamped: (4+4+9+9+24+24+29+29)/8, rounded
+	CHECK(reduced->GetScalarComponentAsDouble(2, 0, 0, 0) == 17);
+
+	vtkImageDataPtr subsampled = cx::ImagePyramid::subsample(raw, 2);
+	CHECK(subsampled->GetDimensions()[0] == 3);
+	CHECK(subsampled->GetScalarComponentAsDouble(1, 1, 1, 0) == 2 + 2*5 + 2*20);
+}
+
+TEST_CASE("ImagePyramid: Levels are built in the background and cached on disk", "[unit][resource][core]")
+{
+	QString folder = cx::DataLocations::getTestDataPath() + "/temp/ImagePyramid/";
+	cx::removeNonemptyDirRecursively(folder);
+	QDir().mkpath(folder);
+	QString filename = folder + "pyramidImage.mhd";
+
+	vtkImageDataPtr raw = cx::generateVtkImageData(Eigen::Array3i(128, 128, 64), cx::Vector3D(1, 1, 1), 0);
+	unsigned char* ptr = static_cast<unsigned char*>(raw->GetScalarPointer());
+	for (int i=0; i<128*128*64; ++i)
+		ptr[i] = i%251;
+	raw->Modified();
+	cx::ImagePtr image = cx::Image::create("pyramidImage", "pyramidImage");
+	image->setVtkImageData(raw);
+	cx::MetaImageReader().saveImage(image, filename);
+
+	cx::ImagePyramidPtr pyramid = cx::ImagePyramid::create(raw, filename);
+	vtkImageDataPtr preview = pyramid->getLevelBelow(300000);
+	REQUIRE(preview);
+	CHECK(preview->GetNumberOfPoints() <= 300000);
+	pyramid->waitForBuild();
+
+	REQUIRE(pyramid->getNumberOfLevels() == 2);
+	vtkImageDataPtr level = pyramid->getLevelBelow(300000);
+	CHECK(level == pyramid->getLevel(1));
+	CHECK(level->GetNumberOfPoints() == 64*64*32);
+	CHECK(pyramid->getLevelBelow(0) == raw);
+	CHECK(cx::ImagePyramid::getCacheFiles(filename).size() == 3); // level mhd+raw, stamp
+
+	// the cache of another image sharing the prefix is not included
+	QFile other(folder + "pyramid/pyramidImage_level1_level1.mhd");
+	REQUIRE(other.open(QIODevice::WriteOnly));
+	other.close();
+	CHECK(cx::ImagePyramid::getCacheFiles(filename).size() == 3);
+
+	cx::ImagePyramidPtr cached = cx::ImagePyramid::create(raw, filename);
+	cached->build();
+	cached->waitForBuild();
+	REQUIRE(cached->getNumberOfLevels() == 2);
+	vtkImageDataPtr cachedLevel = cached->getLevel(1);
+	CHECK(cx::similar(cx::Vector3D(cachedLevel->GetOrigin()), cx::Vector3D(level->GetOrigin())));
+	CHECK(cachedLevel->GetScalarComponentAsDouble(10, 20, 5, 0) == level->GetScalarComponentAsDouble(10, 20, 5, 0));
+}
+
+TEST_CASE("ImagePyramid: Cache follows the image when saved to a new folder", "[unit][resource][core]")
+{
+	QString folder = cx::DataLocations::getTestDataPath() + "/temp/ImagePyramidSaveAs/";
+	cx::removeNonemptyDirRecursively(folder);
+	QDir().mkpath(folder);
+
+	vtkImageDataPtr raw = cx::generateVtkImageData(Eigen::Array3i(128, 128, 64), cx::Vector3D(1, 1, 1), 0);
+	unsigned char* ptr = static_cast<unsigned char*>(raw->GetScalarPointer());
+	for (int i=0; i<128*128*64; ++i)
+		ptr[i] = i%251;
+	raw->Modified();
+	cx::ImagePtr image = cx::Image::create("pyramidImage", "pyramidImage");
+	image->setVtkImageData(raw);
+
+	image->save(folder + "first");
+	cx::ImagePyramidPtr pyramid = image->getPyramid();
+	pyramid->build();
+	pyramid->waitForBuild();
+	REQUIRE(pyramid->getNumberOfLevels() == 2);
+	CHECK(cx::ImagePyramid::getCacheFiles(folder + "first/Images/pyramidImage.mhd").size() == 3);
+
+	image->save(folder + "second");
+	QString filename = folder + "second/Images/pyramidImage.mhd";
+	CHECK(image->getPyramid() == pyramid);
+	CHECK(cx::ImagePyramid::getCacheFiles(filename).size() == 3);
+
+	cx::ImagePyramidPtr cached = cx::ImagePyramid::create(raw, filename);
+	cached->build();
+	cached->waitForBuild();
+	REQUIRE(cached->getNumberOfLevels() == 2);
+	CHECK(cached->getLevel(1)->GetScalarComponentAsDouble(10, 20, 5, 0) == pyramid->getLevel(1)->GetScalarComponentAsDouble(10, 20, 5, 0));
+	CHECK(cx::ImagePyramid::readThumbnail(filename, Eigen::Array3i(128, 128, 64), Eigen::Array3d(1, 1, 1)));
+}
+
+TEST_CASE("ImagePyramid: Cache is keyed on the source contents", "[unit][resource][core]")
+{
+	QString folder = cx::DataLocations::getTestDataPath() + "/temp/ImagePyramidStamp/";
+	cx::removeNonemptyDirRecursively(folder);
+	QDir().mkpath(folder);
+	QString filename = folder + "pyramidImage.mhd";
+
+	vtkImageDataPtr raw = cx::generateVtkImageData(Eigen::Array3i(128, 128, 64), cx::Vector3D(1, 1, 1), 100);
+	cx::ImagePtr image = cx::Image::create("pyramidImage", "pyramidImage");
+	image->setVtkImageData(raw);
+	cx::MetaImageReader().saveImage(image, filename);
+
+	cx::ImagePyramidPtr pyramid = cx::ImagePyramid::create(raw, filename);
+	pyramid->build();
+	pyramid->waitForBuild();
+	REQUIRE(pyramid->getNumberOfLevels() == 2);
+
+	// mark the cached level, then save the source again: the mark must be read back.
+	QFile levelFile(folder + "pyramid/pyramidImage_level1.raw");
+	REQUIRE(levelFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+	levelFile.write(QByteArray(64*64*32, char(0)));
+	levelFile.close();
+	cx::MetaImageReader().saveImage(image, filename);
+
+	cx::ImagePyramidPtr cached = cx::ImagePyramid::create(raw, filename);
+	cached->build();
+	cached->waitForBuild();
+	REQUIRE(cached->getNumberOfLevels() == 2);
+	CHECK(cached->getLevel(1)->GetScalarComponentAsDouble(10, 20, 5, 0) == 0);
+
+	// new contents rebuild the levels.
+	unsigned char* ptr = static_cast<unsigned char*>(raw->GetScalarPointer());
+	for (int i=0; i<128*128*64; ++i)
+		ptr[i] = 7;
+	raw->Modified();
+
+	cx::ImagePyramidPtr rebuilt = cx::ImagePyramid::create(raw, filename);
+	rebuilt->build();
+	rebuilt->waitForBuild();
+	REQUIRE(rebuilt->getNumberOfLevels() == 2);
+	CHECK(rebuilt->getLevel(1)->GetScalarComponentAsDouble(10, 20, 5, 0) == 7);
+}
+
+TEST_CASE("ImagePyramid: Thumbnail is read from the cache while the image loads", "[unit][resource][core]")
+{
+	QString folder = cx::DataLocations::getTestDataPath() + "/temp/ImagePyramidThumbnail/";
+	cx::removeNonemptyDirRecursively(folder);
+	QDir().mkpath(folder);
+	QString filename = folder + "pyramidImage.mhd";
+
+	vtkImageDataPtr raw = cx::generateVtkImageData(Eigen::Array3i(128, 128, 64), cx::Vector3D(1, 1, 1), 100);
+	cx::ImagePtr image = cx::Image::create("pyramidImage", "pyramidImage");
+	image->setVtkImageData(raw);
+	cx::MetaImageReader().saveImage(image, filename);
+
+	Eigen::Array3i dim(128, 128, 64);
+	Eigen::Array3d spacing(1, 1, 1);
+	CHECK(!cx::ImagePyramid::readThumbnail(filename, dim, spacing)); // no cache yet
+
+	cx::ImagePyramidPtr pyramid = cx::ImagePyramid::create(raw, filename);
+	pyramid->build();
+	pyramid->waitForBuild();
+
+	cx::ImagePtr loaded = cx::Image::create("pyramidImage", "pyramidImage");
+	REQUIRE(loaded->loadInBackground(filename));
+	vtkImageDataPtr thumbnail = loaded->getThumbnail();
+	REQUIRE(thumbnail);
+	CHECK(thumbnail->GetNumberOfPoints() == 64*64*32);
+	CHECK(thumbnail->GetScalarComponentAsDouble(10, 20, 5, 0) == 100);
+	CHECK(loaded->resample(300000) == thumbnail);
+	CHECK(loaded->isLoadingInBackground());
+
+	CHECK(loaded->getBaseVtkImageData());
+	CHECK(!loaded->getThumbnail());
+
+	// a changed source file invalidates the thumbnail
+	QFile rawFile(folder + "pyramidImage.raw");
+	REQUIRE(rawFile.open(QIODevice::Append));
+	rawFile.write(QByteArray(1, char(0)));
+	rawFile.close();
+	CHECK(!cx::ImagePyramid::readThumbnail(filename, dim, spacing));
+}
+
 } // namespace cxtest
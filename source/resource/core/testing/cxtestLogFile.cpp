@@ -0,0 +1,134 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "catch.hpp"
+#include <QDir>
+#include <QFile>
+#include "internal/cxLogFile.h"
+#include "cxDataLocations.h"
+#include "cxFileHelpers.h"
+
+namespace cxtest
+{
+
+namespace
+{
+QString getTempLogFolder()
+{
+	QString folder = cx::DataLocations::getTestDataPath() + "/temp/LogFile/";
+	cx::removeNonemptyDirRecursively(folder);
+	QDir().mkpath(folder);
+	return folder;
+}
+
+void appendToFile(QString filename, QString text)
+{
+	QFile file(filename);
+	file.open(QFile::WriteOnly | QFile::Append);
+	file.write(text.toLocal8Bit());
+}
+
+cx::Message createMessage(int index)
+{
+	cx::Message message(QString("message %1").arg(index), cx::mlINFO);
+	message.mThread = "main";
+	message.mSourceFile = "cxtestLogFile.cpp";
+	message.mSourceLine = index;
+	message.mSourceFunction = "createMessage()";
+	return message;
+}
+}
+
+TEST_CASE("LogFile: Reads written messages incrementally", "[unit][resource][core]")
+{
+	QString folder = getTempLogFolder();
+	cx::LogFile output = cx::LogFile::fromChannel(folder, "test");
+	cx::LogFile input = cx::LogFile::fromFilename(output.getFilename());
+
+	output.writeHeader();
+	output.write(createMessage(0));
+	output.write(createMessage(1));
+
+	std::vector<cx::Message> messages = input.readMessages();
+	REQUIRE(messages.size() == 3); // session start and two messages
+	CHECK(messages[0].getMessageLevel() == cx::mlSUCCESS);
+	CHECK(messages[1].getText().trimmed() == "message 0");
+	CHECK(messages[2].getText().trimmed() == "message 1");
+	CHECK(messages[2].getMessageLevel() == cx::mlINFO);
+	CHECK(messages[2].mThread == "main");
+	CHECK(messages[2].mSourceFile == "cxtestLogFile.cpp");
+	CHECK(messages[2].mSourceLine == 1);
+	CHECK(messages[2].mSourceFunction == "createMessage()");
+	CHECK(messages[2].getTimeStamp().date() == QDate::currentDate());
+
+	CHECK(input.readMessages().empty());
+
+	// incomplete lines are read when completed
+	output.write(createMessage(2));
+	appendToFile(output.getFilename(), "[12:13:14.156]\t[main]\t\t\t[INFO] part");
+	messages = input.readMessages();
+	REQUIRE(messages.size() == 1);
+	CHECK(messages[0].getText().trimmed() == "message 2");
+
+	appendToFile(output.getFilename(), "ial\nsecond line\n");
+	messages = input.readMessages();
+	REQUIRE(messages.size() == 1);
+	CHECK(messages[0].getText() == " partial\nsecond line");
+	CHECK(messages[0].getTimeStamp().time() == QTime(12, 13, 14, 156));
+}
+
+TEST_CASE("LogFile: Initial read is limited to the last messages", "[unit][resource][core]")
+{
+	QString folder = getTempLogFolder();
+	cx::LogFileWriterPtr writer(new cx::LogFileWriter());
+	cx::LogFile output = cx::LogFile::fromChannel(folder, "test", writer);
+
+	output.writeHeader();
+	for (int i=0; i<100000; ++i)
+		output.write(createMessage(i));
+	writer->flush();
+
+	cx::LogFile input = cx::LogFile::fromFilename(output.getFilename());
+	input.setMaxInitialMessages(10);
+	std::vector<cx::Message> messages = input.readMessages();
+	REQUIRE(messages.size() == 10);
+	CHECK(messages.front().getText().trimmed() == "message 99990");
+	CHECK(messages.back().getText().trimmed() == "message 99999");
+	CHECK(messages.back().getTimeStamp().date() == QDate::currentDate());
+
+	output.write(createMessage(100000));
+	writer->flush();
+	messages = input.readMessages();
+	REQUIRE(messages.size() == 1);
+	CHECK(messages[0].getText().trimmed() == "message 100000");
+}
+
+} // namespace cxtest
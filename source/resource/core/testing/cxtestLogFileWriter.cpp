@@ -0,0 +1,117 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "catch.hpp"
+#include <QDir>
+#include <QFile>
+#include "internal/cxLogFileWriter.h"
+#include "cxDataLocations.h"
+#include "cxFileHelpers.h"
+
+namespace cxtest
+{
+
+namespace
+{
+QString getTempLogFilename()
+{
+	QString folder = cx::DataLocations::getTestDataPath() + "/temp/LogFileWriter/";
+	cx::removeNonemptyDirRecursively(folder);
+	QDir().mkpath(folder);
+	return folder + "org.custusx.log.test.txt";
+}
+
+QString readFile(QString filename)
+{
+	QFile file(filename);
+	file.open(QIODevice::ReadOnly);
+	return file.readAll();
+}
+}
+
+TEST_CASE("LogFileWriter: Buffers text until threshold or flush", "[unit][resource][core]")
+{
+	QString filename = getTempLogFilename();
+	cx::LogFileWriter writer;
+	writer.setFlushThreshold(100, 100000);
+
+	writer.write(filename, "line 1\n");
+	CHECK(readFile(filename).isEmpty());
+	CHECK(writer.getBacklog() == 7);
+
+	writer.write(filename, "error\n", true);
+	CHECK(readFile(filename) == "line 1\nerror\n");
+	CHECK(writer.getBacklog() == 0);
+
+	writer.write(filename, QString(100, 'x'));
+	CHECK(readFile(filename).size() == 113);
+	CHECK(writer.getBacklog() == 0);
+}
+
+TEST_CASE("LogFileWriter: Rotates large files and repeats the header", "[unit][resource][core]")
+{
+	QString filename = getTempLogFilename();
+	cx::LogFileWriter writer;
+	writer.setFlushThreshold(0, 0);
+	writer.setMaxFileSize(100);
+	writer.setMaxRotatedFiles(2);
+
+	writer.writeHeader(filename, "header\n");
+	for (int i=0; i<10; ++i)
+		writer.write(filename, QString("%1 %2\n").arg(i).arg(QString(40, 'x')));
+	writer.close();
+
+	CHECK(writer.getRotationCount() > 2);
+	CHECK(QFile::exists(cx::LogFileWriter::getRotatedFilename(filename, 1)));
+	CHECK(QFile::exists(cx::LogFileWriter::getRotatedFilename(filename, 2)));
+	CHECK(!QFile::exists(cx::LogFileWriter::getRotatedFilename(filename, 3)));
+
+	QString text = readFile(filename);
+	CHECK(text.size() <= 100);
+	CHECK(text.startsWith("header\n"));
+	CHECK(text.endsWith(QString("9 %1\n").arg(QString(40, 'x'))));
+}
+
+TEST_CASE("LogFileWriter: Drops text when backlog is full", "[unit][resource][core]")
+{
+	QString filename = getTempLogFilename() + "/invalid/file.txt"; // cannot be written
+	cx::LogFileWriter writer;
+	writer.setFlushThreshold(10, 100000);
+	writer.setMaxBacklog(100);
+
+	for (int i=0; i<20; ++i)
+		writer.write(filename, "0123456789");
+
+	CHECK(writer.getBacklog() == 100);
+	CHECK(writer.getDropCount() == 10);
+}
+
+} // namespace cxtest
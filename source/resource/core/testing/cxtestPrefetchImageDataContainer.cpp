@@ -0,0 +1,142 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "catch.hpp"
+#include <vtkImageData.h>
+#include "cxPrefetchImageDataContainer.h"
+#include "cxVolumeHelpers.h"
+
+namespace cxtest
+{
+
+namespace
+{
+/** Frames in memory, but presented as a container read from file.
+  */
+class FileFramesContainerMock : public cx::ImageDataContainer
+{
+public:
+	FileFramesContainerMock(std::vector<vtkImageDataPtr> frames) : mFrames(frames) {}
+	virtual vtkImageDataPtr get(unsigned index) { return mFrames[index]; }
+	virtual unsigned size() const { return mFrames.size(); }
+private:
+	std::vector<vtkImageDataPtr> mFrames;
+};
+
+std::vector<vtkImageDataPtr> createFrameList(int count)
+{
+	std::vector<vtkImageDataPtr> frames;
+	for (int i=0; i<count; ++i)
+		frames.push_back(cx::generateVtkImageData(Eigen::Array3i(4,3,1), cx::Vector3D(1,1,1), i));
+	return frames;
+}
+
+cx::ImageDataContainerPtr createFrames(int count)
+{
+	return cx::ImageDataContainerPtr(new FileFramesContainerMock(createFrameList(count)));
+}
+
+int getValue(vtkImageDataPtr frame)
+{
+	return *static_cast<unsigned char*>(frame->GetScalarPointer());
+}
+}
+
+TEST_CASE("PrefetchImageDataContainer: Returns copies of the base frames", "[unit][resource][core]")
+{
+	cx::ImageDataContainerPtr base = createFrames(20);
+	cx::PrefetchImageDataContainer frames(base, 10, 4);
+
+	REQUIRE(frames.size() == 20);
+	for (unsigned i=0; i<frames.size(); ++i)
+	{
+		vtkImageDataPtr frame = frames.get(i);
+		REQUIRE(frame);
+		CHECK(getValue(frame) == int(i));
+		CHECK(frame.GetPointer() != base->get(i).GetPointer());
+	}
+	CHECK(!frames.get(20));
+}
+
+TEST_CASE("PrefetchImageDataContainer: Frames held in memory are returned directly", "[unit][resource][core]")
+{
+	cx::ImageDataContainerPtr base(new cx::FramesDataContainer(createFrameList(20)));
+	cx::PrefetchImageDataContainer frames(base, 10, 4);
+
+	REQUIRE(frames.size() == 20);
+	CHECK(frames.get(5).GetPointer() == base->get(5).GetPointer());
+	frames.waitForPendingLoads();
+	CHECK(frames.getNumberOfCachedFrames() == 0);
+	CHECK(frames.getNumberOfMisses() == 0);
+}
+
+TEST_CASE("PrefetchImageDataContainer: Reads ahead in the direction of access", "[unit][resource][core]")
+{
+	cx::PrefetchImageDataContainer frames(createFrames(100), 10, 4);
+
+	frames.get(50);
+	frames.waitForPendingLoads();
+	for (unsigned i=50; i<=54; ++i)
+		CHECK(frames.isCached(i));
+	CHECK(!frames.isCached(55));
+
+	frames.get(49);
+	frames.waitForPendingLoads();
+	for (unsigned i=45; i<=49; ++i)
+		CHECK(frames.isCached(i));
+	CHECK(!frames.isCached(44));
+	CHECK(frames.getNumberOfMisses() == 2);
+
+	// sequential access backwards is served from the read-ahead
+	for (int i=48; i>=0; --i)
+	{
+		frames.waitForPendingLoads();
+		CHECK(getValue(frames.get(i)) == i);
+	}
+	CHECK(frames.getNumberOfMisses() == 2);
+}
+
+TEST_CASE("PrefetchImageDataContainer: Keeps a bounded number of frames", "[unit][resource][core]")
+{
+	cx::PrefetchImageDataContainer frames(createFrames(100), 10, 4);
+
+	for (unsigned i=0; i<100; i+=7)
+		frames.get(i);
+	frames.waitForPendingLoads();
+	CHECK(frames.getNumberOfCachedFrames() <= 10);
+
+	// the most recently used frame survives eviction
+	CHECK(frames.isCached(98));
+	CHECK(frames.purge(98));
+	CHECK(!frames.isCached(98));
+}
+
+} // namespace cxtest
@@ -0,0 +1,106 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "catch.hpp"
+#include "cxSpaceProviderImpl.h"
+#include "cxDummyToolManager.h"
+#include "cxDummyTool.h"
+#include "cxRegistrationTransform.h"
+#include "cxtestPatientModelServiceMock.h"
+
+namespace cxtest
+{
+
+TEST_CASE("SpaceProviderImpl: Cached transforms follow tool and rMpr changes", "[unit][resource][core]")
+{
+	cx::PatientModelServicePtr patientModel(new PatientModelServiceMock());
+	cx::DummyToolManager::DummyToolManagerPtr trackingService = cx::DummyToolManager::create();
+	cx::SpaceProviderImpl spaceProvider(trackingService, patientModel);
+	cx::DummyToolPtr tool = boost::dynamic_pointer_cast<cx::DummyTool>(trackingService->getTool("dummytool"));
+	REQUIRE(tool);
+
+	cx::CoordinateSystem t(cx::csTOOL, tool->getUid());
+	cx::CoordinateSystem pr = cx::CoordinateSystem::patientReference();
+	cx::CoordinateSystem r = cx::CoordinateSystem::reference();
+
+	tool->set_prMt(cx::createTransformTranslate(cx::Vector3D(1,2,3)));
+	CHECK(cx::similar(spaceProvider.get_toMfrom(t, pr), cx::createTransformTranslate(cx::Vector3D(1,2,3))));
+
+	// second lookup is served from the cache
+	spaceProvider.resetCacheStatistics();
+	spaceProvider.get_toMfrom(t, pr);
+	CHECK(spaceProvider.getCacheHits() == 2);
+	CHECK(spaceProvider.getCacheMisses() == 0);
+
+	// tool movement invalidates the tool space
+	tool->set_prMt(cx::createTransformTranslate(cx::Vector3D(4,5,6)));
+	CHECK(cx::similar(spaceProvider.get_toMfrom(t, pr), cx::createTransformTranslate(cx::Vector3D(4,5,6))));
+
+	// registration invalidates all spaces
+	patientModel->get_rMpr_History()->setRegistration(cx::createTransformTranslate(cx::Vector3D(0,0,10)));
+	CHECK(cx::similar(spaceProvider.get_toMfrom(t, r), cx::createTransformTranslate(cx::Vector3D(4,5,16))));
+
+	// continuous registration changes rMpr without signals
+	patientModel->get_rMpr_History()->blockSignals(true);
+	patientModel->get_rMpr_History()->setRegistration(cx::createTransformTranslate(cx::Vector3D(0,0,20)));
+	patientModel->get_rMpr_History()->blockSignals(false);
+	CHECK(cx::similar(spaceProvider.get_toMfrom(t, r), cx::createTransformTranslate(cx::Vector3D(4,5,26))));
+}
+
+TEST_CASE("SpaceProviderImpl: Bulk lookup equals single lookups", "[unit][resource][core]")
+{
+	cx::PatientModelServicePtr patientModel(new PatientModelServiceMock());
+	cx::DummyToolManager::DummyToolManagerPtr trackingService = cx::DummyToolManager::create();
+	cx::SpaceProviderImpl spaceProvider(trackingService, patientModel);
+	cx::DummyToolPtr tool = boost::dynamic_pointer_cast<cx::DummyTool>(trackingService->getTool("dummytool"));
+	REQUIRE(tool);
+	tool->set_prMt(cx::createTransformTranslate(cx::Vector3D(1,2,3)) * cx::createTransformRotateZ(0.3));
+	patientModel->get_rMpr_History()->setRegistration(cx::createTransformRotateX(0.2));
+
+	std::vector<cx::CoordinateSystem> from;
+	from.push_back(cx::CoordinateSystem(cx::csTOOL, tool->getUid()));
+	from.push_back(cx::CoordinateSystem(cx::csTOOL_OFFSET, tool->getUid()));
+	from.push_back(cx::CoordinateSystem(cx::csSENSOR, tool->getUid()));
+	from.push_back(cx::CoordinateSystem::patientReference());
+	from.push_back(cx::CoordinateSystem::reference());
+	cx::CoordinateSystem to(cx::csTOOL, tool->getUid());
+
+	std::vector<cx::Transform3D> bulk = spaceProvider.get_toMfrom(from, to);
+	REQUIRE(bulk.size() == from.size());
+	for (unsigned i=0; i<from.size(); ++i)
+	{
+		INFO("space " << from[i].toString().toStdString());
+		CHECK(cx::similar(bulk[i], spaceProvider.get_toMfrom(from[i], to)));
+	}
+	CHECK(cx::similar(bulk[0], cx::Transform3D::Identity()));
+}
+
+} // namespace cxtest
@@ -0,0 +1,190 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+#include "catch.hpp"
+#include <iterator>
+#include <QDir>
+#include "cxTimedTransformStore.h"
+#include "cxPositionStorageFile.h"
+#include "cxDataLocations.h"
+#include "cxFileHelpers.h"
+
+namespace cxtest
+{
+
+namespace
+{
+cx::Transform3D createSampleTransform(int i)
+{
+	return cx::createTransformTranslate(cx::Vector3D(i, 2*i, 3)) * cx::createTransformRotateZ(0.01*i) * cx::createTransformRotateX(0.02*i);
+}
+
+QString getTempPositionsFilename()
+{
+	QString folder = cx::DataLocations::getTestDataPath() + "/temp/TimedTransformStore/";
+	cx::removeNonemptyDirRecursively(folder);
+	QDir().mkpath(folder);
+	return folder + "toolpositions.snwpos";
+}
+}
+
+TEST_CASE("TimedTransformStore: Lookups match std::map for samples added in any order", "[unit][resource][core]")
+{
+	cx::TimedTransformStore store;
+	cx::TimedTransformMap expected;
+
+	// append most samples, insert some in the middle and overwrite some.
+	for (int i=0; i<2000; ++i)
+	{
+		int t = (i%7==3) ? (i*10 - 5005) : (i*10);
+		store.set(t, createSampleTransform(i));
+		expected[t] = createSampleTransform(i);
+	}
+	store.set(100, createSampleTransform(-1));
+	expected[100] = createSampleTransform(-1);
+
+	REQUIRE(store.size() == expected.size());
+	double times[] = { -100000, 0, 3, 10, 4995, 5000, 10010, 19990, 100000 };
+	for (unsigned i=0; i<sizeof(times)/sizeof(double); ++i)
+	{
+		double t = times[i];
+		INFO("t=" << t);
+		CHECK(store.lowerBound(t) == unsigned(std::distance(expected.begin(), expected.lower_bound(t))));
+		CHECK(store.upperBound(t) == unsigned(std::distance(expected.begin(), expected.upper_bound(t))));
+	}
+
+	cx::TimedTransformMap range = store.getRange(4000, 6000).toMap();
+	cx::TimedTransformMap expectedRange(expected.lower_bound(4000), expected.upper_bound(6000));
+	REQUIRE(range.size() == expectedRange.size());
+	for (cx::TimedTransformMap::iterator iter=expectedRange.begin(); iter!=expectedRange.end(); ++iter)
+		CHECK(cx::similar(range[iter->first], iter->second));
+}
+
+TEST_CASE("TimedTransformStore: Non-rigid transforms are stored unchanged", "[unit][resource][core]")
+{
+	cx::TimedTransformStore store;
+	cx::Transform3D scaled = createSampleTransform(5) * cx::createTransformScale(cx::Vector3D(1, 2, 3));
+	store.set(1, createSampleTransform(1));
+	store.set(2, scaled);
+
+	cx::Transform3D result;
+	REQUIRE(store.find(2, &result));
+	CHECK(cx::similar(result, scaled));
+	REQUIRE(store.find(1, &result));
+	CHECK(cx::similar(result, createSampleTransform(1)));
+	CHECK(!store.find(3, &result));
+}
+
+TEST_CASE("TimedTransformStore: Positions are loaded from file only when used", "[unit][resource][core]")
+{
+	QString filename = getTempPositionsFilename();
+	unsigned count = 3*cx::PositionStorageIndex::mMaxBlockCount;
+	{
+		cx::PositionStorageWriter writer(filename);
+		for (unsigned i=0; i<count; ++i)
+			writer.write(createSampleTransform(i), 1000+10*i, "tool");
+	}
+
+	std::vector<cx::PositionStorageBlock> blocks = cx::PositionStorageIndex::load(filename);
+	REQUIRE(blocks.size() == 3);
+	CHECK(blocks[0].mToolUid == "tool");
+	CHECK(blocks[0].mCount == cx::PositionStorageIndex::mMaxBlockCount);
+	// the index written by the writer equals a new scan of the file
+	std::vector<cx::PositionStorageBlock> scanned = cx::PositionStorageIndex::scan(filename, cx::PositionStorageIndex::mPositionsHeaderSize, "");
+	REQUIRE(scanned.size() == blocks.size());
+	CHECK(scanned.back().getEnd() == blocks.back().getEnd());
+
+	cx::TimedTransformStore store;
+	for (unsigned i=0; i<blocks.size(); ++i)
+		store.addFileBlock(filename, blocks[i]);
+	CHECK(store.getLoadedSize() == 0);
+	CHECK(store.getFirstTimestamp() == 1000);
+	CHECK(store.getLastTimestamp() == 1000+10*(count-1));
+
+	cx::TimedTransformRange range = store.getRange(1000+10*1500, 1000+10*1510);
+	CHECK(store.getLoadedSize() == cx::PositionStorageIndex::mMaxBlockCount);
+	REQUIRE(range.size() == 11);
+	CHECK(cx::similar(range.getTransform(0), createSampleTransform(1500)));
+
+	CHECK(store.size() == count);
+}
+
+TEST_CASE("TimedTransformStore: Time spans are found without loading positions", "[unit][resource][core]")
+{
+	QString filename = getTempPositionsFilename();
+	unsigned count = 2*cx::PositionStorageIndex::mMaxBlockCount;
+	{
+		cx::PositionStorageWriter writer(filename);
+		for (unsigned i=0; i<count; ++i)
+			writer.write(createSampleTransform(i), 1000+10*i, "tool");
+	}
+
+	cx::TimedTransformStore store;
+	std::vector<cx::PositionStorageBlock> blocks = cx::PositionStorageIndex::load(filename);
+	for (unsigned i=0; i<blocks.size(); ++i)
+		store.addFileBlock(filename, blocks[i]);
+	store.set(100000, createSampleTransform(0));
+	store.set(100005, createSampleTransform(1));
+
+	std::vector<std::pair<double, double> > spans = store.getTimeSpans(200);
+	CHECK(store.getLoadedSize() == 2);
+	REQUIRE(spans.size() == 2);
+	CHECK(spans[0].first == 1000);
+	CHECK(spans[0].second == 1000+10*(count-1));
+	CHECK(spans[1].first == 100000);
+	CHECK(spans[1].second == 100005);
+}
+
+TEST_CASE("PositionStorageIndex: Index is rebuilt for files without index", "[unit][resource][core]")
+{
+	QString filename = getTempPositionsFilename();
+	{
+		cx::PositionStorageWriter writer(filename);
+		for (unsigned i=0; i<10; ++i)
+			writer.write(createSampleTransform(i), 1000+10*i, (i<5) ? "tool1" : "tool2");
+	}
+	QFile::remove(cx::PositionStorageIndex::getFilename(filename));
+
+	std::vector<cx::PositionStorageBlock> blocks = cx::PositionStorageIndex::load(filename);
+	REQUIRE(blocks.size() == 2);
+	CHECK(blocks[1].mToolUid == "tool2");
+	CHECK(blocks[1].mStartTime == 1050);
+	CHECK(cx::PositionStorageIndex::read(cx::PositionStorageIndex::getFilename(filename)).size() == 2);
+
+	std::vector<double> timestamps;
+	std::vector<cx::Transform3D> transforms;
+	cx::PositionStorageReader reader(filename);
+	REQUIRE(reader.read(blocks[1], &timestamps, &transforms));
+	REQUIRE(timestamps.size() == 5);
+	CHECK(cx::similar(transforms[0], createSampleTransform(5)));
+}
+
+} // namespace cxtest
@@ -32,6 +32,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "catch.hpp"
 #include "cxTrackingPositionFilter.h"
+#include "cxTypeConversions.h"
+#include <QElapsedTimer>
+#include "cxtestJenkinsMeasurement.h"
 
 namespace cxtest
 {
@@ -76,6 +79,57 @@ TEST_CASE("TrackingPositionFilter: Check if interpolation is correct", "[unit]")
 	//CHECK(cx::similar(expected, result));
 }
 
+TEST_CASE("TrackingPositionFilter: Filtered position follows a slow movement", "[unit]")
+{
+	cx::TrackingPositionFilter filter;
+	for (int i = 0; i < 1000; i++)
+		filter.addPosition(cx::createTransformTranslate(cx::Vector3D(0.01*i, 1, 2)), i*4);
+
+	// low pass filter delays the movement slightly
+	cx::Vector3D expected(0.01*999, 1, 2);
+	cx::Vector3D result = filter.getFilteredPosition().translation();
+	INFO(expected << " == " << result);
+	CHECK(cx::similar(expected, result, 0.5));
+}
+
+TEST_CASE("Speed: TrackingPositionFilter uses constant time per sample over 10 hours at 250Hz with 8 tools", "[speed][integration]")
+{
+	const int numberOfTools = 8;
+	const double rate = 250; // Hz
+	const int hours = 10;
+	const int samplesPerHour = 3600*rate;
+
+	std::vector<cx::TrackingPositionFilterPtr> filters;
+	for (int tool=0; tool<numberOfTools; ++tool)
+		filters.push_back(cx::TrackingPositionFilterPtr(new cx::TrackingPositionFilter()));
+	std::vector<double> timePerSample; // ns, for each hour
+	cx::Transform3D pos = cx::Transform3D::Identity();
+
+	for (int hour=0; hour<hours; ++hour)
+	{
+		QElapsedTimer timer;
+		timer.start();
+		for (int i=0; i<samplesPerHour; ++i)
+		{
+			double timestamp = (double(hour)*samplesPerHour + i) * 1000/rate;
+			for (int tool=0; tool<numberOfTools; ++tool)
+			{
+				pos.translation() = cx::Vector3D(sin(timestamp/1000+tool), cos(timestamp/1000), tool);
+				filters[tool]->addPosition(pos, timestamp);
+				filters[tool]->getFilteredPosition();
+			}
+		}
+		timePerSample.push_back(double(timer.nsecsElapsed())/samplesPerHour/numberOfTools);
+		std::cout << QString("TrackingPositionFilter hour %1: %2 ns/sample").arg(hour).arg(timePerSample.back()) << std::endl;
+	}
+
+	// The filter holds no history, thus the time per sample must not grow.
+	// Allow some slack for machine noise.
+	CHECK(timePerSample.back() < 3*timePerSample.front());
+
+	JenkinsMeasurement jenkins;
+	jenkins.createOutput("TrackingPositionFilter_ns_per_sample", QString::number(timePerSample.back()));
+}
 
 } // namespace cx
 
@@ -36,6 +36,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QFile>
 #include <QFileInfo>
 #include <QTextStream>
+#include <QRunnable>
+#include <algorithm>
+#include <cstring>
 
 #include <vtkImageChangeInformation.h>
 #include <vtkImageLuminance.h>
@@ -53,23 +56,98 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace cx
 {
 
+namespace
+{
+qint64 getImageSize(vtkImageDataPtr image)
+{
+	int* dim = image->GetDimensions();
+	return qint64(dim[0]) * dim[1] * dim[2] * image->GetNumberOfScalarComponents() * image->GetScalarSize();
+}
+
+bool hasSameFormat(vtkImageDataPtr a, vtkImageDataPtr b)
+{
+	int* ea = a->GetExtent();
+	int* eb = b->GetExtent();
+	return std::equal(ea, ea+6, eb)
+			&& (a->GetScalarType()==b->GetScalarType())
+			&& (a->GetNumberOfScalarComponents()==b->GetNumberOfScalarComponents());
+}
+} // namespace
+
+VideoRecorderSaveStatistics::VideoRecorderSaveStatistics() :
+	mBacklogFrames(0),
+	mBacklogBytes(0),
+	mWrittenFrames(0),
+	mInputRate(0),
+	mWriteRate(0)
+{
+}
+
+void VideoRecorderSaveStatistics::add(const VideoRecorderSaveStatistics& other)
+{
+	mBacklogFrames += other.mBacklogFrames;
+	mBacklogBytes += other.mBacklogBytes;
+	mWrittenFrames += other.mWrittenFrames;
+	mInputRate += other.mInputRate;
+	mWriteRate += other.mWriteRate;
+}
+
+double VideoRecorderSaveStatistics::getSecondsUntilBacklogReaches(qint64 maxBytes) const
+{
+	if (mBacklogBytes >= maxBytes)
+		return 0;
+	double growth = mInputRate - mWriteRate;
+	if ((growth <= 0) || (mBacklogFrames==0))
+		return -1;
+	double bytesPerFrame = double(mBacklogBytes) / mBacklogFrames;
+	return (maxBytes - mBacklogBytes) / (growth * bytesPerFrame);
+}
+
+///--------------------------------------------------------
+///--------------------------------------------------------
+
+/** Process one frame in the worker pool.
+  */
+class VideoRecorderSaveThread::Job : public QRunnable
+{
+public:
+	Job(VideoRecorderSaveThread* base, DataType data) : mBase(base), mData(data) {}
+	virtual void run() { mBase->process(mData); }
+private:
+	VideoRecorderSaveThread* mBase;
+	DataType mData;
+};
+
 VideoRecorderSaveThread::VideoRecorderSaveThread(QObject* parent, QString saveFolder, QString prefix, bool compressed, bool writeColor) :
 	QThread(parent),
 	mSaveFolder(saveFolder),
 	mPrefix(prefix),
 	mImageIndex(0),
-	mMutex(QMutex::Recursive),
+	mNextIndex(0),
+	mProcessingFrames(0),
 	mStop(false),
 	mCancel(false),
+	mAddedFramesAtRate(0),
+	mWrittenFramesAtRate(0),
+	mAddedFrames(0),
 	mTimestampsFile(saveFolder+"/"+prefix+".fts"),
 	mCompressed(compressed),
-	mWriteColor(writeColor)
+	mWriteColor(writeColor),
+	mSingleFile(false)
 {
 	this->setObjectName("org.custusx.resource.videorecordersave"); // becomes the thread name
+	this->setNumberOfWorkers(QThread::idealThreadCount());
+	mRateTimer.start();
 }
 
 VideoRecorderSaveThread::~VideoRecorderSaveThread()
 {
+	mWorkers.waitForDone();
+}
+
+void VideoRecorderSaveThread::setNumberOfWorkers(int count)
+{
+	mWorkers.setMaxThreadCount(std::max(count, 1));
 }
 
 QString VideoRecorderSaveThread::addData(TimeInfo timestamp, vtkImageDataPtr image)
@@ -77,29 +155,129 @@ QString VideoRecorderSaveThread::addData(TimeInfo timestamp, vtkImageDataPtr ima
 	if (!image)
 		return "";
 
+	if (mImageIndex==0)
+	{
+		// use a single file if possible, i.e. uncompressed 2D frames.
+		mFrameFormat = MappedFramesFileInfo::fromFrame(image);
+		mSingleFile = !mCompressed && MappedFramesFileWriter(this->getSingleFilename()).accepts(image);
+	}
+
 	DataType data;
+	data.mSingleFile = mSingleFile;
+	if (mSingleFile)
+	{
+		if (!mFrameFormat.isCompatible(image))
+		{
+			reportWarning(QString("Frame format changed during recording, ignoring frame %1").arg(mImageIndex));
+			return "";
+		}
+		data.mImageFilename = this->getSingleFilename();
+	}
+	else
+	{
+		data.mImageFilename = QString("%1/%2_%3.mhd").arg(mSaveFolder).arg(mPrefix).arg(mImageIndex);
+	}
+	data.mIndex = mImageIndex;
+	++mImageIndex;
+
 	data.mTimestamp = timestamp;
-	data.mImage = vtkImageDataPtr::New();
-	data.mImage->DeepCopy(image);
-	data.mImageFilename = QString("%1/%2_%3.mhd").arg(mSaveFolder).arg(mPrefix).arg(mImageIndex++);
+	data.mImage = this->copyToBuffer(image);
+	data.mSize = getImageSize(data.mImage);
 
 	{
 		QMutexLocker sentry(&mMutex);
 		mPendingData.push_back(data);
+		++mAddedFrames;
+		++mStatistics.mBacklogFrames;
+		mStatistics.mBacklogBytes += data.mSize;
+		mWakeup.wakeAll();
 	}
 
 	return data.mImageFilename;
 }
 
+/** Copy image into a buffer from the pool of written frames,
+  * or a new buffer if none have the correct format.
+  */
+vtkImageDataPtr VideoRecorderSaveThread::copyToBuffer(vtkImageDataPtr image)
+{
+	vtkImageDataPtr buffer;
+	{
+		QMutexLocker sentry(&mMutex);
+		for (std::list<vtkImageDataPtr>::iterator iter=mFreeBuffers.begin(); iter!=mFreeBuffers.end(); ++iter)
+		{
+			if (hasSameFormat(*iter, image))
+			{
+				buffer = *iter;
+				mFreeBuffers.erase(iter);
+				break;
+			}
+		}
+	}
+
+	if (!buffer)
+	{
+		buffer = vtkImageDataPtr::New();
+		buffer->DeepCopy(image);
+		return buffer;
+	}
+
+	buffer->SetSpacing(image->GetSpacing());
+	buffer->SetOrigin(image->GetOrigin());
+	memcpy(buffer->GetScalarPointer(), image->GetScalarPointer(), getImageSize(image));
+	buffer->Modified();
+	return buffer;
+}
+
+/** Return a frame buffer to the pool. The frame must have been completed.
+  */
+void VideoRecorderSaveThread::releaseBuffer(vtkImageDataPtr buffer)
+{
+	if (!buffer)
+		return;
+
+	QMutexLocker sentry(&mMutex);
+	// keep enough buffers for the frames in the workers and the next few added.
+	size_t maxFreeBuffers = 2*mWorkers.maxThreadCount();
+	if (mFreeBuffers.size() < maxFreeBuffers)
+		mFreeBuffers.push_back(buffer);
+}
+
+QString VideoRecorderSaveThread::getSingleFilename() const
+{
+	return QString("%1/%2.mhd").arg(mSaveFolder).arg(mPrefix);
+}
+
 void VideoRecorderSaveThread::stop()
 {
+	QMutexLocker sentry(&mMutex);
 	mStop = true;
+	mWakeup.wakeAll();
 }
 
 void VideoRecorderSaveThread::cancel()
 {
+	QMutexLocker sentry(&mMutex);
 	mCancel = true;
 	mStop = true;
+	mWakeup.wakeAll();
+}
+
+VideoRecorderSaveStatistics VideoRecorderSaveThread::getStatistics()
+{
+	QMutexLocker sentry(&mMutex);
+
+	qint64 elapsed = mRateTimer.elapsed();
+	if (elapsed >= 1000)
+	{
+		mStatistics.mInputRate = 1000.0 * (mAddedFrames - mAddedFramesAtRate) / elapsed;
+		mStatistics.mWriteRate = 1000.0 * (mStatistics.mWrittenFrames - mWrittenFramesAtRate) / elapsed;
+		mAddedFramesAtRate = mAddedFrames;
+		mWrittenFramesAtRate = mStatistics.mWrittenFrames;
+		mRateTimer.restart();
+	}
+
+	return mStatistics;
 }
 
 bool VideoRecorderSaveThread::openTimestampsFile()
@@ -127,26 +305,62 @@ bool VideoRecorderSaveThread::closeTimestampsFile()
 	return true;
 }
 
-void VideoRecorderSaveThread::write(VideoRecorderSaveThread::DataType data)
+/** Run in a worker thread: Convert the frame and,
+  * if not writing to a single file, write it.
+  */
+void VideoRecorderSaveThread::process(VideoRecorderSaveThread::DataType data)
 {
-	this->writeTimeStampsFile(data.mTimestamp);
+	vtkImageDataPtr image = data.mImage;
 
 	// convert to 8 bit data if applicable.
-	if (!mWriteColor && data.mImage->GetNumberOfScalarComponents()>2)
+	if (!mWriteColor && image->GetNumberOfScalarComponents()>2)
 	{
 		  vtkSmartPointer<vtkImageLuminance> luminance = vtkSmartPointer<vtkImageLuminance>::New();
-		  luminance->SetInputData(data.mImage);
+		  luminance->SetInputData(image);
 		  luminance->Update();
-		  data.mImage = luminance->GetOutput();
-//		  data.mImage->Update();
+		  image = luminance->GetOutput();
+	}
+
+	if (data.mSingleFile)
+	{
+		data.mOutput = image;
+	}
+	else if (!mCancel)
+	{
+		vtkMetaImageWriterPtr writer = vtkMetaImageWriterPtr::New();
+		writer->SetInputData(image);
+		writer->SetFileName(cstring_cast(data.mImageFilename));
+		writer->SetCompression(mCompressed);
+		writer->Write();
 	}
 
-	// write image
-	vtkMetaImageWriterPtr writer = vtkMetaImageWriterPtr::New();
-	writer->SetInputData(data.mImage);
-	writer->SetFileName(cstring_cast(data.mImageFilename));
-	writer->SetCompression(mCompressed);
-	writer->Write();
+	QMutexLocker sentry(&mMutex);
+	--mProcessingFrames;
+	mProcessedData[data.mIndex] = data;
+	mWakeup.wakeAll();
+}
+
+/** Run in the save thread after the frame has been processed,
+  * frames are completed in the order they were added.
+  */
+void VideoRecorderSaveThread::complete(VideoRecorderSaveThread::DataType data)
+{
+	if (data.mOutput && !mCancel)
+	{
+		if (!mFramesWriter)
+			mFramesWriter.reset(new MappedFramesFileWriter(data.mImageFilename));
+		mFramesWriter->append(data.mOutput);
+	}
+	data.mOutput = vtkImageDataPtr();
+
+	{
+		QMutexLocker sentry(&mMutex);
+		--mStatistics.mBacklogFrames;
+		mStatistics.mBacklogBytes -= data.mSize;
+		++mStatistics.mWrittenFrames;
+	}
+
+	this->releaseBuffer(data.mImage);
 }
 
 void VideoRecorderSaveThread::writeTimeStampsFile(TimeInfo timeStamps)
@@ -156,38 +370,67 @@ void VideoRecorderSaveThread::writeTimeStampsFile(TimeInfo timeStamps)
 	stream << endl;
 }
 
-/** Write all pending images to file.
-  *
+/** Return true when stopped and all frames have been completed. Call with mMutex locked.
+  */
+bool VideoRecorderSaveThread::isCompleted() const
+{
+	return mCancel
+			|| (mStop && mPendingData.empty() && (mProcessingFrames==0) && mProcessedData.empty());
+}
+
+/** Wait until there are new frames to process, processed frames ready
+  * for completion, or the thread is completed.
+  * Return false when completed.
   */
-void VideoRecorderSaveThread::writeQueue()
+bool VideoRecorderSaveThread::waitForWork(std::list<DataType>* pending, std::vector<DataType>* processed)
 {
-	while(!mPendingData.empty())
+	QMutexLocker sentry(&mMutex);
+	while (true)
 	{
-		if (mCancel)
-			return;
+		if (this->isCompleted())
+			return false;
 
-		DataType current;
+		pending->swap(mPendingData);
+		mProcessingFrames += pending->size();
 
+		std::map<int, DataType>::iterator iter = mProcessedData.begin();
+		while ((iter!=mProcessedData.end()) && (iter->first==mNextIndex))
 		{
-			QMutexLocker sentry(&mMutex);
-			current = mPendingData.front();
-			mPendingData.pop_front();
+			processed->push_back(iter->second);
+			mProcessedData.erase(iter++);
+			++mNextIndex;
 		}
 
-		this->write(current);
+		if (!pending->empty() || !processed->empty())
+			return true;
+
+		mWakeup.wait(&mMutex);
 	}
 }
 
 void VideoRecorderSaveThread::run()
 {
 	this->openTimestampsFile();
-	while (!mStop)
+
+	std::list<DataType> pending;
+	std::vector<DataType> processed;
+	while (this->waitForWork(&pending, &processed))
 	{
-		this->writeQueue();
-		this->msleep(20);
+		for (std::list<DataType>::iterator iter=pending.begin(); iter!=pending.end(); ++iter)
+		{
+			this->writeTimeStampsFile(iter->mTimestamp);
+			mWorkers.start(new Job(this, *iter));
+		}
+		pending.clear();
+
+		for (unsigned i=0; i<processed.size(); ++i)
+			this->complete(processed[i]);
+		processed.clear();
 	}
 
-	this->writeQueue();
+	mWorkers.waitForDone();
+	if (mFramesWriter)
+		mFramesWriter->close();
 	this->closeTimestampsFile();
 }
 
@@ -233,14 +476,26 @@ void SavingVideoRecorder::newFrameSlot()
 	vtkImageDataPtr image = mSource->getVtkImageData();
 	TimeInfo timestamp = mSource->getAdvancedTimeInfo();
 	QString filename = mSaveThread->addData(timestamp, image);
+	if (filename.isEmpty())
+		return;
 
-	mImages->append(filename);
+	if (!mSaveThread->isSingleFile())
+		mImages->append(filename);
 	mTimestamps.push_back(timestamp);
 }
 
-CachedImageDataContainerPtr SavingVideoRecorder::getImageData()
+ImageDataContainerPtr SavingVideoRecorder::getImageData()
 {
-	return mImages;
+	if (!mSaveThread->isSingleFile())
+		return mImages;
+
+	if (!mSingleFileImages && mSaveThread->isFinished())
+	{
+		MappedImageDataContainerPtr images(new MappedImageDataContainer(mSaveThread->getSingleFilename()));
+		images->setDeleteFilesOnRelease(true);
+		mSingleFileImages = images;
+	}
+	return mSingleFileImages;
 }
 
 std::vector<TimeInfo> SavingVideoRecorder::getTimestamps()
@@ -281,6 +536,11 @@ void SavingVideoRecorder::completeSave()
 	mSaveThread->wait(); // wait indefinitely for thread to finish
 }
 
+VideoRecorderSaveStatistics SavingVideoRecorder::getSaveStatistics()
+{
+	return mSaveThread->getStatistics();
+}
+
 } // namespace cx
 
 
@@ -35,17 +35,48 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxResourceExport.h"
 
 #include <vector>
+#include <list>
+#include <map>
 #include <QFile>
 #include <QThread>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QElapsedTimer>
 
 #include "vtkForwardDeclarations.h"
 #include "cxForwardDeclarations.h"
 #include "cxData.h"
+#include "cxMappedFramesFile.h"
 
 namespace cx
 {
 typedef boost::shared_ptr<class CachedImageDataContainer> CachedImageDataContainerPtr;
+typedef boost::shared_ptr<class MappedFramesFileWriter> MappedFramesFileWriterPtr;
+
+/** Progress of a VideoRecorderSaveThread.
+  *
+  * The backlog is the frames that have been added but not yet written
+  * to disk. These are held in memory, thus if the input rate is higher
+  * than the write rate over time, memory will run out.
+  *
+  * \ingroup cx_resource_usreconstructiontypes
+  */
+struct cxResource_EXPORT VideoRecorderSaveStatistics
+{
+	VideoRecorderSaveStatistics();
+	int mBacklogFrames; ///< frames added but not yet written
+	qint64 mBacklogBytes; ///< memory used by the backlog
+	int mWrittenFrames; ///< total number of written frames
+	double mInputRate; ///< frames/s added the last second
+	double mWriteRate; ///< frames/s written the last second
+
+	void add(const VideoRecorderSaveStatistics& other); ///< accumulate statistics from several threads
+	/** Estimated time in seconds until the backlog reaches maxBytes,
+	  * or negative if the backlog is not growing.
+	  */
+	double getSecondsUntilBacklogReaches(qint64 maxBytes) const;
+};
 
 /** Class that saves vtkImageData continously to file.
   *
@@ -54,8 +85,20 @@ typedef boost::shared_ptr<class CachedImageDataContainer> CachedImageDataContain
   *
   * A single file named \<prefix\>.fts containing N lines with timestamps
   * is written.
-  * A sequence of N files named \<prefix\>_i.mhd (0<i<N) and corresponding .raw
-  * files are written.
+  *
+  * If compressed, a sequence of N files named \<prefix\>_i.mhd (0<i<N) and
+  * corresponding .zraw files are written.
+  * Otherwise all frames are written contiguously to \<prefix\>.raw, described
+  * by the header \<prefix\>.mhd, see MappedFramesFileWriter. In this case all
+  * frames must have the same format as the first, others are rejected by addData().
+  * 3D frames are always written as separate files.
+  *
+  * Frames are queued by addData() and processed by a pool of workers, see
+  * setNumberOfWorkers(). The workers convert to grayscale if required, and
+  * when compressed, compress and write each frame in parallel. For the single
+  * file, frames are appended by this thread in the order they were added.
+  * Frame buffers are reused when the previous frames have been written.
+  * Use getStatistics() to monitor the backlog.
   *
   * If stop() is called, the thread will continue to write all remaining data,
   * then close files and return from run().
@@ -77,37 +120,69 @@ public:
 	virtual ~VideoRecorderSaveThread();
 	/**
 	  * Add data to be saved.
+	  * Return the file the data will be written to, or empty if rejected.
 	  */
 	QString addData(TimeInfo timestamp, vtkImageDataPtr data);
 	void stop();
 	void cancel();
+	bool isSingleFile() const { return mSingleFile; } ///< valid after the first call to addData()
+	QString getSingleFilename() const; ///< filename of the mhd header, if isSingleFile()
+	void setNumberOfWorkers(int count); ///< number of threads processing frames. Call before start().
+	VideoRecorderSaveStatistics getStatistics(); ///< thread-safe
 
 protected:
 	struct DataType
 	{
+		DataType() : mSingleFile(false), mIndex(0), mSize(0) {}
 		TimeInfo mTimestamp;
 		QString mImageFilename;
-		vtkImageDataPtr mImage;
+		vtkImageDataPtr mImage; ///< pooled copy of the input frame
+		vtkImageDataPtr mOutput; ///< frame to append to the single file
+		bool mSingleFile;
+		int mIndex;
+		qint64 mSize; ///< size of mImage in bytes
 	};
+	class Job;
+
 	QString mSaveFolder;
 	QString mPrefix;
 	int mImageIndex;
-	std::list<DataType> mPendingData;
-	QMutex mMutex; ///< protects the mPendingData
+
+	QMutex mMutex; ///< protects the members below
+	QWaitCondition mWakeup; ///< signalled when new frames are added or processed, or when stopped
+	std::list<DataType> mPendingData; ///< frames waiting for a worker
+	std::map<int, DataType> mProcessedData; ///< frames processed by a worker, waiting to be completed in order
+	int mNextIndex; ///< index of the next frame to complete
+	int mProcessingFrames; ///< frames currently held by workers
+	std::list<vtkImageDataPtr> mFreeBuffers; ///< buffers ready to be reused by addData()
 	bool mStop;
 	bool mCancel;
+	VideoRecorderSaveStatistics mStatistics;
+	QElapsedTimer mRateTimer;
+	int mAddedFramesAtRate;
+	int mWrittenFramesAtRate;
+	int mAddedFrames;
+
+	QThreadPool mWorkers;
 	QFile mTimestampsFile;
 	bool mCompressed;
 	bool mWriteColor;
+	bool mSingleFile;
+	MappedFramesFileInfo mFrameFormat; ///< format of the first frame, used if mSingleFile
+	MappedFramesFileWriterPtr mFramesWriter; ///< used if mSingleFile
 	/**
 	  * Save the images to disk
 	  */
 	virtual void run();
 
-	void writeQueue();
+	bool waitForWork(std::list<DataType>* pending, std::vector<DataType>* processed);
+	bool isCompleted() const;
+	vtkImageDataPtr copyToBuffer(vtkImageDataPtr image);
+	void releaseBuffer(vtkImageDataPtr buffer);
+	void process(DataType data);
+	void complete(DataType data);
 	bool openTimestampsFile();
 	bool closeTimestampsFile();
-	void write(DataType data);
 	void writeTimeStampsFile(TimeInfo timeStamps);
 };
 
@@ -134,13 +209,19 @@ public:
 	virtual void stopRecord();
 	void cancel();
 
-	CachedImageDataContainerPtr getImageData();
+	/** Return the recorded frames. Call completeSave() first
+	  * if the recording is saved to a single file.
+	  */
+	ImageDataContainerPtr getImageData();
 	std::vector<TimeInfo> getTimestamps();
 	QString getSaveFolder() { return mSaveFolder; }
 
 	/** Call to force complete the writing of data to disk.
 	  */
 	void completeSave();
+	/** Return the progress of the writing to disk. Thread-safe.
+	  */
+	VideoRecorderSaveStatistics getSaveStatistics();
 
 	VideoSourcePtr getSource() { return mSource; }
 
@@ -152,6 +233,7 @@ private:
 	  */
 	void deleteFolder(QString folder);
 	CachedImageDataContainerPtr mImages;
+	ImageDataContainerPtr mSingleFileImages;
 	std::vector<TimeInfo> mTimestamps;
 	QString mSaveFolder;
 	QString mPrefix;
@@ -39,22 +39,168 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vtkImageAppend.h>
 #include <vtkMetaImageWriter.h>
 #include <vtkImageImport.h>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <boost/bind.hpp>
+#include <algorithm>
 #include "cxTypeConversions.h"
 #include "cxDataReaderWriter.h"
 #include <QFileInfo>
 #include "cxTimeKeeper.h"
 #include "cxImageDataContainer.h"
+#include "cxMappedFramesFile.h"
 #include "cxVolumeHelpers.h"
 #include "cxLogger.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 typedef vtkSmartPointer<vtkImageAppend> vtkImageAppendPtr;
 
 namespace cx
 {
 
-ProcessedUSInputData::ProcessedUSInputData(std::vector<vtkImageDataPtr> frames, std::vector<TimedPosition> pos, vtkImageDataPtr mask, QString path, QString uid) :
+namespace
+{
+/** Luminance as in vtkImageLuminance, (0.30R + 0.59G + 0.11B), truncated,
+  * computed exactly in integer arithmetic: x/100 == (x*5243)>>19 for x<=25500.
+  */
+inline unsigned char rgbToLuminance(int r, int g, int b)
+{
+	return static_cast<unsigned char>(((30*r + 59*g + 11*b)*5243) >> 19);
+}
+
+/** True if the average absolute difference between the color components is at most 3.
+  * |r-g|+|r-b|+|g-b| == 2*(max-min), thus this is equal to max-min <= 5.
+  */
+inline bool isNearGray(int r, int g, int b)
+{
+	int maxValue = std::max(r, std::max(g, b));
+	int minValue = std::min(r, std::min(g, b));
+	return maxValue - minValue <= 5;
+}
+
+#ifdef __SSE2__
+/** Split 16 packed RGB pixels into one register per component.
+  */
+inline void deinterleaveRGB(const unsigned char* rgb, __m128i& r, __m128i& g, __m128i& b)
+{
+	__m128i t00 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb));
+	__m128i t01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 16));
+	__m128i t02 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 32));
+
+	__m128i t10 = _mm_unpacklo_epi8(t00, _mm_unpackhi_epi64(t01, t01));
+	__m128i t11 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t00, t00), t02);
+	__m128i t12 = _mm_unpacklo_epi8(t01, _mm_unpackhi_epi64(t02, t02));
+
+	__m128i t20 = _mm_unpacklo_epi8(t10, _mm_unpackhi_epi64(t11, t11));
+	__m128i t21 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t10, t10), t12);
+	__m128i t22 = _mm_unpacklo_epi8(t11, _mm_unpackhi_epi64(t12, t12));
+
+	__m128i t30 = _mm_unpacklo_epi8(t20, _mm_unpackhi_epi64(t21, t21));
+	__m128i t31 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t20, t20), t22);
+	__m128i t32 = _mm_unpacklo_epi8(t21, _mm_unpackhi_epi64(t22, t22));
+
+	r = _mm_unpacklo_epi8(t30, _mm_unpackhi_epi64(t31, t31));
+	g = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t30, t30), t32);
+	b = _mm_unpacklo_epi8(t31, _mm_unpackhi_epi64(t32, t32));
+}
+
+/** Luminance of 8 pixels stored as 16 bit values.
+  */
+inline __m128i luminance16(__m128i r, __m128i g, __m128i b)
+{
+	__m128i sum = _mm_mullo_epi16(r, _mm_set1_epi16(30));
+	sum = _mm_add_epi16(sum, _mm_mullo_epi16(g, _mm_set1_epi16(59)));
+	sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(11)));
+	return _mm_srli_epi16(_mm_mulhi_epu16(sum, _mm_set1_epi16(5243)), 3);
+}
+#endif
+
+/** Convert count packed 8 bit RGB pixels to grayscale and angio in one pass.
+  * Either of gray and angio can be NULL.
+  *
+  * The grayscale is equal to vtkImageLuminance, except for rounding errors in
+  * the floating point computation used by vtk (differs by max 1). The angio
+  * is equal to the grayscale, with near-gray pixels set to zero.
+  */
+void convertRGBToGrayscaleAndAngio(const unsigned char* rgb, unsigned char* gray, unsigned char* angio, int count)
+{
+	int i = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i grayLimit = _mm_set1_epi8(5);
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i r, g, b;
+		deinterleaveRGB(rgb + 3*i, r, g, b);
+
+		__m128i lo = luminance16(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(b, zero));
+		__m128i hi = luminance16(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(b, zero));
+		__m128i lum = _mm_packus_epi16(lo, hi);
+		if (gray)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(gray + i), lum);
+
+		if (angio)
+		{
+			__m128i maxValue = _mm_max_epu8(r, _mm_max_epu8(g, b));
+			__m128i minValue = _mm_min_epu8(r, _mm_min_epu8(g, b));
+			__m128i spread = _mm_subs_epu8(maxValue, minValue);
+			__m128i nearGray = _mm_cmpeq_epi8(_mm_subs_epu8(spread, grayLimit), zero);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(angio + i), _mm_andnot_si128(nearGray, lum));
+		}
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const unsigned char* pixel = rgb + 3*i;
+		unsigned char lum = rgbToLuminance(pixel[0], pixel[1], pixel[2]);
+		if (gray)
+			gray[i] = lum;
+		if (angio)
+			angio[i] = isNearGray(pixel[0], pixel[1], pixel[2]) ? 0 : lum;
+	}
+}
+
+/** An RGB frame to be converted into preallocated grayscale and angio frames.
+  * Contains no vtk objects, thus it can be processed in any thread.
+  */
+struct RGBFrameJob
+{
+	const unsigned char* mInput; ///< first pixel inside the crop box
+	vtkIdType mInputRowIncrement; ///< bytes between rows in the input
+	vtkIdType mInputSliceIncrement; ///< bytes between slices in the input
+	int mWidth;
+	int mHeight;
+	int mDepth;
+	unsigned char* mGray; ///< contiguous output, or NULL
+	unsigned char* mAngio; ///< contiguous output, or NULL
+};
+
+void processRGBFrame(RGBFrameJob job)
+{
+	for (int z=0; z<job.mDepth; ++z)
+	{
+		for (int y=0; y<job.mHeight; ++y)
+		{
+			const unsigned char* row = job.mInput + z*job.mInputSliceIncrement + y*job.mInputRowIncrement;
+			vtkIdType offset = (vtkIdType(z)*job.mHeight + y)*job.mWidth;
+			convertRGBToGrayscaleAndAngio(row,
+										  job.mGray ? job.mGray+offset : NULL,
+										  job.mAngio ? job.mAngio+offset : NULL,
+										  job.mWidth);
+		}
+	}
+}
+} // namespace
+
+
+ProcessedUSInputData::ProcessedUSInputData(std::vector<vtkImageDataPtr> frames, std::vector<TimedPosition> pos, vtkImageDataPtr mask, QString path, QString uid,
+										   ImageDataContainerPtr source) :
 	mProcessedImage(frames),
+	mSource(source),
 	mFrames(pos),
 	mMask(mask),
 	mPath(path),
@@ -146,7 +292,8 @@ USFrameDataPtr USFrameData::create(ImagePtr inputFrameData)
 }
 
 /** Create object from file.
-  * If file or file+.mhd exists, use this,
+  * If file or file+.mhd exists, use this. If it is
+  * uncompressed, the frames are memory mapped instead of loaded.
   * Otherwise assume input is split over several
   * files and try to load all mhdFile + i + ".mhd".
   * forall i.
@@ -158,7 +305,15 @@ USFrameDataPtr USFrameData::create(QString inputFilename)
 	TimeKeeper timer;
 	QString mhdSingleFile = info.absolutePath()+"/"+info.completeBaseName()+".mhd";
 
-	if (QFileInfo(mhdSingleFile).exists())
+	if (MappedImageDataContainer::canMap(mhdSingleFile))
+	{
+		// frames stored contiguously in one raw file: map it
+		MappedImageDataContainerPtr container(new MappedImageDataContainer(mhdSingleFile));
+		USFrameDataPtr retval = USFrameData::create(QFileInfo(mhdSingleFile).completeBaseName(), container);
+		timer.printElapsedms(QString("Mapping single %1").arg(inputFilename));
+		return retval;
+	}
+	else if (QFileInfo(mhdSingleFile).exists())
 	{
 		vtkImageDataPtr image = MetaImageReader().loadVtkImageData(mhdSingleFile);
 		// load from single file
@@ -310,6 +465,78 @@ vtkImageDataPtr USFrameData::to8bitGrayscaleAndEffectuateCropping(vtkImageDataPt
 	return copy;
 }
 
+bool USFrameData::is8bitGrayscale(vtkImageDataPtr input) const
+{
+	return (input->GetNumberOfScalarComponents() == 1) && (input->GetScalarType() == VTK_UNSIGNED_CHAR);
+}
+
+/** Crop an 8 bit grayscale frame.
+ *
+ * If the cropbox covers the entire frame, the input is returned as is,
+ * otherwise the cropped rows are copied into a new contiguous frame.
+ * This avoids the vtk pipeline and the extra copies in cropImageExtent()
+ * and to8bitGrayscaleAndEffectuateCropping() for the common case.
+ */
+vtkImageDataPtr USFrameData::crop8bitGrayscale(vtkImageDataPtr input) const
+{
+	IntBoundingBox3D extent(input->GetExtent());
+	IntBoundingBox3D cropped = this->getCropExtent(input);
+	if (cropped == extent)
+		return input;
+
+	vtkImageDataPtr retval = vtkImageDataPtr::New();
+	retval->SetSpacing(input->GetSpacing());
+	retval->SetOrigin(input->GetOrigin());
+	retval->SetExtent(cropped.data());
+	retval->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+	int rowLength = cropped[1]-cropped[0]+1;
+	unsigned char* outPtr = static_cast<unsigned char*>(retval->GetScalarPointer());
+	for (int z=cropped[4]; z<=cropped[5]; ++z)
+	{
+		for (int y=cropped[2]; y<=cropped[3]; ++y)
+		{
+			unsigned char* inPtr = static_cast<unsigned char*>(input->GetScalarPointer(cropped[0], y, z));
+			memcpy(outPtr, inPtr, rowLength);
+			outPtr += rowLength;
+		}
+	}
+	return retval;
+}
+
+/** Return the extent of input after cropping, i.e. the intersection of the extent and the crop box.
+ */
+IntBoundingBox3D USFrameData::getCropExtent(vtkImageDataPtr input) const
+{
+	IntBoundingBox3D extent(input->GetExtent());
+	if (mCropbox.range()[0]==0)
+		return extent;
+
+	IntBoundingBox3D cropped = extent;
+	for (unsigned i=0; i<2; ++i)
+	{
+		cropped[2*i] = std::max(extent[2*i], mCropbox[2*i]);
+		cropped[2*i+1] = std::min(extent[2*i+1], mCropbox[2*i+1]);
+	}
+	return cropped;
+}
+
+bool USFrameData::isPackedRGB(vtkImageDataPtr input) const
+{
+	return (input->GetNumberOfScalarComponents() == 3) && (input->GetScalarType() == VTK_UNSIGNED_CHAR);
+}
+
+vtkImageDataPtr USFrameData::createCroppedFrame(vtkImageDataPtr input) const
+{
+	IntBoundingBox3D cropped = this->getCropExtent(input);
+	vtkImageDataPtr retval = vtkImageDataPtr::New();
+	retval->SetSpacing(input->GetSpacing());
+	retval->SetOrigin(input->GetOrigin());
+	retval->SetExtent(cropped.data());
+	retval->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+	return retval;
+}
+
 vtkImageDataPtr USFrameData::convertTo8bit(vtkImageDataPtr input) const
 {
 	vtkImageDataPtr retval = input;
@@ -438,9 +665,44 @@ void USFrameData::setPurgeInputDataAfterInitialize(bool value)
 	mPurgeInput = value;
 }
 
-std::vector<std::vector<vtkImageDataPtr> > USFrameData::initializeFrames(std::vector<bool> angio)
+/** Preprocess a single frame using the vtk pipeline. Used for all frames
+ * except 8 bit RGB, which are handled in initializeFrames().
+ */
+void USFrameData::initializeFrame(unsigned index, std::vector<bool> angio, std::vector<std::vector<vtkImageDataPtr> >* raw) const
 {
+	vtkImageDataPtr current = mImageContainer->get(mReducedToFull[index]);
 
+	// optimization: grayFrame is used in both calculations: compute once
+	vtkImageDataPtr grayFrame;
+	if (this->is8bitGrayscale(current))
+	{
+		// no conversion needed: crop directly, reuse the input frame if possible.
+		grayFrame = this->crop8bitGrayscale(current);
+	}
+	else
+	{
+		if (mCropbox.range()[0]!=0)
+			current = this->cropImageExtent(current, mCropbox);
+		grayFrame = this->to8bitGrayscaleAndEffectuateCropping(current);
+	}
+
+	for (unsigned j=0; j<angio.size(); ++j)
+	{
+		if (angio[j])
+			(*raw)[j][index] = this->useAngio(current, grayFrame, index);
+		else
+			(*raw)[j][index] = grayFrame;
+	}
+}
+
+/** Frames are processed in batches. The 8 bit RGB frames in a batch are
+ * cropped and converted to grayscale and angio in one pass, in parallel,
+ * directly into preallocated output frames. Other frames use the vtk pipeline.
+ *
+ * The image container is only accessed from the calling thread.
+ */
+std::vector<std::vector<vtkImageDataPtr> > USFrameData::initializeFrames(std::vector<bool> angio)
+{
 	std::vector<std::vector<vtkImageDataPtr> > raw(angio.size());
 
 	for (unsigned i=0; i<raw.size(); ++i)
@@ -448,34 +710,60 @@ std::vector<std::vector<vtkImageDataPtr> > USFrameData::initializeFrames(std::ve
 		raw[i].resize(mReducedToFull.size());
 	}
 
-	// apply cropping and angio
-	for (unsigned i=0; i<mReducedToFull.size(); ++i)
-	{
-		CX_ASSERT(mImageContainer->size() > mReducedToFull[i]);
-		vtkImageDataPtr current = mImageContainer->get(mReducedToFull[i]);
+	bool needGray = std::find(angio.begin(), angio.end(), false) != angio.end();
+	bool needAngio = std::find(angio.begin(), angio.end(), true) != angio.end();
 
-		if (mCropbox.range()[0]!=0)
-			current = this->cropImageExtent(current, mCropbox);
+	QThreadPool threadPool;
+	unsigned batchSize = 4 * std::max(1, threadPool.maxThreadCount());
 
-		// optimization: grayFrame is used in both calculations: compute once
-		vtkImageDataPtr grayFrame = this->to8bitGrayscaleAndEffectuateCropping(current);
+	for (unsigned batchStart=0; batchStart<mReducedToFull.size(); batchStart+=batchSize)
+	{
+		unsigned batchEnd = std::min<unsigned>(batchStart+batchSize, mReducedToFull.size());
+		std::vector<vtkImageDataPtr> inputs; // keep input alive until processed
+		std::vector<QFuture<void> > futures;
 
-		for (unsigned j=0; j<angio.size(); ++j)
+		for (unsigned i=batchStart; i<batchEnd; ++i)
 		{
-
-			if (angio[j])
+			CX_ASSERT(mImageContainer->size() > mReducedToFull[i]);
+			vtkImageDataPtr current = mImageContainer->get(mReducedToFull[i]);
+			if (angio.empty())
+				continue;
+			if (!this->isPackedRGB(current))
 			{
-				vtkImageDataPtr angioFrame = this->useAngio(current, grayFrame, i);
-				raw[j][i] = angioFrame;
-			}
-			else
-			{
-				raw[j][i] = grayFrame;
+				this->initializeFrame(i, angio, &raw);
+				continue;
 			}
+
+			vtkImageDataPtr grayFrame = needGray ? this->createCroppedFrame(current) : vtkImageDataPtr();
+			vtkImageDataPtr angioFrame = needAngio ? this->createCroppedFrame(current) : vtkImageDataPtr();
+			for (unsigned j=0; j<angio.size(); ++j)
+				raw[j][i] = angio[j] ? angioFrame : grayFrame;
+
+			IntBoundingBox3D cropped = this->getCropExtent(current);
+			vtkIdType* increments = current->GetIncrements();
+			RGBFrameJob job;
+			job.mInput = static_cast<unsigned char*>(current->GetScalarPointer(cropped[0], cropped[2], cropped[4]));
+			job.mInputRowIncrement = increments[1];
+			job.mInputSliceIncrement = increments[2];
+			job.mWidth = cropped.range()[0]+1;
+			job.mHeight = cropped.range()[1]+1;
+			job.mDepth = cropped.range()[2]+1;
+			job.mGray = grayFrame ? static_cast<unsigned char*>(grayFrame->GetScalarPointer()) : NULL;
+			job.mAngio = angioFrame ? static_cast<unsigned char*>(angioFrame->GetScalarPointer()) : NULL;
+
+			inputs.push_back(current);
+			futures.push_back(QtConcurrent::run(&threadPool, boost::bind(&processRGBFrame, job)));
 		}
 
+		for (unsigned i=0; i<futures.size(); ++i)
+			futures[i].waitForFinished();
+		inputs.clear();
+
 		if (mPurgeInput)
-			mImageContainer->purge(mReducedToFull[i]);
+		{
+			for (unsigned i=batchStart; i<batchEnd; ++i)
+				mImageContainer->purge(mReducedToFull[i]);
+		}
 	}
 
 	if (mPurgeInput)
@@ -65,7 +65,11 @@ typedef boost::shared_ptr<class USFrameData> USFrameDataPtr;
 class cxResource_EXPORT ProcessedUSInputData
 {
 public:
-	ProcessedUSInputData(std::vector<vtkImageDataPtr> frames, std::vector<TimedPosition> pos, vtkImageDataPtr mask, QString path, QString uid);
+	/** The frames might point directly into the raw data, e.g. if no processing
+	  * was needed, thus source should be set to the container holding the raw data.
+	  */
+	ProcessedUSInputData(std::vector<vtkImageDataPtr> frames, std::vector<TimedPosition> pos, vtkImageDataPtr mask, QString path, QString uid,
+						 ImageDataContainerPtr source = ImageDataContainerPtr());
 
 	unsigned char* getFrame(unsigned int index) const;
 	Eigen::Array3i getDimensions() const;
@@ -79,6 +83,7 @@ public:
 
 private:
 	std::vector<vtkImageDataPtr> mProcessedImage;
+	ImageDataContainerPtr mSource; ///< keeps the raw data alive, in case mProcessedImage refers to it
 	std::vector<TimedPosition> mFrames;
 	vtkImageDataPtr mMask;///< Clipping mask for the input data
 	QString mPath;
@@ -129,6 +134,12 @@ public:
 	/** Use the input raw data and control parameters to generate filtered frames.
 	  * The input angio controls how many output objects that will be created, and if each
 	  * of them should be angio or grayscale.
+	  *
+	  * 8 bit grayscale frames that need no cropping are not copied, thus the
+	  * output might refer to data in the image container.
+	  *
+	  * 8 bit RGB frames are processed in parallel. Grayscale and angio output are
+	  * computed in one pass, the grayscale differs from vtkImageLuminance by max 1.
 	  */
 	std::vector<std::vector<vtkImageDataPtr> > initializeFrames(std::vector<bool> angio);
 
@@ -153,6 +164,12 @@ protected:
 	bool mPurgeInput;
 private:
 	vtkImageDataPtr convertTo8bit(vtkImageDataPtr input) const;
+	bool is8bitGrayscale(vtkImageDataPtr input) const;
+	vtkImageDataPtr crop8bitGrayscale(vtkImageDataPtr input) const;
+	IntBoundingBox3D getCropExtent(vtkImageDataPtr input) const;
+	bool isPackedRGB(vtkImageDataPtr input) const;
+	vtkImageDataPtr createCroppedFrame(vtkImageDataPtr input) const;
+	void initializeFrame(unsigned index, std::vector<bool> angio, std::vector<std::vector<vtkImageDataPtr> >* raw) const;
 };
 
 /**
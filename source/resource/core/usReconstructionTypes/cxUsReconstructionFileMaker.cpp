@@ -49,6 +49,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxUSFrameData.h"
 #include "cxSavingVideoRecorder.h"
 #include "cxImageDataContainer.h"
+#include "cxMappedFramesFile.h"
 #include "cxUSReconstructInputDataAlgoritms.h"
 #include "cxCustomMetaImage.h"
 
@@ -352,9 +353,42 @@ void UsReconstructionFileMaker::report()
 	}
 }
 
+/** Write all frames contiguously into one uncompressed file \<session\>.mhd/.raw,
+  * that can be memory mapped when read.
+  * Return false if the frames cannot be written this way.
+  */
+bool UsReconstructionFileMaker::writeUSImagesToSingleFile(QString path, ImageDataContainerPtr images)
+{
+	QString filename = QString("%1/%2.mhd").arg(path).arg(mSessionDescription);
+	bool success = true;
+	{
+		MappedFramesFileWriter writer(filename);
+		writer.setTag("Modality", "US");
+		writer.setTag("ImageType3", mSessionDescription);
+		for (unsigned i=0; success && i<images->size(); ++i)
+			success = writer.append(images->get(i));
+		success = writer.close() && success;
+	}
+
+	if (!success)
+	{
+		QDir().remove(filename);
+		QDir().remove(MappedFramesFileWriter::getRawFilename(filename));
+	}
+	return success;
+}
+
 void UsReconstructionFileMaker::writeUSImages(QString path, ImageDataContainerPtr images, bool compression, std::vector<TimedPosition> pos)
 {
 	CX_ASSERT(images->size()==pos.size());
+
+	if (!compression && !images->empty())
+	{
+		if (this->writeUSImagesToSingleFile(path, images))
+			return;
+		reportWarning("Frames cannot be written to a single file, writing them separately.");
+	}
+
 	vtkMetaImageWriterPtr writer = vtkMetaImageWriterPtr::New();
 
 	for (unsigned i=0; i<images->size(); ++i)
@@ -0,0 +1,147 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "catch.hpp"
+#include <vtkImageData.h>
+#include <vtkImageLuminance.h>
+#include <cstdlib>
+#include <cmath>
+#include "cxUSFrameData.h"
+#include "cxVolumeHelpers.h"
+
+namespace cxtest
+{
+
+namespace
+{
+std::vector<vtkImageDataPtr> createRandomRGBFrames(int numberOfFrames)
+{
+	std::vector<vtkImageDataPtr> retval;
+	Eigen::Array3i dim(53, 31, 1);
+	for (int i=0; i<numberOfFrames; ++i)
+	{
+		vtkImageDataPtr frame = cx::generateVtkImageData(dim, cx::Vector3D(0.2, 0.3, 1), 0, 3);
+		unsigned char* data = static_cast<unsigned char*>(frame->GetScalarPointer());
+		for (vtkIdType j=0; j<frame->GetNumberOfPoints(); ++j)
+		{
+			unsigned char value = rand() % 256;
+			data[3*j+0] = value;
+			data[3*j+1] = (j % 2) ? rand() % 256 : std::min(255, value + rand() % 7); // near-gray
+			data[3*j+2] = (j % 3) ? rand() % 256 : value;
+		}
+		retval.push_back(frame);
+	}
+	return retval;
+}
+
+vtkImageDataPtr luminance(vtkImageDataPtr input)
+{
+	vtkSmartPointer<vtkImageLuminance> filter = vtkSmartPointer<vtkImageLuminance>::New();
+	filter->SetInputData(input);
+	filter->Update();
+	return filter->GetOutput();
+}
+
+bool isNearGray(unsigned char* rgb)
+{
+	double r = rgb[0];
+	double g = rgb[1];
+	double b = rgb[2];
+	int metric = (fabs(r-g) + fabs(r-b) + fabs(g-b)) / 3;
+	return metric <= 3;
+}
+} // namespace
+
+TEST_CASE("USFrameData: RGB frames are cropped and converted to grayscale and angio", "[usreconstruction][unit]")
+{
+	std::vector<vtkImageDataPtr> input = createRandomRGBFrames(37);
+	cx::USFrameDataPtr frameData = cx::USFrameData::create("test", input);
+	cx::IntBoundingBox3D cropbox(3, 47, 2, 28, 0, 0);
+	frameData->setCropBox(cropbox);
+
+	std::vector<bool> angio;
+	angio.push_back(false);
+	angio.push_back(true);
+	std::vector<std::vector<vtkImageDataPtr> > output = frameData->initializeFrames(angio);
+
+	REQUIRE(output.size() == 2);
+	REQUIRE(output[0].size() == input.size());
+	REQUIRE(output[1].size() == input.size());
+
+	for (unsigned i=0; i<input.size(); ++i)
+	{
+		vtkImageDataPtr reference = luminance(input[i]);
+		vtkImageDataPtr gray = output[0][i];
+		vtkImageDataPtr angioFrame = output[1][i];
+
+		REQUIRE(gray->GetNumberOfScalarComponents() == 1);
+		REQUIRE(gray->GetScalarType() == VTK_UNSIGNED_CHAR);
+		REQUIRE(cx::IntBoundingBox3D(gray->GetExtent()) == cropbox);
+		REQUIRE(cx::IntBoundingBox3D(angioFrame->GetExtent()) == cropbox);
+
+		int failures = 0;
+		for (int y=cropbox[2]; y<=cropbox[3]; ++y)
+		{
+			for (int x=cropbox[0]; x<=cropbox[1]; ++x)
+			{
+				unsigned char* rgb = static_cast<unsigned char*>(input[i]->GetScalarPointer(x, y, 0));
+				int expected = *static_cast<unsigned char*>(reference->GetScalarPointer(x, y, 0));
+				int grayValue = *static_cast<unsigned char*>(gray->GetScalarPointer(x, y, 0));
+				int angioValue = *static_cast<unsigned char*>(angioFrame->GetScalarPointer(x, y, 0));
+
+				// vtkImageLuminance uses floating point, allow rounding differences
+				if (std::abs(grayValue - expected) > 1)
+					++failures;
+				if (angioValue != (isNearGray(rgb) ? 0 : grayValue))
+					++failures;
+			}
+		}
+		CHECK(failures == 0);
+	}
+}
+
+TEST_CASE("USFrameData: Grayscale frames are passed through", "[usreconstruction][unit]")
+{
+	std::vector<vtkImageDataPtr> input;
+	for (int i=0; i<5; ++i)
+		input.push_back(cx::generateVtkImageData(Eigen::Array3i(20, 10, 1), cx::Vector3D(1, 1, 1), i));
+	cx::USFrameDataPtr frameData = cx::USFrameData::create("test", input);
+
+	std::vector<std::vector<vtkImageDataPtr> > output = frameData->initializeFrames(std::vector<bool>(1, false));
+
+	REQUIRE(output.size() == 1);
+	REQUIRE(output[0].size() == input.size());
+	for (unsigned i=0; i<input.size(); ++i)
+		CHECK(output[0][i]->GetScalarComponentAsDouble(5, 5, 0, 0) == i);
+}
+
+} // namespace cxtest
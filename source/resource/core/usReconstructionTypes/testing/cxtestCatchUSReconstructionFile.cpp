@@ -37,6 +37,40 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxUsReconstructionFileMaker.h"
 #include "cxUsReconstructionFileReader.h"
 #include "cxUSFrameData.h"
+#include "cxMappedFramesFile.h"
+#include "cxSavingVideoRecorder.h"
+#include "cxVolumeHelpers.h"
+#include "vtkImageData.h"
+#include <cstdlib>
+#include <QDir>
+#include <QFileInfo>
+
+namespace
+{
+unsigned char* getFramePointer(cx::ImageDataContainerPtr images, unsigned index)
+{
+	return static_cast<unsigned char*>(images->get(index)->GetScalarPointer());
+}
+
+/** Add frames with pixel value equal to frame index, reusing the same input frame
+  * as a video source would.
+  */
+void writeFramesUsingSaveThread(cx::VideoRecorderSaveThread* thread, int components, unsigned count)
+{
+	vtkImageDataPtr frame = cx::generateVtkImageData(Eigen::Array3i(32, 24, 1), cx::Vector3D(0.5, 0.5, 1), 0, components);
+	unsigned frameSize = 32*24*components;
+	thread->setNumberOfWorkers(4);
+	thread->start();
+	for (unsigned i=0; i<count; ++i)
+	{
+		memset(frame->GetScalarPointer(), i, frameSize);
+		frame->Modified();
+		CHECK(!thread->addData(cx::TimeInfo(i), frame).isEmpty());
+	}
+	thread->stop();
+	thread->wait();
+}
+}
 
 
 TEST_CASE_METHOD(cxtest::USReconstructionFileFixture, "USReconstructionFile: Create unique folders", "[unit][resource][usReconstructionTypes]")
@@ -92,3 +126,97 @@ TEST_CASE_METHOD(cxtest::USReconstructionFileFixture, "USReconstructionFile: Sav
 
 	this->assertCorrespondence(input, hasBeenRead);
 }
+
+TEST_CASE_METHOD(cxtest::USReconstructionFileFixture, "USReconstructionFile: Save and load uncompressed USReconstructInputData as mapped single file", "[unit][resource][usReconstructionTypes]")
+{
+	ReconstructionData input = this->createSampleReconstructData();
+	Eigen::Array3i dim(input.imageData->get(0)->GetDimensions());
+	unsigned frameSize = dim[0]*dim[1];
+	for (unsigned i=0; i<input.imageData->size(); ++i)
+	{
+		unsigned char* frame = getFramePointer(input.imageData, i);
+		for (unsigned j=0; j<frameSize; ++j)
+			frame[j] = (i+j) % 256;
+	}
+
+	QString filename = this->write(input, false);
+	cx::USReconstructInputData hasBeenRead = this->read(filename);
+	this->assertCorrespondence(input, hasBeenRead);
+
+	cx::ImageDataContainerPtr images = hasBeenRead.mUsRaw->getImageContainer();
+	REQUIRE(boost::dynamic_pointer_cast<cx::MappedImageDataContainer>(images));
+	REQUIRE(images->size() == input.imageData->size());
+	for (unsigned i=0; i<images->size(); ++i)
+	{
+		CHECK((Eigen::Array3i(images->get(i)->GetDimensions()) == Eigen::Array3i(dim[0], dim[1], 1)).all());
+		CHECK(memcmp(getFramePointer(images, i), getFramePointer(input.imageData, i), frameSize) == 0);
+	}
+}
+
+TEST_CASE_METHOD(cxtest::USReconstructionFileFixture, "USReconstructionFile: Uncropped 8 bit frames are not copied during initialize", "[unit][resource][usReconstructionTypes]")
+{
+	ReconstructionData input = this->createSampleReconstructData();
+	cx::USReconstructInputData data = this->createUSReconstructData(input);
+
+	std::vector<std::vector<vtkImageDataPtr> > frames = data.mUsRaw->initializeFrames(std::vector<bool>(1, false));
+	REQUIRE(frames[0].size() == input.imageData->size());
+	for (unsigned i=0; i<frames[0].size(); ++i)
+		CHECK(frames[0][i]->GetScalarPointer() == input.imageData->get(i)->GetScalarPointer());
+}
+
+TEST_CASE_METHOD(cxtest::USReconstructionFileFixture, "VideoRecorderSaveThread: Writes uncompressed frames in order to single file", "[unit][resource][usReconstructionTypes]")
+{
+	QString folder = this->getDataPath()+"/save_thread";
+	QDir().mkpath(folder);
+	unsigned count = 50;
+
+	cx::VideoRecorderSaveThread thread(NULL, folder, "frames", false, true);
+	writeFramesUsingSaveThread(&thread, 1, count);
+
+	REQUIRE(thread.isSingleFile());
+	cx::VideoRecorderSaveStatistics stats = thread.getStatistics();
+	CHECK(stats.mBacklogFrames == 0);
+	CHECK(stats.mBacklogBytes == 0);
+	CHECK(stats.mWrittenFrames == int(count));
+
+	cx::MappedImageDataContainer images(thread.getSingleFilename());
+	REQUIRE(images.size() == count);
+	for (unsigned i=0; i<count; ++i)
+		CHECK(static_cast<unsigned char*>(images.get(i)->GetScalarPointer())[0] == i);
+	CHECK(QFileInfo(folder+"/frames.fts").size() > 0);
+}
+
+TEST_CASE_METHOD(cxtest::USReconstructionFileFixture, "VideoRecorderSaveThread: Writes compressed frames converted to grayscale in parallel", "[unit][resource][usReconstructionTypes]")
+{
+	QString folder = this->getDataPath()+"/save_thread";
+	QDir().mkpath(folder);
+	unsigned count = 20;
+
+	cx::VideoRecorderSaveThread thread(NULL, folder, "frames", true, false);
+	writeFramesUsingSaveThread(&thread, 3, count);
+
+	REQUIRE(!thread.isSingleFile());
+	CHECK(thread.getStatistics().mWrittenFrames == int(count));
+	for (unsigned i=0; i<count; ++i)
+	{
+		cx::CachedImageDataContainer images(std::vector<QString>(1, QString("%1/frames_%2.mhd").arg(folder).arg(i)));
+		REQUIRE(images.size() == 1);
+		CHECK(images.get(0)->GetNumberOfScalarComponents() == 1);
+		int value = static_cast<unsigned char*>(images.get(0)->GetScalarPointer())[0];
+		CHECK(std::abs(value - int(i)) <= 1); // allow for rounding in the luminance conversion
+	}
+}
+
+TEST_CASE("VideoRecorderSaveStatistics: Estimate time until backlog limit", "[unit][resource][usReconstructionTypes]")
+{
+	cx::VideoRecorderSaveStatistics stats;
+	stats.mBacklogFrames = 10;
+	stats.mBacklogBytes = 1000;
+	stats.mInputRate = 30;
+	stats.mWriteRate = 20;
+
+	CHECK(stats.getSecondsUntilBacklogReaches(2000) == Approx(1.0));
+	CHECK(stats.getSecondsUntilBacklogReaches(500) == 0);
+	stats.mWriteRate = 30;
+	CHECK(stats.getSecondsUntilBacklogReaches(2000) < 0);
+}
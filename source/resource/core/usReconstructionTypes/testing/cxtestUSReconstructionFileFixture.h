@@ -75,7 +75,7 @@ protected:
 
 	cx::USReconstructInputData createUSReconstructData(ReconstructionData input);
 
-	QString write(ReconstructionData input);
+	QString write(ReconstructionData input, bool compress = true);
 	cx::USReconstructInputData read(QString filename);
 	void assertCorrespondence(ReconstructionData input, cx::USReconstructInputData output);
 };
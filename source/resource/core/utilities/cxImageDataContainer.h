@@ -92,6 +92,7 @@ public:
 	bool empty() const { return this->size()==0; }
 	virtual bool purge(unsigned index) { return false; }
 	virtual void purgeAll();
+	virtual bool isInMemory() const { return false; } ///< true if all frames are held in memory, i.e. get() is cheap
 };
 typedef boost::shared_ptr<ImageDataContainer> ImageDataContainerPtr;
 
@@ -137,6 +138,7 @@ public:
 	virtual ~SplitFramesContainer() {}
 	virtual vtkImageDataPtr get(unsigned index);
 	virtual unsigned size() const;
+	virtual bool isInMemory() const { return true; }
 private:
 	std::vector<vtkImageDataPtr> mImages;
 	vtkImageDataPtr mOptionalWholeBase; ///< handle for original monolithic data if present
@@ -155,6 +157,7 @@ public:
 	virtual ~FramesDataContainer() {}
 	virtual vtkImageDataPtr get(unsigned index);
 	virtual unsigned size() const;
+	virtual bool isInMemory() const { return true; }
 private:
 	std::vector<vtkImageDataPtr> mImages;
 };
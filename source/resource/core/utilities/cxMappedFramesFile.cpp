@@ -0,0 +1,400 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxMappedFramesFile.h"
+
+#include <map>
+#include <QDir>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QStringList>
+#include <vtkImageData.h>
+#include <vtkImageImport.h>
+#include <vtkAbstractArray.h>
+#include "cxLogger.h"
+#include "cxUtilHelpers.h"
+#include "cxBoundingBox3D.h"
+
+typedef vtkSmartPointer<class vtkImageImport> vtkImageImportPtr;
+
+namespace cx
+{
+
+namespace
+{
+QString getMetaElementType(int vtkScalarType)
+{
+	switch (vtkScalarType)
+	{
+	case VTK_CHAR:
+	case VTK_SIGNED_CHAR: return "MET_CHAR";
+	case VTK_UNSIGNED_CHAR: return "MET_UCHAR";
+	case VTK_SHORT: return "MET_SHORT";
+	case VTK_UNSIGNED_SHORT: return "MET_USHORT";
+	case VTK_INT: return "MET_INT";
+	case VTK_UNSIGNED_INT: return "MET_UINT";
+	case VTK_FLOAT: return "MET_FLOAT";
+	case VTK_DOUBLE: return "MET_DOUBLE";
+	default: return "";
+	}
+}
+
+int getVtkScalarType(QString metaElementType)
+{
+	if (metaElementType == "MET_CHAR") return VTK_SIGNED_CHAR;
+	if (metaElementType == "MET_UCHAR") return VTK_UNSIGNED_CHAR;
+	if (metaElementType == "MET_SHORT") return VTK_SHORT;
+	if (metaElementType == "MET_USHORT") return VTK_UNSIGNED_SHORT;
+	if (metaElementType == "MET_INT") return VTK_INT;
+	if (metaElementType == "MET_UINT") return VTK_UNSIGNED_INT;
+	if (metaElementType == "MET_FLOAT") return VTK_FLOAT;
+	if (metaElementType == "MET_DOUBLE") return VTK_DOUBLE;
+	return -1;
+}
+
+bool isTrue(QString value)
+{
+	return (value.compare("True", Qt::CaseInsensitive)==0) || (value=="1");
+}
+
+} // namespace
+
+///--------------------------------------------------------
+///--------------------------------------------------------
+///--------------------------------------------------------
+
+MappedFramesFileInfo::MappedFramesFileInfo() :
+	mDim(0,0,0),
+	mSpacing(1,1,1),
+	mScalarType(-1),
+	mComponents(1),
+	mHeaderSize(0)
+{
+}
+
+qint64 MappedFramesFileInfo::getFrameSize() const
+{
+	if (mScalarType<0)
+		return 0;
+	return qint64(mDim[0]) * mDim[1] * mComponents * vtkAbstractArray::GetDataTypeSize(mScalarType);
+}
+
+bool MappedFramesFileInfo::isCompatible(vtkImageDataPtr frame) const
+{
+	if (!frame)
+		return false;
+	MappedFramesFileInfo other = MappedFramesFileInfo::fromFrame(frame);
+	return (mDim[0]==other.mDim[0])
+			&& (mDim[1]==other.mDim[1])
+			&& (other.mDim[2]==1)
+			&& (mScalarType==other.mScalarType)
+			&& (mComponents==other.mComponents)
+			&& similar(mSpacing, other.mSpacing);
+}
+
+MappedFramesFileInfo MappedFramesFileInfo::fromFrame(vtkImageDataPtr frame)
+{
+	MappedFramesFileInfo retval;
+	retval.mDim = Eigen::Array3i(frame->GetDimensions());
+	retval.mSpacing = Vector3D(frame->GetSpacing());
+	retval.mScalarType = frame->GetScalarType();
+	retval.mComponents = frame->GetNumberOfScalarComponents();
+	return retval;
+}
+
+///--------------------------------------------------------
+///--------------------------------------------------------
+///--------------------------------------------------------
+
+MappedFramesFileWriter::MappedFramesFileWriter(QString mhdFilename) :
+	mFilename(mhdFilename),
+	mRawFile(getRawFilename(mhdFilename)),
+	mInitialized(false),
+	mFailed(false)
+{
+}
+
+MappedFramesFileWriter::~MappedFramesFileWriter()
+{
+	this->close();
+}
+
+QString MappedFramesFileWriter::getRawFilename(QString mhdFilename)
+{
+	return changeExtension(mhdFilename, "raw");
+}
+
+bool MappedFramesFileWriter::accepts(vtkImageDataPtr frame) const
+{
+	if (!frame)
+		return false;
+	if (!mInitialized)
+		return (frame->GetDimensions()[2]==1) && !getMetaElementType(frame->GetScalarType()).isEmpty();
+	return mInfo.isCompatible(frame);
+}
+
+bool MappedFramesFileWriter::open()
+{
+	if (!mRawFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		reportError("Cannot open " + mRawFile.fileName());
+		mFailed = true;
+		return false;
+	}
+	return true;
+}
+
+bool MappedFramesFileWriter::append(vtkImageDataPtr frame)
+{
+	if (mFailed || !this->accepts(frame))
+		return false;
+
+	if (!mInitialized)
+	{
+		mInfo = MappedFramesFileInfo::fromFrame(frame);
+		mInfo.mDim[2] = 0;
+		mInfo.mRawFilename = QFileInfo(mRawFile.fileName()).fileName();
+		mInitialized = true;
+		if (!this->open())
+			return false;
+	}
+
+	qint64 size = mInfo.getFrameSize();
+	if (mRawFile.write(static_cast<const char*>(frame->GetScalarPointer()), size) != size)
+	{
+		reportError("Failed to write frame to " + mRawFile.fileName());
+		mFailed = true;
+		return false;
+	}
+
+	++mInfo.mDim[2];
+	return true;
+}
+
+void MappedFramesFileWriter::setTag(QString key, QString value)
+{
+	mTags << QString("%1 = %2").arg(key).arg(value);
+}
+
+bool MappedFramesFileWriter::close()
+{
+	if (!mRawFile.isOpen())
+		return !mFailed;
+	mRawFile.close();
+	if (mFailed)
+		return false;
+	return this->writeHeader();
+}
+
+bool MappedFramesFileWriter::writeHeader()
+{
+	QFile file(mFilename);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		reportError("Cannot open " + mFilename);
+		return false;
+	}
+
+	QTextStream stream(&file);
+	stream << "ObjectType = Image" << "\n";
+	stream << "NDims = 3" << "\n";
+	stream << "BinaryData = True" << "\n";
+	stream << "BinaryDataByteOrderMSB = False" << "\n";
+	stream << "CompressedData = False" << "\n";
+	stream << "TransformMatrix = 1 0 0 0 1 0 0 0 1" << "\n";
+	stream << "Offset = 0 0 0" << "\n";
+	stream << "CenterOfRotation = 0 0 0" << "\n";
+	stream << "ElementSpacing = "
+		   << QString::number(mInfo.mSpacing[0], 'g', 10) << " "
+		   << QString::number(mInfo.mSpacing[1], 'g', 10) << " "
+		   << QString::number(mInfo.mSpacing[2], 'g', 10) << "\n";
+	stream << "DimSize = " << mInfo.mDim[0] << " " << mInfo.mDim[1] << " " << mInfo.mDim[2] << "\n";
+	if (mInfo.mComponents>1)
+		stream << "ElementNumberOfChannels = " << mInfo.mComponents << "\n";
+	for (int i=0; i<mTags.size(); ++i)
+		stream << mTags[i] << "\n";
+	stream << "ElementType = " << getMetaElementType(mInfo.mScalarType) << "\n";
+	stream << "ElementDataFile = " << mInfo.mRawFilename << "\n";
+	file.close();
+	return true;
+}
+
+///--------------------------------------------------------
+///--------------------------------------------------------
+///--------------------------------------------------------
+
+bool MappedImageDataContainer::readHeader(QString mhdFilename, MappedFramesFileInfo* info)
+{
+	QFile file(mhdFilename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	std::map<QString, QString> keys;
+	QTextStream stream(&file);
+	while (!stream.atEnd())
+	{
+		QString line = stream.readLine();
+		int pos = line.indexOf("=");
+		if (pos<0)
+			continue;
+		keys[line.left(pos).trimmed().toLower()] = line.mid(pos+1).trimmed();
+	}
+
+	if (isTrue(keys["compresseddata"]))
+		return false;
+	if (isTrue(keys["binarydatabyteordermsb"]) || isTrue(keys["elementbyteordermsb"]))
+		return false;
+
+	QStringList dim = keys["dimsize"].split(" ", QString::SkipEmptyParts);
+	if (dim.size()<2 || dim.size()>3)
+		return false;
+	info->mDim = Eigen::Array3i(dim[0].toInt(), dim[1].toInt(), 1);
+	if (dim.size()==3)
+		info->mDim[2] = dim[2].toInt();
+
+	QString spacingText = keys.count("elementspacing") ? keys["elementspacing"] : keys["elementsize"];
+	QStringList spacing = spacingText.split(" ", QString::SkipEmptyParts);
+	for (int i=0; i<spacing.size() && i<3; ++i)
+		info->mSpacing[i] = spacing[i].toDouble();
+
+	info->mScalarType = getVtkScalarType(keys["elementtype"]);
+	if (info->mScalarType<0)
+		return false;
+	if (keys.count("elementnumberofchannels"))
+		info->mComponents = keys["elementnumberofchannels"].toInt();
+	if (info->mComponents<1)
+		return false;
+
+	QString dataFile = keys["elementdatafile"];
+	if (dataFile.isEmpty() || dataFile=="LOCAL" || dataFile.startsWith("LIST") || dataFile.contains("%"))
+		return false;
+	info->mRawFilename = QDir(QFileInfo(mhdFilename).absolutePath()).absoluteFilePath(dataFile);
+
+	qint64 dataSize = info->getFrameSize() * info->mDim[2];
+	qint64 fileSize = QFileInfo(info->mRawFilename).size();
+	info->mHeaderSize = keys.count("headersize") ? keys["headersize"].toLongLong() : 0;
+	if (info->mHeaderSize<0) // -1 means data at end of file
+		info->mHeaderSize = fileSize - dataSize;
+	if (info->mHeaderSize<0 || fileSize < info->mHeaderSize + dataSize)
+		return false;
+
+	return true;
+}
+
+bool MappedImageDataContainer::canMap(QString mhdFilename)
+{
+	MappedFramesFileInfo info;
+	return readHeader(mhdFilename, &info);
+}
+
+MappedImageDataContainer::MappedImageDataContainer(QString mhdFilename) :
+	mFilename(mhdFilename),
+	mData(NULL),
+	mDeleteFilesOnRelease(false)
+{
+	if (!readHeader(mFilename, &mInfo))
+	{
+		reportError("Cannot map frames from " + mFilename);
+		mInfo = MappedFramesFileInfo();
+		return;
+	}
+
+	qint64 dataSize = mInfo.getFrameSize() * mInfo.mDim[2];
+	if (!dataSize)
+		return;
+
+	mRawFile.setFileName(mInfo.mRawFilename);
+	if (!mRawFile.open(QIODevice::ReadOnly))
+	{
+		reportError("Cannot open " + mRawFile.fileName());
+		mInfo.mDim[2] = 0;
+		return;
+	}
+
+	// private mapping: frames are copy-on-write, and the file is never modified.
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 4, 0))
+	mData = mRawFile.map(mInfo.mHeaderSize, dataSize, QFileDevice::MapPrivateOption);
+#else
+	mData = mRawFile.map(mInfo.mHeaderSize, dataSize);
+#endif
+	if (!mData)
+	{
+		reportError(QString("Failed to map %1: %2").arg(mRawFile.fileName()).arg(mRawFile.errorString()));
+		mInfo.mDim[2] = 0;
+	}
+}
+
+MappedImageDataContainer::~MappedImageDataContainer()
+{
+	if (mData)
+		mRawFile.unmap(mData);
+	mRawFile.close();
+
+	if (mDeleteFilesOnRelease)
+	{
+		QDir().remove(mFilename);
+		QDir().remove(mInfo.mRawFilename);
+	}
+}
+
+unsigned MappedImageDataContainer::size() const
+{
+	return mInfo.mDim[2];
+}
+
+unsigned char* MappedImageDataContainer::getFramePointer(unsigned index) const
+{
+	CX_ASSERT(index < this->size());
+	return mData + index * mInfo.getFrameSize();
+}
+
+vtkImageDataPtr MappedImageDataContainer::get(unsigned index)
+{
+	CX_ASSERT(index < this->size());
+	if (index >= this->size())
+		return vtkImageDataPtr();
+
+	vtkImageImportPtr import = vtkImageImportPtr::New();
+
+	import->SetImportVoidPointer(this->getFramePointer(index));
+	import->SetDataScalarType(mInfo.mScalarType);
+	import->SetDataSpacing(mInfo.mSpacing.data());
+	import->SetNumberOfScalarComponents(mInfo.mComponents);
+	IntBoundingBox3D extent(0, mInfo.mDim[0]-1, 0, mInfo.mDim[1]-1, 0, 0);
+	import->SetWholeExtent(extent.data());
+	import->SetDataExtentToWholeExtent();
+
+	import->Update();
+	return import->GetOutput();
+}
+
+} // namespace cx
@@ -0,0 +1,153 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXMAPPEDFRAMESFILE_H
+#define CXMAPPEDFRAMESFILE_H
+
+#include "cxResourceExport.h"
+
+#include <QFile>
+#include <QStringList>
+#include "cxImageDataContainer.h"
+#include "cxVector3D.h"
+
+namespace cx
+{
+
+/**
+ * \addtogroup cx_resource_core_utilities
+ * \{
+ */
+
+/** Description of a sequence of 2D frames stored contiguously in one raw file.
+ *
+ * The header is a standard uncompressed MetaImage (.mhd) with
+ * DimSize = X Y N, thus the file can also be read as a 3D volume
+ * by any MetaImage reader.
+ */
+struct cxResource_EXPORT MappedFramesFileInfo
+{
+	MappedFramesFileInfo();
+	Eigen::Array3i mDim; ///< frame size in x,y, number of frames in z
+	Vector3D mSpacing;
+	int mScalarType; ///< vtk scalar type
+	int mComponents;
+	qint64 mHeaderSize; ///< bytes to skip at start of raw file
+	QString mRawFilename;
+
+	qint64 getFrameSize() const; ///< bytes per frame
+	bool isCompatible(vtkImageDataPtr frame) const;
+	static MappedFramesFileInfo fromFrame(vtkImageDataPtr frame);
+};
+
+/** Write a sequence of frames into one raw file with a MetaImage header.
+ *
+ * Frames are appended to the raw file as they arrive. All frames must
+ * have the same size and format as the first. The header is written
+ * by close().
+ *
+ * \sa MappedImageDataContainer
+ */
+class cxResource_EXPORT MappedFramesFileWriter
+{
+public:
+	explicit MappedFramesFileWriter(QString mhdFilename);
+	~MappedFramesFileWriter();
+
+	bool accepts(vtkImageDataPtr frame) const; ///< true if frame can be appended
+	bool append(vtkImageDataPtr frame);
+	bool close(); ///< write header and close raw file. Called by destructor.
+	unsigned getNumberOfFrames() const { return mInfo.mDim[2]; }
+	QString getFilename() const { return mFilename; }
+	void setTag(QString key, QString value); ///< add custom key to the header
+
+	static QString getRawFilename(QString mhdFilename);
+
+private:
+	bool open();
+	bool writeHeader();
+	QString mFilename;
+	QFile mRawFile;
+	bool mInitialized;
+	bool mFailed;
+	MappedFramesFileInfo mInfo;
+	QStringList mTags;
+};
+
+/** Container for frames stored in a single raw file, see MappedFramesFileWriter.
+ *
+ * The raw file is memory mapped, and each frame is served as a
+ * vtkImageData pointing directly into the mapped memory. No frame data
+ * is read before it is accessed, and nothing is copied: the OS pages the
+ * data in and out as needed.
+ *
+ * The returned images are only valid as long as the container exists.
+ *
+ */
+class cxResource_EXPORT MappedImageDataContainer : public ImageDataContainer
+{
+public:
+	/** Return true if the mhd file is an uncompressed MetaImage with
+	  * a single raw file, i.e. it can be mapped.
+	  */
+	static bool canMap(QString mhdFilename);
+	static bool readHeader(QString mhdFilename, MappedFramesFileInfo* info);
+
+	explicit MappedImageDataContainer(QString mhdFilename);
+	virtual ~MappedImageDataContainer();
+	bool isValid() const { return mData!=NULL; }
+	virtual vtkImageDataPtr get(unsigned index);
+	virtual unsigned size() const;
+	unsigned char* getFramePointer(unsigned index) const;
+	QString getFilename() const { return mFilename; }
+	/**
+	* If set, the files managed by this object will be deleted when
+	* object goes out of scope
+	*/
+	void setDeleteFilesOnRelease(bool on) { mDeleteFilesOnRelease = on; }
+
+private:
+	QString mFilename;
+	QFile mRawFile;
+	uchar* mData;
+	MappedFramesFileInfo mInfo;
+	bool mDeleteFilesOnRelease;
+};
+typedef boost::shared_ptr<MappedImageDataContainer> MappedImageDataContainerPtr;
+
+/**
+ * \}
+ */
+
+} // namespace cx
+
+#endif // CXMAPPEDFRAMESFILE_H
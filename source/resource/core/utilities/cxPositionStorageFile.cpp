@@ -32,6 +32,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxPositionStorageFile.h"
 #include <QDateTime>
+#include <QFileInfo>
+#include <algorithm>
 #include <boost/cstdint.hpp>
 #include "cxFrame3D.h"
 #include "cxTime.h"
@@ -40,6 +42,155 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace cx
 {
 
+PositionStorageBlock::PositionStorageBlock() :
+	mOffset(0),
+	mSize(0),
+	mCount(0),
+	mStartTime(0),
+	mStopTime(0)
+{
+}
+
+//---------------------------------------------------------
+//---------------------------------------------------------
+//---------------------------------------------------------
+
+QString PositionStorageIndex::getFilename(QString positionsFilename)
+{
+	return positionsFilename + ".idx";
+}
+
+std::vector<PositionStorageBlock> PositionStorageIndex::load(QString positionsFilename)
+{
+	QString indexFilename = PositionStorageIndex::getFilename(positionsFilename);
+	std::vector<PositionStorageBlock> blocks = PositionStorageIndex::read(indexFilename);
+	qint64 size = QFileInfo(positionsFilename).size();
+
+	if (PositionStorageIndex::getEnd(blocks) > size)
+		blocks.clear(); // index belongs to another file
+
+	qint64 end = PositionStorageIndex::getEnd(blocks);
+	if (end < size)
+	{
+		// index is missing or outdated: scan the rest of the file
+		QString toolUid = blocks.empty() ? QString("") : blocks.back().mToolUid;
+		std::vector<PositionStorageBlock> added = PositionStorageIndex::scan(positionsFilename, end, toolUid);
+		if (!added.empty())
+			PositionStorageIndex::write(indexFilename, added, !blocks.empty());
+		blocks.insert(blocks.end(), added.begin(), added.end());
+	}
+
+	return blocks;
+}
+
+std::vector<PositionStorageBlock> PositionStorageIndex::scan(QString positionsFilename, qint64 offset, QString toolUid)
+{
+	std::vector<PositionStorageBlock> retval;
+
+	PositionStorageReader reader(positionsFilename);
+	if (!reader.seek(offset, toolUid))
+		return retval;
+
+	Transform3D matrix = Transform3D::Identity();
+	double timestamp;
+	QString uid;
+
+	while (!reader.atEnd())
+	{
+		qint64 pos = reader.pos();
+		if (!reader.read(&matrix, &timestamp, &uid))
+			break;
+
+		if (retval.empty() || (retval.back().mToolUid!=uid) || (retval.back().mCount>=mMaxBlockCount))
+		{
+			PositionStorageBlock block;
+			block.mOffset = pos;
+			block.mToolUid = uid;
+			block.mStartTime = timestamp;
+			block.mStopTime = timestamp;
+			retval.push_back(block);
+		}
+
+		PositionStorageBlock& block = retval.back();
+		++block.mCount;
+		block.mStartTime = std::min(block.mStartTime, timestamp);
+		block.mStopTime = std::max(block.mStopTime, timestamp);
+		block.mSize = reader.pos() - block.mOffset;
+	}
+
+	return retval;
+}
+
+std::vector<PositionStorageBlock> PositionStorageIndex::read(QString indexFilename)
+{
+	std::vector<PositionStorageBlock> retval;
+
+	QFile file(indexFilename);
+	if (!file.open(QIODevice::ReadOnly))
+		return retval;
+	QDataStream stream(&file);
+	stream.setByteOrder(QDataStream::LittleEndian);
+
+	char header[7];
+	memset(header, 0, sizeof(header));
+	stream.readRawData(header, 6);
+	quint8 version = 0;
+	stream >> version;
+	if (QString(header)!="SNWIDX" || version!=1)
+		return retval;
+
+	qint64 end = mPositionsHeaderSize;
+	while (!stream.atEnd())
+	{
+		PositionStorageBlock block;
+		stream >> block.mOffset >> block.mSize >> block.mCount;
+		stream >> block.mStartTime >> block.mStopTime >> block.mToolUid;
+		// discard corrupt or noncontiguous indices, they will be rebuilt.
+		if ((stream.status()!=QDataStream::Ok) || (block.mOffset!=end))
+			return std::vector<PositionStorageBlock>();
+		end = block.getEnd();
+		retval.push_back(block);
+	}
+
+	return retval;
+}
+
+bool PositionStorageIndex::write(QString indexFilename, const std::vector<PositionStorageBlock>& blocks, bool append)
+{
+	QFile file(indexFilename);
+	QIODevice::OpenMode mode = append ? QIODevice::Append : (QIODevice::WriteOnly | QIODevice::Truncate);
+	if (!file.open(mode))
+		return false;
+	QDataStream stream(&file);
+	stream.setByteOrder(QDataStream::LittleEndian);
+
+	if (file.size() == 0)
+	{
+		stream.writeRawData("SNWIDX", 6);
+		stream << (quint8)1;
+	}
+
+	for (unsigned i=0; i<blocks.size(); ++i)
+	{
+		const PositionStorageBlock& block = blocks[i];
+		stream << block.mOffset << block.mSize << block.mCount;
+		stream << block.mStartTime << block.mStopTime << block.mToolUid;
+	}
+
+	return stream.status()==QDataStream::Ok;
+}
+
+qint64 PositionStorageIndex::getEnd(const std::vector<PositionStorageBlock>& blocks)
+{
+	if (blocks.empty())
+		return mPositionsHeaderSize;
+	return blocks.back().getEnd();
+}
+
+//---------------------------------------------------------
+//---------------------------------------------------------
+//---------------------------------------------------------
+
 
 PositionStorageReader::PositionStorageReader(QString filename) : positions(filename)
 {
@@ -176,6 +327,40 @@ bool PositionStorageReader::read(Transform3D* matrix, double* timestamp, QString
   return false;
 }
 
+bool PositionStorageReader::read(const PositionStorageBlock& block, std::vector<double>* timestamps, std::vector<Transform3D>* matrices)
+{
+	if (!this->seek(block.mOffset, block.mToolUid))
+		return false;
+
+	Transform3D matrix = Transform3D::Identity();
+	double timestamp;
+	QString toolUid;
+
+	while (!this->atEnd() && (this->pos() < block.getEnd()))
+	{
+		if (!this->read(&matrix, &timestamp, &toolUid))
+			return false;
+		timestamps->push_back(timestamp);
+		matrices->push_back(matrix);
+	}
+	return true;
+}
+
+qint64 PositionStorageReader::pos() const
+{
+	return positions.pos();
+}
+
+bool PositionStorageReader::seek(qint64 offset, QString toolUid)
+{
+	if (!positions.isOpen() || !positions.seek(offset))
+		return false;
+	stream.resetStatus();
+	mError = false;
+	mCurrentToolUid = toolUid;
+	return true;
+}
+
 Frame3D PositionStorageReader::frameFromStream()
 {
   boost::array<double, 6> rep;
@@ -207,26 +392,57 @@ QString PositionStorageReader::timestampToString(double timestamp)
 //---------------------------------------------------------
 
 
-PositionStorageWriter::PositionStorageWriter(QString filename) : positions(filename)
+PositionStorageWriter::PositionStorageWriter(QString filename) : positions(filename), mWriteIndex(false)
 {
+	QString indexFilename = PositionStorageIndex::getFilename(filename);
 	positions.open(QIODevice::Append);
 	stream.setDevice(&positions);
 	stream.setByteOrder(QDataStream::LittleEndian);
 	if (positions.size() == 0)
 	{
+		QFile::remove(indexFilename);
 		stream.writeRawData("SNWPOS", 6);
 		stream << (quint8)2; // version 1 had only 32 bit timestamps
+		mWriteIndex = true;
+	}
+	else
+	{
+		// append to the index only if it is up to date, otherwise it is rebuilt by PositionStorageIndex::load()
+		std::vector<PositionStorageBlock> blocks = PositionStorageIndex::read(indexFilename);
+		mWriteIndex = !blocks.empty() && (PositionStorageIndex::getEnd(blocks) == positions.size());
 	}
 }
 
 PositionStorageWriter::~PositionStorageWriter()
 {
 	positions.close();
+
+	if (mWriteIndex && !mBlocks.empty())
+		PositionStorageIndex::write(PositionStorageIndex::getFilename(positions.fileName()), mBlocks, true);
 }
 
+void PositionStorageWriter::addToBlock(QString toolUid, qint64 offset, uint64_t timestamp)
+{
+	if (mBlocks.empty() || (mBlocks.back().mToolUid!=toolUid) || (mBlocks.back().mCount>=PositionStorageIndex::mMaxBlockCount))
+	{
+		PositionStorageBlock block;
+		block.mOffset = offset;
+		block.mToolUid = toolUid;
+		block.mStartTime = timestamp;
+		block.mStopTime = timestamp;
+		mBlocks.push_back(block);
+	}
+
+	PositionStorageBlock& block = mBlocks.back();
+	++block.mCount;
+	block.mStartTime = std::min<double>(block.mStartTime, timestamp);
+	block.mStopTime = std::max<double>(block.mStopTime, timestamp);
+}
 
 void PositionStorageWriter::write(Transform3D matrix, uint64_t timestamp, int toolIndex)
 {
+	this->addToBlock(QString::number(toolIndex), positions.pos(), timestamp);
+
 	Frame3D frame = Frame3D::create(matrix);
 
 	stream << (quint8)1;	// Type - there is only one
@@ -242,10 +458,14 @@ void PositionStorageWriter::write(Transform3D matrix, uint64_t timestamp, int to
 	stream << (double)frame.mPos[0];
 	stream << (double)frame.mPos[1];
 	stream << (double)frame.mPos[2];
+
+	mBlocks.back().mSize = positions.pos() - mBlocks.back().mOffset;
 }
 
 void PositionStorageWriter::write(Transform3D matrix, uint64_t timestamp, QString toolUid)
 {
+  this->addToBlock(toolUid, positions.pos(), timestamp);
+
   if (toolUid!=mCurrentToolUid)
   {
     QByteArray name = toolUid.toLatin1();
@@ -255,8 +475,13 @@ void PositionStorageWriter::write(Transform3D matrix, uint64_t timestamp, QStrin
     stream.writeBytes(name.data(), name.size());
     mCurrentToolUid = toolUid;
   }
-  else
-  {
+
+  this->writePosition(matrix, timestamp);
+  mBlocks.back().mSize = positions.pos() - mBlocks.back().mOffset;
+}
+
+void PositionStorageWriter::writePosition(const Transform3D& matrix, uint64_t timestamp)
+{
     Frame3D frame = Frame3D::create(matrix);
     boost::array<double, 6> rep = frame.getCompactAxisAngleRep();
 
@@ -272,8 +497,6 @@ void PositionStorageWriter::write(Transform3D matrix, uint64_t timestamp, QStrin
     stream << rep[3];
     stream << rep[4];
     stream << rep[5];
-  }
-
 }
 
 
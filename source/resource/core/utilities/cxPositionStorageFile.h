@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxResourceExport.h"
 
+#include <vector>
 #include <QString>
 #include <QFile>
 #include <QDataStream>
@@ -44,6 +45,68 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace cx {
 
+/**\brief A contiguous range of records in the position file.
+ *
+ * All positions in a block belong to the same tool, and are
+ * sorted by time.
+ *
+ * \sa PositionStorageIndex
+ * \ingroup cx_resource_core_utilities
+ */
+struct cxResource_EXPORT PositionStorageBlock
+{
+	PositionStorageBlock();
+	qint64 mOffset; ///< file position of the first record
+	qint64 mSize; ///< size of all records in bytes
+	quint32 mCount; ///< number of positions
+	double mStartTime; ///< timestamp of the first position
+	double mStopTime; ///< timestamp of the last position
+	QString mToolUid;
+
+	qint64 getEnd() const { return mOffset + mSize; }
+	bool overlaps(double startTime, double stopTime) const { return (mStartTime<=stopTime) && (startTime<=mStopTime); }
+};
+
+/**\brief Block index for the position file.
+ *
+ * The index is stored next to the position file as \<filename\>.idx, and
+ * enables reading only the time windows of the position file that are used.
+ * PositionStorageWriter appends to the index if it is up to date, otherwise
+ * load() creates or updates the index by scanning the position file.
+ *
+ * Binary file format description
+   \verbatim
+  Header:
+    "SNWIDX"<version>
+
+  Entries, one for each block:
+    <offset><size><count><starttime><stoptime><toolUid>
+   \endverbatim
+ *
+ * The blocks cover the position file contiguously, starting after the header.
+ *
+ * \sa PositionStorageReader
+ * \ingroup cx_resource_core_utilities
+ */
+class cxResource_EXPORT PositionStorageIndex
+{
+public:
+	static QString getFilename(QString positionsFilename);
+	/** Return the blocks in the position file.
+	  * The index file is created or updated if it does not cover the position file.
+	  */
+	static std::vector<PositionStorageBlock> load(QString positionsFilename);
+	/** Scan the position file from offset, where toolUid is the current tool at offset.
+	  */
+	static std::vector<PositionStorageBlock> scan(QString positionsFilename, qint64 offset, QString toolUid);
+	static std::vector<PositionStorageBlock> read(QString indexFilename); ///< empty if invalid
+	static bool write(QString indexFilename, const std::vector<PositionStorageBlock>& blocks, bool append);
+	static qint64 getEnd(const std::vector<PositionStorageBlock>& blocks); ///< end of the last block, or end of header if empty
+
+	static const quint32 mMaxBlockCount = 1024; ///< max number of positions in each block
+	static const qint64 mPositionsHeaderSize = 7; ///< size of the position file header
+};
+
 /**\brief Reader class for the position file.
  * 
  * Each call to read() gives the next position entry from the file.
@@ -82,6 +145,13 @@ public:
 	~PositionStorageReader();
 	bool read(Transform3D* matrix, double* timestamp, int* toolIndex); // reads only tool data in integer format.
 	bool read(Transform3D* matrix, double* timestamp, QString* toolUid);
+	/** Read all positions in block, appending to timestamps and matrices.
+	  */
+	bool read(const PositionStorageBlock& block, std::vector<double>* timestamps, std::vector<Transform3D>* matrices);
+	qint64 pos() const; ///< file position of the next record
+	/** Continue reading from offset, where toolUid is the tool current at that position.
+	  */
+	bool seek(qint64 offset, QString toolUid);
 	bool atEnd() const;
 	static QString timestampToString(double timestamp);
 	int version();
@@ -102,6 +172,9 @@ typedef boost::shared_ptr<PositionStorageReader> PositionStorageReaderPtr;
  * of tool position data along with timestamp and tool id.
  * Extract the info with class PositionStorageReader.
  *
+ * The block index (PositionStorageIndex) is also updated,
+ * if it covered the file when opened.
+ *
  * For a description of the file format, see PositionStorageReader.
  *
  * \sa PositionStorageReader
@@ -115,9 +188,13 @@ public:
 	void write(Transform3D matrix, uint64_t timestamp, int toolIndex);
 	void write(Transform3D matrix, uint64_t timestamp, QString toolUid);
 private:
+	void writePosition(const Transform3D& matrix, uint64_t timestamp);
+	void addToBlock(QString toolUid, qint64 offset, uint64_t timestamp);
 	QString mCurrentToolUid; ///< the tool currently being written.
 	QFile positions;
 	QDataStream stream;
+	bool mWriteIndex;
+	std::vector<PositionStorageBlock> mBlocks; ///< blocks written by this writer
 };
 
 } // namespace cx 
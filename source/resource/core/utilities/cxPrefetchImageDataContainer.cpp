@@ -0,0 +1,192 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxPrefetchImageDataContainer.h"
+
+#include <algorithm>
+#include <QtConcurrent>
+#include <vtkImageData.h>
+#include "boost/bind.hpp"
+
+namespace cx
+{
+
+PrefetchImageDataContainer::PrefetchImageDataContainer(ImageDataContainerPtr base, unsigned capacity, unsigned readAhead) :
+	mBase(base),
+	mCapacity(std::max(capacity, readAhead+1)), // room for the current frame and the read-ahead
+	mReadAhead(readAhead),
+	mLastIndex(0),
+	mMisses(0)
+{
+}
+
+PrefetchImageDataContainer::~PrefetchImageDataContainer()
+{
+	this->waitForPendingLoads();
+}
+
+unsigned PrefetchImageDataContainer::size() const
+{
+	return mBase->size();
+}
+
+bool PrefetchImageDataContainer::isCached(unsigned index) const
+{
+	return mCache.count(index);
+}
+
+vtkImageDataPtr PrefetchImageDataContainer::get(unsigned index)
+{
+	if (index >= this->size())
+		return vtkImageDataPtr();
+	if (mBase->isInMemory())
+		return mBase->get(index);
+
+	this->collectFinishedLoads();
+
+	vtkImageDataPtr retval;
+	std::map<unsigned, Entry>::iterator iter = mCache.find(index);
+	if (iter!=mCache.end())
+	{
+		mRecent.splice(mRecent.begin(), mRecent, iter->second.mRecent);
+		retval = iter->second.mImage;
+	}
+	else
+	{
+		std::map<unsigned, QFuture<vtkImageDataPtr> >::iterator pending = mPending.find(index);
+		if (pending!=mPending.end())
+		{
+			retval = pending->second.result();
+			mPending.erase(pending);
+		}
+		else
+		{
+			retval = this->load(mBase, index);
+		}
+		++mMisses;
+		this->insert(index, retval);
+	}
+
+	int direction = (index < mLastIndex) ? -1 : 1;
+	mLastIndex = index;
+	this->readAhead(index, direction);
+
+	return retval;
+}
+
+bool PrefetchImageDataContainer::purge(unsigned index)
+{
+	std::map<unsigned, Entry>::iterator iter = mCache.find(index);
+	if (iter==mCache.end())
+		return false;
+	mRecent.erase(iter->second.mRecent);
+	mCache.erase(iter);
+	return true;
+}
+
+void PrefetchImageDataContainer::waitForPendingLoads()
+{
+	for (std::map<unsigned, QFuture<vtkImageDataPtr> >::iterator iter=mPending.begin(); iter!=mPending.end(); ++iter)
+		iter->second.waitForFinished();
+	this->collectFinishedLoads();
+}
+
+/** Load from base and copy into memory owned by the returned frame,
+ *  thus the frame is independent of the base.
+ *  Called from worker threads.
+ */
+vtkImageDataPtr PrefetchImageDataContainer::load(ImageDataContainerPtr base, unsigned index)
+{
+	vtkImageDataPtr image = base->get(index);
+	if (!image)
+		return vtkImageDataPtr();
+	vtkImageDataPtr retval = vtkImageDataPtr::New();
+	retval->DeepCopy(image);
+	base->purge(index);
+	return retval;
+}
+
+void PrefetchImageDataContainer::collectFinishedLoads()
+{
+	std::map<unsigned, QFuture<vtkImageDataPtr> >::iterator iter = mPending.begin();
+	while (iter!=mPending.end())
+	{
+		if (iter->second.isFinished())
+		{
+			this->insert(iter->first, iter->second.result());
+			mPending.erase(iter++);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+/** Start loading the frames following index in the given direction.
+ *  Loads cannot be cancelled, thus allow the read-ahead from before a
+ *  change of direction to complete, but not more.
+ */
+void PrefetchImageDataContainer::readAhead(unsigned index, int direction)
+{
+	for (unsigned i=1; i<=mReadAhead; ++i)
+	{
+		if (mPending.size() >= 2*mReadAhead)
+			return;
+		int next = int(index) + direction*int(i);
+		if (next<0 || next>=int(this->size()))
+			return;
+		if (mCache.count(next) || mPending.count(next))
+			continue;
+		mPending[next] = QtConcurrent::run(boost::bind(&PrefetchImageDataContainer::load, mBase, unsigned(next)));
+	}
+}
+
+void PrefetchImageDataContainer::insert(unsigned index, vtkImageDataPtr image)
+{
+	if (!image || mCache.count(index))
+		return;
+
+	mRecent.push_front(index);
+	Entry entry;
+	entry.mImage = image;
+	entry.mRecent = mRecent.begin();
+	mCache[index] = entry;
+
+	while (mCache.size() > mCapacity)
+	{
+		mCache.erase(mRecent.back());
+		mRecent.pop_back();
+	}
+}
+
+} // namespace cx
@@ -0,0 +1,110 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXPREFETCHIMAGEDATACONTAINER_H
+#define CXPREFETCHIMAGEDATACONTAINER_H
+
+#include "cxResourceExport.h"
+
+#include <list>
+#include <map>
+#include <QFuture>
+#include "cxImageDataContainer.h"
+
+namespace cx
+{
+
+/**
+ * \addtogroup cx_resource_core_utilities
+ * \{
+ */
+
+/** Container caching the frames of another container, with read-ahead.
+ *
+ * At most capacity frames are kept in memory, the least recently used
+ * frame is evicted first. After each get(), the next frames in the
+ * direction of access are loaded in background threads, thus
+ * playback forwards or backwards rarely waits for loading.
+ *
+ * Frames are deep copied from the base container, which is then purged.
+ * If the base holds all frames in memory, they are returned directly
+ * without caching or read-ahead.
+ *
+ * Use from one thread only. The base container is accessed from
+ * worker threads, but never for the same index at the same time.
+ *
+ * \date 2026-10-18
+ */
+class cxResource_EXPORT PrefetchImageDataContainer : public ImageDataContainer
+{
+public:
+	explicit PrefetchImageDataContainer(ImageDataContainerPtr base, unsigned capacity=64, unsigned readAhead=8);
+	virtual ~PrefetchImageDataContainer(); ///< waits for pending loads
+	virtual vtkImageDataPtr get(unsigned index);
+	virtual unsigned size() const;
+	virtual bool purge(unsigned index);
+
+	bool isCached(unsigned index) const;
+	unsigned getNumberOfCachedFrames() const { return mCache.size(); }
+	unsigned getNumberOfMisses() const { return mMisses; } ///< number of get() that had to load the frame
+	void waitForPendingLoads();
+
+private:
+	static vtkImageDataPtr load(ImageDataContainerPtr base, unsigned index);
+	void collectFinishedLoads();
+	void readAhead(unsigned index, int direction);
+	void insert(unsigned index, vtkImageDataPtr image);
+
+	struct Entry
+	{
+		vtkImageDataPtr mImage;
+		std::list<unsigned>::iterator mRecent;
+	};
+
+	ImageDataContainerPtr mBase;
+	unsigned mCapacity;
+	unsigned mReadAhead;
+	std::list<unsigned> mRecent; ///< cached indices, most recently used first
+	std::map<unsigned, Entry> mCache;
+	std::map<unsigned, QFuture<vtkImageDataPtr> > mPending;
+	unsigned mLastIndex;
+	unsigned mMisses;
+};
+typedef boost::shared_ptr<PrefetchImageDataContainer> PrefetchImageDataContainerPtr;
+
+/**
+ * \}
+ */
+
+} // namespace cx
+
+#endif // CXPREFETCHIMAGEDATACONTAINER_H
@@ -31,6 +31,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 =========================================================================*/
 #include "cxSharedMemory.h"
 
+#include <QThread>
+#include <QWaitCondition>
+#include <QMutexLocker>
+
 namespace cx
 {
 
@@ -43,10 +47,93 @@ struct shm_header
 	qint32 bufferSize;	// size of each buffer
 	qint32 headerSize;	// size of this header
 	qint64 timestamp;	// timestamp of last buffer that was written
+	qint64 sequence;	// sequence number of last buffer that was written
+	qint32 waiting;		// number of client threads waiting for the next buffer
 	qint32 buffer[0];	// number of readers currently operating on each buffer
 };
 
-SharedMemoryServer::SharedMemoryServer(QString key, int buffers, int sizeEach, QObject *parent) : mBuffer(key, parent)
+namespace
+{
+QString getNewBufferSemaphoreKey(QString key)
+{
+	return key + "_newbuffer";
+}
+}
+
+/** Bound the time a thread blocks in SharedMemoryClient::waitForNewBuffer().
+ *
+ * QSystemSemaphore cannot be acquired with a timeout. Instead, this thread
+ * wakes the waiting thread when the timeout expires, e.g. because the server
+ * has crashed and will never release the semaphore.
+ */
+class SharedMemoryWaitTimeout : public QThread
+{
+public:
+	explicit SharedMemoryWaitTimeout(SharedMemoryClient* client) :
+		mClient(client), mWait(0), mTimeout(0), mQuit(false)
+	{
+	}
+	virtual ~SharedMemoryWaitTimeout()
+	{
+		{
+			QMutexLocker locker(&mMutex);
+			mQuit = true;
+			mCondition.wakeAll();
+		}
+		this->wait();
+	}
+	void arm(int timeout)
+	{
+		QMutexLocker locker(&mMutex);
+		++mWait;
+		mTimeout = timeout;
+		mCondition.wakeAll();
+	}
+	void disarm()
+	{
+		QMutexLocker locker(&mMutex);
+		++mWait;
+		mTimeout = -1;
+		mCondition.wakeAll();
+	}
+
+protected:
+	virtual void run()
+	{
+		QMutexLocker locker(&mMutex);
+		while (!mQuit)
+		{
+			if (mTimeout < 0)
+			{
+				mCondition.wait(&mMutex);
+				continue;
+			}
+			int wait = mWait;
+			if (mCondition.wait(&mMutex, mTimeout))
+				continue; // armed again or disarmed
+			// Repeat until the wait ends, as the release may be taken by another client.
+			while (!mQuit && mWait == wait)
+			{
+				locker.unlock();
+				mClient->wakeWaiting();
+				locker.relock();
+				mCondition.wait(&mMutex, 20);
+			}
+		}
+	}
+
+private:
+	SharedMemoryClient* mClient;
+	int mWait; ///< incremented each time a wait starts or ends
+	int mTimeout; ///< timeout of the current wait, -1 if no wait
+	bool mQuit;
+	QMutex mMutex;
+	QWaitCondition mCondition;
+};
+
+SharedMemoryServer::SharedMemoryServer(QString key, int buffers, int sizeEach, QObject *parent) :
+	mBuffer(key, parent),
+	mNewBuffer(getNewBufferSemaphoreKey(key), 0, QSystemSemaphore::Create)
 {
 	int headerSize = sizeof(struct shm_header) + buffers * sizeof(qint32);
 	mSize = sizeEach;
@@ -74,6 +161,8 @@ SharedMemoryServer::SharedMemoryServer(QString key, int buffers, int sizeEach, Q
 	header->lastDone = -1;
 	header->writeBuffer = -1;
 	header->timestamp = 0;
+	header->sequence = 0;
+	header->waiting = 0;
 	memset(header->buffer, 0, sizeof(qint32) * buffers);
 	mCurrentBuffer = -1;
 }
@@ -90,18 +179,12 @@ void *SharedMemoryServer::buffer()
 	if (header)
 	{
 		mBuffer.lock();
-		// Find first next buffer that is not being read; searching from left to right
-		for (int i = mCurrentBuffer + 1; i < header->numBuffers && !found; i++)
-		{
-			if (header->buffer[i] == 0) // no read locks
-			{
-				found = true;
-				internalRelease(false);
-				mCurrentBuffer = i;
-			}
-		}
-		for (int i = 0; i < header->numBuffers && !found; i++)
+		// Find the next buffer that is not being read, continuing the circle after the
+		// last buffer written. Thus the latest buffer is the last one to be reused.
+		int last = (mCurrentBuffer >= 0) ? mCurrentBuffer : header->lastDone;
+		for (int n = 1; n <= header->numBuffers && !found; n++)
 		{
+			int i = (last + n) % header->numBuffers;
 			if (header->buffer[i] == 0) // no read locks
 			{
 				found = true;
@@ -136,8 +219,13 @@ void SharedMemoryServer::internalRelease(bool lock)
 		header->writeBuffer = -1;
 		mLastTimestamp = QDateTime::currentDateTime();
 		header->timestamp = mLastTimestamp.toMSecsSinceEpoch();
+		header->sequence++;
+		int wake = header->waiting;
+		header->waiting = 0;
 		if (lock) mBuffer.unlock();
 		mCurrentBuffer = -1;
+		if (wake > 0)
+			mNewBuffer.release(wake); // one for each waiting thread, in all clients
 	}
 }
 
@@ -146,11 +234,29 @@ void SharedMemoryServer::release()
 	internalRelease(true);
 }
 
-SharedMemoryClient::SharedMemoryClient(QObject *parent) : mBuffer(parent)
+SharedMemoryClient::SharedMemoryClient(QObject *parent) :
+	mBuffer(parent),
+	mNewBuffer(QString(), 0, QSystemSemaphore::Open),
+	mWaiters(0),
+	mWaitTimeout(NULL)
 {
 	mSize = 0;
 	mBuffers = 0;
 	mCurrentBuffer = -1;
+	mSequence = 0;
+}
+
+// QSharedMemory::lock() is not thread-safe within a process, serialize it.
+void SharedMemoryClient::lock()
+{
+	mMutex.lock();
+	mBuffer.lock();
+}
+
+void SharedMemoryClient::unlock()
+{
+	mBuffer.unlock();
+	mMutex.unlock();
 }
 
 bool SharedMemoryClient::attach(const QString &key)
@@ -162,6 +268,7 @@ bool SharedMemoryClient::attach(const QString &key)
 		const struct shm_header *header = (const struct shm_header *)mBuffer.data();
 		mSize = header->bufferSize;
 		mBuffers = header->numBuffers;
+		mNewBuffer.setKey(getNewBufferSemaphoreKey(key), 0, QSystemSemaphore::Open);
 	}
 	return success;
 }
@@ -176,11 +283,11 @@ const void *SharedMemoryClient::buffer(bool onlyNew)
 	struct shm_header *header = (struct shm_header *)mBuffer.data();
 	if (header)
 	{
-		mBuffer.lock();
+		this->lock();
 		if (header->lastDone == -1 || header->lastDone == header->writeBuffer ||
 			( onlyNew && header->lastDone == mCurrentBuffer) )
 		{
-			mBuffer.unlock();
+			this->unlock();
 			return NULL; // Nothing 
 		}
 		if (mCurrentBuffer >= 0 && header->buffer[mCurrentBuffer] > 0)
@@ -191,7 +298,8 @@ const void *SharedMemoryClient::buffer(bool onlyNew)
 		mCurrentBuffer = header->lastDone;
 		const void *ptr = ((const char *)header) + header->headerSize + header->bufferSize * header->lastDone;
 		mTimestamp.setMSecsSinceEpoch(header->timestamp);
-		mBuffer.unlock();
+		mSequence = header->sequence;
+		this->unlock();
 		return ptr;
 	}
 	return NULL;
@@ -207,18 +315,119 @@ void SharedMemoryClient::release()
 	struct shm_header *header = (struct shm_header *)mBuffer.data();
 	if (header && mCurrentBuffer >= 0)
 	{
-		mBuffer.lock();
+		this->lock();
 		if (header->buffer[mCurrentBuffer] > 0)
 		{
 			header->buffer[mCurrentBuffer]--;
 		}
-		mBuffer.unlock();
+		this->unlock();
 		mCurrentBuffer = -1;
 	}
 }
 
+int SharedMemoryClient::lockLatestBuffer(qint64 lastSequence, qint64* sequence, QDateTime* timestamp)
+{
+	struct shm_header *header = (struct shm_header *)mBuffer.data();
+	if (!header)
+		return -1;
+
+	this->lock();
+	if (header->lastDone == -1 || header->lastDone == header->writeBuffer || header->sequence <= lastSequence)
+	{
+		this->unlock();
+		return -1;
+	}
+	int index = header->lastDone;
+	header->buffer[index]++; // Lock page against writing
+	if (sequence)
+		*sequence = header->sequence;
+	if (timestamp)
+		timestamp->setMSecsSinceEpoch(header->timestamp);
+	this->unlock();
+	return index;
+}
+
+const void *SharedMemoryClient::getBuffer(int index)
+{
+	const struct shm_header *header = (const struct shm_header *)mBuffer.data();
+	if (!header || index < 0 || index >= header->numBuffers)
+		return NULL;
+	return ((const char *)header) + header->headerSize + header->bufferSize * index;
+}
+
+void SharedMemoryClient::unlockBuffer(int index)
+{
+	struct shm_header *header = (struct shm_header *)mBuffer.data();
+	if (!header || index < 0 || index >= header->numBuffers)
+		return;
+	this->lock();
+	if (header->buffer[index] > 0)
+	{
+		header->buffer[index]--;
+	}
+	this->unlock();
+}
+
+qint64 SharedMemoryClient::waitForNewBuffer(qint64 lastSequence, int timeout)
+{
+	struct shm_header *header = (struct shm_header *)mBuffer.data();
+	if (!header)
+		return -1;
+
+	this->lock();
+	qint64 sequence = header->sequence;
+	// Ask the server for a wakeup only if there is nothing new. The server releases
+	// the semaphore once for each waiting thread, thus no client is left behind.
+	if (sequence <= lastSequence)
+	{
+		header->waiting++;
+		mWaiters.ref();
+		if (timeout >= 0 && !mWaitTimeout)
+		{
+			mWaitTimeout = new SharedMemoryWaitTimeout(this);
+			mWaitTimeout->start();
+		}
+	}
+	this->unlock();
+	if (sequence > lastSequence)
+		return sequence;
+
+	if (timeout >= 0)
+		mWaitTimeout->arm(timeout);
+	bool acquired = mNewBuffer.acquire();
+	if (timeout >= 0)
+		mWaitTimeout->disarm();
+	mWaiters.deref();
+	if (!acquired)
+		return -1;
+
+	this->lock();
+	sequence = header->sequence;
+	this->unlock();
+	return sequence;
+}
+
+void SharedMemoryClient::wakeWaiting()
+{
+	struct shm_header *header = (struct shm_header *)mBuffer.data();
+	if (!header)
+		return;
+	this->lock();
+	// Release only when a thread here is waiting, and remove it from the count
+	// so the server will not release for it as well. The semaphore is shared
+	// with other clients, which may take this release: call again if the
+	// thread does not return.
+	bool wake = mWaiters.loadAcquire() > 0;
+	if (wake && header->waiting > 0)
+		header->waiting--;
+	this->unlock();
+	if (wake)
+		mNewBuffer.release();
+}
+
 SharedMemoryClient::~SharedMemoryClient()
 {
+	delete mWaitTimeout;
 	release();
 }
 
@@ -36,10 +36,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxResourceExport.h"
 
 #include <QSharedMemory>
+#include <QSystemSemaphore>
 #include <QDateTime>
+#include <QMutex>
+#include <QAtomicInt>
 
 namespace cx
 {
+class SharedMemoryWaitTimeout;
 
 /// Implements a circular buffer in shared memory using a client-server model,
 /// where you have one writer and potentially multiple readers. Note that if you
@@ -55,6 +59,9 @@ namespace cx
  * you want to write new data. Readers always grab the latest buffer. Things go
  * more smooth when all users release their buffers as soon as they are done.
  *
+ * Each released buffer gets a sequence number. A client waiting for new
+ * buffers is woken up through a system semaphore instead of polling.
+ *
  * \sa SharedMemoryClient
  * \ingroup cx_resource_core_utilities
  */
@@ -66,6 +73,7 @@ private:
 	int mBuffers;
 	int mCurrentBuffer;
 	QDateTime mLastTimestamp;
+	QSystemSemaphore mNewBuffer; ///< released when a buffer is released and a client waits
 
 public:
 	/**
@@ -98,6 +106,15 @@ private:
 
 /**\brief Shared Memory Client
  *
+ * Use either buffer()/release() to hold one buffer at a time, or
+ * lockLatestBuffer()/unlockBuffer() to hold several buffers. The
+ * latter are thread-safe: the shared memory lock is taken through a
+ * process-local mutex.
+ *
+ * waitForNewBuffer() blocks until the server releases a buffer. Several
+ * clients can wait at the same time, but use only one waiting thread in
+ * each client. Give a timeout to return also if the server stops
+ * releasing buffers, e.g. because it has crashed.
  *
  * \sa SharedMemoryServer
  * \ingroup cx_resource_core_utilities
@@ -110,6 +127,13 @@ private:
 	int mBuffers;
 	int mCurrentBuffer;
 	QDateTime mTimestamp; ///< Time of writing of current buffer
+	qint64 mSequence; ///< Sequence number of current buffer
+	QSystemSemaphore mNewBuffer;
+	QMutex mMutex; ///< serializes mBuffer.lock() between threads in this process
+	QAtomicInt mWaiters; ///< number of threads blocked in waitForNewBuffer()
+	SharedMemoryWaitTimeout* mWaitTimeout; ///< wakes up waitForNewBuffer() when the timeout expires
+	void lock();
+	void unlock();
 
 public:
 	SharedMemoryClient(QObject *parent = 0);
@@ -123,6 +147,23 @@ public:
 	void release();			///< Release our read buffer
 	const void *isNew();		///< Return new buffer only if new is available, otherwise return NULL
 	QDateTime timestamp() { return mTimestamp; }
+	qint64 sequence() { return mSequence; } ///< sequence number of current buffer, starting at 1
+
+	/** Read lock the latest buffer if its sequence number is larger than lastSequence.
+	  * Return the buffer index, or -1 if nothing new is available.
+	  * The buffer must be unlocked with unlockBuffer().
+	  */
+	int lockLatestBuffer(qint64 lastSequence, qint64* sequence, QDateTime* timestamp);
+	const void *getBuffer(int index);
+	void unlockBuffer(int index);
+
+	/** Block until a buffer with sequence number larger than lastSequence
+	  * is released, wakeWaiting() is called, or timeout milliseconds have
+	  * passed. A negative timeout waits forever.
+	  * Return the latest sequence number, or -1 on error.
+	  */
+	qint64 waitForNewBuffer(qint64 lastSequence, int timeout = -1);
+	void wakeWaiting(); ///< Wake up a thread blocked in waitForNewBuffer().
 };
 
 }
@@ -0,0 +1,84 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "cxSharedMemoryWaiterThread.h"
+
+#include "cxSharedMemory.h"
+
+namespace cx
+{
+
+SharedMemoryWaiterThread::SharedMemoryWaiterThread(SharedMemoryClient* client, QObject* parent) :
+	QThread(parent),
+	mClient(client),
+	mStop(0),
+	mPending(0)
+{
+}
+
+SharedMemoryWaiterThread::~SharedMemoryWaiterThread()
+{
+	this->stop();
+}
+
+void SharedMemoryWaiterThread::bufferHandled()
+{
+	mPending.fetchAndStoreOrdered(0);
+}
+
+void SharedMemoryWaiterThread::stop()
+{
+	mStop.fetchAndStoreOrdered(1);
+	while (this->isRunning() && !this->wait(20))
+		mClient->wakeWaiting(); // repeat in case the thread was not waiting yet
+	mStop.fetchAndStoreOrdered(0); // allow restart
+	mPending.fetchAndStoreOrdered(0);
+}
+
+void SharedMemoryWaiterThread::run()
+{
+	qint64 lastSequence = 0;
+	while (!mStop.loadAcquire())
+	{
+		// Bounded wait: if the server has crashed, return now and then to check for stop
+		qint64 sequence = mClient->waitForNewBuffer(lastSequence, 1000);
+		if (sequence < 0)
+			break; // server gone
+		if (sequence == lastSequence)
+			continue; // woken by wakeWaiting() or timeout
+		lastSequence = sequence;
+		if (mPending.testAndSetOrdered(0, 1))
+			emit newBuffer();
+	}
+}
+
+} // namespace cx
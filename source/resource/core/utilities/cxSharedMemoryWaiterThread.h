@@ -0,0 +1,82 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#ifndef CXSHAREDMEMORYWAITERTHREAD_H_
+#define CXSHAREDMEMORYWAITERTHREAD_H_
+
+#include "cxResourceExport.h"
+
+#include <QThread>
+#include <QAtomicInt>
+
+namespace cx
+{
+class SharedMemoryClient;
+
+/** \brief Wait for new buffers in a shared memory ring, without polling.
+ *
+ * Blocks in SharedMemoryClient::waitForNewBuffer() and emits newBuffer()
+ * each time the server releases a buffer. Use a queued connection to handle
+ * the buffer in another thread. Buffers arriving before the previous signal is
+ * handled are coalesced into one signal: Call bufferHandled() before reading
+ * from the client to receive the next signal. The wait is bounded, thus the
+ * thread does not hang if the server crashes.
+ *
+ * The client must outlive the thread.
+ *
+ * \ingroup cx_resource_core_utilities
+ */
+class cxResource_EXPORT SharedMemoryWaiterThread : public QThread
+{
+	Q_OBJECT
+public:
+	explicit SharedMemoryWaiterThread(SharedMemoryClient* client, QObject* parent = NULL);
+	virtual ~SharedMemoryWaiterThread();
+
+	void bufferHandled(); ///< allow the next newBuffer() signal
+	void stop(); ///< wake up and stop the thread, return when completed. The thread can be restarted.
+
+signals:
+	void newBuffer();
+
+protected:
+	virtual void run();
+
+private:
+	SharedMemoryClient* mClient;
+	QAtomicInt mStop;
+	QAtomicInt mPending; ///< nonzero when newBuffer() is emitted but not handled
+};
+
+} // namespace cx
+
+#endif /* CXSHAREDMEMORYWAITERTHREAD_H_ */
@@ -35,5 +35,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace cx
 {
 
+/** Default implementation, subclasses may resolve to only once.
+ */
+std::vector<Transform3D> SpaceProvider::get_toMfrom(const std::vector<CoordinateSystem>& from, CoordinateSystem to)
+{
+	std::vector<Transform3D> retval(from.size());
+	for (unsigned i=0; i<from.size(); ++i)
+		retval[i] = this->get_toMfrom(from[i], to);
+	return retval;
+}
 
 } // namespace cx
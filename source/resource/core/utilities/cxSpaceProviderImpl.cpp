@@ -47,11 +47,20 @@ namespace cx
 
 SpaceProviderImpl::SpaceProviderImpl(TrackingServicePtr trackingService, PatientModelServicePtr dataManager) :
 	mTrackingService(trackingService),
-	mDataManager(dataManager)
+	mDataManager(dataManager),
+	m_rMpr(Transform3D::Identity()),
+	mCacheHits(0),
+	mCacheMisses(0)
 {
 //	connect(mTrackingService.get(), SIGNAL(stateChanged()), this, SIGNAL(spaceAddedOrRemoved()));
 	connect(mTrackingService.get(), &TrackingService::stateChanged, this, &SpaceProvider::spaceAddedOrRemoved);
 	connect(mDataManager.get(), &PatientModelService::dataAddedOrRemoved, this, &SpaceProvider::spaceAddedOrRemoved);
+
+	// changes affecting many spaces: clear the cache
+	connect(mTrackingService.get(), &TrackingService::stateChanged, this, &SpaceProviderImpl::clearCache);
+	connect(mDataManager.get(), &PatientModelService::dataAddedOrRemoved, this, &SpaceProviderImpl::clearCache);
+	connect(mDataManager.get(), &PatientModelService::rMprChanged, this, &SpaceProviderImpl::clearCache);
+	connect(mDataManager.get(), &PatientModelService::patientChanged, this, &SpaceProviderImpl::clearCache);
 }
 
 SpaceListenerPtr SpaceProviderImpl::createListener()
@@ -149,10 +158,137 @@ Transform3D SpaceProviderImpl::getActiveToolTipTransform(CoordinateSystem to, bo
 
 Transform3D SpaceProviderImpl::get_toMfrom(CoordinateSystem from, CoordinateSystem to)
 {
-	Transform3D to_M_from = get_rMfrom(to).inv() * get_rMfrom(from);
+	this->check_rMpr();
+	Transform3D to_M_from = this->getCachedSpace(to).m_xMr * this->getCachedSpace(from).m_rMx;
 	return to_M_from;
 }
 
+std::vector<Transform3D> SpaceProviderImpl::get_toMfrom(const std::vector<CoordinateSystem>& from, CoordinateSystem to)
+{
+	this->check_rMpr();
+	Transform3D toMr = this->getCachedSpace(to).m_xMr;
+	std::vector<Transform3D> retval(from.size());
+	for (unsigned i=0; i<from.size(); ++i)
+		retval[i] = toMr * this->getCachedSpace(from[i]).m_rMx;
+	return retval;
+}
+
+/** Clear the cache if rMpr has changed. Needed because
+ *  continuous registration blocks the rMprChanged signal.
+ */
+void SpaceProviderImpl::check_rMpr()
+{
+	Transform3D rMpr = this->get_rMpr();
+	if (rMpr.matrix() == m_rMpr.matrix())
+		return;
+	m_rMpr = rMpr;
+	this->clearCache();
+}
+
+void SpaceProviderImpl::resetCacheStatistics()
+{
+	mCacheHits = 0;
+	mCacheMisses = 0;
+}
+
+/** Return rMx and xMr for the space x, from the cache if possible.
+ *  Spaces that cannot be found are not cached.
+ */
+SpaceProviderImpl::CachedSpace SpaceProviderImpl::getCachedSpace(const CoordinateSystem& space)
+{
+	SpaceKey key(space.mId, space.mRefObject);
+	std::map<SpaceKey, CachedSpace>::iterator iter = mCache.find(key);
+	if (iter!=mCache.end())
+	{
+		++mCacheHits;
+		return iter->second;
+	}
+
+	++mCacheMisses;
+	CachedSpace retval;
+	retval.m_rMx = this->get_rMfrom(space);
+	retval.m_xMr = retval.m_rMx.inv();
+	if (this->connectToOwner(space))
+		mCache[key] = retval;
+	return retval;
+}
+
+/** Connect to the change signals of the object owning the space.
+ *  Return false if the space cannot be cached.
+ */
+bool SpaceProviderImpl::connectToOwner(const CoordinateSystem& space)
+{
+	if (space.mRefObject=="active")
+		return false; // alias can change at any time
+
+	switch(space.mId)
+	{
+	case csREF:
+	case csPATIENTREF:
+		return true;
+	case csDATA:
+	case csDATA_VOXEL:
+	{
+		if (!mDataManager->isPatientValid())
+			return false;
+		DataPtr data = mDataManager->getData(space.mRefObject);
+		if (!data)
+			return false;
+		connect(data.get(), &Data::transformChanged, this, &SpaceProviderImpl::onDataChanged, Qt::UniqueConnection);
+		ImagePtr image = boost::dynamic_pointer_cast<Image>(data);
+		if (image)
+			connect(image.get(), &Image::vtkImageDataChanged, this, &SpaceProviderImpl::onDataChanged, Qt::UniqueConnection);
+		return true;
+	}
+	case csTOOL:
+	case csTOOL_OFFSET:
+	{
+		ToolPtr tool = mTrackingService->getTool(space.mRefObject);
+		if (!tool)
+			return false;
+		connect(tool.get(), &Tool::toolTransformAndTimestamp, this, &SpaceProviderImpl::onToolChanged, Qt::UniqueConnection);
+		connect(tool.get(), &Tool::tooltipOffset, this, &SpaceProviderImpl::onToolChanged, Qt::UniqueConnection);
+		return true;
+	}
+	default:
+		return false; // includes csSENSOR: no signal for calibration changes
+	}
+}
+
+void SpaceProviderImpl::invalidate(COORDINATE_SYSTEM id, QString uid)
+{
+	mCache.erase(SpaceKey(id, uid));
+}
+
+void SpaceProviderImpl::clearCache()
+{
+	mCache.clear();
+}
+
+void SpaceProviderImpl::onToolChanged()
+{
+	Tool* tool = dynamic_cast<Tool*>(this->sender());
+	if (!tool)
+	{
+		this->clearCache();
+		return;
+	}
+	this->invalidate(csTOOL, tool->getUid());
+	this->invalidate(csTOOL_OFFSET, tool->getUid());
+}
+
+void SpaceProviderImpl::onDataChanged()
+{
+	Data* data = dynamic_cast<Data*>(this->sender());
+	if (!data)
+	{
+		this->clearCache();
+		return;
+	}
+	this->invalidate(csDATA, data->getUid());
+	this->invalidate(csDATA_VOXEL, data->getUid());
+}
+
 Transform3D SpaceProviderImpl::get_rMfrom(CoordinateSystem from)
 {
 	Transform3D rMfrom = Transform3D::Identity();
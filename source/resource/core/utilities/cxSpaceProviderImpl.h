@@ -34,6 +34,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxResourceExport.h"
 
+#include <map>
 #include "cxSpaceProvider.h"
 #include "cxForwardDeclarations.h"
 
@@ -42,6 +43,13 @@ namespace cx
 
 /** Provides information about all the coordinate systems in the application.
  *
+ * The transforms rMx and xMr for each space x are cached. A cached space
+ * is invalidated by the change signals of the tool or data owning it,
+ * and all spaces are invalidated when tools, data, rMpr or the patient change.
+ * rMpr is also compared on each call, as continuous registration
+ * changes it without signals.
+ * Not cached: "active" aliases, and sensor spaces, as the
+ * calibration has no change signal.
  *
  * \ingroup cx_resource_core_utilities
  * \date 2014-02-21
@@ -54,6 +62,7 @@ public:
 	virtual ~SpaceProviderImpl() {}
 
 	virtual Transform3D get_toMfrom(CoordinateSystem from, CoordinateSystem to); ///< to_M_from
+	virtual std::vector<Transform3D> get_toMfrom(const std::vector<CoordinateSystem>& from, CoordinateSystem to); ///< to_M_from for each from
 	virtual std::vector<CoordinateSystem> getSpacesToPresentInGUI();
 	virtual std::map<QString, QString> getDisplayNamesForCoordRefObjects();
 	virtual SpaceListenerPtr createListener();
@@ -70,7 +79,26 @@ public:
 	virtual CoordinateSystem getR(); ///<data references coordinate system
 	virtual CoordinateSystem convertToSpecific(CoordinateSystem space);
 
+	unsigned getCacheHits() const { return mCacheHits; } ///< number of space lookups found in cache
+	unsigned getCacheMisses() const { return mCacheMisses; } ///< number of space lookups computed
+	void resetCacheStatistics();
+
 private:
+	struct CachedSpace
+	{
+		Transform3D m_rMx;
+		Transform3D m_xMr;
+	};
+	typedef std::pair<int, QString> SpaceKey;
+
+	CachedSpace getCachedSpace(const CoordinateSystem& space);
+	bool connectToOwner(const CoordinateSystem& space);
+	void check_rMpr();
+	void invalidate(COORDINATE_SYSTEM id, QString uid);
+	void clearCache();
+	void onToolChanged();
+	void onDataChanged();
+
 	Transform3D get_rMfrom(CoordinateSystem from); ///< ref_M_from
 
 	Transform3D get_rMr(); ///< ref_M_ref
@@ -85,6 +113,10 @@ private:
 
 	TrackingServicePtr mTrackingService;
 	PatientModelServicePtr mDataManager;
+	std::map<SpaceKey, CachedSpace> mCache;
+	Transform3D m_rMpr; ///< rMpr used in the cache
+	unsigned mCacheHits;
+	unsigned mCacheMisses;
 };
 
 } // namespace cx
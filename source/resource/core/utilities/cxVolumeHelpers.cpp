@@ -322,11 +322,13 @@ void printDisplayFriendlyInfo(std::map<std::string, std::string> map)
 
 int calculateNumVoxelsWithMaxValue(ImagePtr image)
 {
-	return static_cast<int*>(image->getHistogram()->GetOutput()->GetScalarPointer(image->getRange(), 0, 0))[0];
+	ImageStatisticsPtr statistics = image->getStatistics();
+	return statistics->getCount(statistics->getMax());
 }
 int calculateNumVoxelsWithMinValue(ImagePtr image)
 {
-	return static_cast<int*>(image->getHistogram()->GetOutput()->GetScalarPointer(0,0,0))[0];
+	ImageStatisticsPtr statistics = image->getStatistics();
+	return statistics->getCount(statistics->getMin());
 }
 
 DoubleBoundingBox3D findEnclosingBoundingBox(std::vector<DataPtr> data, Transform3D qMr)
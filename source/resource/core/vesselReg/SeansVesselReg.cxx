@@ -6,6 +6,11 @@
 #include <fstream>
 
 #include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <boost/bind.hpp>
+#include <algorithm>
 
 #include "cxImage.h"
 #include "cxTypeConversions.h"
@@ -25,7 +30,7 @@
 #include "vtkImageData.h"
 #include "vtkGeneralTransform.h"
 #include "vtkMath.h"
-#include "vtkSortDataArray.h"
+#include "vtkGenericCell.h"
 #include "vtkMaskPoints.h"
 #include "vtkPointData.h"
 #include "vtkLandmarkTransform.h"
@@ -49,7 +54,10 @@ SeansVesselReg::SeansVesselReg()// : mInvertedTransform(false)
 	mt_maximumNumberOfIterations = 100;
 	mt_verbose = false;
 	mt_maximumDurationSeconds = 1E6; // Random high number
+	mt_coarseToFineMinimumPoints = 0; // opt-in: decimation may change the result slightly
+	mt_numberOfThreads = QThread::idealThreadCount();
 	margin = 40;
+	mThreadPool.reset(new QThreadPool());
 }
 
 SeansVesselReg::~SeansVesselReg()
@@ -185,12 +193,50 @@ SeansVesselReg::ContextPtr SeansVesselReg::linearRefineAllLTS(ContextPtr seed)
 
 /**iteratetively register linearly on the input context until it converges.
  *
+ * Start with a decimated set of source points, and converge on each level
+ * before doubling the number of points, ending with all points.
  */
 void SeansVesselReg::linearRefine(ContextPtr context)
+{
+	QDateTime t0 = QDateTime::currentDateTime();
+	for (int decimation = this->getInitialDecimation(context); decimation >= 1; decimation /= 2)
+	{
+		this->setDecimation(context, decimation);
+		this->linearRefineAtCurrentDecimation(context, t0);
+	}
+}
+
+/**Find the largest power of two decimation keeping
+ * at least mt_coarseToFineMinimumPoints source points.
+ */
+int SeansVesselReg::getInitialDecimation(ContextPtr context) const
+{
+	int numPoints = context->mSourcePoints->GetNumberOfPoints();
+	int decimation = 1;
+	if (mt_coarseToFineMinimumPoints <= 0)
+		return decimation;
+	while (numPoints / (2*decimation) >= mt_coarseToFineMinimumPoints)
+		decimation *= 2;
+	return decimation;
+}
+
+void SeansVesselReg::setDecimation(ContextPtr context, int decimation)
+{
+	if (context->mDecimation == decimation)
+		return;
+	context->mDecimation = decimation;
+	// distances computed using the old decimation are invalid
+	context->mSortedSourcePoints = vtkPointsPtr();
+	context->mSortedTargetPoints = vtkPointsPtr();
+}
+
+/**iteratetively register linearly on the input context until it converges,
+ * using the current decimation.
+ */
+void SeansVesselReg::linearRefineAtCurrentDecimation(ContextPtr context, QDateTime t0)
 {
 	// Perform registrations iteratively until convergence is reached:
 	double previousMetric = 1E6;
-	QDateTime t0 = QDateTime::currentDateTime();
 	for (int iteration = 1; iteration < mt_maximumNumberOfIterations && (t0.msecsTo(QDateTime::currentDateTime()) < mt_maximumDurationSeconds*1000); ++iteration)
 	{
 		this->performOneRegistration(context, true);
@@ -219,10 +265,11 @@ SeansVesselReg::ContextPtr SeansVesselReg::splitContext(ContextPtr context)
 	ContextPtr retval = ContextPtr(new Context);
 
 	retval->mLtsRatio = context->mLtsRatio;
+	retval->mDecimation = context->mDecimation;
 	retval->mInvertedTransform = context->mInvertedTransform;
 
 	// constant data: shallow copy
-	retval->mTargetPointLocator = context->mTargetPointLocator;
+	retval->mTargetPointLocators = context->mTargetPointLocators;
 	retval->mTargetPoints = context->mTargetPoints;
 
 	// will be modified: deep copy
@@ -285,27 +332,78 @@ SeansVesselReg::ContextPtr SeansVesselReg::createContext(DataPtr source, DataPtr
 	}
 
 
-	// Create locator for target points
+	// Create locators for target points.
+	// The locator search is not thread-safe, thus use one for each thread.
 	context->mTargetPoints = targetPolyData;
-	context->mTargetPointLocator = vtkCellLocatorPtr::New();
-	context->mTargetPointLocator->SetDataSet(targetPolyData);
-	context->mTargetPointLocator->SetNumberOfCellsPerBucket(1);
-	context->mTargetPointLocator->BuildLocator();
+	int numberOfLocators = std::max(1, mt_numberOfThreads);
+	for (int i = 0; i < numberOfLocators; ++i)
+	{
+		vtkCellLocatorPtr locator = vtkCellLocatorPtr::New();
+		locator->SetDataSet(targetPolyData);
+		locator->SetNumberOfCellsPerBucket(1);
+		locator->BuildLocator();
+		context->mTargetPointLocators.push_back(locator);
+	}
 
 	//Since we are going to play with the data, we have to make a copy
 	context->mSourcePoints = vtkPointsPtr::New();
 	context->mSourcePoints->DeepCopy(sourcePolyData->GetPoints());
 
 	context->mLtsRatio = mt_ltsRatio; ///< local copy of the lts ratio, can be changed for current iteration.
+	context->mDecimation = 1;
 
 	return context;
 }
 
+namespace
+{
+/** Find the closest target point for the source points given by indices [begin,end).
+ *  Thread-safe, as long as the locator is used by one thread only.
+ */
+void findClosestPoints(vtkCellLocatorPtr locator, vtkPointsPtr sourcePoints, const std::vector<vtkIdType>* indices,
+					   int begin, int end, std::vector<Vector3D>* closestPoints, std::vector<double>* residuals)
+{
+	vtkSmartPointer<vtkGenericCell> cell = vtkSmartPointer<vtkGenericCell>::New();
+	for (int i = begin; i < end; ++i)
+	{
+		double point[3];
+		double outPoint[3];
+		vtkIdType cell_id;
+		int sub_id;
+		double distanceSquared;
+		sourcePoints->GetPoint((*indices)[i], point);
+		locator->FindClosestPoint(point, outPoint, cell, cell_id, sub_id, distanceSquared);
+		(*closestPoints)[i] = Vector3D(outPoint);
+		(*residuals)[i] = distanceSquared;
+	}
+}
+
+/** Order point indices by residual, ties broken on index.
+ */
+class ResidualLess
+{
+public:
+	ResidualLess(const std::vector<double>& residuals) : mResiduals(residuals) {}
+	bool operator()(int a, int b) const
+	{
+		if (mResiduals[a] != mResiduals[b])
+			return mResiduals[a] < mResiduals[b];
+		return a < b;
+	}
+private:
+	const std::vector<double>& mResiduals;
+};
+} // namespace
+
 /**\brief Compute distances between the two datasets.
  *
  * The results will be added into the context: sorted source and target points,
  * and the metric.
  *
+ * Only every mDecimation'th source point is used. The closest point search is
+ * split between the available locators and run in parallel. The best mLtsRatio
+ * percent of the points are kept, in no particular order.
+ *
  */
 void SeansVesselReg::computeDistances(ContextPtr context)
 {
@@ -317,8 +415,14 @@ void SeansVesselReg::computeDistances(ContextPtr context)
 	if (context->mSortedSourcePoints || context->mSortedTargetPoints)
 		return;
 
+	// source points used in this iteration
+	std::vector<vtkIdType> sourceIndices;
+	int decimation = std::max(1, context->mDecimation);
+	for (vtkIdType i = 0; i < context->mSourcePoints->GetNumberOfPoints(); i += decimation)
+		sourceIndices.push_back(i);
+
 	// total number of source points:
-	int numPoints = context->mSourcePoints->GetNumberOfPoints();
+	int numPoints = sourceIndices.size();
 	// number of source points used in each iteration (the rest is temporarily rejected from the computation)
 	int nb_points = ((int) (numPoints * context->mLtsRatio) / 100);
 //	std::cout << QString("onestep %1/%2").arg(nb_points).arg(numPoints) << std::endl;
@@ -326,27 +430,35 @@ void SeansVesselReg::computeDistances(ContextPtr context)
 	// - closestPoint is used so that the internal state of LandmarkTransform remains
 	//   correct whenever the iteration process is stopped (hence its source
 	//   and landmark points might be used in a vtkThinPlateSplineTransform).
-	vtkPointsPtr closestPoint = vtkPointsPtr::New();
-	closestPoint->SetNumberOfPoints(numPoints);
+	std::vector<Vector3D> closestPoints(numPoints);
+	std::vector<double> residuals(numPoints);
 
-	// Fill points with the closest points to each vertex in input
-	vtkFloatArrayPtr residuals = vtkFloatArrayPtr::New();
-	residuals->SetNumberOfValues(numPoints);
+	//Find closest points to all source points
+	int numberOfBlocks = std::min<int>(context->mTargetPointLocators.size(), numPoints/500 + 1);
+	if (numberOfBlocks <= 1)
+	{
+		findClosestPoints(context->mTargetPointLocators[0], context->mSourcePoints, &sourceIndices, 0, numPoints, &closestPoints, &residuals);
+	}
+	else
+	{
+		mThreadPool->setMaxThreadCount(numberOfBlocks);
+		std::vector<QFuture<void> > blocks;
+		for (int i = 0; i < numberOfBlocks; ++i)
+		{
+			int begin = (i * numPoints) / numberOfBlocks;
+			int end = ((i+1) * numPoints) / numberOfBlocks;
+			blocks.push_back(QtConcurrent::run(mThreadPool.get(), boost::bind(&findClosestPoints,
+											   context->mTargetPointLocators[i], context->mSourcePoints, &sourceIndices,
+											   begin, end, &closestPoints, &residuals)));
+		}
+		for (unsigned i = 0; i < blocks.size(); ++i)
+			blocks[i].waitForFinished();
+	}
 
-	vtkIdListPtr IdList = vtkIdListPtr::New();
-	IdList->SetNumberOfIds(numPoints);
 	double total_distance = 0;
-	double distanceSquared = 0;
-	//Find closest points to all source points
 	for (int i = 0; i < numPoints; ++i)
 	{
-		//Check the distance to neighbouring points (neighbours should be matched to nearby points)
-		vtkIdType cell_id;
-		int sub_id;
-		double outPoint[3];
-		context->mTargetPointLocator->FindClosestPoint(context->mSourcePoints->GetPoint(i), outPoint, cell_id, sub_id, distanceSquared);
-		closestPoint->SetPoint(i, outPoint);
-		if ((boost::math::isnan)(distanceSquared))
+		if ((boost::math::isnan)(residuals[i]))
 		{
 			std::cout << "nan found during findClosestPoint!" << std::endl;
 			{
@@ -354,18 +466,30 @@ void SeansVesselReg::computeDistances(ContextPtr context)
 				return;
 			}
 		}
-		residuals->InsertValue(i, distanceSquared);
-		IdList->InsertId(i, i);
-		total_distance += sqrt(distanceSquared);
+		total_distance += sqrt(residuals[i]);
 	}
 
 	// quality of the current iteration
 	context->mMetric = total_distance / numPoints;
 
-	vtkSortDataArrayPtr sort = vtkSortDataArrayPtr::New();
-	sort->Sort(residuals, IdList);
-	context->mSortedSourcePoints = this->createSortedPoints(IdList, context->mSourcePoints, nb_points);
-	context->mSortedTargetPoints = this->createSortedPoints(IdList, closestPoint, nb_points);
+	// select the nb_points best points, the order is not important.
+	std::vector<int> order(numPoints);
+	for (int i = 0; i < numPoints; ++i)
+		order[i] = i;
+	if (nb_points < numPoints)
+		std::nth_element(order.begin(), order.begin() + nb_points, order.end(), ResidualLess(residuals));
+
+	context->mSortedSourcePoints = vtkPointsPtr::New();
+	context->mSortedSourcePoints->SetNumberOfPoints(nb_points);
+	context->mSortedTargetPoints = vtkPointsPtr::New();
+	context->mSortedTargetPoints->SetNumberOfPoints(nb_points);
+	double temp_point[3];
+	for (int i = 0; i < nb_points; ++i)
+	{
+		context->mSourcePoints->GetPoint(sourceIndices[order[i]], temp_point);
+		context->mSortedSourcePoints->SetPoint(i, temp_point);
+		context->mSortedTargetPoints->SetPoint(i, closestPoints[order[i]].data());
+	}
 }
 
 /**\brief Register the source points to the target point in a single ste.
@@ -410,27 +534,6 @@ void SeansVesselReg::performOneRegistration(ContextPtr context, bool linear)
 	this->computeDistances(context);
 }
 
-/**Using the already sorted list of point ID's, create a sorted list of points
- * based on the numPoint first of unsortedPoints.
- *
- */
-vtkPointsPtr SeansVesselReg::createSortedPoints(vtkIdListPtr sortedIDList, vtkPointsPtr unsortedPoints, int numPoints)
-{
-	vtkPointsPtr retval = vtkPointsPtr::New();
-	retval->SetNumberOfPoints(numPoints);
-
-	double temp_point[3];
-
-	for (int i = 0; i < numPoints; ++i)
-	{
-		vtkIdType index = sortedIDList->GetId(i);
-		unsortedPoints->GetPoint(index, temp_point); // source points to use in tps
-		retval->SetPoint(i, temp_point);
-	}
-
-	return retval;
-}
-
 /**Transform input using the transform
  *
  */
@@ -7,6 +7,10 @@
 #include "vtkForwardDeclarations.h"
 #include "cxTransform3D.h"
 #include "vtkSmartPointer.h"
+#include <vector>
+#include <QDateTime>
+
+class QThreadPool;
 
 namespace cx
 {
@@ -17,6 +21,10 @@ namespace cx
  *
  * Basic usage: Run execute(), then get result with getLinearTransform()
  *
+ * The linear iteration is run coarse-to-fine: It first converges using a
+ * decimated set of the source points, then refines using successively more
+ * points. The closest point search is run in parallel.
+ *
  *
  * \ingroup cx_resource_core_utilities
  * \date Feb 4, 2011
@@ -35,7 +43,7 @@ public:
 	 */
 	struct cxResource_EXPORT Context
 	{
-		vtkCellLocatorPtr mTargetPointLocator; ///< input: target data wrapped in a locator
+		std::vector<vtkCellLocatorPtr> mTargetPointLocators; ///< input: target data wrapped in locators, one for each thread
 		vtkPolyDataPtr mTargetPoints; ///< input: target data
 		vtkPointsPtr mSourcePoints; ///< input: current source data, modified according to last iteration
 
@@ -51,6 +59,7 @@ public:
 		double mMetric; ///< output: mean least squares from BEFORE last iteration.
 
 		double mLtsRatio; ///< local copy of the lts ratio, can be changed for current iteration.
+		int mDecimation; ///< use only every n'th source point when computing distances, used for coarse-to-fine iteration.
 
 		//---------------------------------------------------------------------------
 		//TODO non-linear needs to handle this!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -93,6 +102,8 @@ public:
 	int mt_maximumNumberOfIterations;
 	bool mt_verbose;
 	double mt_maximumDurationSeconds;
+	int mt_coarseToFineMinimumPoints; ///< minimum number of source points used on the coarsest level, 0 (default) means no decimation.
+	int mt_numberOfThreads; ///< number of threads used in the closest point search.
 	double margin;
 	QString m_logPath;
 
@@ -121,10 +132,12 @@ protected:
 	vtkAbstractTransformPtr nonLinearRegistration(vtkPointsPtr sortedSourcePoints, vtkPointsPtr sortedTargetPoints);
 	vtkPolyDataPtr convertToPolyData(DataPtr data, QString id);
 	vtkPointsPtr transformPoints(vtkPointsPtr input, vtkAbstractTransformPtr transform);
-	vtkPointsPtr createSortedPoints(vtkIdListPtr sortedIDList, vtkPointsPtr unsortedPoints, int numPoints);
 	vtkPolyDataPtr crop(vtkPolyDataPtr input, vtkPolyDataPtr fixed, double margin);
 	ContextPtr linearRefineAllLTS(ContextPtr context);
 	void linearRefine(ContextPtr context);
+	void linearRefineAtCurrentDecimation(ContextPtr context, QDateTime t0);
+	int getInitialDecimation(ContextPtr context) const;
+	void setDecimation(ContextPtr context, int decimation);
 	SeansVesselReg::ContextPtr splitContext(ContextPtr context);
 
 	void print(vtkPointsPtr points);
@@ -134,6 +147,7 @@ protected:
 
 //	Transform3D mLinearTransformResult;
 	ContextPtr mLastRun; ///< result from last run of execute()
+	boost::shared_ptr<QThreadPool> mThreadPool; ///< used for the closest point search
 
 //	//---------------------------------------------------------------------------
 //	//TODO non-linear needs to handle this!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -193,6 +193,7 @@ bool BinaryThresholdImageFilter::execute()
 	//Binary Thresholding
 	typedef itk::BinaryThresholdImageFilter<itkImageType, itkImageType> thresholdFilterType;
 	thresholdFilterType::Pointer thresholdFilter = thresholdFilterType::New();
+	thresholdFilter->InPlaceOff(); // itkImage shares the buffer of the input image
 	thresholdFilter->SetInput(itkImage);
 	thresholdFilter->SetOutsideValue(0);
 	thresholdFilter->SetInsideValue(1);
@@ -202,12 +203,7 @@ bool BinaryThresholdImageFilter::execute()
 	itkImage = thresholdFilter->GetOutput();
 
 	//Convert ITK to VTK
-	itkToVtkFilterType::Pointer itkToVtkFilter = itkToVtkFilterType::New();
-	itkToVtkFilter->SetInput(itkImage);
-	itkToVtkFilter->Update();
-
-	vtkImageDataPtr rawResult = vtkImageDataPtr::New();
-	rawResult->DeepCopy(itkToVtkFilter->GetOutput());
+	vtkImageDataPtr rawResult = AlgorithmHelper::getVTKFromITK(itkImage);
 
 	vtkImageCastPtr imageCast = vtkImageCastPtr::New();
 	imageCast->SetInputData(rawResult);
@@ -171,12 +171,7 @@ bool DilationFilter::execute() {
 	itkImage = dilationFilter->GetOutput();
 
 	//Convert ITK to VTK
-	itkToVtkFilterType::Pointer itkToVtkFilter = itkToVtkFilterType::New();
-	itkToVtkFilter->SetInput(itkImage);
-	itkToVtkFilter->Update();
-
-	vtkImageDataPtr rawResult = vtkImageDataPtr::New();
-	rawResult->DeepCopy(itkToVtkFilter->GetOutput());
+	vtkImageDataPtr rawResult = AlgorithmHelper::getVTKFromITK(itkImage);
 
 	vtkImageCastPtr imageCast = vtkImageCastPtr::New();
 	imageCast->SetInputData(rawResult);
@@ -121,19 +121,14 @@ bool SmoothingImageFilter::execute()
 
 	typedef itk::SmoothingRecursiveGaussianImageFilter<itkImageType, itkImageType> smoothingFilterType;
 	smoothingFilterType::Pointer smoohingFilter = smoothingFilterType::New();
+	smoohingFilter->InPlaceOff(); // itkImage shares the buffer of the input image
 	smoohingFilter->SetSigma(sigma->getValue());
 	smoohingFilter->SetInput(itkImage);
 	smoohingFilter->Update();
 	itkImage = smoohingFilter->GetOutput();
 
 	//Convert ITK to VTK
-	itkToVtkFilterType::Pointer itkToVtkFilter = itkToVtkFilterType::New();
-	itkToVtkFilter->SetInput(itkImage);
-	itkToVtkFilter->Update();
-
-	vtkImageDataPtr rawResult = vtkImageDataPtr::New();
-	rawResult->DeepCopy(itkToVtkFilter->GetOutput());
-	// TODO: possible memory problem here - check debug mem system of itk/vtk
+	vtkImageDataPtr rawResult = AlgorithmHelper::getVTKFromITK(itkImage);
 
 	mRawResult =  rawResult;
 	return true;
@@ -34,6 +34,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxtestfilter_export.h"
 #include "cxBinaryThresholdImageFilter.h"
 #include "cxtestVisServices.h"
+#include "cxImage.h"
+#include "cxVolumeHelpers.h"
+#include "cxDoublePairProperty.h"
+#include "cxBoolProperty.h"
+#include "cxSelectDataStringProperty.h"
+#include "cxPatientModelService.h"
+#include <vtkImageData.h>
 
 namespace
 {
@@ -73,3 +80,38 @@ TEST_CASE("BinaryThresholdImageFilter: update threshold with no image selected",
 	filterFixture->callThresholdSlot();
 	REQUIRE_FALSE(filterFixture->getPreviewImage());
 }
+
+TEST_CASE("BinaryThresholdImageFilter: execute leaves the input image unchanged", "[unit]")
+{
+	cxtest::TestVisServicesPtr dummyservices = cxtest::TestVisServices::create();
+
+	Eigen::Array3i dim(20, 30, 40);
+	vtkImageDataPtr raw = cx::generateVtkImageDataSignedShort(dim, cx::Vector3D(1, 1, 1), 0);
+	short* data = static_cast<short*>(raw->GetScalarPointer());
+	for (vtkIdType i = 0; i < raw->GetNumberOfPoints(); ++i)
+		data[i] = i % 100;
+	vtkImageDataPtr original = vtkImageDataPtr::New();
+	original->DeepCopy(raw);
+
+	cx::ImagePtr image(new cx::Image("threshold_input", raw));
+	dummyservices->patient()->insertData(image);
+
+	BinaryThresholdImageFilterFixturePtr filter(new BinaryThresholdImageFilterFixture(dummyservices));
+	filter->init();
+	REQUIRE(filter->getInputTypes()[0]->setValue(image->getUid()));
+
+	std::vector<cx::PropertyPtr> options = filter->getOptions();
+	cx::DoublePairPropertyPtr thresholds = boost::dynamic_pointer_cast<cx::DoublePairProperty>(options[0]);
+	cx::BoolPropertyPtr generateSurface = boost::dynamic_pointer_cast<cx::BoolProperty>(options[1]);
+	REQUIRE(thresholds);
+	REQUIRE(generateSurface);
+	thresholds->setValue(Eigen::Vector2d(50, 99));
+	generateSurface->setValue(false);
+
+	REQUIRE(filter->preProcess());
+	REQUIRE(filter->execute());
+
+	short* expected = static_cast<short*>(original->GetScalarPointer());
+	for (vtkIdType i = 0; i < raw->GetNumberOfPoints(); ++i)
+		REQUIRE(data[i] == expected[i]);
+}
@@ -34,48 +34,215 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxIGTLinkConversion.h"
 #include "cxIGTLinkConversionImage.h"
 #include "cxIGTLinkConversionSonixCXLegacy.h"
+#include <QHostAddress>
+#include <algorithm>
 
 namespace cx
 {
 
-GrabberSenderQTcpSocket::GrabberSenderQTcpSocket(QTcpSocket* socket)
+GrabberSenderClientStatistics::GrabberSenderClientStatistics() :
+	mSentFrames(0),
+	mDroppedFrames(0),
+	mSentBytes(0),
+	mThroughput(0)
 {
-	mMaxBufferSize = 19200000; //800(width)*600(height)*4(bytes)*10(images)
-	mSocket = socket;
+}
+
+GrabberSenderQTcpSocket::GrabberSenderQTcpSocket(QTcpSocket* socket) :
+	mMaxQueuedFrames(1),
+	mSocketBufferLimit(0)
+{
+	if (socket)
+		this->addSocket(socket);
+}
+
+void GrabberSenderQTcpSocket::addSocket(QTcpSocket* socket)
+{
+	Client client;
+	client.mSocket = socket;
+	client.mStatistics.mName = QString("%1:%2").arg(socket->peerAddress().toString()).arg(socket->peerPort());
+	client.mConnectedTime.start();
+	mClients.push_back(client);
+	connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(bytesWrittenSlot()));
+
+	// the probe definition is sent only on change: give the new client the latest.
+	if (mLastProbeDefinition)
+	{
+		OutboundMessage msg;
+		msg.mMessage = mLastProbeDefinition;
+		msg.mIsFrame = false;
+		this->enqueue(mClients.back(), msg);
+	}
+}
+
+void GrabberSenderQTcpSocket::removeSocket(QTcpSocket* socket)
+{
+	for (unsigned i=0; i<mClients.size(); ++i)
+	{
+		if (mClients[i].mSocket == socket)
+		{
+			if (socket)
+				disconnect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(bytesWrittenSlot()));
+			mClients.erase(mClients.begin()+i);
+			return;
+		}
+	}
+}
+
+int GrabberSenderQTcpSocket::getNumberOfClients() const
+{
+	return mClients.size();
+}
+
+void GrabberSenderQTcpSocket::setMaxQueuedFrames(int frames)
+{
+	mMaxQueuedFrames = std::max(1, frames);
+}
+
+void GrabberSenderQTcpSocket::setSocketBufferLimit(qint64 bytes)
+{
+	mSocketBufferLimit = bytes;
+}
+
+std::vector<GrabberSenderClientStatistics> GrabberSenderQTcpSocket::getStatistics() const
+{
+	std::vector<GrabberSenderClientStatistics> retval;
+	for (unsigned i=0; i<mClients.size(); ++i)
+		retval.push_back(this->getStatistics(mClients[i]));
+	return retval;
+}
+
+GrabberSenderClientStatistics GrabberSenderQTcpSocket::getStatistics(QTcpSocket* socket) const
+{
+	for (unsigned i=0; i<mClients.size(); ++i)
+		if (mClients[i].mSocket == socket)
+			return this->getStatistics(mClients[i]);
+	return GrabberSenderClientStatistics();
+}
+
+GrabberSenderClientStatistics GrabberSenderQTcpSocket::getStatistics(const Client& client) const
+{
+	GrabberSenderClientStatistics retval = client.mStatistics;
+	double elapsed = client.mConnectedTime.elapsed() / 1000.0;
+	if (elapsed > 0)
+		retval.mThroughput = retval.mSentBytes / elapsed;
+	return retval;
 }
 
 bool GrabberSenderQTcpSocket::isReady() const
 {
-	if (!mSocket)
-		return false;
-	if (mSocket->bytesToWrite() > mMaxBufferSize)
-		return false;;
-	return true;
+	return this->hasConnectedClients();
+}
+
+bool GrabberSenderQTcpSocket::hasConnectedClients() const
+{
+	for (unsigned i=0; i<mClients.size(); ++i)
+	{
+		if (mClients[i].mSocket)
+			return true;
+	}
+	return false;
+}
+
+int GrabberSenderQTcpSocket::getNumberOfQueuedFrames(const Client& client) const
+{
+	int retval = 0;
+	for (unsigned i=0; i<client.mQueue.size(); ++i)
+		if (client.mQueue[i].mIsFrame)
+			++retval;
+	return retval;
+}
+
+void GrabberSenderQTcpSocket::enqueue(igtl::MessageBase::Pointer msg, bool isFrame)
+{
+	OutboundMessage outbound;
+	outbound.mMessage = msg;
+	outbound.mIsFrame = isFrame;
+	for (unsigned i=0; i<mClients.size(); ++i)
+		this->enqueue(mClients[i], outbound);
+}
+
+void GrabberSenderQTcpSocket::enqueue(Client& client, OutboundMessage msg)
+{
+	if (!client.mSocket)
+		return;
+
+	if (msg.mIsFrame)
+	{
+		// drop the oldest frames, keep other messages
+		int frames = this->getNumberOfQueuedFrames(client);
+		for (std::deque<OutboundMessage>::iterator iter=client.mQueue.begin(); iter!=client.mQueue.end() && frames>=mMaxQueuedFrames; )
+		{
+			if (iter->mIsFrame)
+			{
+				iter = client.mQueue.erase(iter);
+				--frames;
+				++client.mStatistics.mDroppedFrames;
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	client.mQueue.push_back(msg);
+	this->flush(client);
+}
+
+void GrabberSenderQTcpSocket::flush(Client& client)
+{
+	if (!client.mSocket)
+		return;
+
+	while (!client.mQueue.empty() && client.mSocket->bytesToWrite() <= mSocketBufferLimit)
+	{
+		OutboundMessage msg = client.mQueue.front();
+		client.mQueue.pop_front();
+		const char* data = reinterpret_cast<const char*>(msg.mMessage->GetPackPointer());
+		qint64 written = client.mSocket->write(data, msg.mMessage->GetPackSize());
+		if (written < 0)
+			return;
+		client.mStatistics.mSentBytes += written;
+		if (msg.mIsFrame)
+			++client.mStatistics.mSentFrames;
+	}
+}
+
+void GrabberSenderQTcpSocket::bytesWrittenSlot()
+{
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(this->sender());
+	for (unsigned i=0; i<mClients.size(); ++i)
+	{
+		if (mClients[i].mSocket == socket)
+			this->flush(mClients[i]);
+	}
 }
 
 void GrabberSenderQTcpSocket::send(igtl::ImageMessage::Pointer msg)
 {
-	if (!msg || !this->isReady())
+	if (!msg || !this->hasConnectedClients())
 		return;
 
-	// Pack (serialize) and send
+	// Pack (serialize) once for all clients
 	msg->Pack();
-	mSocket->write(reinterpret_cast<const char*> (msg->GetPackPointer()), msg->GetPackSize());
+	this->enqueue(igtl::MessageBase::Pointer(msg.GetPointer()), true);
 }
 
 void GrabberSenderQTcpSocket::send(IGTLinkUSStatusMessage::Pointer msg)
 {
-	if (!msg || !this->isReady())
+	if (!msg || mClients.empty())
 		return;
 
-	// Pack (serialize) and send
+	// Pack (serialize) once for all clients
 	msg->Pack();
-	mSocket->write(reinterpret_cast<const char*> (msg->GetPackPointer()), msg->GetPackSize());
+	mLastProbeDefinition = igtl::MessageBase::Pointer(msg.GetPointer());
+	this->enqueue(mLastProbeDefinition, false);
 }
 
 void GrabberSenderQTcpSocket::send(ImagePtr msg)
 {
-	if (!this->isReady())
+	if (!this->hasConnectedClients())
 		return;
 
 	IGTLinkConversionImage converter;
@@ -84,7 +251,7 @@ void GrabberSenderQTcpSocket::send(ImagePtr msg)
 
 void GrabberSenderQTcpSocket::send(ProbeDefinitionPtr msg)
 {
-	if (!this->isReady())
+	if (mClients.empty())
 		return;
 
 	IGTLinkConversion converter;
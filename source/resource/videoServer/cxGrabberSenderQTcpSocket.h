@@ -37,7 +37,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cxSenderImpl.h"
 
+#include <deque>
+#include <vector>
 #include <QObject>
+#include <QPointer>
+#include <QElapsedTimer>
 #include <boost/shared_ptr.hpp>
 #include <qtcpsocket.h>
 #include "igtlImageMessage.h"
@@ -55,12 +59,47 @@ namespace cx
 * @{
 */
 
+struct cxGrabber_EXPORT GrabberSenderClientStatistics
+{
+	GrabberSenderClientStatistics();
+	QString mName;
+	int mSentFrames;
+	int mDroppedFrames; ///< frames dropped because the client was too slow
+	qint64 mSentBytes;
+	double mThroughput; ///< bytes/s since the client connected
+};
+
+/** Send messages to one or more clients over tcp/ip.
+ *
+ * Each message is encoded and packed once, then the packed
+ * buffer is written to all clients.
+ *
+ * Each client has a bounded queue of outbound messages. A message is
+ * written to the socket only when the socket buffer has been emptied, thus
+ * a slow client cannot make the buffer grow. Instead, the oldest queued
+ * frames are dropped, always keeping the newest one. Other messages, such
+ * as probe definitions, are never dropped.
+ */
 class cxGrabber_EXPORT GrabberSenderQTcpSocket : public SenderImpl
 {
+	Q_OBJECT
+
 public:
-	explicit GrabberSenderQTcpSocket(QTcpSocket* socket);
+	explicit GrabberSenderQTcpSocket(QTcpSocket* socket = NULL);
 	virtual ~GrabberSenderQTcpSocket() {}
 
+	void addSocket(QTcpSocket* socket);
+	void removeSocket(QTcpSocket* socket);
+	int getNumberOfClients() const;
+
+	void setMaxQueuedFrames(int frames); ///< max frames waiting per client, default 1.
+	void setSocketBufferLimit(qint64 bytes); ///< only write to a socket with at most this many bytes unsent, default 0.
+	std::vector<GrabberSenderClientStatistics> getStatistics() const;
+	GrabberSenderClientStatistics getStatistics(QTcpSocket* socket) const;
+
+	/** Return true if at least one client is connected.
+	  * A client that is too slow for the new frame drops its oldest queued frame.
+	  */
 	bool isReady() const;
 
 protected:
@@ -69,9 +108,34 @@ protected:
 	virtual void send(ImagePtr msg);
 	virtual void send(ProbeDefinitionPtr msg);
 
+private slots:
+	void bytesWrittenSlot();
+
 private:
-	QTcpSocket* mSocket;
-	int mMaxBufferSize;
+	struct OutboundMessage
+	{
+		igtl::MessageBase::Pointer mMessage; ///< packed message
+		bool mIsFrame; ///< frames can be dropped
+	};
+	struct Client
+	{
+		QPointer<QTcpSocket> mSocket;
+		std::deque<OutboundMessage> mQueue;
+		GrabberSenderClientStatistics mStatistics;
+		QElapsedTimer mConnectedTime;
+	};
+
+	void enqueue(igtl::MessageBase::Pointer msg, bool isFrame);
+	void enqueue(Client& client, OutboundMessage msg);
+	void flush(Client& client);
+	int getNumberOfQueuedFrames(const Client& client) const;
+	bool hasConnectedClients() const;
+	GrabberSenderClientStatistics getStatistics(const Client& client) const;
+
+	std::vector<Client> mClients;
+	int mMaxQueuedFrames;
+	qint64 mSocketBufferLimit;
+	igtl::MessageBase::Pointer mLastProbeDefinition; ///< sent to new clients
 };
 
 /**
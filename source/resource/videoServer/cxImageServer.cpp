@@ -42,13 +42,43 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxCommandlineImageStreamerFactory.h"
 //#include "cxSender.h"
 #include "cxGrabberSenderQTcpSocket.h"
+#include "cxGrabberSenderSharedMemory.h"
 
 namespace cx
 {
 
+namespace
+{
+/** Send to several senders. Each sender handles frames it is not ready for,
+ *  i.e. by dropping frames.
+ */
+class SenderList : public Sender
+{
+public:
+	explicit SenderList(std::vector<SenderPtr> senders) : mSenders(senders) {}
+	virtual bool isReady() const
+	{
+		for (unsigned i=0; i<mSenders.size(); ++i)
+			if (mSenders[i]->isReady())
+				return true;
+		return false;
+	}
+	virtual void send(PackagePtr package)
+	{
+		for (unsigned i=0; i<mSenders.size(); ++i)
+			mSenders[i]->send(package);
+	}
+private:
+	std::vector<SenderPtr> mSenders;
+};
+} // namespace
+
 ImageServer::ImageServer(QObject* parent) :
-	QTcpServer(parent)
-{}
+	QTcpServer(parent),
+	mStreaming(false)
+{
+	mSender.reset(new GrabberSenderQTcpSocket());
+}
 
 bool ImageServer::initialize()
 {
@@ -59,6 +89,13 @@ bool ImageServer::initialize()
 	if(!mImageSender)
 		return false;
 
+	if (args.count("shm") && !args["shm"].isEmpty())
+	{
+		mSharedMemorySender.reset(new GrabberSenderSharedMemory(args["shm"]));
+		std::cout << "Streaming to shared memory " << args["shm"].toStdString() << std::endl;
+		this->updateStreaming();
+	}
+
 	ok = true;
 
 	return ok;
@@ -100,33 +137,73 @@ void ImageServer::incomingConnection(qintptr socketDescriptor)
 {
 	std::cout << "Server: Incoming connection..." << std::endl;
 
-	if (mSocket != 0)
-	{
-		reportError("The image server can only handle a single connection.");
-		return;
-	}
-
-	mSocket = new QTcpSocket();
-	connect(mSocket, SIGNAL(disconnected()), this, SLOT(socketDisconnectedSlot()));
-	mSocket->setSocketDescriptor(socketDescriptor);
-	QString clientName = mSocket->localAddress().toString();
+	QTcpSocket* socket = new QTcpSocket();
+	connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnectedSlot()));
+	socket->setSocketDescriptor(socketDescriptor);
+	QString clientName = socket->localAddress().toString();
 	report("Connected to "+clientName+". Session started.");
-	SenderPtr sender(new GrabberSenderQTcpSocket(mSocket));
 
-	mImageSender->startStreaming(sender);
+	mSender->addSocket(socket);
+	this->updateStreaming();
 }
 
 void ImageServer::socketDisconnectedSlot()
 {
-	if (mImageSender)
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(this->sender());
+	if (!socket)
+		return;
+
+	this->reportStatistics(socket);
+	mSender->removeSocket(socket);
+
+	this->updateStreaming();
+
+	QString clientName = socket->localAddress().toString();
+	report("Disconnected from "+clientName+". Session ended.");
+	socket->deleteLater();
+}
+
+/** Stream while there is a receiver: shared memory if enabled, or tcp clients.
+ *  The tcp sender ignores frames while no client is connected, thus streaming
+ *  is started once and not restarted when clients come and go.
+ */
+void ImageServer::updateStreaming()
+{
+	if (!mImageSender)
+		return;
+	bool receiving = mSharedMemorySender || (mSender->getNumberOfClients() > 0);
+	if (receiving == mStreaming)
+		return;
+
+	if (mStreaming)
+	{
 		mImageSender->stopStreaming();
+		mStreaming = false;
+		return;
+	}
 
-	if (mSocket)
+	if (mSharedMemorySender)
 	{
-		QString clientName = mSocket->localAddress().toString();
-		report("Disconnected from "+clientName+". Session ended.");
-		mSocket->deleteLater();
+		std::vector<SenderPtr> senders;
+		senders.push_back(mSharedMemorySender);
+		senders.push_back(mSender);
+		mImageSender->startStreaming(SenderPtr(new SenderList(senders)));
 	}
+	else
+	{
+		mImageSender->startStreaming(mSender);
+	}
+	mStreaming = true;
+}
+
+void ImageServer::reportStatistics(QTcpSocket* socket)
+{
+	GrabberSenderClientStatistics stats = mSender->getStatistics(socket);
+	report(QString("Sent %1 frames to %2, dropped %3, %4 MB/s")
+		   .arg(stats.mSentFrames)
+		   .arg(stats.mName)
+		   .arg(stats.mDroppedFrames)
+		   .arg(stats.mThroughput/1024/1024, 0, 'f', 1));
 }
 
 void ImageServer::printHelpText()
@@ -145,6 +222,7 @@ QString ImageServer::getArgumentHelpText(QString applicationName)
 
 	ss << "Usage: " << applicationName << " (--arg <argval>)*" << std::endl;
 	ss << "    --port   : Tcp/IP port # (default=18333)" << std::endl;
+	ss << "    --shm    : Also stream to shared memory with this key (default=off)" << std::endl;
 	ss << "    --type   : Grabber type  (default=" << factory.getDefaultSenderType().toStdString() << ")"
 		<< std::endl;
 	ss << std::endl;
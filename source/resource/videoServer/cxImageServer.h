@@ -43,10 +43,18 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace cx
 {
 typedef boost::shared_ptr<class Streamer> StreamerPtr;
+typedef boost::shared_ptr<class GrabberSenderQTcpSocket> GrabberSenderQTcpSocketPtr;
+typedef boost::shared_ptr<class GrabberSenderSharedMemory> GrabberSenderSharedMemoryPtr;
 
 /**
  * \brief ImageServer
  *
+ * Streams images to all connected clients. Each frame is
+ * encoded once, slow clients drop frames instead of delaying the others.
+ *
+ * With the --shm argument, images are also streamed to shared memory,
+ * for clients on the same computer.
+ *
  * \ingroup cx_resource_videoserver
  * \date Oct 30, 2010
  * \author Christian Askeland
@@ -68,8 +76,12 @@ protected:
 private slots:
 	void socketDisconnectedSlot();
 private:
+	void reportStatistics(QTcpSocket* socket);
+	void updateStreaming();
 	StreamerPtr mImageSender;
-	QPointer<QTcpSocket> mSocket;
+	GrabberSenderQTcpSocketPtr mSender;
+	GrabberSenderSharedMemoryPtr mSharedMemorySender;
+	bool mStreaming;
 };
 
 } // namespace cx
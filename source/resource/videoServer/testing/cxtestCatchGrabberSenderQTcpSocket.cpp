@@ -0,0 +1,154 @@
+/*=========================================================================
+This file is part of CustusX, an Image Guided Therapy Application.
+
+Copyright (c) 2008-2014, SINTEF Department of Medical Technology
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, 
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, 
+   this list of conditions and the following disclaimer in the documentation 
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors 
+   may be used to endorse or promote products derived from this software 
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+=========================================================================*/
+
+#include "catch.hpp"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QCoreApplication>
+#include <boost/shared_ptr.hpp>
+#include "vtkImageData.h"
+#include "cxGrabberSenderQTcpSocket.h"
+#include "cxVolumeHelpers.h"
+#include "cxImage.h"
+
+namespace cxtest
+{
+
+namespace
+{
+/** A client connected to a local server, and the server side of the connection.
+ */
+struct Connection
+{
+	boost::shared_ptr<QTcpSocket> mClient;
+	QTcpSocket* mServerSide;
+	qint64 mReceived;
+
+	Connection(QTcpServer* server) : mServerSide(NULL), mReceived(0)
+	{
+		mClient.reset(new QTcpSocket());
+		mClient->connectToHost(QHostAddress::LocalHost, server->serverPort());
+		REQUIRE(mClient->waitForConnected(5000));
+		REQUIRE(server->waitForNewConnection(5000));
+		mServerSide = server->nextPendingConnection();
+		REQUIRE(mServerSide);
+	}
+
+	/** Read until expected bytes are received, or timeout.
+	  */
+	void receive(qint64 expected)
+	{
+		for (int i=0; i<1000 && mReceived<expected; ++i)
+		{
+			QCoreApplication::processEvents();
+			mClient->waitForReadyRead(10);
+			mReceived += mClient->readAll().size();
+		}
+	}
+};
+
+cx::PackagePtr createFramePackage(int value)
+{
+	vtkImageDataPtr raw = cx::generateVtkImageData(Eigen::Array3i(400, 300, 1), cx::Vector3D(1, 1, 1), value);
+	cx::PackagePtr retval(new cx::Package());
+	retval->mImage.reset(new cx::Image("frame", raw));
+	return retval;
+}
+} // namespace
+
+TEST_CASE("GrabberSenderQTcpSocket: Slow client drops old frames, keeps newest", "[resource][videoserver][unit]")
+{
+	QTcpServer server;
+	REQUIRE(server.listen(QHostAddress::LocalHost));
+	Connection connection(&server);
+
+	cx::GrabberSenderQTcpSocket sender;
+	sender.addSocket(connection.mServerSide);
+	REQUIRE(sender.getNumberOfClients() == 1);
+
+	// no event processing: the socket buffer is not emptied, frames are queued or dropped.
+	int numberOfFrames = 10;
+	for (int i=0; i<numberOfFrames; ++i)
+		static_cast<cx::Sender&>(sender).send(createFramePackage(i));
+
+	cx::GrabberSenderClientStatistics stats = sender.getStatistics(connection.mServerSide);
+	CHECK(stats.mSentFrames == 1);
+	CHECK(stats.mDroppedFrames == numberOfFrames-2);
+	qint64 frameSize = stats.mSentBytes;
+	CHECK(connection.mServerSide->bytesToWrite() <= frameSize);
+
+	// the newest frame is sent when the buffer is emptied
+	connection.receive(2*frameSize);
+	CHECK(connection.mReceived == 2*frameSize);
+	stats = sender.getStatistics(connection.mServerSide);
+	CHECK(stats.mSentFrames == 2);
+	CHECK(stats.mDroppedFrames == numberOfFrames-2);
+	CHECK(sender.isReady());
+}
+
+TEST_CASE("GrabberSenderQTcpSocket: Frames are sent to several clients", "[resource][videoserver][unit]")
+{
+	QTcpServer server;
+	REQUIRE(server.listen(QHostAddress::LocalHost));
+	Connection fast(&server);
+	Connection slow(&server);
+
+	cx::GrabberSenderQTcpSocket sender;
+	sender.addSocket(fast.mServerSide);
+	sender.addSocket(slow.mServerSide);
+
+	qint64 frameSize = 0;
+	int numberOfFrames = 5;
+	for (int i=0; i<numberOfFrames; ++i)
+	{
+		static_cast<cx::Sender&>(sender).send(createFramePackage(i));
+		frameSize = sender.getStatistics(fast.mServerSide).mSentBytes / (i+1);
+		fast.receive((i+1)*frameSize);
+	}
+
+	CHECK(fast.mReceived == numberOfFrames*frameSize);
+	cx::GrabberSenderClientStatistics fastStats = sender.getStatistics(fast.mServerSide);
+	CHECK(fastStats.mSentFrames == numberOfFrames);
+	CHECK(fastStats.mDroppedFrames == 0);
+
+	// the slow client has received data while the fast one was served, but has not read it.
+	slow.receive(numberOfFrames*frameSize);
+	cx::GrabberSenderClientStatistics slowStats = sender.getStatistics(slow.mServerSide);
+	CHECK(slowStats.mSentFrames + slowStats.mDroppedFrames == numberOfFrames);
+	CHECK(slow.mReceived == slowStats.mSentFrames*frameSize);
+
+	sender.removeSocket(slow.mServerSide);
+	CHECK(sender.getNumberOfClients() == 1);
+}
+
+} // namespace cxtest
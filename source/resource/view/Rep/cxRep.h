@@ -114,6 +114,10 @@ public:
 	 * \return the unique id.
 	 */
 	virtual QString getUid() const = 0;
+	/**Return the time used updating this Rep before the last render,
+	 * in milliseconds. Zero if the Rep was unchanged.
+	 */
+	virtual double getLastUpdateTime() const = 0;
 
 	virtual void printSelf(std::ostream & os, Indent indent) = 0;
 
@@ -36,6 +36,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxView.h"
 #include "vtkCallbackCommand.h"
 #include "vtkRenderer.h"
+#include <QElapsedTimer>
 
 namespace cx
 {
@@ -44,6 +45,7 @@ RepImpl::RepImpl(const QString& uid, const QString& name) :
 	mName(name), mUid(uid)
 {
 	mModified = true;
+	mLastUpdateTime = 0;
 	this->mCallbackCommand = vtkCallbackCommandPtr::New();
 	this->mCallbackCommand->SetClientData(this);
 	this->mCallbackCommand->SetCallback(RepImpl::ProcessEvents);
@@ -68,6 +70,11 @@ QString RepImpl::getUid() const
 	return mUid;
 }
 
+double RepImpl::getLastUpdateTime() const
+{
+	return mLastUpdateTime;
+}
+
 bool RepImpl::isConnectedToView(ViewPtr theView) const
 {
 	return this->getView()==theView;
@@ -124,9 +131,15 @@ void RepImpl::ProcessEvents(vtkObject* vtkNotUsed(object), unsigned long event,
 void RepImpl::onStartRenderPrivate()
 {
 	if (!mModified)
+	{
+		mLastUpdateTime = 0;
 		return;
+	}
+	QElapsedTimer timer;
+	timer.start();
 	this->onModifiedStartRender();
 	mModified = false;
+	mLastUpdateTime = timer.nsecsElapsed()/1.0E6;
 }
 
 void RepImpl::setModified()
@@ -73,6 +73,7 @@ public:
 	void setName(QString name);
 	QString getName() const; ///< \return a reps name
 	QString getUid() const; ///< \return a reps unique id
+	virtual double getLastUpdateTime() const;
 	virtual void printSelf(std::ostream & os, Indent indent);
 
 	/** Usage:
@@ -111,6 +112,7 @@ private:
 										void* clientdata,
 										void* calldata);
 	bool mModified;
+	double mLastUpdateTime; ///< time used in last onModifiedStartRender(), ms
 	vtkCallbackCommandPtr mCallbackCommand;
 	void onStartRenderPrivate();
 	ViewWeakPtr mView;
@@ -132,6 +132,7 @@ void VolumetricRep::setImage(ImagePtr image)
 		mVolumeProperty->setImage(ImagePtr());
 		disconnect(mImage.get(), &Image::vtkImageDataChanged, this, &VolumetricRep::vtkImageDataChangedSlot);
 		disconnect(mImage.get(), &Image::transformChanged, this, &VolumetricRep::transformChangedSlot);
+		disconnect(mImage.get(), &Image::pyramidChanged, this, &VolumetricRep::updateVtkImageDataSlot);
 		mMonitor.reset();
 		mMapper->SetInputData( (vtkImageData*)NULL );
 	}
@@ -142,6 +143,7 @@ void VolumetricRep::setImage(ImagePtr image)
 	{
 		connect(mImage.get(), &Image::vtkImageDataChanged, this, &VolumetricRep::vtkImageDataChangedSlot);
 		connect(mImage.get(), &Image::transformChanged, this, &VolumetricRep::transformChangedSlot);
+		connect(mImage.get(), &Image::pyramidChanged, this, &VolumetricRep::updateVtkImageDataSlot);
 		mVolumeProperty->setImage(mImage);
 		this->vtkImageDataChangedSlot();
 		mMonitor = ImageMapperMonitor::create(mVolume, mImage);
@@ -111,7 +111,7 @@ protected:
 	cx::VolumePropertyPtr mVolumeProperty;
 	vtkVolumeMapperPtr mMapper;
 	vtkVolumePtr mVolume;
-	long mMaxVoxels; ///< always resample volume below this size.
+	long mMaxVoxels; ///< always use a pyramid level below this size.
 
 	ImagePtr mImage;
 	cx::ImageMapperMonitorPtr mMonitor; ///< helper object for visualizing clipping/cropping
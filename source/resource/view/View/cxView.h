@@ -91,6 +91,8 @@ public:
 	virtual vtkRendererPtr getRenderer() const = 0; ///< Get the renderer used by this \a View.
 	virtual vtkRenderWindowPtr getRenderWindow() const = 0;
 	virtual void setModified() = 0;
+	virtual double getLastRenderTime() const = 0; ///< time used by the last render of this view, including rep updates, in ms
+	virtual int getNumberOfRenders() const = 0; ///< number of times this view has been rendered
 	virtual void setBackgroundColor(QColor color) = 0;
 	virtual QSize size() const = 0;
 	virtual void setZoomFactor(double factor) = 0;
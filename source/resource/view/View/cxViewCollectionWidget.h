@@ -38,6 +38,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxView.h"
 #include "cxLayoutData.h"
 #include <QWidget>
+#include <set>
 
 
 class QGridLayout;
@@ -70,6 +71,11 @@ public:
 	virtual void clearViews() = 0;
 	virtual void setModified() = 0;
 	virtual void render() = 0;
+	/**
+	 * Views with uids in this set are not rendered by render(). Views
+	 * sharing a render window with other modified views are rendered anyway.
+	 */
+	void setDeferredViews(const std::set<QString>& uids) { mDeferredViews = uids; }
 	virtual void setGridSpacing(int val) = 0;
 	virtual void setGridMargin(int val) = 0;
     virtual int getGridSpacing() const = 0;
@@ -86,6 +92,8 @@ signals:
     void rendered();
 protected:
 	ViewCollectionWidget(QWidget* parent) : QWidget(parent) {}
+	bool isDeferred(ViewPtr view) const { return mDeferredViews.count(view->getUid()); }
+	std::set<QString> mDeferredViews;
 };
 
 
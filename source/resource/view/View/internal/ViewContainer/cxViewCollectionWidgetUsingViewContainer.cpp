@@ -91,7 +91,7 @@ void ViewCollectionWidgetUsingViewContainer::setModified()
 
 void ViewCollectionWidgetUsingViewContainer::render()
 {
-	mViewContainer->renderAll();
+	mViewContainer->renderAll(mDeferredViews);
     emit rendered();
 }
 
@@ -245,20 +245,35 @@ void ViewContainer::showEvent(QShowEvent* event)
 	inherited_widget::showEvent(event);
 }
 
-void ViewContainer::renderAll()
+void ViewContainer::renderAll(const std::set<QString>& deferred)
 {
 	// First, calculate if anything has changed
 	long hash = 0;
+	std::map<QString, long> viewHashes;
 	for (int i = 0; getGridLayout() && i < getGridLayout()->count(); ++i)
 	{
 		ViewItem *item = this->getViewItem(i);
-		hash += item->getView()->computeTotalMTime();
+		long viewHash = item->getView()->computeTotalMTime();
+		viewHashes[item->getView()->getUid()] = viewHash;
+		hash += viewHash;
 	}
+	if (hash == mMTimeHash)
+		return;
+
+	// Skip if the only changed views are deferred
+	bool changed = deferred.empty();
+	for (std::map<QString, long>::iterator iter=viewHashes.begin(); iter!=viewHashes.end(); ++iter)
+	{
+		if (!deferred.count(iter->first) && (mViewMTimeHashes[iter->first] != iter->second))
+			changed = true;
+	}
+
 	// Then, if anything has changed, render everything anew
-	if (hash != mMTimeHash)
+	if (changed)
 	{
 		this->doRender();
 		mMTimeHash = hash;
+		mViewMTimeHashes = viewHashes;
 
 		QString msg("During rendering of ViewContainer");
 		report_gl_error_text(cstring_cast(msg));
@@ -40,6 +40,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "vtkForwardDeclarations.h"
 #include "QVTKWidget.h"
 #include "cxLayoutData.h"
+#include <set>
+#include <map>
 
 class QGridLayout;
 
@@ -66,7 +68,11 @@ public:
 
 	ViewItem *addView(QString uid, LayoutRegion region, QString name = "");
 	virtual void clear();
-	void renderAll(); ///< Use this function to render all views at once. Do not call render on each view.
+	/**
+	 * Use this function to render all views at once. Do not call render on each view.
+	 * If the only modified views are in deferred, nothing is rendered.
+	 */
+	void renderAll(const std::set<QString>& deferred = std::set<QString>());
 
 	vtkRenderWindowPtr getRenderWindow() { return mRenderWindow; }
 	virtual void setModified();
@@ -88,6 +94,7 @@ protected:
 	ViewItem *mMouseEventTarget;
 	vtkRenderWindowPtr mRenderWindow;
 	unsigned long mMTimeHash; ///< sum of all MTimes in objects rendered
+	std::map<QString, long> mViewMTimeHashes; ///< MTime sum for each view at last render
 	virtual void doRender();
 	ViewItem* getViewItem(int index);
 
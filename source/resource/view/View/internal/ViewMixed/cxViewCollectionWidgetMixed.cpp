@@ -130,10 +130,13 @@ void ViewCollectionWidgetMixed::setModified()
 
 void ViewCollectionWidgetMixed::render()
 {
+	mBaseLayout->setDeferredViews(mDeferredViews);
 	mBaseLayout->render();
 
 	for (unsigned i=0; i<mOverlays.size(); ++i)
 	{
+		if (this->isDeferred(mOverlays[i]->getView()))
+			continue;
 		mOverlays[i]->render();
 	}
 
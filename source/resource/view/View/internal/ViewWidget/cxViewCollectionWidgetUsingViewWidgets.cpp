@@ -113,6 +113,8 @@ void LayoutWidgetUsingViewWidgets::render()
 	for (unsigned i=0; i<mViews.size(); ++i)
 	{
 		ViewWidget* current = mViews[i];
+		if (this->isDeferred(current->getView()))
+			continue;
 		current->render(); // render only changed scenegraph (shaky but smooth)
 	}
 
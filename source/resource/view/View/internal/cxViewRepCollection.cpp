@@ -36,6 +36,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vtkImageData.h>
 #include "vtkRenderWindow.h"
 #include "vtkRenderer.h"
+#include "vtkCallbackCommand.h"
 
 #include "cxRep.h"
 #include "cxTypeConversions.h"
@@ -56,6 +57,12 @@ ViewRepCollection::ViewRepCollection(vtkRenderWindowPtr renderWindow, const QStr
 	mUid = myuid;
 	mName = name;
 	mType = View::VIEW;
+	mLastRenderTime = 0;
+	mNumberOfRenders = 0;
+
+	mRenderTimingCommand = vtkCallbackCommandPtr::New();
+	mRenderTimingCommand->SetClientData(this);
+	mRenderTimingCommand->SetCallback(ViewRepCollection::processRenderEvents);
 
 	this->clear();
 }
@@ -65,7 +72,10 @@ ViewRepCollection::~ViewRepCollection()
 	removeReps();
 
 	if (mRenderer)
+	{
+		mRenderer->RemoveObserver(mRenderTimingCommand);
 		mRenderWindow->RemoveRenderer(mRenderer);
+	}
 }
 
 QString ViewRepCollection::getTypeString() const
@@ -129,13 +139,34 @@ void ViewRepCollection::clear()
 	removeReps();
 
 	if (mRenderer)
+	{
+		mRenderer->RemoveObserver(mRenderTimingCommand);
 		mRenderWindow->RemoveRenderer(mRenderer);
+	}
 
 	mRenderer = vtkRendererPtr::New();
 	mRenderer->SetBackground(mBackgroundColor.redF(), mBackgroundColor.greenF(), mBackgroundColor.blueF());
+	// priority above the reps: start timing before the reps are updated
+	mRenderer->AddObserver(vtkCommand::StartEvent, mRenderTimingCommand, 2.0);
+	mRenderer->AddObserver(vtkCommand::EndEvent, mRenderTimingCommand);
 	mRenderWindow->AddRenderer(mRenderer);
 }
 
+void ViewRepCollection::processRenderEvents(vtkObject* vtkNotUsed(object), unsigned long event, void* clientdata,
+		void* vtkNotUsed(calldata))
+{
+	ViewRepCollection* self = reinterpret_cast<ViewRepCollection*>(clientdata);
+	if (event == vtkCommand::StartEvent)
+	{
+		self->mRenderTimer.start();
+	}
+	else if ((event == vtkCommand::EndEvent) && self->mRenderTimer.isValid())
+	{
+		self->mLastRenderTime = self->mRenderTimer.nsecsElapsed()/1.0E6;
+		++self->mNumberOfRenders;
+	}
+}
+
 void ViewRepCollection::removeReps()
 {
 	for (RepsIter it = mReps.begin(); it != mReps.end(); ++it)
@@ -37,6 +37,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cxForwardDeclarations.h"
 #include "cxView.h"
 #include <QColor>
+#include <QElapsedTimer>
 
 namespace cx
 {
@@ -83,6 +84,8 @@ public:
 	virtual void setBackgroundColor(QColor color);
 
 	virtual void setModified();
+	virtual double getLastRenderTime() const { return mLastRenderTime; }
+	virtual int getNumberOfRenders() const { return mNumberOfRenders; }
 	int computeTotalMTime();
 
 	QColor mBackgroundColor;
@@ -94,6 +97,13 @@ public:
 	typedef std::vector<RepPtr>::iterator RepsIter; ///< Iterator typedef for the internal rep vector.
 	View::Type mType;
 	boost::weak_ptr<class View> mSelf;
+
+private:
+	static void processRenderEvents(vtkObject* object, unsigned long event, void* clientdata, void* calldata);
+	vtkCallbackCommandPtr mRenderTimingCommand; ///< times the renderer using its start and end events
+	QElapsedTimer mRenderTimer;
+	double mLastRenderTime;
+	int mNumberOfRenders;
 };
 
 } // namespace cx
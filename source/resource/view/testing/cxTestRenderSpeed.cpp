@@ -141,6 +141,25 @@ void TestRenderSpeed::testLotsOfViews()
 	this->renderNumTimes(10);
 }
 
+void TestRenderSpeed::testLayout(const cx::LayoutData& layout, int numRenders)
+{
+	mCounter.setName(layout.getUid());
+	this->createViews(layout);
+	this->showViews();
+	this->renderNumTimes(numRenders);
+}
+
+void TestRenderSpeed::createViews(const cx::LayoutData& layout)
+{
+	for (cx::LayoutData::const_iterator iter = layout.begin(); iter != layout.end(); ++iter)
+	{
+		if (!iter->isValid())
+			continue;
+		cx::ViewPtr view = mMainWidget->addView(iter->mType, iter->mRegion);
+		mViews.push_back(view);
+	}
+}
+
 void TestRenderSpeed::createViews(int num)
 {
 	for(int i = 0; i < num; ++i)
@@ -90,11 +90,14 @@ public:
 	void testSingleView();
 	void testSeveralViews();
 	void testLotsOfViews();
+	void testLayout(const cx::LayoutData& layout, int numRenders=100); ///< render all views in layout
 	int getRenderFPS() { return mCounter.getRenderFPS(); }
+	void printResult() { mCounter.printResult(); }
 
 	void showViews();
 	void renderNumTimes(int num);
 	void createViews(int num);
+	void createViews(const cx::LayoutData& layout);
 
 	std::vector<cx::ViewPtr> mViews;
 	boost::shared_ptr<cx::ViewCollectionWidget> mMainWidget;